@@ -0,0 +1,218 @@
+#include "Arena.h"
+#include "meshoptimizer.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+// In front of every arena allocation, enough to roll the top back when it is freed
+struct ArenaHeader
+{
+	uint64_t size; // Including the header
+	uint32_t previousBlock;
+	uint32_t previousTop;
+};
+static_assert(sizeof(ArenaHeader) % ARENA_ALIGNMENT == 0, "Header breaks the alignment");
+
+struct ArenaBlock
+{
+	uint8_t* data;
+	size_t size;
+	size_t base; // Size of all blocks before this one, the arena use is base + top of the current block
+};
+
+static std::atomic<uint64_t> g_liveBytes{ 0 };
+static std::atomic<uint64_t> g_reservedBytes{ 0 };
+static std::atomic<uint64_t> g_peakReservedBytes{ 0 };
+static std::atomic<uint64_t> g_stageAllocations[(int)ArenaStage::Count];
+static std::atomic<uint64_t> g_stageTotalBytes[(int)ArenaStage::Count];
+static std::atomic<uint64_t> g_stagePeakBytes[(int)ArenaStage::Count];
+
+static void AtomicMax(std::atomic<uint64_t>& value, uint64_t candidate)
+{
+	uint64_t current = value.load(std::memory_order_relaxed);
+	while (candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+	{
+	}
+}
+
+struct ThreadArena
+{
+	std::vector<ArenaBlock> blocks;
+	uint32_t block = 0;
+	size_t top = 0;
+	int depth = 0; // Open scopes
+	ArenaStage stage = ArenaStage::None;
+
+	~ThreadArena() { ReleaseBlocks(0); }
+
+	size_t Used() const { return blocks.empty() ? 0 : blocks[block].base + top; }
+
+	void SetTop(uint32_t newBlock, size_t newTop)
+	{
+		size_t before = Used();
+		block = newBlock;
+		top = newTop;
+		g_liveBytes.fetch_add(Used() - before, std::memory_order_relaxed); // Wraps around when it shrinks
+	}
+
+	void ReleaseBlocks(size_t first)
+	{
+		for (size_t b = first; b < blocks.size(); ++b)
+		{
+			g_reservedBytes.fetch_sub(blocks[b].size, std::memory_order_relaxed);
+			free(blocks[b].data);
+		}
+		blocks.resize(std::min(first, blocks.size()));
+	}
+
+	bool Owns(const void* p) const
+	{
+		for (const ArenaBlock& b : blocks)
+		{
+			if (p >= b.data && p < b.data + b.size)
+				return true;
+		}
+		return false;
+	}
+};
+
+static thread_local ThreadArena t_arena;
+
+ArenaScope::ArenaScope(ArenaStage stage)
+{
+	ThreadArena& arena = t_arena;
+	block = arena.block;
+	top = arena.top;
+	previousStage = arena.stage;
+	arena.stage = stage;
+	arena.depth += 1;
+}
+
+ArenaScope::~ArenaScope()
+{
+	ThreadArena& arena = t_arena;
+	arena.SetTop(block, top);
+	arena.stage = previousStage;
+	arena.depth -= 1;
+}
+
+void* ArenaAllocate(size_t size, [[maybe_unused]] size_t alignment)
+{
+	assert(alignment <= ARENA_ALIGNMENT);
+	ThreadArena& arena = t_arena;
+	if (arena.depth == 0)
+		return ::operator new(size);
+
+	size_t total = sizeof(ArenaHeader) + ((size + ARENA_ALIGNMENT - 1) & ~size_t(ARENA_ALIGNMENT - 1));
+	uint32_t block = arena.block;
+	size_t top = arena.top;
+	if (arena.blocks.empty() || top + total > arena.blocks[block].size)
+	{
+		// Next block when it is large enough, otherwise the unused ones are dropped for one that is
+		block = arena.blocks.empty() ? 0 : block + 1;
+		top = 0;
+		if (block < arena.blocks.size() && arena.blocks[block].size < total)
+			arena.ReleaseBlocks(block);
+
+		if (block == arena.blocks.size())
+		{
+			size_t blockSize = std::max<size_t>(ARENA_BLOCK_SIZE, total);
+			if (block > 0)
+				blockSize = std::max(blockSize, arena.blocks.back().size * 2);
+			assert(blockSize <= UINT32_MAX); // Tops are 32 bit in the header
+
+			uint8_t* data = static_cast<uint8_t*>(malloc(blockSize));
+			if (!data)
+				throw std::bad_alloc();
+			size_t base = block > 0 ? arena.blocks.back().base + arena.blocks.back().size : 0;
+			arena.blocks.push_back({ data, blockSize, base });
+			AtomicMax(g_peakReservedBytes, g_reservedBytes.fetch_add(blockSize, std::memory_order_relaxed) + blockSize);
+		}
+	}
+
+	ArenaHeader* header = reinterpret_cast<ArenaHeader*>(arena.blocks[block].data + top);
+	header->size = total;
+	header->previousBlock = arena.block;
+	header->previousTop = (uint32_t)arena.top;
+	arena.SetTop(block, top + total);
+
+	int stage = (int)arena.stage;
+	g_stageAllocations[stage].fetch_add(1, std::memory_order_relaxed);
+	g_stageTotalBytes[stage].fetch_add(size, std::memory_order_relaxed);
+	AtomicMax(g_stagePeakBytes[stage], g_liveBytes.load(std::memory_order_relaxed));
+	return header + 1;
+}
+
+void ArenaFree(void* p)
+{
+	if (!p)
+		return;
+
+	ThreadArena& arena = t_arena;
+	if (!arena.Owns(p))
+	{
+		::operator delete(p);
+		return;
+	}
+
+	// Anything but the last allocation stays until its scope ends
+	ArenaHeader* header = static_cast<ArenaHeader*>(p) - 1;
+	const uint8_t* blockData = arena.blocks[arena.block].data;
+	if (reinterpret_cast<uint8_t*>(header) + header->size == blockData + arena.top)
+		arena.SetTop(header->previousBlock, header->previousTop);
+}
+
+static void* MESHOPTIMIZER_ALLOC_CALLCONV MeshoptArenaAllocate(size_t size)
+{
+	return ArenaAllocate(size);
+}
+
+static void MESHOPTIMIZER_ALLOC_CALLCONV MeshoptArenaFree(void* p)
+{
+	ArenaFree(p);
+}
+
+void InstallMeshoptArena()
+{
+	meshopt_setAllocator(MeshoptArenaAllocate, MeshoptArenaFree);
+}
+
+void ResetArenaStats()
+{
+	for (int s = 0; s < (int)ArenaStage::Count; ++s)
+	{
+		g_stageAllocations[s] = 0;
+		g_stageTotalBytes[s] = 0;
+		g_stagePeakBytes[s] = 0;
+	}
+	g_peakReservedBytes = g_reservedBytes.load();
+}
+
+ArenaStageStats GetArenaStageStats(ArenaStage stage)
+{
+	ArenaStageStats stats;
+	stats.allocations = g_stageAllocations[(int)stage];
+	stats.totalBytes = g_stageTotalBytes[(int)stage];
+	stats.peakBytes = g_stagePeakBytes[(int)stage];
+	return stats;
+}
+
+uint64_t GetArenaPeakReservedBytes()
+{
+	return g_peakReservedBytes;
+}
+
+const char* GetArenaStageName(ArenaStage stage)
+{
+	switch (stage)
+	{
+	case ArenaStage::None: return "none";
+	case ArenaStage::Prepare: return "prepare";
+	case ArenaStage::Meshlets: return "meshlets";
+	case ArenaStage::Simplify: return "simplify";
+	default: return "unknown";
+	}
+}
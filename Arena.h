@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per thread bump allocator for the temporary data of the cook
+// An ArenaScope remembers the top of the calling thread's arena and rolls it back when it ends, so the next work item
+// reuses the same memory instead of going back to the heap. Scopes nest the way ParallelFor items nest on a thread.
+// Everything allocated in a scope has to be gone when it ends and must not be freed on another thread.
+// Freeing only gives memory back when it is the last allocation of the thread, meshoptimizer frees in reverse order so
+// its scratch always is. Outside of a scope allocations go to the heap.
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_BLOCK_SIZE (4 * 1024 * 1024)
+
+// What allocations are counted under, the innermost scope decides
+enum class ArenaStage : uint32_t
+{
+	None,
+	Prepare, // Decoding and optimizing a primitive
+	Meshlets, // First level clusters
+	Simplify, // Merging and simplifying a group, clustering the result
+	Count
+};
+
+struct ArenaStageStats
+{
+	uint64_t allocations = 0;
+	uint64_t totalBytes = 0; // Allocated over the whole cook, freed or not
+	uint64_t peakBytes = 0; // Largest arena use of all threads together while allocating in this stage
+};
+
+struct ArenaScope
+{
+	explicit ArenaScope(ArenaStage stage);
+	~ArenaScope();
+
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+	uint32_t block;
+	size_t top;
+	ArenaStage previousStage;
+};
+
+// Every allocation is ARENA_ALIGNMENT aligned, alignment is only checked against that
+void* ArenaAllocate(size_t size, size_t alignment = ARENA_ALIGNMENT);
+void ArenaFree(void* p);
+
+// Routes the scratch memory of meshoptimizer through the arenas, call before any meshopt function runs
+void InstallMeshoptArena();
+
+void ResetArenaStats();
+ArenaStageStats GetArenaStageStats(ArenaStage stage);
+uint64_t GetArenaPeakReservedBytes(); // Blocks held by all threads together
+const char* GetArenaStageName(ArenaStage stage);
+
+template<class T>
+struct ArenaAllocator
+{
+	using value_type = T;
+
+	ArenaAllocator() = default;
+	template<class U> ArenaAllocator(const ArenaAllocator<U>&) {}
+
+	T* allocate(size_t n)
+	{
+		static_assert(alignof(T) <= ARENA_ALIGNMENT, "Over aligned type");
+		return static_cast<T*>(ArenaAllocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* p, size_t) { ArenaFree(p); }
+
+	template<class U> bool operator==(const ArenaAllocator<U>&) const { return true; }
+	template<class U> bool operator!=(const ArenaAllocator<U>&) const { return false; }
+};
+
+// For temporaries that live inside one ArenaScope, reserve up front since growing leaves the old storage behind
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,1762 @@
+#include "Benchmark.h"
+#include "Log.h"
+#include "ClusterGraph.h"
+#include "LodCut.h"
+#include "Parallel.h"
+#include "SceneFile.h"
+#include "ClusterStreaming.h"
+#include "GltfDecode.h"
+#include "SpatialOrder.h"
+#include "SharedVertices.h"
+#include "PackedTriangles.h"
+#include "MeshletConfig.h"
+#include "SimdMath.h"
+#include "Generator.h"
+
+#include <cstring>
+#include <cstdio>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+
+/*
+ * Cluster adjacency
+ */
+
+// The old way of building the adjacency, testing every cluster against every other cluster
+static void BuildClusterAdjacencyReference(const std::vector<std::vector<uint64_t>>& edgeSets, std::unordered_map<uint64_t, int>& clusterAdjacencyMap)
+{
+	std::vector<std::unordered_set<uint64_t>> edgeHashSets(edgeSets.size());
+	for (size_t ml = 0; ml < edgeSets.size(); ++ml)
+		edgeHashSets[ml].insert(edgeSets[ml].begin(), edgeSets[ml].end());
+
+	for (int ml = 0; ml < edgeSets.size(); ++ml)
+	{
+		for (int ml_inner = ml + 1; ml_inner < edgeSets.size(); ++ml_inner)
+		{
+			int count = 0;
+			for (uint64_t edge : edgeSets[ml_inner])
+			{
+				if (edgeHashSets[ml].contains(edge))
+					count += 1;
+			}
+
+			if (count > 0)
+				clusterAdjacencyMap[PackCluster(ml, ml_inner)] = count;
+		}
+	}
+}
+
+// Lays out the clusters as a grid of square patches with patchSize quads per side
+// and returns the border edges of each patch
+static std::vector<std::vector<uint64_t>> MakeClusterGridEdges(int gridSize, int patchSize)
+{
+	int verticesPerRow = gridSize * patchSize + 1;
+	auto vertexIndex = [verticesPerRow](int x, int y) { return y * verticesPerRow + x; };
+
+	std::vector<std::vector<uint64_t>> edgeSets(gridSize * gridSize);
+	for (int py = 0; py < gridSize; ++py)
+	{
+		for (int px = 0; px < gridSize; ++px)
+		{
+			auto& edgeSet = edgeSets[py * gridSize + px];
+			int x0 = px * patchSize;
+			int y0 = py * patchSize;
+			int x1 = x0 + patchSize;
+			int y1 = y0 + patchSize;
+			for (int i = 0; i < patchSize; ++i)
+			{
+				edgeSet.push_back(PackEdge(vertexIndex(x0 + i, y0), vertexIndex(x0 + i + 1, y0)));
+				edgeSet.push_back(PackEdge(vertexIndex(x0 + i, y1), vertexIndex(x0 + i + 1, y1)));
+				edgeSet.push_back(PackEdge(vertexIndex(x0, y0 + i), vertexIndex(x0, y0 + i + 1)));
+				edgeSet.push_back(PackEdge(vertexIndex(x1, y0 + i), vertexIndex(x1, y0 + i + 1)));
+			}
+		}
+	}
+
+	return edgeSets;
+}
+
+static void BenchmarkClusterAdjacency()
+{
+	Log("Cluster adjacency (grid of clusters, 16 border edges each)\n");
+	Log("%10s %12s %12s %14s\n", "clusters", "pairs", "indexed ms", "all pairs ms");
+
+	const int gridSizes[] = { 32, 64, 128, 256, 512, 1024 }; // 1k to 1M clusters
+	const int maxReferenceGridSize = 128;
+
+	for (int gridSize : gridSizes)
+	{
+		std::vector<std::vector<uint64_t>> edgeSets = MakeClusterGridEdges(gridSize, 4);
+
+		FlatHashMap<int> clusterAdjacencyMap;
+		std::vector<std::pair<int, int>> clusterAdjacencyCount;
+		double start = GetTimeMs();
+		BuildClusterAdjacency(edgeSets, clusterAdjacencyMap, clusterAdjacencyCount);
+		double indexedTime = GetTimeMs() - start;
+
+		if (gridSize <= maxReferenceGridSize)
+		{
+			std::unordered_map<uint64_t, int> referenceMap;
+			start = GetTimeMs();
+			BuildClusterAdjacencyReference(edgeSets, referenceMap);
+			double referenceTime = GetTimeMs() - start;
+
+			bool match = referenceMap.size() == clusterAdjacencyMap.Size();
+			for (auto& iter : referenceMap)
+			{
+				const int* edgeCount = clusterAdjacencyMap.Find(iter.first);
+				match = match && edgeCount && *edgeCount == iter.second;
+			}
+			Log("%10zu %12zu %12.2f %14.2f%s\n", edgeSets.size(), clusterAdjacencyMap.Size(), indexedTime, referenceTime, match ? "" : " MISMATCH");
+		}
+		else
+		{
+			Log("%10zu %12zu %12.2f %14s\n", edgeSets.size(), clusterAdjacencyMap.Size(), indexedTime, "-");
+		}
+	}
+}
+
+/*
+ * Cluster grouping
+ */
+
+static void BenchmarkClusterGrouping()
+{
+	Log("Cluster grouping (grid of clusters)\n");
+	Log("%10s %10s %8s %8s %10s %10s\n", "clusters", "strategy", "groups", "avg", "edge cut", "ms");
+
+	const int gridSizes[] = { 32, 64, 128, 256, 512 };
+	const int maxGreedyGridSize = 64;
+
+	for (int gridSize : gridSizes)
+	{
+		std::vector<std::vector<uint64_t>> edgeSets = MakeClusterGridEdges(gridSize, 4);
+
+		FlatHashMap<int> clusterAdjacencyMap;
+		std::vector<std::pair<int, int>> clusterAdjacencyCount;
+		BuildClusterAdjacency(edgeSets, clusterAdjacencyMap, clusterAdjacencyCount);
+
+		for (ClusterGrouping grouping : { ClusterGrouping::Greedy, ClusterGrouping::Partition })
+		{
+			if (grouping == ClusterGrouping::Greedy && gridSize > maxGreedyGridSize)
+				continue;
+
+			std::vector<MergeCandidate> mergeLists;
+			GroupingStats stats;
+			double start = GetTimeMs();
+			GroupClusters(grouping, (int)edgeSets.size(), clusterAdjacencyMap, clusterAdjacencyCount, mergeLists);
+			stats.timeMs = GetTimeMs() - start;
+			ComputeGroupingStats((int)edgeSets.size(), clusterAdjacencyMap, mergeLists, stats);
+
+			Log("%10d %10s %8d %8.2f %9.1f%% %10.2f\n", stats.clusterCount, GetClusterGroupingName(grouping), stats.groupCount,
+				float(stats.clusterCount) / stats.groupCount, 100.0f * stats.edgeCut / stats.totalEdges, stats.timeMs);
+		}
+	}
+}
+
+/*
+ * LOD cut selection
+ */
+
+// Uses the cooked scene in the working directory, copied out on a grid to scale it up
+static void BenchmarkLodCut()
+{
+	// Instances are copied since they get moved around, the rest is used straight from the mapped file
+	SceneFile sceneFile;
+	std::vector<Instance> sceneInstances;
+	size_t numMeshes = 0, numClusters = 0, numClusterLods = 0;
+	const Mesh* meshes = nullptr;
+	const Cluster* clusters = nullptr;
+	const ClusterLod* clusterLods = nullptr;
+	if (OpenSceneFile(SCENE_FILE_NAME, sceneFile))
+	{
+		meshes = sceneFile.GetSectionView<Mesh>(SceneSectionType::Meshes, numMeshes);
+		clusters = sceneFile.GetSectionView<Cluster>(SceneSectionType::Clusters, numClusters);
+		clusterLods = sceneFile.GetSectionView<ClusterLod>(SceneSectionType::ClusterLods, numClusterLods);
+	}
+	if (!ReadSceneSection(sceneFile, SceneSectionType::Instances, sceneInstances) || !meshes || !clusters || !clusterLods ||
+		sceneInstances.empty() || numClusters != numClusterLods)
+	{
+		Log("LOD cut benchmark needs a cooked scene with LOD data in the working directory, run -generate first\n");
+		return;
+	}
+
+	MinMaxAABB sceneBounds = { float3(FLT_MAX), float3(-FLT_MAX) };
+	for (const Instance& instance : sceneInstances)
+	{
+		sceneBounds.Min = min(sceneBounds.Min, instance.Box.Center - instance.Box.Extents);
+		sceneBounds.Max = max(sceneBounds.Max, instance.Box.Center + instance.Box.Extents);
+	}
+	float3 sceneSize = sceneBounds.Max - sceneBounds.Min;
+	float spacing = std::max(sceneSize.x, sceneSize.z) * 1.1f;
+
+	UINT fullDetailTriangles = 0;
+	for (const Instance& instance : sceneInstances)
+	{
+		const Mesh& mesh = meshes[instance.MeshIndex];
+		for (UINT ic = mesh.ClusterStart; ic < mesh.ClusterStart + mesh.LodClusterCount; ++ic)
+			if (clusterLods[ic].Group == LOD_GROUP_NONE)
+				fullDetailTriangles += clusters[ic].PrimitiveCount;
+	}
+
+	InitializeParallel(0);
+	Log("LOD cut selection, %d threads, camera at the corner of a grid of scene copies\n", GetParallelThreadCount());
+	Log("%10s %10s %10s %12s %14s %14s %10s\n", "copies", "instances", "threshold", "clusters", "triangles", "full detail", "ms");
+
+	const int gridSizes[] = { 1, 4, 16, 32 };
+	const float thresholds[] = { 0.5f, 1.0f, 4.0f };
+	for (int gridSize : gridSizes)
+	{
+		std::vector<Instance> instances;
+		instances.reserve(sceneInstances.size() * gridSize * gridSize);
+		for (int z = 0; z < gridSize; ++z)
+		{
+			for (int x = 0; x < gridSize; ++x)
+			{
+				float3 offset = float3(x * spacing, 0.0f, z * spacing);
+				for (Instance instance : sceneInstances)
+				{
+					instance.ModelMatrix.m41 += offset.x;
+					instance.ModelMatrix.m43 += offset.z;
+					instance.Box.Center += offset;
+					instances.push_back(instance);
+				}
+			}
+		}
+
+		LodCutScene scene;
+		scene.instances = instances.data();
+		scene.numInstances = (UINT)instances.size();
+		scene.meshes = meshes;
+		scene.clusters = clusters;
+		scene.clusterLods = clusterLods;
+
+		for (float threshold : thresholds)
+		{
+			// 60 degree field of view on a 720 pixel high viewport
+			LodCutParams params;
+			params.cameraPosition = sceneBounds.Min - float3(sceneSize.x, -sceneSize.y, sceneSize.z) * 0.5f;
+			params.projectionScale = 720.0f * 0.5f / tanf(3.14159265f / 6.0f);
+			params.errorThreshold = threshold;
+
+			// Best of a few runs
+			LodCut cut;
+			double bestTime = DBL_MAX;
+			for (int run = 0; run < 5; ++run)
+			{
+				SelectLodCut(scene, params, cut);
+				bestTime = std::min(bestTime, cut.timeMs);
+			}
+
+			Log("%10d %10u %10.1f %12zu %14u %14llu %10.3f\n", gridSize * gridSize, scene.numInstances, threshold,
+				cut.selectedClusters.size(), cut.triangleCount, (unsigned long long)fullDetailTriangles * gridSize * gridSize, bestTime);
+		}
+	}
+
+	ShutdownParallel();
+}
+
+/*
+ * Stream compression
+ */
+
+// The index codec may rotate the vertices of a triangle, so compare triangles by their rotation starting at the smallest index
+static bool SameTriangles(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	auto rotate = [](const uint8_t* data, size_t t, uint32_t tri[3])
+	{
+		uint32_t packed;
+		memcpy(&packed, data + t * sizeof(uint32_t), sizeof(uint32_t));
+		UnpackTriangle(packed, tri);
+		while (tri[0] > tri[1] || tri[0] > tri[2])
+			std::rotate(tri, tri + 1, tri + 3);
+	};
+
+	for (size_t t = 0; t < a.size() / sizeof(uint32_t); ++t)
+	{
+		uint32_t ta[3], tb[3];
+		rotate(a.data(), t, ta);
+		rotate(b.data(), t, tb);
+		if (memcmp(ta, tb, sizeof(ta)) != 0)
+			return false;
+	}
+	return true;
+}
+
+// Encodes the vertex and index streams of the cooked scene and decodes them on 1 to all threads
+static void BenchmarkStreamCodec()
+{
+	struct StreamSection
+	{
+		const char* name;
+		SceneSectionType type;
+		StreamCodec codec;
+	};
+
+	const StreamSection streamSections[] = {
+		{ "positions", SceneSectionType::Positions, StreamCodec::Vertex },
+		{ "normals", SceneSectionType::Normals, StreamCodec::Vertex },
+		{ "tangents", SceneSectionType::Tangents, StreamCodec::Vertex },
+		{ "texcoords", SceneSectionType::Texcoords, StreamCodec::Vertex },
+		{ "indices", SceneSectionType::Indices, StreamCodec::Index },
+	};
+
+	SceneFile sceneFile;
+	std::vector<std::vector<uint8_t>> streams(std::size(streamSections));
+	std::vector<size_t> elementSizes(std::size(streamSections));
+	bool loaded = OpenSceneFile(SCENE_FILE_NAME, sceneFile);
+	for (size_t i = 0; i < streams.size() && loaded; ++i)
+	{
+		// Compressed sections are decoded, so this always starts from the plain streams
+		const SceneSection* section = sceneFile.FindSection(streamSections[i].type);
+		loaded = section && ReadSceneSection(sceneFile, streamSections[i].type, section->stride, streams[i]) && !streams[i].empty();
+		elementSizes[i] = section ? section->stride : 0;
+	}
+
+	if (!loaded)
+	{
+		Log("Stream codec benchmark needs a cooked scene in the working directory, run -generate first\n");
+		return;
+	}
+	bool quantized = sceneFile.FindSection(SceneSectionType::Positions)->format == VERTEX_FORMAT_QUANTIZED;
+
+	InitializeParallel(0);
+	int maxThreads = GetParallelThreadCount();
+	ShutdownParallel();
+
+	Log("Stream codec, %s vertices, blocks of %d elements\n", quantized ? "quantized" : "float", STREAM_BLOCK_ELEMENTS);
+	Log("%16s %12s %12s %8s %12s\n", "stream", "raw", "compressed", "ratio", "encode ms");
+
+	size_t totalRaw = 0;
+	size_t totalCompressed = 0;
+	std::vector<std::vector<StreamBlock>> blocks(streams.size());
+	std::vector<std::vector<uint8_t>> compressed(streams.size());
+	InitializeParallel(0);
+	for (size_t i = 0; i < streams.size(); ++i)
+	{
+		double start = GetTimeMs();
+		EncodeStream(streamSections[i].codec, streams[i].data(), elementSizes[i], streams[i].size() / elementSizes[i], blocks[i], compressed[i]);
+		double encodeMs = GetTimeMs() - start;
+
+		totalRaw += streams[i].size();
+		totalCompressed += compressed[i].size();
+		Log("%16s %12zu %12zu %7.2fx %12.2f\n", streamSections[i].name, streams[i].size(), compressed[i].size(), double(streams[i].size()) / compressed[i].size(), encodeMs);
+	}
+	ShutdownParallel();
+	Log("%16s %12zu %12zu %7.2fx\n", "total", totalRaw, totalCompressed, double(totalRaw) / totalCompressed);
+
+	Log("%10s %12s %12s %16s\n", "threads", "decode ms", "GB/s", "GB/s per core");
+	std::vector<std::vector<uint8_t>> decoded(streams.size());
+	for (size_t i = 0; i < streams.size(); ++i)
+		decoded[i].resize(streams[i].size());
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		InitializeParallel(threads);
+
+		// Best of a few runs
+		double bestTime = DBL_MAX;
+		for (int run = 0; run < 5; ++run)
+		{
+			bool success = true;
+			double start = GetTimeMs();
+			for (size_t i = 0; i < streams.size(); ++i)
+				success &= DecodeStream(blocks[i].data(), blocks[i].size(), elementSizes[i], compressed[i].data(), compressed[i].size(), decoded[i].data(), decoded[i].size());
+			bestTime = std::min(bestTime, GetTimeMs() - start);
+
+			for (size_t i = 0; i < streams.size(); ++i)
+			{
+				if (!success || !(streamSections[i].codec == StreamCodec::Index ? SameTriangles(decoded[i], streams[i]) : decoded[i] == streams[i]))
+				{
+					Log("%s does not round trip\n", streamSections[i].name);
+					ShutdownParallel();
+					return;
+				}
+			}
+		}
+
+		double gbPerSecond = totalRaw / (bestTime / 1000.0) / 1e9;
+		Log("%10d %12.2f %12.2f %16.2f\n", threads, bestTime, gbPerSecond, gbPerSecond / threads);
+
+		ShutdownParallel();
+	}
+}
+
+/*
+ * Scene loading
+ */
+
+// The CPU side sections the renderer needs
+static const SceneSectionType g_cpuSceneSections[] = { SceneSectionType::Instances, SceneSectionType::Meshes, SceneSectionType::Clusters, SceneSectionType::ClusterLods };
+
+#if defined(_WIN32)
+#define fseek64 _fseeki64
+#else
+#define fseek64 fseeko
+#endif
+
+static volatile uint64_t g_touchSink = 0;
+
+// Reads a byte from every page so all of them are faulted in, like the first pass over the clusters does
+static void TouchPages(const uint8_t* data, size_t size)
+{
+	uint64_t sum = 0;
+	for (size_t i = 0; i < size; i += 4096)
+		sum += data[i];
+	g_touchSink += sum;
+}
+
+// Loads the CPU side sections of the cooked scene a few times, copying them into allocations and mapping the file
+static void BenchmarkSceneLoad()
+{
+	std::vector<SceneSection> sections;
+	{
+		SceneFile sceneFile;
+		if (!OpenSceneFile(SCENE_FILE_NAME, sceneFile))
+		{
+			Log("Scene load benchmark needs a cooked scene in the working directory, run -generate first\n");
+			return;
+		}
+
+		for (SceneSectionType type : g_cpuSceneSections)
+		{
+			const SceneSection* section = sceneFile.FindSection(type);
+			if (section)
+				sections.push_back(*section);
+		}
+	}
+
+	size_t cpuBytes = 0;
+	for (const SceneSection& section : sections)
+		cpuBytes += (size_t)section.size;
+
+	const int reloads = 8;
+	const double mb = 1024.0 * 1024.0;
+	Log("Scene load, %.1f MB of CPU side sections, %d reloads, page cache is warm\n", cpuBytes / mb, reloads);
+	Log("%10s %12s %12s %20s %20s\n", "method", "load ms", "touch ms", "RSS first load MB", "RSS all reloads MB");
+
+	// Copy into allocations, what ReloadScene used to do (minus leaking the previous copy)
+	{
+		size_t startRss = GetMemoryUsage();
+		size_t firstRss = 0;
+		std::vector<void*> allocations;
+		double loadMs = 0.0;
+		double touchMs = 0.0;
+		for (int reload = 0; reload < reloads; ++reload)
+		{
+			for (void* data : allocations)
+				free(data);
+			allocations.clear();
+
+			double start = GetTimeMs();
+			FILE* file = fopen(SCENE_FILE_NAME, "rb");
+			for (const SceneSection& section : sections)
+			{
+				void* data = malloc((size_t)section.size);
+				fseek64(file, (long long)section.offset, SEEK_SET);
+				fread(data, 1, (size_t)section.size, file);
+				allocations.push_back(data);
+			}
+			fclose(file);
+			loadMs += GetTimeMs() - start;
+
+			start = GetTimeMs();
+			for (size_t i = 0; i < sections.size(); ++i)
+				TouchPages((const uint8_t*)allocations[i], (size_t)sections[i].size);
+			touchMs += GetTimeMs() - start;
+
+			if (reload == 0)
+				firstRss = GetMemoryUsage();
+		}
+		size_t endRss = GetMemoryUsage();
+		Log("%10s %12.2f %12.2f %20.1f %20.1f\n", "copy", loadMs / reloads, touchMs / reloads, (firstRss - startRss) / mb, (endRss - startRss) / mb);
+
+		for (void* data : allocations)
+			free(data);
+	}
+
+	// Mapped, every reload replaces the previous mapping
+	{
+		size_t startRss = GetMemoryUsage();
+		size_t firstRss = 0;
+		SceneFile sceneFile;
+		double loadMs = 0.0;
+		double touchMs = 0.0;
+		for (int reload = 0; reload < reloads; ++reload)
+		{
+			double start = GetTimeMs();
+			OpenSceneFile(SCENE_FILE_NAME, sceneFile);
+			loadMs += GetTimeMs() - start;
+
+			start = GetTimeMs();
+			for (const SceneSection& section : sections)
+				TouchPages(sceneFile.file.data + section.offset, (size_t)section.size);
+			touchMs += GetTimeMs() - start;
+
+			if (reload == 0)
+				firstRss = GetMemoryUsage();
+		}
+		size_t endRss = GetMemoryUsage();
+		Log("%10s %12.2f %12.2f %20.1f %20.1f\n", "mapped", loadMs / reloads, touchMs / reloads, (firstRss - startRss) / mb, (endRss - startRss) / mb);
+	}
+}
+
+/*
+ * Cluster streaming
+ */
+
+struct StreamingCamera
+{
+	float3 position;
+	float3 forward;
+};
+
+// Rough view test, cone around the forward direction that covers a 60 degree vertical field of view at 16:9
+static bool IsInViewCone(const StreamingCamera& camera, const CenterExtentsAABB& box)
+{
+	const float halfAngle = 0.95f;
+	float3 toBox = box.Center - camera.position;
+	float distance = length(toBox);
+	float radius = length(box.Extents);
+	if (distance <= radius)
+		return true;
+	float angle = acosf(std::clamp(dot(toBox, camera.forward) / distance, -1.0f, 1.0f));
+	return angle - asinf(radius / distance) <= halfAngle;
+}
+
+// Drives the page streamer over camera paths through a grid of copies of the cooked scene.
+// Pages are read from the scene file into a CPU pool, so this measures the real read volume without a GPU.
+static void BenchmarkClusterStreaming()
+{
+	SceneFile sceneFile;
+	std::vector<Instance> sceneInstances;
+	size_t numMeshes = 0, numClusters = 0, numClusterLods = 0, numPages = 0;
+	const Mesh* meshes = nullptr;
+	const Cluster* clusters = nullptr;
+	const ClusterLod* clusterLods = nullptr;
+	const ClusterPage* pages = nullptr;
+	if (OpenSceneFile(SCENE_FILE_NAME, sceneFile))
+	{
+		meshes = sceneFile.GetSectionView<Mesh>(SceneSectionType::Meshes, numMeshes);
+		clusters = sceneFile.GetSectionView<Cluster>(SceneSectionType::Clusters, numClusters);
+		clusterLods = sceneFile.GetSectionView<ClusterLod>(SceneSectionType::ClusterLods, numClusterLods);
+		pages = sceneFile.GetSectionView<ClusterPage>(SceneSectionType::Pages, numPages);
+	}
+	if (!ReadSceneSection(sceneFile, SceneSectionType::Instances, sceneInstances) || !meshes || !clusters || !clusterLods || !pages ||
+		sceneInstances.empty() || numPages == 0)
+	{
+		Log("Streaming benchmark needs a cooked scene with pages in the working directory, run -generate with -pages first\n");
+		return;
+	}
+
+	size_t totalPageBytes = 0;
+	for (size_t p = 0; p < numPages; ++p)
+		totalPageBytes += pages[p].size;
+
+	MinMaxAABB sceneBounds = { float3(FLT_MAX), float3(-FLT_MAX) };
+	for (const Instance& instance : sceneInstances)
+	{
+		sceneBounds.Min = min(sceneBounds.Min, instance.Box.Center - instance.Box.Extents);
+		sceneBounds.Max = max(sceneBounds.Max, instance.Box.Center + instance.Box.Extents);
+	}
+	float3 sceneSize = sceneBounds.Max - sceneBounds.Min;
+	float spacing = std::max(sceneSize.x, sceneSize.z) * 1.1f;
+
+	// Copies share their pages, they spread the same data over distance so the LOD cut varies along the path
+	const int gridSize = 8;
+	std::vector<Instance> instances;
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			float3 offset = float3(x * spacing, 0.0f, z * spacing);
+			for (Instance instance : sceneInstances)
+			{
+				instance.ModelMatrix.m41 += offset.x;
+				instance.ModelMatrix.m43 += offset.z;
+				instance.Box.Center += offset;
+				instances.push_back(instance);
+			}
+		}
+	}
+
+	LodCutScene scene;
+	scene.instances = instances.data();
+	scene.numInstances = (UINT)instances.size();
+	scene.meshes = meshes;
+	scene.clusters = clusters;
+	scene.clusterLods = clusterLods;
+
+	float3 gridMin = sceneBounds.Min;
+	float3 gridSize3 = float3(spacing * gridSize, sceneSize.y, spacing * gridSize);
+	float3 gridCenter = gridMin + gridSize3 * 0.5f;
+	float height = sceneBounds.Max.y + sceneSize.y * 0.5f;
+
+	const int numFrames = 300;
+	auto flyover = [&](int frame)
+	{
+		// Low pass along the diagonal of the grid
+		float t = float(frame) / (numFrames - 1);
+		StreamingCamera camera;
+		camera.position = float3(gridMin.x + gridSize3.x * t, height, gridMin.z + gridSize3.z * t);
+		camera.forward = normalize(float3(1.0f, -0.25f, 1.0f));
+		return camera;
+	};
+	auto orbit = [&](int frame)
+	{
+		// Circle around the grid looking at the center
+		float angle = 2.0f * 3.14159265f * frame / numFrames;
+		float radius = gridSize3.x * 0.6f;
+		StreamingCamera camera;
+		camera.position = gridCenter + float3(cosf(angle) * radius, height - gridCenter.y, sinf(angle) * radius);
+		camera.forward = normalize(gridCenter - camera.position);
+		return camera;
+	};
+	auto turn = [&](int frame)
+	{
+		// Standing in the middle of the grid turning around, what comes into view was just evicted
+		float angle = 2.0f * 3.14159265f * frame / (numFrames / 2);
+		StreamingCamera camera;
+		camera.position = float3(gridCenter.x, height, gridCenter.z);
+		camera.forward = float3(cosf(angle), -0.25f, sinf(angle));
+		camera.forward = normalize(camera.forward);
+		return camera;
+	};
+
+	struct CameraPath
+	{
+		const char* name;
+		std::function<StreamingCamera(int)> camera;
+	};
+	const CameraPath paths[] = { { "flyover", flyover }, { "orbit", orbit }, { "turn", turn } };
+	const float poolFractions[] = { 1.0f, 0.5f, 0.25f, 0.1f };
+	const uint32_t loadsPerFrame = 64;
+
+	InitializeParallel(0);
+	const double mb = 1024.0 * 1024.0;
+	Log("Cluster streaming, %zu pages of up to %d vertices and %d triangles, %.1f MB, %d copies, %d frames per path, %u loads per frame\n",
+		numPages, CLUSTER_PAGE_VERTICES, CLUSTER_PAGE_TRIANGLES, totalPageBytes / mb, gridSize * gridSize, numFrames, loadsPerFrame);
+	Log("%10s %8s %10s %10s %8s %10s %10s %12s %12s %10s %10s\n", "path", "pool", "requests", "hit rate", "loads", "evictions", "deferred",
+		"MB/frame", "max MB/frame", "update ms", "read ms");
+
+	for (const CameraPath& path : paths)
+	{
+		// The requests only depend on the camera, so they are the same for every pool size
+		std::vector<std::vector<uint32_t>> frameRequests(numFrames);
+		for (int frame = 0; frame < numFrames; ++frame)
+		{
+			StreamingCamera camera = path.camera(frame);
+
+			LodCutParams params;
+			params.cameraPosition = camera.position;
+			params.projectionScale = 720.0f * 0.5f / tanf(3.14159265f / 6.0f);
+			params.errorThreshold = 1.0f;
+
+			LodCut cut;
+			SelectLodCut(scene, params, cut);
+
+			for (const std::pair<UINT, UINT>& selected : cut.selectedClusters)
+			{
+				const Cluster& cluster = clusters[selected.second];
+				if (IsInViewCone(camera, TransformAABB(cluster.Box, instances[selected.first].ModelMatrix)))
+					frameRequests[frame].push_back(cluster.Page);
+			}
+		}
+
+		for (float poolFraction : poolFractions)
+		{
+			uint32_t slotCount = std::max(1u, uint32_t(numPages * poolFraction));
+
+			PageFileLoader loader;
+			if (!loader.Open(SCENE_FILE_NAME, sceneFile, slotCount))
+			{
+				Log("Can't open %s for streaming\n", SCENE_FILE_NAME);
+				ShutdownParallel();
+				return;
+			}
+
+			ClusterPageStreamer streamer;
+			streamer.Initialize(pages, (uint32_t)numPages, slotCount, loadsPerFrame, 2);
+
+			ClusterStreamingStats total;
+			uint64_t maxFrameBytes = 0;
+			double updateMs = 0.0;
+			double readMs = 0.0;
+			bool failed = false;
+			for (int frame = 0; frame < numFrames; ++frame)
+			{
+				ClusterStreamingStats frameStats;
+				double frameReadMs = 0.0;
+				double start = GetTimeMs();
+				streamer.Update(frameRequests[frame].data(), frameRequests[frame].size(), [&](uint32_t page, uint32_t slot)
+				{
+					double readStart = GetTimeMs();
+					failed |= !loader.Load(pages[page], slot);
+					frameReadMs += GetTimeMs() - readStart;
+				}, frameStats);
+				updateMs += GetTimeMs() - start - frameReadMs;
+				readMs += frameReadMs;
+
+				total.Add(frameStats);
+				maxFrameBytes = std::max(maxFrameBytes, frameStats.bytesStreamed);
+			}
+
+			if (failed)
+				Log("Reading pages from %s failed\n", SCENE_FILE_NAME);
+
+			char pool[16];
+			snprintf(pool, sizeof(pool), "%d%%", int(poolFraction * 100.0f + 0.5f));
+			Log("%10s %8s %10llu %9.1f%% %8llu %10llu %10llu %12.3f %12.3f %10.3f %10.3f\n", path.name, pool,
+				(unsigned long long)total.requests, total.requests ? 100.0 * total.hits / total.requests : 0.0,
+				(unsigned long long)total.loads, (unsigned long long)total.evictions, (unsigned long long)total.deferred,
+				total.bytesStreamed / mb / numFrames, maxFrameBytes / mb, updateMs / numFrames, readMs / numFrames);
+		}
+	}
+
+	ShutdownParallel();
+}
+
+/*
+ * glTF accessor decoding
+ */
+
+#define DECODE_BENCHMARK_VERTICES 100000000
+#define DECODE_BENCHMARK_BATCH 4000000 // Vertices decoded per call, the whole input would not fit in memory
+
+struct DecodeBenchmarkAttribute
+{
+	cgltf_component_type componentType;
+	cgltf_type type;
+	bool normalized;
+	size_t offset; // In the interleaved source vertex
+	size_t components; // Written per vertex
+	size_t outOffset; // In the decoded vertex
+};
+
+struct DecodeBenchmarkLayout
+{
+	const char* name;
+	size_t stride;
+	DecodeBenchmarkAttribute attributes[4];
+};
+
+// Decodes DECODE_BENCHMARK_VERTICES through all kernels, from an interleaved float layout and from a KHR_mesh_quantization style one
+static void BenchmarkAccessorDecode()
+{
+	// Same layout as the generator's vertex: position, normal, tangent, texcoord
+	const size_t outStride = 12 * sizeof(float);
+	const DecodeBenchmarkLayout layouts[] = {
+		{ "float", 48, {
+			{ cgltf_component_type_r_32f, cgltf_type_vec3, false, 0, 3, 0 },
+			{ cgltf_component_type_r_32f, cgltf_type_vec3, false, 12, 3, 12 },
+			{ cgltf_component_type_r_32f, cgltf_type_vec4, false, 24, 4, 24 },
+			{ cgltf_component_type_r_32f, cgltf_type_vec2, false, 40, 2, 40 } } },
+		{ "quantized", 20, {
+			{ cgltf_component_type_r_16u, cgltf_type_vec3, false, 0, 3, 0 },
+			{ cgltf_component_type_r_8, cgltf_type_vec3, true, 8, 3, 12 },
+			{ cgltf_component_type_r_8, cgltf_type_vec4, true, 12, 4, 24 },
+			{ cgltf_component_type_r_16u, cgltf_type_vec2, true, 16, 2, 40 } } },
+	};
+	const DecodeKernel kernels[] = { DecodeKernel::Scalar, DecodeKernel::Sse2, DecodeKernel::Avx2 };
+
+	// Random bits are valid values for every component type, as long as floats stay finite
+	uint64_t seed = 1;
+	auto random = [&]()
+	{
+		seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+		return uint32_t(seed >> 32);
+	};
+
+	Log("Accessor decoding, %d million vertices in batches of %d, %s kernels available\n", DECODE_BENCHMARK_VERTICES / 1000000, DECODE_BENCHMARK_BATCH,
+		GetDecodeKernelName(GetDecodeKernel(DecodeKernel::Best)));
+	Log("%12s %10s %8s %12s %12s %12s\n", "input", "order", "kernel", "ms", "Mverts/s", "GB/s read");
+
+	std::vector<uint8_t> decoded(DECODE_BENCHMARK_BATCH * outStride);
+	std::vector<uint8_t> reference(decoded.size());
+	for (const DecodeBenchmarkLayout& layout : layouts)
+	{
+		std::vector<uint8_t> source(DECODE_BENCHMARK_BATCH * layout.stride);
+		for (size_t i = 0; i < source.size(); i += 4)
+		{
+			uint32_t bits = random();
+			memcpy(source.data() + i, &bits, std::min<size_t>(4, source.size() - i));
+		}
+		if (layout.attributes[0].componentType == cgltf_component_type_r_32f)
+		{
+			float* floats = (float*)source.data();
+			for (size_t i = 0; i < source.size() / sizeof(float); ++i)
+				floats[i] = float(random() % 20001) * 0.0001f - 1.0f;
+		}
+
+		cgltf_buffer buffer = {};
+		buffer.size = source.size();
+		buffer.data = source.data();
+		cgltf_buffer_view view = {};
+		view.buffer = &buffer;
+		view.size = source.size();
+		view.stride = layout.stride;
+
+		cgltf_accessor accessors[4] = {};
+		for (int a = 0; a < 4; ++a)
+		{
+			accessors[a].component_type = layout.attributes[a].componentType;
+			accessors[a].type = layout.attributes[a].type;
+			accessors[a].normalized = layout.attributes[a].normalized;
+			accessors[a].offset = layout.attributes[a].offset;
+			accessors[a].count = DECODE_BENCHMARK_BATCH;
+			accessors[a].stride = layout.stride;
+			accessors[a].buffer_view = &view;
+		}
+
+		AccessorDecodeTarget targets[4];
+		for (int a = 0; a < 4; ++a)
+			targets[a] = { &accessors[a], layout.attributes[a].components, layout.attributes[a].outOffset };
+
+		// One whole pass per attribute against all attributes a block of vertices at a time
+		for (bool blocked : { false, true })
+		{
+			for (DecodeKernel kernel : kernels)
+			{
+				if (GetDecodeKernel(kernel) != kernel)
+					continue;
+
+				double start = GetTimeMs();
+				for (size_t batch = 0; batch < DECODE_BENCHMARK_VERTICES / DECODE_BENCHMARK_BATCH; ++batch)
+				{
+					if (blocked)
+					{
+						DecodeAccessorsInterleaved(targets, 4, DECODE_BENCHMARK_BATCH, decoded.data(), outStride, kernel);
+						continue;
+					}
+					for (int a = 0; a < 4; ++a)
+						DecodeAccessorFloats(&accessors[a], layout.attributes[a].components, (float*)(decoded.data() + layout.attributes[a].outOffset), outStride, kernel);
+				}
+				double ms = GetTimeMs() - start;
+
+				if (kernel == DecodeKernel::Scalar && !blocked)
+					reference = decoded;
+				bool same = decoded == reference;
+
+				Log("%12s %10s %8s %12.2f %12.1f %12.2f%s\n", layout.name, blocked ? "blocked" : "per stream", GetDecodeKernelName(kernel), ms, DECODE_BENCHMARK_VERTICES / (ms * 1000.0),
+					double(DECODE_BENCHMARK_VERTICES) * layout.stride / (ms / 1000.0) / 1e9, same ? "" : "  does not match scalar");
+			}
+		}
+	}
+
+	// Three indices per vertex, roughly what a triangle mesh has
+	for (cgltf_component_type componentType : { cgltf_component_type_r_8u, cgltf_component_type_r_16u })
+	{
+		size_t indexSize = cgltf_component_size(componentType);
+		std::vector<uint8_t> source(3 * DECODE_BENCHMARK_BATCH * indexSize);
+		for (size_t i = 0; i < source.size(); ++i)
+			source[i] = uint8_t(random());
+
+		cgltf_buffer buffer = {};
+		buffer.size = source.size();
+		buffer.data = source.data();
+		cgltf_buffer_view view = {};
+		view.buffer = &buffer;
+		view.size = source.size();
+		cgltf_accessor accessor = {};
+		accessor.component_type = componentType;
+		accessor.type = cgltf_type_scalar;
+		accessor.count = 3 * DECODE_BENCHMARK_BATCH;
+		accessor.stride = indexSize;
+		accessor.buffer_view = &view;
+
+		std::vector<uint32_t> indices(accessor.count);
+		std::vector<uint32_t> referenceIndices;
+		for (DecodeKernel kernel : kernels)
+		{
+			if (GetDecodeKernel(kernel) != kernel)
+				continue;
+
+			double start = GetTimeMs();
+			for (size_t batch = 0; batch < DECODE_BENCHMARK_VERTICES / DECODE_BENCHMARK_BATCH; ++batch)
+				DecodeAccessorIndices(&accessor, indices.data(), kernel);
+			double ms = GetTimeMs() - start;
+
+			if (kernel == DecodeKernel::Scalar)
+				referenceIndices = indices;
+			bool same = indices == referenceIndices;
+
+			Log("%12s %10s %8s %12.2f %12.1f %12.2f%s\n", indexSize == 1 ? "indices u8" : "indices u16", "", GetDecodeKernelName(kernel), ms,
+				DECODE_BENCHMARK_VERTICES / (ms * 1000.0), 3.0 * DECODE_BENCHMARK_VERTICES * indexSize / (ms / 1000.0) / 1e9, same ? "" : "  does not match scalar");
+		}
+	}
+}
+
+/*
+ * Spatial order
+ */
+
+#define CACHE_LINE_SIZE 64
+
+// Set associative cache with LRU replacement, counts the misses of a loop without hardware counters
+struct CacheModel
+{
+	size_t ways = 0;
+	size_t sets = 0;
+	std::vector<uint64_t> lines; // Tags per set, most recently used first
+	uint64_t misses = 0;
+
+	CacheModel(size_t size, size_t ways_) : ways(ways_), sets(size / (CACHE_LINE_SIZE * ways_)), lines(sets * ways_, ~0ull) {}
+
+	void Touch(const void* address, size_t size)
+	{
+		uint64_t first = uint64_t(address) / CACHE_LINE_SIZE;
+		uint64_t last = (uint64_t(address) + size - 1) / CACHE_LINE_SIZE;
+		for (uint64_t line = first; line <= last; ++line)
+		{
+			uint64_t* set = &lines[(line % sets) * ways];
+			size_t way = 0;
+			while (way < ways && set[way] != line)
+				++way;
+			if (way == ways)
+			{
+				misses += 1;
+				way = ways - 1;
+			}
+			memmove(set + 1, set, way * sizeof(uint64_t));
+			set[0] = line;
+		}
+	}
+};
+
+struct SpatialBenchmarkScene
+{
+	std::vector<Instance> instances;
+	std::vector<Cluster> clusters;
+	std::vector<ClusterLod> clusterLods;
+	std::vector<uint8_t> positions;
+};
+
+struct SpatialBenchmarkFrame
+{
+	UINT visibleInstances = 0;
+	UINT testedClusters = 0;
+	UINT visibleClusters = 0;
+	uint64_t checksum = 0;
+	double cullMs = 0.0;
+	double fetchMs = 0.0;
+};
+
+// The culling loop of Draw(), instances then the default level clusters of the visible ones, then a fetch of the positions
+// of the visible clusters like the rasterizer does. The caches see every access when they are given.
+template<bool CountMisses>
+static SpatialBenchmarkFrame CullSpatialBenchmarkFrame(const SpatialBenchmarkScene& scene, const std::vector<Mesh>& meshes, size_t positionStride,
+	const StreamingCamera& camera, std::vector<std::pair<UINT, UINT>>& visible, CacheModel* l1, CacheModel* l2)
+{
+	auto touch = [&](const void* address, size_t size)
+	{
+		if constexpr (CountMisses)
+		{
+			l1->Touch(address, size);
+			l2->Touch(address, size);
+		}
+	};
+
+	SpatialBenchmarkFrame frame;
+	double start = GetTimeMs();
+	visible.clear();
+	for (UINT i = 0; i < scene.instances.size(); ++i)
+	{
+		const Instance& instance = scene.instances[i];
+		touch(&instance, sizeof(Instance));
+		if (!IsInViewCone(camera, instance.Box))
+			continue;
+
+		frame.visibleInstances += 1;
+		const Mesh& mesh = meshes[instance.MeshIndex];
+		touch(&mesh, sizeof(Mesh));
+		frame.testedClusters += mesh.ClusterCount;
+		for (UINT c = mesh.ClusterStart; c < mesh.ClusterStart + mesh.ClusterCount; ++c)
+		{
+			const Cluster& cluster = scene.clusters[c];
+			touch(&cluster, sizeof(Cluster));
+			if (IsInViewCone(camera, TransformAABB(cluster.Box, instance.ModelMatrix)))
+				visible.push_back({ i, c });
+		}
+	}
+	frame.visibleClusters = (UINT)visible.size();
+	frame.cullMs = GetTimeMs() - start;
+
+	start = GetTimeMs();
+
+	for (auto [i, c] : visible)
+	{
+		const Cluster& cluster = scene.clusters[c];
+		const uint8_t* vertices = scene.positions.data() + size_t(cluster.VertexStart) * positionStride;
+		touch(&cluster, sizeof(Cluster));
+		touch(vertices, size_t(cluster.VertexCount) * positionStride);
+		for (UINT v = 0; v < cluster.VertexCount; ++v)
+		{
+			uint32_t bits;
+			memcpy(&bits, vertices + v * positionStride, sizeof(bits));
+			frame.checksum += bits;
+		}
+	}
+	frame.fetchMs = GetTimeMs() - start;
+	return frame;
+}
+
+// Culls a grid of copies of the cooked scene with the instances in a random order, like an exporter's node order,
+// once with the clusters as they are in the scene file and once with everything in spatial order
+static void BenchmarkSpatialOrder()
+{
+	SceneFile sceneFile;
+	std::vector<Instance> sceneInstances;
+	std::vector<Mesh> meshes;
+	std::vector<ClusterGroup> groups;
+	SpatialBenchmarkScene cooked;
+	const SceneSection* positionsSection = nullptr;
+	bool loaded = OpenSceneFile(SCENE_FILE_NAME, sceneFile) &&
+		ReadSceneSection(sceneFile, SceneSectionType::Instances, sceneInstances) &&
+		ReadSceneSection(sceneFile, SceneSectionType::Meshes, meshes) &&
+		ReadSceneSection(sceneFile, SceneSectionType::Groups, groups) &&
+		ReadSceneSection(sceneFile, SceneSectionType::Clusters, cooked.clusters) &&
+		ReadSceneSection(sceneFile, SceneSectionType::ClusterLods, cooked.clusterLods);
+	if (loaded)
+	{
+		positionsSection = sceneFile.FindSection(SceneSectionType::Positions);
+		loaded = positionsSection && ReadSceneSection(sceneFile, SceneSectionType::Positions, positionsSection->stride, cooked.positions);
+	}
+	if (!loaded || sceneInstances.empty())
+	{
+		Log("Spatial order benchmark needs a cooked scene in the working directory, run -generate first\n");
+		return;
+	}
+	size_t positionStride = positionsSection->stride;
+
+	MinMaxAABB sceneBounds = { float3(FLT_MAX), float3(-FLT_MAX) };
+	for (const Instance& instance : sceneInstances)
+	{
+		sceneBounds.Min = min(sceneBounds.Min, instance.Box.Center - instance.Box.Extents);
+		sceneBounds.Max = max(sceneBounds.Max, instance.Box.Center + instance.Box.Extents);
+	}
+	float3 sceneSize = sceneBounds.Max - sceneBounds.Min;
+	float spacing = std::max(sceneSize.x, sceneSize.z) * 1.1f;
+
+	const int gridSize = 8;
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			float3 offset = float3(x * spacing, 0.0f, z * spacing);
+			for (Instance instance : sceneInstances)
+			{
+				instance.ModelMatrix.m41 += offset.x;
+				instance.ModelMatrix.m43 += offset.z;
+				instance.Box.Center += offset;
+				cooked.instances.push_back(instance);
+			}
+		}
+	}
+
+	uint64_t seed = 1;
+	for (size_t i = cooked.instances.size() - 1; i > 0; --i)
+	{
+		seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+		std::swap(cooked.instances[i], cooked.instances[(seed >> 33) % (i + 1)]);
+	}
+
+	SpatialBenchmarkScene sorted = cooked;
+	double sortStart = GetTimeMs();
+	SortInstancesSpatially(sorted.instances);
+	SortClustersSpatially(meshes, groups, sorted.clusters, sorted.clusterLods);
+	GatherClusterElements(sorted.clusters, false, cooked.positions.data(), positionStride, sorted.positions.data());
+	RebaseClusterElements(sorted.clusters);
+	double sortMs = GetTimeMs() - sortStart;
+
+	float3 gridMin = sceneBounds.Min;
+	float3 gridSize3 = float3(spacing * gridSize, sceneSize.y, spacing * gridSize);
+	float3 gridCenter = gridMin + gridSize3 * 0.5f;
+	float height = sceneBounds.Max.y + sceneSize.y * 0.5f;
+
+	// Orbit around the grid and a low pass over it
+	const int numFrames = 60;
+	auto camera = [&](int frame)
+	{
+		StreamingCamera result;
+		if (frame < numFrames / 2)
+		{
+			float angle = 2.0f * 3.14159265f * frame / (numFrames / 2);
+			float radius = gridSize3.x * 0.6f;
+			result.position = gridCenter + float3(cosf(angle) * radius, height - gridCenter.y, sinf(angle) * radius);
+			result.forward = normalize(gridCenter - result.position);
+		}
+		else
+		{
+			float t = float(frame - numFrames / 2) / (numFrames / 2 - 1);
+			result.position = float3(gridMin.x + gridSize3.x * t, height, gridMin.z + gridSize3.z * t);
+			result.forward = normalize(float3(1.0f, -0.25f, 1.0f));
+		}
+		return result;
+	};
+
+	Log("Spatial order, %zu instances in %d copies, %zu clusters, %d frames, sorted in %.2f ms\n",
+		cooked.instances.size(), gridSize * gridSize, cooked.clusters.size(), numFrames, sortMs);
+	Log("Misses are of a modelled 32 KB 8 way L1 and 1 MB 16 way L2, scenes cooked with -spatial are already in order\n");
+	Log("%10s %12s %12s %10s %10s %14s %14s %12s\n", "order", "instances", "clusters", "cull ms", "fetch ms", "L1 miss/frame", "L2 miss/frame", "Mtests/s");
+
+	const SpatialBenchmarkScene* scenes[] = { &cooked, &sorted };
+	const char* names[] = { "cooked", "spatial" };
+	uint64_t checksums[2] = {};
+	uint64_t visibleInstances[2] = {}, visibleClusters[2] = {}, testedClusters[2] = {};
+	double bestCullMs[2] = { DBL_MAX, DBL_MAX }, bestFetchMs[2] = { DBL_MAX, DBL_MAX };
+	std::vector<std::pair<UINT, UINT>> visible;
+
+	// Timing first, the cache model is much slower than the loop it models
+	// The orders take turns, whatever runs second in a row is measurably slower on some machines
+	for (int run = 0; run < 5; ++run)
+	{
+		for (int s = 0; s < 2; ++s)
+		{
+			double cullMs = 0.0, fetchMs = 0.0;
+			for (int frame = 0; frame < numFrames; ++frame)
+			{
+				SpatialBenchmarkFrame result = CullSpatialBenchmarkFrame<false>(*scenes[s], meshes, positionStride, camera(frame), visible, nullptr, nullptr);
+				cullMs += result.cullMs;
+				fetchMs += result.fetchMs;
+				if (run == 0)
+				{
+					visibleInstances[s] += result.visibleInstances;
+					visibleClusters[s] += result.visibleClusters;
+					testedClusters[s] += result.testedClusters;
+					checksums[s] += result.checksum;
+				}
+			}
+			bestCullMs[s] = std::min(bestCullMs[s], cullMs);
+			bestFetchMs[s] = std::min(bestFetchMs[s], fetchMs);
+		}
+	}
+
+	for (int s = 0; s < 2; ++s)
+	{
+		CacheModel l1(32 * 1024, 8);
+		CacheModel l2(1024 * 1024, 16);
+		for (int frame = 0; frame < numFrames; ++frame)
+			CullSpatialBenchmarkFrame<true>(*scenes[s], meshes, positionStride, camera(frame), visible, &l1, &l2);
+
+		Log("%10s %12.1f %12.1f %10.3f %10.3f %14.1f %14.1f %12.1f\n", names[s], double(visibleInstances[s]) / numFrames, double(visibleClusters[s]) / numFrames,
+			bestCullMs[s] / numFrames, bestFetchMs[s] / numFrames, double(l1.misses) / numFrames, double(l2.misses) / numFrames, testedClusters[s] / (bestCullMs[s] * 1000.0));
+	}
+
+	if (checksums[0] != checksums[1])
+		Log("Spatial order changed what is visible\n");
+}
+
+/*
+ * Cluster cone culling
+ */
+
+// Frustum culls a grid of copies of the cooked scene along camera paths, then counts how many of the clusters
+// that pass face away from the camera and would be rejected by their normal cone
+static void BenchmarkConeCulling()
+{
+	SceneFile sceneFile;
+	std::vector<Instance> sceneInstances;
+	std::vector<Mesh> meshes;
+	std::vector<Cluster> clusters;
+	if (!OpenSceneFile(SCENE_FILE_NAME, sceneFile) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Instances, sceneInstances) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Meshes, meshes) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Clusters, clusters) ||
+		sceneInstances.empty())
+	{
+		Log("Cone culling benchmark needs a cooked scene in the working directory, run -generate first\n");
+		return;
+	}
+
+	// How many default level clusters have a cone that can cull at all, and how wide the cones are
+	size_t defaultClusters = 0, coneClusters = 0;
+	double coneAngleSum = 0.0;
+	for (const Mesh& mesh : meshes)
+	{
+		for (UINT c = mesh.ClusterStart; c < mesh.ClusterStart + mesh.ClusterCount; ++c)
+		{
+			defaultClusters += 1;
+			if (clusters[c].Cone.w < 1.0f)
+			{
+				coneClusters += 1;
+				coneAngleSum += asin(clusters[c].Cone.w) * (180.0 / 3.14159265); // Cutoff is the sine of the normal spread
+			}
+		}
+	}
+
+	MinMaxAABB sceneBounds = { float3(FLT_MAX), float3(-FLT_MAX) };
+	for (const Instance& instance : sceneInstances)
+	{
+		sceneBounds.Min = min(sceneBounds.Min, instance.Box.Center - instance.Box.Extents);
+		sceneBounds.Max = max(sceneBounds.Max, instance.Box.Center + instance.Box.Extents);
+	}
+	float3 sceneSize = sceneBounds.Max - sceneBounds.Min;
+	float spacing = std::max(sceneSize.x, sceneSize.z) * 1.1f;
+
+	const int gridSize = 4;
+	std::vector<Instance> instances;
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			float3 offset = float3(x * spacing, 0.0f, z * spacing);
+			for (Instance instance : sceneInstances)
+			{
+				instance.ModelMatrix.m41 += offset.x;
+				instance.ModelMatrix.m43 += offset.z;
+				instance.Box.Center += offset;
+				instances.push_back(instance);
+			}
+		}
+	}
+
+	float3 gridMin = sceneBounds.Min;
+	float3 gridSize3 = float3(spacing * gridSize, sceneSize.y, spacing * gridSize);
+	float3 gridCenter = gridMin + gridSize3 * 0.5f;
+	float height = sceneBounds.Max.y + sceneSize.y * 0.5f;
+	float eyeHeight = sceneBounds.Min.y + sceneSize.y * 0.1f;
+
+	const int numFrames = 120;
+	auto flyover = [&](int frame)
+	{
+		float t = float(frame) / (numFrames - 1);
+		StreamingCamera camera;
+		camera.position = float3(gridMin.x + gridSize3.x * t, height, gridMin.z + gridSize3.z * t);
+		camera.forward = normalize(float3(1.0f, -0.25f, 1.0f));
+		return camera;
+	};
+	auto orbit = [&](int frame)
+	{
+		float angle = 2.0f * 3.14159265f * frame / numFrames;
+		float radius = gridSize3.x * 0.6f;
+		StreamingCamera camera;
+		camera.position = gridCenter + float3(cosf(angle) * radius, height - gridCenter.y, sinf(angle) * radius);
+		camera.forward = normalize(gridCenter - camera.position);
+		return camera;
+	};
+	auto walk = [&](int frame)
+	{
+		// Close to the ground between the copies, looking ahead, where most of what is seen is near
+		float t = float(frame) / (numFrames - 1);
+		StreamingCamera camera;
+		camera.position = float3(gridMin.x + gridSize3.x * t, eyeHeight, gridCenter.z + spacing * 0.5f);
+		camera.forward = float3(1.0f, 0.0f, 0.0f);
+		return camera;
+	};
+
+	struct CameraPath
+	{
+		const char* name;
+		std::function<StreamingCamera(int)> camera;
+	};
+	const CameraPath paths[] = { { "flyover", flyover }, { "orbit", orbit }, { "walk", walk } };
+
+	Log("Cone culling, %zu instances in %d copies, %d frames per path, %zu of %zu default level clusters have a cone (mean half angle %.1f deg)\n",
+		instances.size(), gridSize * gridSize, numFrames, coneClusters, defaultClusters, coneClusters ? coneAngleSum / coneClusters : 0.0);
+	Log("%10s %14s %14s %10s %14s %10s %12s\n", "path", "frustum/frame", "backface/frame", "rejected", "triangles/frame", "rejected", "cone ms");
+
+	for (const CameraPath& path : paths)
+	{
+		uint64_t frustumClusters = 0, backfaceClusters = 0, frustumTriangles = 0, backfaceTriangles = 0;
+		double coneMs = 0.0;
+		std::vector<std::pair<UINT, UINT>> visible;
+		for (int frame = 0; frame < numFrames; ++frame)
+		{
+			StreamingCamera camera = path.camera(frame);
+
+			visible.clear();
+			for (UINT i = 0; i < instances.size(); ++i)
+			{
+				const Instance& instance = instances[i];
+				if (!IsInViewCone(camera, instance.Box))
+					continue;
+
+				const Mesh& mesh = meshes[instance.MeshIndex];
+				for (UINT c = mesh.ClusterStart; c < mesh.ClusterStart + mesh.ClusterCount; ++c)
+				{
+					if (IsInViewCone(camera, TransformAABB(clusters[c].Box, instance.ModelMatrix)))
+						visible.push_back({ i, c });
+				}
+			}
+
+			// Only the cone test is timed, the scale of an instance is looked up every time like the culling shader does it once per instance
+			double start = GetTimeMs();
+			UINT lastInstance = ~0u;
+			float coneAxisScale = 0.0f;
+			for (auto [i, c] : visible)
+			{
+				if (i != lastInstance)
+				{
+					coneAxisScale = GetConeAxisScale(instances[i].ModelMatrix);
+					lastInstance = i;
+				}
+				const Cluster& cluster = clusters[c];
+				frustumTriangles += cluster.PrimitiveCount;
+				if (IsClusterBackfacing(cluster, instances[i].ModelMatrix, coneAxisScale, camera.position))
+				{
+					backfaceClusters += 1;
+					backfaceTriangles += cluster.PrimitiveCount;
+				}
+			}
+			coneMs += GetTimeMs() - start;
+			frustumClusters += visible.size();
+		}
+
+		Log("%10s %14.1f %14.1f %9.1f%% %14.1f %9.1f%% %12.3f\n", path.name, double(frustumClusters) / numFrames, double(backfaceClusters) / numFrames,
+			frustumClusters ? 100.0 * backfaceClusters / frustumClusters : 0.0, double(frustumTriangles) / numFrames,
+			frustumTriangles ? 100.0 * backfaceTriangles / frustumTriangles : 0.0, coneMs / numFrames);
+	}
+}
+
+/*
+ * Shared vertex pool
+ */
+
+struct VertexFetchScene
+{
+	std::vector<Cluster> clusters;
+	std::vector<float3> positions;
+	std::vector<float3> normals;
+	std::vector<float4> tangents;
+	std::vector<float2> texcoords;
+	std::vector<uint32_t> vertexIndices; // Empty when the clusters own their vertices
+};
+
+// Every vertex of the default level clusters of every instance, all four attributes, like the rasterizer fetches them
+template<bool CountMisses>
+static uint64_t FetchClusterVertices(const VertexFetchScene& scene, const std::vector<Instance>& instances, const std::vector<Mesh>& meshes, CacheModel* l1, CacheModel* l2)
+{
+	auto touch = [&](const void* address, size_t size)
+	{
+		if constexpr (CountMisses)
+		{
+			l1->Touch(address, size);
+			l2->Touch(address, size);
+		}
+	};
+
+	const uint32_t* vertexIndices = scene.vertexIndices.empty() ? nullptr : scene.vertexIndices.data();
+	uint64_t checksum = 0;
+	for (const Instance& instance : instances)
+	{
+		const Mesh& mesh = meshes[instance.MeshIndex];
+		for (UINT c = mesh.ClusterStart; c < mesh.ClusterStart + mesh.ClusterCount; ++c)
+		{
+			const Cluster& cluster = scene.clusters[c];
+			touch(&cluster, sizeof(Cluster));
+			for (UINT v = 0; v < cluster.VertexCount; ++v)
+			{
+				if (vertexIndices)
+					touch(&vertexIndices[cluster.VertexStart + v], sizeof(uint32_t));
+				uint32_t index = GetClusterVertexIndex(cluster, vertexIndices, v);
+				touch(&scene.positions[index], sizeof(float3));
+				touch(&scene.normals[index], sizeof(float3));
+				touch(&scene.tangents[index], sizeof(float4));
+				touch(&scene.texcoords[index], sizeof(float2));
+
+				float values[4] = { scene.positions[index].x, scene.normals[index].y, scene.tangents[index].w, scene.texcoords[index].x };
+				uint32_t bits[4];
+				memcpy(bits, values, sizeof(bits));
+				checksum += bits[0] + bits[1] + bits[2] + bits[3];
+			}
+		}
+	}
+	return checksum;
+}
+
+// Builds the shared pool of a scene cooked with cluster vertices, then compares the size of the two and what it costs
+// to fetch the default level through the index lists
+static void BenchmarkSharedVertices()
+{
+	SceneFile sceneFile;
+	std::vector<Instance> instances;
+	std::vector<Mesh> meshes;
+	VertexFetchScene cooked;
+	if (!OpenSceneFile(SCENE_FILE_NAME, sceneFile) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Instances, instances) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Meshes, meshes) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Clusters, cooked.clusters) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Positions, cooked.positions) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Normals, cooked.normals) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Tangents, cooked.tangents) ||
+		!ReadSceneSection(sceneFile, SceneSectionType::Texcoords, cooked.texcoords) ||
+		sceneFile.FindSection(SceneSectionType::VertexIndices) || instances.empty())
+	{
+		Log("Shared vertex benchmark needs a scene cooked without -quantize and -sharedvertices in the working directory, run -generate first\n");
+		return;
+	}
+
+	VertexFetchScene shared = cooked;
+	double buildStart = GetTimeMs();
+	SharedVertexStats stats = BuildSharedVertexPool(meshes, shared.clusters, shared.positions, shared.normals, shared.tangents, shared.texcoords, shared.vertexIndices);
+	double buildMs = GetTimeMs() - buildStart;
+
+	// The default level alone, what is drawn without a LOD cut
+	size_t defaultVertices = 0;
+	std::vector<uint8_t> poolUsed(shared.positions.size(), 0);
+	size_t defaultPoolVertices = 0;
+	for (const Mesh& mesh : meshes)
+	{
+		for (UINT c = mesh.ClusterStart; c < mesh.ClusterStart + mesh.ClusterCount; ++c)
+		{
+			const Cluster& cluster = shared.clusters[c];
+			defaultVertices += cluster.VertexCount;
+			for (UINT v = 0; v < cluster.VertexCount; ++v)
+			{
+				uint32_t index = shared.vertexIndices[cluster.VertexStart + v];
+				defaultPoolVertices += poolUsed[index] == 0;
+				poolUsed[index] = 1;
+			}
+		}
+	}
+
+	const size_t vertexSize = sizeof(float3) + sizeof(float3) + sizeof(float4) + sizeof(float2);
+	size_t clusterBytes = stats.clusterVertices * vertexSize;
+	size_t poolBytes = stats.poolVertices * vertexSize + shared.vertexIndices.size() * sizeof(uint32_t);
+	Log("Shared vertices, %zu meshes, %zu clusters, pool built in %.2f ms\n", meshes.size(), cooked.clusters.size(), buildMs);
+	Log("  all levels: %zu cluster vertices -> %zu pool vertices (%.2fx), %.2f MB -> %.2f MB with the index lists (%.1f%% saved)\n",
+		stats.clusterVertices, stats.poolVertices, stats.poolVertices ? double(stats.clusterVertices) / stats.poolVertices : 0.0,
+		clusterBytes / (1024.0 * 1024.0), poolBytes / (1024.0 * 1024.0), clusterBytes ? 100.0 - 100.0 * poolBytes / clusterBytes : 0.0);
+	Log("  default level: %zu cluster vertices, %zu distinct (%.2fx)\n",
+		defaultVertices, defaultPoolVertices, defaultPoolVertices ? double(defaultVertices) / defaultPoolVertices : 0.0);
+
+	Log("Fetch of the default level of %zu instances, misses are of a modelled 32 KB 8 way L1 and 1 MB 16 way L2\n", instances.size());
+	Log("%10s %12s %10s %14s %14s\n", "vertices", "fetched", "ms", "L1 miss", "L2 miss");
+
+	const VertexFetchScene* scenes[] = { &cooked, &shared };
+	const char* names[] = { "cluster", "shared" };
+	uint64_t checksums[2] = {};
+	double bestMs[2] = { DBL_MAX, DBL_MAX };
+	for (int run = 0; run < 5; ++run)
+	{
+		for (int s = 0; s < 2; ++s)
+		{
+			double start = GetTimeMs();
+			checksums[s] = FetchClusterVertices<false>(*scenes[s], instances, meshes, nullptr, nullptr);
+			bestMs[s] = std::min(bestMs[s], GetTimeMs() - start);
+		}
+	}
+
+	size_t fetched = 0;
+	for (const Instance& instance : instances)
+	{
+		const Mesh& mesh = meshes[instance.MeshIndex];
+		for (UINT c = mesh.ClusterStart; c < mesh.ClusterStart + mesh.ClusterCount; ++c)
+			fetched += cooked.clusters[c].VertexCount;
+	}
+
+	for (int s = 0; s < 2; ++s)
+	{
+		CacheModel l1(32 * 1024, 8);
+		CacheModel l2(1024 * 1024, 16);
+		FetchClusterVertices<true>(*scenes[s], instances, meshes, &l1, &l2);
+		Log("%10s %12zu %10.3f %14llu %14llu\n", names[s], fetched, bestMs[s], (unsigned long long)l1.misses, (unsigned long long)l2.misses);
+	}
+
+	if (checksums[0] != checksums[1])
+		Log("The shared pool fetches different vertices\n");
+}
+
+/*
+ * SIMD culling math
+ */
+
+#define SIMD_BENCHMARK_BOXES 1000000 // Clusters per pass, about what a large scene has in its default level
+#define SIMD_BENCHMARK_PASSES 50
+#define SIMD_BENCHMARK_MATRICES 100000 // View projections per pass of the plane extraction
+
+// The SimdMath.h kernels against the Render.h functions in a loop, on boxes read out of Cluster like UpdatePageStreaming does
+static void BenchmarkSimdMath()
+{
+	uint64_t seed = 1;
+	auto random = [&]()
+	{
+		seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+		return float(uint32_t(seed >> 40)) / float(1 << 24);
+	};
+
+	std::vector<Cluster> clusters(SIMD_BENCHMARK_BOXES);
+	for (Cluster& cluster : clusters)
+	{
+		cluster.Box.Center = float3(random(), random(), random()) * 200.0f - float3(100.0f);
+		cluster.Box.Extents = float3(random(), random(), random()) * 5.0f + float3(0.1f);
+	}
+
+	// A rotated and scaled instance in front of a camera that looks down -z, about half of its boxes stay visible
+	float4x4 model = make_float4x4_scale(float3(1.5f)) * make_float4x4_rotation_y(0.7f) * make_float4x4_rotation_x(0.3f) * make_float4x4_translation(float3(20.0f, 0.0f, -150.0f));
+	float4x4 proj = make_float4x4_perspective_field_of_view(3.14159265f / 3.0f, 16.0f / 9.0f, 1.0f, 10000.0f);
+	float4x4 viewProj = make_float4x4_rotation_y(0.2f) * proj;
+	float4 planes[6];
+	ExtractPlanesD3D((plane*)planes, viewProj, true);
+
+	std::vector<float4x4> matrices(SIMD_BENCHMARK_MATRICES);
+	for (float4x4& matrix : matrices)
+		matrix = make_float4x4_rotation_y(random() * 6.28f) * make_float4x4_rotation_x(random() - 0.5f) * make_float4x4_translation(float3(random(), random(), random()) * 100.0f) * proj;
+
+	const MathKernel kernels[] = { MathKernel::Scalar, MathKernel::Sse2, MathKernel::Avx2 };
+	const char* tests[] = { "transform", "cull", "transform+cull", "planes" };
+
+	Log("SIMD culling math, %d passes over %d boxes and %d matrices, %s kernels available\n", SIMD_BENCHMARK_PASSES, SIMD_BENCHMARK_BOXES, SIMD_BENCHMARK_MATRICES,
+		GetMathKernelName(GetMathKernel(MathKernel::Best)));
+	Log("%16s %8s %12s %12s %10s %10s\n", "test", "kernel", "ms", "M/s", "speedup", "visible");
+
+	std::vector<CenterExtentsAABB> transformed(clusters.size()), transformedReference;
+	std::vector<uint8_t> visible(clusters.size()), visibleReference;
+	std::vector<float4> extracted(matrices.size() * 6), extractedReference;
+	for (int test = 0; test < 4; ++test)
+	{
+		double scalarMs = 0.0;
+		for (MathKernel kernel : kernels)
+		{
+			if (GetMathKernel(kernel) != kernel)
+				continue;
+
+			double start = GetTimeMs();
+			for (int pass = 0; pass < SIMD_BENCHMARK_PASSES; ++pass)
+			{
+				if (test == 0)
+					TransformAABBs(&clusters[0].Box, sizeof(Cluster), clusters.size(), model, transformed.data(), kernel);
+				else if (test == 1)
+					CullAABBs(&clusters[0].Box, sizeof(Cluster), clusters.size(), planes, visible.data(), kernel);
+				else if (test == 2)
+					CullTransformedAABBs(&clusters[0].Box, sizeof(Cluster), clusters.size(), model, planes, visible.data(), kernel);
+				else
+					ExtractFrustumPlanes(matrices.data(), matrices.size(), extracted.data(), kernel);
+			}
+			double ms = GetTimeMs() - start;
+
+			// Everything has to match the scalar results bit for bit
+			bool same = true;
+			if (test == 0)
+			{
+				if (kernel == MathKernel::Scalar)
+					transformedReference = transformed;
+				same = memcmp(transformed.data(), transformedReference.data(), transformed.size() * sizeof(CenterExtentsAABB)) == 0;
+			}
+			else if (test == 3)
+			{
+				if (kernel == MathKernel::Scalar)
+					extractedReference = extracted;
+				same = memcmp(extracted.data(), extractedReference.data(), extracted.size() * sizeof(float4)) == 0;
+			}
+			else
+			{
+				if (kernel == MathKernel::Scalar)
+					visibleReference = visible;
+				same = visible == visibleReference;
+			}
+
+			if (kernel == MathKernel::Scalar)
+				scalarMs = ms;
+			size_t items = test == 3 ? matrices.size() : clusters.size();
+			size_t visibleCount = test == 1 || test == 2 ? std::count(visible.begin(), visible.end(), uint8_t(1)) : 0;
+			char visibleText[32] = "";
+			if (test == 1 || test == 2)
+				snprintf(visibleText, sizeof(visibleText), "%.1f%%", 100.0 * visibleCount / items);
+			Log("%16s %8s %12.2f %12.1f %9.2fx %10s%s\n", tests[test], GetMathKernelName(kernel), ms, double(items) * SIMD_BENCHMARK_PASSES / (ms * 1000.0),
+				scalarMs / ms, visibleText, same ? "" : "  does not match scalar");
+		}
+	}
+}
+
+/*
+ * Meshlet configurations
+ */
+
+static const char* g_benchmarkGltfFile = nullptr; // The -generate input, for the benchmarks that cook
+
+struct MeshletBenchmarkResult
+{
+	double cookMs = 0.0;
+	size_t clusters = 0; // All levels
+	size_t defaultClusters = 0;
+	float triangleFill = 0.0f; // Default level
+	float vertexFill = 0.0f;
+	double visibleClusters = 0.0; // Per frame
+	double visibleTriangles = 0.0;
+	double cullMs = 0.0;
+	size_t clusterBytes = 0; // Cluster, ClusterLod and group metadata
+	size_t geometryBytes = 0; // Vertex and index streams as loaded
+	size_t fileBytes = 0;
+};
+
+// Cooks gltfFile with every preset and culls the default level of each along the same orbit. The culling shader
+// spends a test per cluster and the mesh shader a whole thread group per visible cluster, so both follow the
+// cluster count, the group size decides how many of the launched threads have a triangle to output
+static void BenchmarkMeshletConfigs()
+{
+	const char* gltfFile = g_benchmarkGltfFile;
+	if (!gltfFile)
+	{
+		Log("Meshlet benchmark cooks a glTF file with every preset, pass one with -generate\n");
+		return;
+	}
+
+	const size_t presetCount = sizeof(g_meshletPresets) / sizeof(g_meshletPresets[0]);
+	MeshletBenchmarkResult results[presetCount];
+	for (size_t p = 0; p < presetCount; ++p)
+	{
+		const MeshletConfig& config = g_meshletPresets[p].config;
+		GeneratorOptions options;
+		options.meshletConfig = config;
+		options.cacheDirectory = nullptr;
+		options.reportFile = nullptr;
+
+		double cookStart = GetTimeMs();
+		Generate(gltfFile, options);
+		MeshletBenchmarkResult& result = results[p];
+		result.cookMs = GetTimeMs() - cookStart;
+
+		SceneFile sceneFile;
+		std::vector<Instance> instances;
+		std::vector<Mesh> meshes;
+		std::vector<Cluster> clusters;
+		const SceneSection* groupsSection = nullptr;
+		const SceneSection* positionsSection = nullptr;
+		const SceneSection* indicesSection = nullptr;
+		if (!OpenSceneFile(SCENE_FILE_NAME, sceneFile) ||
+			!ReadSceneSection(sceneFile, SceneSectionType::Instances, instances) ||
+			!ReadSceneSection(sceneFile, SceneSectionType::Meshes, meshes) ||
+			!ReadSceneSection(sceneFile, SceneSectionType::Clusters, clusters) ||
+			!(groupsSection = sceneFile.FindSection(SceneSectionType::Groups)) ||
+			!(positionsSection = sceneFile.FindSection(SceneSectionType::Positions)) ||
+			!(indicesSection = sceneFile.FindSection(SceneSectionType::Indices)))
+		{
+			Log("Could not read %s cooked with %s\n", SCENE_FILE_NAME, g_meshletPresets[p].name);
+			return;
+		}
+
+		size_t triangles = 0, vertices = 0;
+		for (const Mesh& mesh : meshes)
+		{
+			for (UINT c = mesh.ClusterStart; c < mesh.ClusterStart + mesh.ClusterCount; ++c)
+			{
+				triangles += clusters[c].PrimitiveCount;
+				vertices += clusters[c].VertexCount;
+				result.defaultClusters += 1;
+			}
+		}
+		result.clusters = clusters.size();
+		result.triangleFill = result.defaultClusters ? float(triangles) / (result.defaultClusters * config.maxTriangles) : 0.0f;
+		result.vertexFill = result.defaultClusters ? float(vertices) / (result.defaultClusters * config.maxVertices) : 0.0f;
+		result.clusterBytes = clusters.size() * (sizeof(Cluster) + sizeof(ClusterLod)) + groupsSection->count * groupsSection->stride;
+		result.geometryBytes = positionsSection->count * (sizeof(float3) + sizeof(float3) + sizeof(float4) + sizeof(float2)) + indicesSection->count * indicesSection->stride;
+		result.fileBytes = sceneFile.file.size;
+
+		MinMaxAABB sceneBounds = { float3(FLT_MAX), float3(-FLT_MAX) };
+		for (const Instance& instance : instances)
+		{
+			sceneBounds.Min = min(sceneBounds.Min, instance.Box.Center - instance.Box.Extents);
+			sceneBounds.Max = max(sceneBounds.Max, instance.Box.Center + instance.Box.Extents);
+		}
+		float3 sceneCenter = (sceneBounds.Min + sceneBounds.Max) * 0.5f;
+		float radius = length(sceneBounds.Max - sceneBounds.Min) * 0.75f;
+
+		// Frustum and cone tests per cluster, like ClusterCulling.hlsl, best of a few runs over the same frames
+		const int numFrames = 120;
+		uint64_t visibleClusters = 0, visibleTriangles = 0;
+		double bestMs = DBL_MAX;
+		for (int run = 0; run < 3; ++run)
+		{
+			visibleClusters = visibleTriangles = 0;
+			double start = GetTimeMs();
+			for (int frame = 0; frame < numFrames; ++frame)
+			{
+				float angle = 2.0f * 3.14159265f * frame / numFrames;
+				StreamingCamera camera;
+				camera.position = sceneCenter + float3(cosf(angle) * radius, radius * 0.3f, sinf(angle) * radius);
+				camera.forward = normalize(sceneCenter - camera.position);
+
+				for (const Instance& instance : instances)
+				{
+					if (!IsInViewCone(camera, instance.Box))
+						continue;
+
+					float coneAxisScale = GetConeAxisScale(instance.ModelMatrix);
+					const Mesh& mesh = meshes[instance.MeshIndex];
+					for (UINT c = mesh.ClusterStart; c < mesh.ClusterStart + mesh.ClusterCount; ++c)
+					{
+						const Cluster& cluster = clusters[c];
+						if (!IsInViewCone(camera, TransformAABB(cluster.Box, instance.ModelMatrix)) ||
+							IsClusterBackfacing(cluster, instance.ModelMatrix, coneAxisScale, camera.position))
+							continue;
+						visibleClusters += 1;
+						visibleTriangles += cluster.PrimitiveCount;
+					}
+				}
+			}
+			bestMs = std::min(bestMs, GetTimeMs() - start);
+		}
+		result.visibleClusters = double(visibleClusters) / numFrames;
+		result.visibleTriangles = double(visibleTriangles) / numFrames;
+		result.cullMs = bestMs / numFrames;
+	}
+
+	const double mb = 1024.0 * 1024.0;
+	Log("Meshlet configurations of %s, default level culled along a %d frame orbit\n", gltfFile, 120);
+	Log("%8s %10s %10s %10s %8s %8s %12s %10s %10s %10s %10s %10s\n", "preset", "cook ms", "clusters", "default", "tri fill", "vtx fill",
+		"visible/frame", "cull ms", "thread use", "meta MB", "geom MB", "file MB");
+	size_t fewestThreads = 0, fewestClusters = 0;
+	for (size_t p = 0; p < presetCount; ++p)
+	{
+		const MeshletBenchmarkResult& result = results[p];
+		double threads = result.visibleClusters * GetMeshletGroupSize(g_meshletPresets[p].config);
+		double threadUse = threads > 0.0 ? result.visibleTriangles / threads : 0.0;
+		if (threads < results[fewestThreads].visibleClusters * GetMeshletGroupSize(g_meshletPresets[fewestThreads].config))
+			fewestThreads = p;
+		if (result.visibleClusters < results[fewestClusters].visibleClusters)
+			fewestClusters = p;
+		Log("%8s %10.1f %10zu %10zu %7.1f%% %7.1f%% %12.1f %10.3f %9.1f%% %10.2f %10.2f %10.2f\n", g_meshletPresets[p].name, result.cookMs,
+			result.clusters, result.defaultClusters, result.triangleFill * 100.0, result.vertexFill * 100.0, result.visibleClusters,
+			result.cullMs, threadUse * 100.0, result.clusterBytes / mb, result.geometryBytes / mb, result.fileBytes / mb);
+	}
+	Log("Fewest mesh shader threads launched: %s, fewest clusters to cull and draw: %s. %s is left cooked with %s\n", g_meshletPresets[fewestThreads].name,
+		g_meshletPresets[fewestClusters].name, SCENE_FILE_NAME, g_meshletPresets[presetCount - 1].name);
+}
+
+struct BenchmarkEntry
+{
+	const char* name;
+	void (*func)();
+};
+
+static const BenchmarkEntry g_benchmarks[] = {
+	{ "adjacency", BenchmarkClusterAdjacency },
+	{ "grouping", BenchmarkClusterGrouping },
+	{ "lodcut", BenchmarkLodCut },
+	{ "codec", BenchmarkStreamCodec },
+	{ "sceneload", BenchmarkSceneLoad },
+	{ "streaming", BenchmarkClusterStreaming },
+	{ "decode", BenchmarkAccessorDecode },
+	{ "spatial", BenchmarkSpatialOrder },
+	{ "cone", BenchmarkConeCulling },
+	{ "sharedvertices", BenchmarkSharedVertices },
+	{ "simd", BenchmarkSimdMath },
+	{ "meshlets", BenchmarkMeshletConfigs }, // Last, it cooks over the scene file the others read
+};
+
+bool RunBenchmark(const char* name, const char* gltfFile)
+{
+	g_benchmarkGltfFile = gltfFile;
+	bool all = name == nullptr || strcmp(name, "all") == 0;
+	bool found = false;
+	for (const BenchmarkEntry& benchmark : g_benchmarks)
+	{
+		if (all || strcmp(name, benchmark.name) == 0)
+		{
+			benchmark.func();
+			found = true;
+		}
+	}
+
+	if (!found)
+		Log("Unknown benchmark '%s'\n", name);
+
+	return found;
+}
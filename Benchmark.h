@@ -0,0 +1,5 @@
+#pragma once
+
+// Runs the named CPU benchmark, or all of them if name is nullptr or "all"
+// gltfFile is the -generate input, the benchmarks that cook need one. Returns false if there is no benchmark with that name
+bool RunBenchmark(const char* name, const char* gltfFile);
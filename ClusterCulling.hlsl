@@ -16,6 +16,7 @@ void main(uint dtid : SV_DispatchThreadID)
 	Mesh mesh = GetMesh(instance.MeshIndex);
 
 	RWByteAddressBuffer visibleClustersCounter = ResourceDescriptorHeap[VISIBLE_CLUSTERS_COUNTER_UAV];
+	float coneAxisScale = GetConeAxisScale(instance.ModelMatrix);
 	for (int i = 0; i < mesh.ClusterCount; ++i)
 	{
 		Cluster cluster = GetCluster(mesh.ClusterStart + i);
@@ -24,6 +25,13 @@ void main(uint dtid : SV_DispatchThreadID)
 		if (IsCulled(box))
 			continue;
 
+		if (IsClusterBackfacing(cluster, instance.ModelMatrix, coneAxisScale))
+			continue;
+
+		// The CPU requests the pages of the clusters it sees, until one is in the pool its clusters are skipped
+		if (!IsClusterResident(cluster))
+			continue;
+
 		uint offset = 0;
 		visibleClustersCounter.InterlockedAdd(0, 1, offset); // TODO: restructure this dispatch to do one instance per wave
 
@@ -0,0 +1,449 @@
+#include "ClusterGraph.h"
+
+#include <numeric>
+#include <climits>
+
+/*
+ * Greedy grouping
+ */
+
+static MergeCandidate SelectBestCandidateTree(const MergeCandidate& input, const std::vector<std::pair<int, int>>& sortedAdjacency, const FlatHashMap<int>& clusterAdjacencyMap)
+{
+	// If the limit is hit we end the search
+	if (input.count >= PREFERED_CLUSTERS_PER_CANDIDATE)
+		return input;
+
+	// Go over all remaining possible clusters to add
+	MergeCandidate output = input;
+	for (auto& c : sortedAdjacency)
+	{
+		// If input candidate already contains the cluster it won't get added
+		if (input.Contains(c.first))
+			continue;
+
+		// Go over all input clusters and get the total connectivity score for the selected cluster
+		int score = 0;
+		for (int i = 0; i < input.count; ++i)
+		{
+			if (const int* edgeCount = clusterAdjacencyMap.Find(PackCluster(input.set[i], c.first)))
+				score += *edgeCount;
+		}
+
+		// If there is any score we try to recursively build up a bigger set of clusters
+		if (score > 0)
+		{
+			// Add the candidate to a local copy and accumulate score
+			MergeCandidate candidate = input;
+			candidate.Push(c.first);
+			candidate.score += score;
+
+			// Recursively find the best candidate
+			candidate = SelectBestCandidateTree(candidate, sortedAdjacency, clusterAdjacencyMap);
+
+			// Store the best candidate in the output
+			if (candidate.score > output.score)
+				output = candidate;
+		}
+ 	}
+
+	return output;
+}
+
+static void GroupClustersGreedy(const FlatHashMap<int>& clusterAdjacencyMap, const std::vector<std::pair<int, int>>& clusterAdjacencyCount, std::vector<MergeCandidate>& mergeLists)
+{
+	// Sort the clusters by connection count
+	// Here we should probably have a triangle size metric as well
+	std::vector<std::pair<int, int>> sortedAdjacency(clusterAdjacencyCount.size());
+	std::partial_sort_copy(clusterAdjacencyCount.begin(), clusterAdjacencyCount.end(), sortedAdjacency.begin(), sortedAdjacency.end(), [](std::pair<int, int> l, std::pair<int, int> r) { return l.second > r.second; });
+
+	while (sortedAdjacency.size() > 0)
+	{
+		// Create a new candidate and populate it with the least connected cluster
+		MergeCandidate candidate;
+		candidate.Push(sortedAdjacency.back().first);
+
+		// Get the best possible scoring merge candidate using this specific candidate starting point
+		MergeCandidate output = SelectBestCandidateTree(candidate, sortedAdjacency, clusterAdjacencyMap);
+		mergeLists.push_back(output);
+
+		// Remove all the selected clusters from future searches
+		std::erase_if(sortedAdjacency, [output](const auto& v) {
+			for (int c = 0; c < output.count; ++c)
+				if (v.first == output.set[c])
+					return true;
+			return false;
+		});
+	}
+}
+
+/*
+ * Graph partitioning
+ */
+
+struct PartitionGraph
+{
+	std::vector<int> offsets; // Neighbours of node n are in edges[offsets[n]] to edges[offsets[n + 1] - 1]
+	std::vector<std::pair<int, int>> edges; // <neighbour, shared edge count>
+	std::vector<int> weights; // Number of clusters in each node
+
+	int NodeCount() const { return (int)weights.size(); }
+	int Degree(int n) const { return offsets[n + 1] - offsets[n]; }
+};
+
+static void BuildPartitionGraph(int clusterCount, const FlatHashMap<int>& clusterAdjacencyMap, PartitionGraph& graph)
+{
+	graph.offsets.assign(clusterCount + 1, 0);
+	clusterAdjacencyMap.ForEach([&](uint64_t clusterPair, int)
+	{
+		graph.offsets[(clusterPair >> 32) + 1] += 1;
+		graph.offsets[(clusterPair & 0xffffffff) + 1] += 1;
+	});
+	std::partial_sum(graph.offsets.begin(), graph.offsets.end(), graph.offsets.begin());
+
+	std::vector<int> fill(graph.offsets.begin(), graph.offsets.end() - 1);
+	graph.edges.resize(graph.offsets.back());
+	clusterAdjacencyMap.ForEach([&](uint64_t clusterPair, int edgeCount)
+	{
+		int c0 = int(clusterPair >> 32);
+		int c1 = int(clusterPair & 0xffffffff);
+		graph.edges[fill[c0]++] = { c1, edgeCount };
+		graph.edges[fill[c1]++] = { c0, edgeCount };
+	});
+
+	// Hash table order is not something we want the result to depend on
+	for (int n = 0; n < clusterCount; ++n)
+		std::sort(graph.edges.begin() + graph.offsets[n], graph.edges.begin() + graph.offsets[n + 1]);
+
+	graph.weights.assign(clusterCount, 1);
+}
+
+// Pairs up nodes along their heaviest edge as long as the pair stays within maxWeight
+// Only nodes lighter than initiatorWeight look for a partner
+// nodeMap maps each node to its coarse node, returns the number of coarse nodes
+static int MatchHeavyEdges(const PartitionGraph& graph, int maxWeight, int initiatorWeight, std::vector<int>& nodeMap)
+{
+	int nodeCount = graph.NodeCount();
+
+	// Visit the least connected nodes first so they get a partner before their neighbours are taken
+	std::vector<int> order(nodeCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](int l, int r) { return graph.Degree(l) < graph.Degree(r); });
+
+	nodeMap.assign(nodeCount, -1);
+	int coarseCount = 0;
+	for (int n : order)
+	{
+		if (nodeMap[n] != -1)
+			continue;
+
+		int best = -1;
+		int bestEdgeCount = 0;
+		if (graph.weights[n] < initiatorWeight)
+		{
+			for (int e = graph.offsets[n]; e < graph.offsets[n + 1]; ++e)
+			{
+				auto [neighbour, edgeCount] = graph.edges[e];
+				if (nodeMap[neighbour] != -1 || graph.weights[n] + graph.weights[neighbour] > maxWeight)
+					continue;
+
+				// Prefer the lighter neighbour on ties to keep the groups even
+				if (edgeCount > bestEdgeCount || (edgeCount == bestEdgeCount && best != -1 && graph.weights[neighbour] < graph.weights[best]))
+				{
+					best = neighbour;
+					bestEdgeCount = edgeCount;
+				}
+			}
+		}
+
+		nodeMap[n] = coarseCount;
+		if (best != -1)
+			nodeMap[best] = coarseCount;
+		coarseCount += 1;
+	}
+
+	return coarseCount;
+}
+
+// Collapses the matched nodes into a new graph, summing node weights and the edges between merged nodes
+static void ContractGraph(const PartitionGraph& graph, const std::vector<int>& nodeMap, int coarseCount, PartitionGraph& coarse)
+{
+	// Fine nodes of each coarse node
+	std::vector<int> memberOffsets(coarseCount + 1, 0);
+	for (int n = 0; n < graph.NodeCount(); ++n)
+		memberOffsets[nodeMap[n] + 1] += 1;
+	std::partial_sum(memberOffsets.begin(), memberOffsets.end(), memberOffsets.begin());
+
+	std::vector<int> members(graph.NodeCount());
+	std::vector<int> fill(memberOffsets.begin(), memberOffsets.end() - 1);
+	for (int n = 0; n < graph.NodeCount(); ++n)
+		members[fill[nodeMap[n]]++] = n;
+
+	coarse.offsets.clear();
+	coarse.edges.clear();
+	coarse.weights.assign(coarseCount, 0);
+	coarse.offsets.reserve(coarseCount + 1);
+	coarse.edges.reserve(graph.edges.size());
+	coarse.offsets.push_back(0);
+
+	// Where each coarse neighbour was last written, entries from earlier nodes are below edgeStart and count as missing
+	std::vector<int> edgeSlot(coarseCount, -1);
+	for (int cn = 0; cn < coarseCount; ++cn)
+	{
+		int edgeStart = (int)coarse.edges.size();
+		for (int m = memberOffsets[cn]; m < memberOffsets[cn + 1]; ++m)
+		{
+			int n = members[m];
+			coarse.weights[cn] += graph.weights[n];
+
+			for (int e = graph.offsets[n]; e < graph.offsets[n + 1]; ++e)
+			{
+				int neighbour = nodeMap[graph.edges[e].first];
+				if (neighbour == cn)
+					continue;
+
+				if (edgeSlot[neighbour] < edgeStart)
+				{
+					edgeSlot[neighbour] = (int)coarse.edges.size();
+					coarse.edges.push_back({ neighbour, graph.edges[e].second });
+				}
+				else
+				{
+					coarse.edges[edgeSlot[neighbour]].second += graph.edges[e].second;
+				}
+			}
+		}
+
+		std::sort(coarse.edges.begin() + edgeStart, coarse.edges.end());
+		coarse.offsets.push_back((int)coarse.edges.size());
+	}
+}
+
+// Moves single clusters between neighbouring groups when it lowers the edge cut,
+// or evens out the group sizes without making the cut worse
+static void RefineGroups(const PartitionGraph& graph, int maxGroupSize, std::vector<int>& groupOf, std::vector<int>& groupSize)
+{
+	const int maxPasses = 4;
+
+	std::vector<std::pair<int, int>> connections; // <group, shared edge count>
+	for (int pass = 0; pass < maxPasses; ++pass)
+	{
+		int moved = 0;
+		for (int n = 0; n < graph.NodeCount(); ++n)
+		{
+			int g = groupOf[n];
+			if (groupSize[g] <= 1)
+				continue;
+
+			connections.clear();
+			int internal = 0;
+			for (int e = graph.offsets[n]; e < graph.offsets[n + 1]; ++e)
+			{
+				auto [neighbour, edgeCount] = graph.edges[e];
+				int h = groupOf[neighbour];
+				if (h == g)
+				{
+					internal += edgeCount;
+					continue;
+				}
+
+				auto iter = std::find_if(connections.begin(), connections.end(), [h](const auto& c) { return c.first == h; });
+				if (iter != connections.end())
+					iter->second += edgeCount;
+				else
+					connections.push_back({ h, edgeCount });
+			}
+
+			int best = -1;
+			int bestGain = INT_MIN;
+			for (auto [h, edgeCount] : connections)
+			{
+				if (groupSize[h] >= maxGroupSize)
+					continue;
+
+				int gain = edgeCount - internal;
+				bool balances = groupSize[h] + 1 < groupSize[g];
+				if ((gain > 0 || (gain == 0 && balances)) && gain > bestGain)
+				{
+					best = h;
+					bestGain = gain;
+				}
+			}
+
+			if (best != -1)
+			{
+				groupOf[n] = best;
+				groupSize[g] -= 1;
+				groupSize[best] += 1;
+				moved += 1;
+			}
+		}
+
+		if (moved == 0)
+			break;
+	}
+}
+
+// Single clusters whose neighbours all filled up join the neighbour group they share the most edges with,
+// even if that group goes above the prefered size. Clusters without neighbours stay on their own.
+static void MergeSingleGroups(const PartitionGraph& graph, std::vector<int>& groupOf, std::vector<int>& groupSize)
+{
+	std::vector<std::pair<int, int>> connections; // <group, shared edge count>
+	for (int n = 0; n < graph.NodeCount(); ++n)
+	{
+		int g = groupOf[n];
+		if (groupSize[g] != 1)
+			continue;
+
+		connections.clear();
+		for (int e = graph.offsets[n]; e < graph.offsets[n + 1]; ++e)
+		{
+			auto [neighbour, edgeCount] = graph.edges[e];
+			int h = groupOf[neighbour];
+			auto iter = std::find_if(connections.begin(), connections.end(), [h](const auto& c) { return c.first == h; });
+			if (iter != connections.end())
+				iter->second += edgeCount;
+			else
+				connections.push_back({ h, edgeCount });
+		}
+
+		// Prefer the smaller group on ties to keep the groups even
+		int best = -1;
+		int bestEdgeCount = 0;
+		for (auto [h, edgeCount] : connections)
+		{
+			if (groupSize[h] >= MAX_CLUSTERS_PER_CANDIDATE)
+				continue;
+			if (edgeCount > bestEdgeCount || (edgeCount == bestEdgeCount && best != -1 && groupSize[h] < groupSize[best]))
+			{
+				best = h;
+				bestEdgeCount = edgeCount;
+			}
+		}
+
+		if (best != -1)
+		{
+			groupOf[n] = best;
+			groupSize[g] = 0;
+			groupSize[best] += 1;
+		}
+	}
+}
+
+static void GroupClustersPartition(int clusterCount, const FlatHashMap<int>& clusterAdjacencyMap, std::vector<MergeCandidate>& mergeLists)
+{
+	PartitionGraph clusterGraph;
+	BuildPartitionGraph(clusterCount, clusterAdjacencyMap, clusterGraph);
+
+	std::vector<int> groupOf(clusterCount);
+	std::iota(groupOf.begin(), groupOf.end(), 0);
+
+	// Coarsen until the nodes are as big as the groups we want, each level roughly halves the node count
+	PartitionGraph graph = clusterGraph;
+	PartitionGraph coarse;
+	std::vector<int> nodeMap;
+	for (;;)
+	{
+		int coarseCount = MatchHeavyEdges(graph, PREFERED_CLUSTERS_PER_CANDIDATE, INT_MAX, nodeMap);
+
+		// Stop when only stragglers are left to match
+		if (graph.NodeCount() - coarseCount <= graph.NodeCount() / 100)
+			break;
+
+		ContractGraph(graph, nodeMap, coarseCount, coarse);
+		for (int& g : groupOf)
+			g = nodeMap[g];
+		std::swap(graph, coarse);
+	}
+
+	int coarseCount = graph.NodeCount();
+	std::vector<int> groupSize(coarseCount, 0);
+	for (int g : groupOf)
+		groupSize[g] += 1;
+
+	RefineGroups(clusterGraph, PREFERED_CLUSTERS_PER_CANDIDATE, groupOf, groupSize);
+	MergeSingleGroups(clusterGraph, groupOf, groupSize);
+
+	// Number the groups in order of their first cluster so the output is stable
+	std::vector<int> groupIndex(coarseCount, -1);
+	size_t firstGroup = mergeLists.size();
+	for (int c = 0; c < clusterCount; ++c)
+	{
+		int& index = groupIndex[groupOf[c]];
+		if (index == -1)
+		{
+			index = int(mergeLists.size() - firstGroup);
+			mergeLists.emplace_back();
+		}
+		mergeLists[firstGroup + index].Push(c);
+	}
+
+	for (size_t il = firstGroup; il < mergeLists.size(); ++il)
+	{
+		MergeCandidate& l = mergeLists[il];
+		for (int i = 0; i < l.count; ++i)
+			for (int j = i + 1; j < l.count; ++j)
+				if (const int* edgeCount = clusterAdjacencyMap.Find(PackCluster(l.set[i], l.set[j])))
+					l.score += *edgeCount;
+	}
+}
+
+/*
+ * Common
+ */
+
+void GroupClusters(ClusterGrouping grouping, int clusterCount, const FlatHashMap<int>& clusterAdjacencyMap, const std::vector<std::pair<int, int>>& clusterAdjacencyCount, std::vector<MergeCandidate>& mergeLists)
+{
+	switch (grouping)
+	{
+	case ClusterGrouping::Greedy:
+		GroupClustersGreedy(clusterAdjacencyMap, clusterAdjacencyCount, mergeLists);
+		break;
+	case ClusterGrouping::Partition:
+		GroupClustersPartition(clusterCount, clusterAdjacencyMap, mergeLists);
+		break;
+	}
+}
+
+void ComputeGroupingStats(int clusterCount, const FlatHashMap<int>& clusterAdjacencyMap, const std::vector<MergeCandidate>& mergeLists, GroupingStats& stats)
+{
+	std::vector<int> groupOf(clusterCount, -1);
+	for (int il = 0; il < (int)mergeLists.size(); ++il)
+	{
+		const MergeCandidate& l = mergeLists[il];
+		for (int i = 0; i < l.count; ++i)
+			groupOf[l.set[i]] = il;
+
+		stats.sizeHistogram[l.count] += 1;
+	}
+
+	stats.clusterCount += clusterCount;
+	stats.groupCount += (int)mergeLists.size();
+
+	clusterAdjacencyMap.ForEach([&](uint64_t clusterPair, int edgeCount)
+	{
+		stats.totalEdges += edgeCount;
+		if (groupOf[clusterPair >> 32] != groupOf[clusterPair & 0xffffffff])
+			stats.edgeCut += edgeCount;
+	});
+}
+
+void GroupingStats::Add(const GroupingStats& other)
+{
+	clusterCount += other.clusterCount;
+	groupCount += other.groupCount;
+	for (int i = 0; i <= MAX_CLUSTERS_PER_CANDIDATE; ++i)
+		sizeHistogram[i] += other.sizeHistogram[i];
+	edgeCut += other.edgeCut;
+	totalEdges += other.totalEdges;
+	timeMs += other.timeMs;
+}
+
+const char* GetClusterGroupingName(ClusterGrouping grouping)
+{
+	switch (grouping)
+	{
+	case ClusterGrouping::Greedy: return "greedy";
+	case ClusterGrouping::Partition: return "partition";
+	}
+	return "unknown";
+}
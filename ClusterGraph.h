@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "HashTable.h"
+
+inline uint64_t PackEdge(int v0, int v1)
+{
+	if (v0 < v1)
+		return (uint64_t)v0 << 32 | (uint64_t)v1;
+	else
+		return (uint64_t)v1 << 32 | (uint64_t)v0;
+}
+
+inline uint64_t PackCluster(int c0, int c1)
+{
+	// TODO: pack in cluster lod level as well
+	if (c0 < c1)
+		return (uint64_t)c0 << 32 | (uint64_t)c1;
+	else
+		return (uint64_t)c1 << 32 | (uint64_t)c0;
+}
+
+// Figures out which clusters are connected, given the border edges of each cluster.
+// Instead of testing every cluster against every other cluster we build a global
+// edge -> cluster index by sorting all <edge, cluster> pairs, so clusters sharing an edge end up next to each other.
+// clusterAdjacencyMap maps the pair <c0, c1> to common edge count
+// clusterAdjacencyCount contains the pair <cluster, counter> counting how many neighbours a cluster have
+template<class EdgeSetList>
+void BuildClusterAdjacency(const EdgeSetList& edgeSets, FlatHashMap<int>& clusterAdjacencyMap, std::vector<std::pair<int, int>>& clusterAdjacencyCount)
+{
+	size_t numEdges = 0;
+	for (const auto& edgeSet : edgeSets)
+		numEdges += edgeSet.size();
+
+	std::vector<std::pair<uint64_t, int>> edgeClusters;
+	edgeClusters.reserve(numEdges);
+	for (int ml = 0; ml < (int)edgeSets.size(); ++ml)
+	{
+		for (uint64_t edge : edgeSets[ml])
+			edgeClusters.push_back({ edge, ml });
+	}
+	std::sort(edgeClusters.begin(), edgeClusters.end());
+
+	clusterAdjacencyMap.Clear();
+	clusterAdjacencyMap.Reserve(numEdges / 2);
+	for (size_t i = 0; i < edgeClusters.size();)
+	{
+		// All clusters sharing this edge, usually two but non-manifold edges can have more
+		size_t end = i + 1;
+		while (end < edgeClusters.size() && edgeClusters[end].first == edgeClusters[i].first)
+			end += 1;
+
+		for (size_t c0 = i; c0 < end; ++c0)
+			for (size_t c1 = c0 + 1; c1 < end; ++c1)
+				clusterAdjacencyMap[PackCluster(edgeClusters[c0].second, edgeClusters[c1].second)] += 1;
+
+		i = end;
+	}
+
+	clusterAdjacencyCount.resize(edgeSets.size());
+	for (int ml = 0; ml < (int)clusterAdjacencyCount.size(); ++ml)
+	{
+		clusterAdjacencyCount[ml].first = ml;
+		clusterAdjacencyCount[ml].second = 0;
+	}
+	clusterAdjacencyMap.ForEach([&](uint64_t clusterPair, int)
+	{
+		clusterAdjacencyCount[clusterPair >> 32].second += 1;
+		clusterAdjacencyCount[clusterPair & 0xffffffff].second += 1;
+	});
+}
+
+#define MAX_CLUSTERS_PER_CANDIDATE 8
+#define PREFERED_CLUSTERS_PER_CANDIDATE 4
+
+struct MergeCandidate
+{
+	int set[MAX_CLUSTERS_PER_CANDIDATE] = { 0 };
+	int count = 0;
+	int score = 0;
+
+	void Push(int c)
+	{
+		assert(count < MAX_CLUSTERS_PER_CANDIDATE);
+		set[count] = c;
+		count += 1;
+	}
+
+	int Pop()
+	{
+		assert(count > 0);
+		count -= 1;
+		return set[count];
+	}
+
+	bool Contains(int c) const
+	{
+		for (int i = 0; i < count; ++i)
+			if (set[i] == c)
+				return true;
+		return false;
+	}
+};
+
+enum class ClusterGrouping : int
+{
+	Greedy, // Recursive best candidate search seeded from the least connected cluster
+	Partition, // Multilevel graph partitioning, coarsening by heavy edge matching followed by refinement
+};
+
+struct GroupingStats
+{
+	int clusterCount = 0;
+	int groupCount = 0;
+	int sizeHistogram[MAX_CLUSTERS_PER_CANDIDATE + 1] = { 0 };
+	int edgeCut = 0; // Shared edges between clusters that ended up in different groups
+	int totalEdges = 0; // All shared edges between clusters
+	double timeMs = 0.0;
+
+	void Add(const GroupingStats& other);
+};
+
+// Splits the clusters into groups of about PREFERED_CLUSTERS_PER_CANDIDATE connected clusters, every cluster ends up in exactly one group
+void GroupClusters(ClusterGrouping grouping, int clusterCount, const FlatHashMap<int>& clusterAdjacencyMap, const std::vector<std::pair<int, int>>& clusterAdjacencyCount, std::vector<MergeCandidate>& mergeLists);
+// Adds the group sizes and edge cut of mergeLists to stats, timeMs is left to the caller
+void ComputeGroupingStats(int clusterCount, const FlatHashMap<int>& clusterAdjacencyMap, const std::vector<MergeCandidate>& mergeLists, GroupingStats& stats);
+const char* GetClusterGroupingName(ClusterGrouping grouping);
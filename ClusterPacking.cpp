@@ -0,0 +1,457 @@
+#include "ClusterPacking.h"
+#include "PackedTriangles.h"
+#include "Parallel.h"
+#include "meshoptimizer.h"
+
+#include <cassert>
+#include <cfloat>
+#include <algorithm>
+
+#define PACK_MAX_ERROR_RATIO 1.25f // Largest to smallest error of the groups a run may merge
+
+// One output cluster: the source clusters it takes the LOD data of, its vertices and triangles local to them
+struct ClusterBin
+{
+	std::vector<UINT> members;
+	std::vector<UINT> vertices; // Source vertex indices
+	std::vector<unsigned char> triangles; // glTF winding
+};
+
+// What meshopt_generateVertexRemap compares, position first so meshopt_buildMeshlets can read it too
+struct PackVertex
+{
+	float3 position;
+	float3 normal;
+	float4 tangent;
+	float2 texcoord;
+};
+
+struct VertexStreams
+{
+	const float3* positions;
+	const float3* normals;
+	const float4* tangents;
+	const float2* texcoords;
+	const uint32_t* triangles;
+};
+
+// Stored triangles have two corners swapped for the rasterizer, meshopt works on the glTF winding
+static void AddClusterTriangles(const Cluster& cluster, const uint32_t* triangles, UINT vertexBase, std::vector<unsigned int>& indices)
+{
+	for (UINT t = 0; t < cluster.PrimitiveCount; ++t)
+	{
+		uint32_t corners[3];
+		UnpackTriangle(triangles[cluster.PrimitiveStart + t], corners);
+		indices.push_back(vertexBase + corners[0]);
+		indices.push_back(vertexBase + corners[2]);
+		indices.push_back(vertexBase + corners[1]);
+	}
+}
+
+static void AddSingleBin(const Cluster& cluster, UINT c, const VertexStreams& streams, std::vector<ClusterBin>& bins)
+{
+	std::vector<unsigned int> indices;
+	AddClusterTriangles(cluster, streams.triangles, 0, indices);
+
+	ClusterBin& bin = bins.emplace_back();
+	bin.members.push_back(c);
+	for (UINT v = 0; v < cluster.VertexCount; ++v)
+		bin.vertices.push_back(cluster.VertexStart + v);
+	bin.triangles.assign(indices.begin(), indices.end());
+}
+
+static void KeepClusters(const std::vector<UINT>& run, const std::vector<Cluster>& clusters, const VertexStreams& streams, std::vector<ClusterBin>& bins)
+{
+	for (UINT c : run)
+		AddSingleBin(clusters[c], c, streams, bins);
+}
+
+// Clusters of a run leave the LOD cut together, and once the groups that produced them are merged they also enter it
+// together, so their triangles can be clustered again as one set. That merges underfilled clusters, the partly filled
+// tails of the groups in particular, and spreads the triangles of a tail over the others
+static void PackClusterRun(const std::vector<UINT>& run, const std::vector<Cluster>& clusters, const VertexStreams& streams,
+	uint32_t maxVertices, uint32_t maxTriangles, float coneWeight, std::vector<ClusterBin>& bins)
+{
+	// Too many triangles to fit in fewer clusters, and the welded vertices below make for a second such bound
+	size_t triangleCount = 0;
+	for (UINT c : run)
+		triangleCount += clusters[c].PrimitiveCount;
+	if ((triangleCount + maxTriangles - 1) / maxTriangles >= run.size())
+	{
+		KeepClusters(run, clusters, streams, bins);
+		return;
+	}
+
+	// Vertices the clusters share are stored once per cluster, weld them so the new clusters can share them too
+	std::vector<PackVertex> vertices;
+	std::vector<UINT> sourceVertices;
+	std::vector<unsigned int> indices;
+	for (UINT c : run)
+	{
+		const Cluster& cluster = clusters[c];
+		AddClusterTriangles(cluster, streams.triangles, (UINT)vertices.size(), indices);
+		for (UINT v = cluster.VertexStart; v < cluster.VertexStart + cluster.VertexCount; ++v)
+		{
+			vertices.push_back(PackVertex{ streams.positions[v], streams.normals[v], streams.tangents[v], streams.texcoords[v] });
+			sourceVertices.push_back(v);
+		}
+	}
+
+	std::vector<unsigned int> remap(vertices.size());
+	size_t uniqueCount = meshopt_generateVertexRemap(remap.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(PackVertex));
+	meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+	if ((uniqueCount + maxVertices - 1) / maxVertices >= run.size())
+	{
+		KeepClusters(run, clusters, streams, bins);
+		return;
+	}
+
+	std::vector<PackVertex> uniqueVertices(uniqueCount);
+	std::vector<UINT> uniqueSources(uniqueCount);
+	for (size_t v = 0; v < vertices.size(); ++v)
+	{
+		uniqueVertices[remap[v]] = vertices[v];
+		uniqueSources[remap[v]] = sourceVertices[v];
+	}
+
+	size_t maxMeshlets = meshopt_buildMeshletsBound(indices.size(), maxVertices, maxTriangles);
+	std::vector<meshopt_Meshlet> meshlets(maxMeshlets);
+	std::vector<unsigned int> meshletVertices(maxMeshlets * maxVertices);
+	std::vector<unsigned char> meshletTriangles(maxMeshlets * maxTriangles * 3);
+	size_t meshletCount = meshopt_buildMeshlets(meshlets.data(), meshletVertices.data(), meshletTriangles.data(), indices.data(), indices.size(),
+		&uniqueVertices[0].position.x, uniqueCount, sizeof(PackVertex), maxVertices, maxTriangles, coneWeight);
+
+	// The greedy clustering doesn't always beat what the cook had, keep the old clusters then
+	if (meshletCount >= run.size())
+	{
+		KeepClusters(run, clusters, streams, bins);
+		return;
+	}
+
+	for (size_t ml = 0; ml < meshletCount; ++ml)
+	{
+		const meshopt_Meshlet& meshlet = meshlets[ml];
+		ClusterBin& bin = bins.emplace_back();
+		bin.members = run;
+		for (UINT v = 0; v < meshlet.vertex_count; ++v)
+			bin.vertices.push_back(uniqueSources[meshletVertices[meshlet.vertex_offset + v]]);
+		bin.triangles.assign(meshletTriangles.begin() + meshlet.triangle_offset, meshletTriangles.begin() + meshlet.triangle_offset + meshlet.triangle_count * 3);
+	}
+}
+
+// Runs of the clusters [start, start + count) in the order their first cluster comes in, the clusters sharing a
+// ParentGroup and run group, see FindRunGroups
+static void FindClusterRuns(UINT start, UINT count, const std::vector<ClusterLod>& clusterLods, const std::vector<UINT>& runGroups,
+	std::vector<std::vector<UINT>>& runs)
+{
+	std::vector<UINT> order(count);
+	for (UINT i = 0; i < count; ++i)
+		order[i] = start + i;
+	std::stable_sort(order.begin(), order.end(), [&](UINT a, UINT b)
+	{
+		if (clusterLods[a].ParentGroup != clusterLods[b].ParentGroup)
+			return clusterLods[a].ParentGroup < clusterLods[b].ParentGroup;
+		return runGroups[a] < runGroups[b];
+	});
+
+	size_t firstRun = runs.size();
+	for (size_t first = 0; first < order.size();)
+	{
+		size_t end = first + 1;
+		while (end < order.size() && clusterLods[order[end]].ParentGroup == clusterLods[order[first]].ParentGroup && runGroups[order[end]] == runGroups[order[first]])
+			end += 1;
+		runs.emplace_back(order.begin() + first, order.begin() + end);
+		first = end;
+	}
+	std::sort(runs.begin() + firstRun, runs.end(), [](const std::vector<UINT>& a, const std::vector<UINT>& b) { return a[0] < b[0]; });
+}
+
+static float4 MergeSpheres(const std::vector<float4>& spheres)
+{
+	float3 minPos = float3(FLT_MAX, FLT_MAX, FLT_MAX);
+	float3 maxPos = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (const float4& sphere : spheres)
+	{
+		minPos = min(minPos, float3(sphere.x, sphere.y, sphere.z) - float3(sphere.w));
+		maxPos = max(maxPos, float3(sphere.x, sphere.y, sphere.z) + float3(sphere.w));
+	}
+
+	float3 center = (minPos + maxPos) * 0.5f;
+	float radius = 0.0f;
+	for (const float4& sphere : spheres)
+		radius = std::max(radius, length(float3(sphere.x, sphere.y, sphere.z) - center) + sphere.w);
+	return float4(center, radius);
+}
+
+// Per cluster, the group its run merges it into. The children of a group come from groups with about the same error,
+// those within PACK_MAX_ERROR_RATIO of the smallest error of the run share it. A merged group takes the largest error
+// and keeps the cut on finer levels for longer, so groups with errors further apart stay in runs of their own.
+// Clusters of the first and last level keep their own Group
+static std::vector<UINT> FindRunGroups(const std::vector<ClusterGroup>& groups, const std::vector<ClusterLod>& clusterLods)
+{
+	std::vector<UINT> runGroups(clusterLods.size());
+	std::vector<UINT> order;
+	for (UINT c = 0; c < clusterLods.size(); ++c)
+	{
+		runGroups[c] = clusterLods[c].Group;
+		if (clusterLods[c].Group != LOD_GROUP_NONE && clusterLods[c].ParentGroup != LOD_GROUP_NONE)
+			order.push_back(c);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](UINT a, UINT b)
+	{
+		if (clusterLods[a].ParentGroup != clusterLods[b].ParentGroup)
+			return clusterLods[a].ParentGroup < clusterLods[b].ParentGroup;
+		return groups[clusterLods[a].Group].Error < groups[clusterLods[b].Group].Error;
+	});
+
+	for (size_t first = 0; first < order.size();)
+	{
+		const ClusterLod& key = clusterLods[order[first]];
+		float maxError = groups[key.Group].Error * PACK_MAX_ERROR_RATIO;
+		size_t end = first + 1;
+		while (end < order.size() && clusterLods[order[end]].ParentGroup == key.ParentGroup && groups[clusterLods[order[end]].Group].Error <= maxError)
+			runGroups[order[end++]] = key.Group;
+		first = end;
+	}
+	return runGroups;
+}
+
+static UINT FindGroupRoot(std::vector<UINT>& groupRoots, UINT group)
+{
+	while (groupRoots[group] != group)
+	{
+		groupRoots[group] = groupRoots[groupRoots[group]];
+		group = groupRoots[group];
+	}
+	return group;
+}
+
+// The groups that produced a packed run become one group with the bounds and error of all of them. A parent of a
+// merged group may then have less error or smaller bounds than it, those grow to cover it level by level up the DAG.
+// Groups merged into another are left without clusters. Returns the number of groups merged away
+static size_t MergeClusterGroups(std::vector<ClusterGroup>& groups, std::vector<UINT>& groupRoots, std::vector<ClusterLod>& clusterLods)
+{
+	std::vector<std::vector<float4>> rootSpheres(groups.size());
+	size_t mergedGroups = 0;
+	for (UINT g = 0; g < groups.size(); ++g)
+	{
+		UINT root = FindGroupRoot(groupRoots, g);
+		if (root == g)
+			continue;
+		if (rootSpheres[root].empty())
+			rootSpheres[root].push_back(groups[root].Sphere);
+		rootSpheres[root].push_back(groups[g].Sphere);
+		groups[root].Error = std::max(groups[root].Error, groups[g].Error);
+		mergedGroups += 1;
+	}
+	if (mergedGroups == 0)
+		return 0;
+
+	for (UINT g = 0; g < groups.size(); ++g)
+	{
+		if (!rootSpheres[g].empty())
+			groups[g].Sphere = MergeSpheres(rootSpheres[g]);
+	}
+
+	// Parents come after all their children when sorted by the level of their children
+	std::vector<UINT> order;
+	for (UINT c = 0; c < clusterLods.size(); ++c)
+	{
+		ClusterLod& clusterLod = clusterLods[c];
+		if (clusterLod.Group != LOD_GROUP_NONE)
+			clusterLod.Group = FindGroupRoot(groupRoots, clusterLod.Group);
+		if (clusterLod.ParentGroup != LOD_GROUP_NONE)
+			clusterLod.ParentGroup = FindGroupRoot(groupRoots, clusterLod.ParentGroup);
+		if (clusterLod.Group != LOD_GROUP_NONE && clusterLod.ParentGroup != LOD_GROUP_NONE)
+			order.push_back(c);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](UINT a, UINT b) { return groups[clusterLods[a].ParentGroup].Level < groups[clusterLods[b].ParentGroup].Level; });
+	for (UINT c : order)
+	{
+		const ClusterGroup& group = groups[clusterLods[c].Group];
+		ClusterGroup& parent = groups[clusterLods[c].ParentGroup];
+		parent.Error = std::max(parent.Error, group.Error);
+		if (length(float3(group.Sphere.x, group.Sphere.y, group.Sphere.z) - float3(parent.Sphere.x, parent.Sphere.y, parent.Sphere.z)) + group.Sphere.w > parent.Sphere.w)
+			parent.Sphere = MergeSpheres({ parent.Sphere, group.Sphere });
+	}
+
+	for (ClusterLod& clusterLod : clusterLods)
+	{
+		if (clusterLod.Group != LOD_GROUP_NONE)
+		{
+			clusterLod.Sphere = groups[clusterLod.Group].Sphere;
+			clusterLod.Error = groups[clusterLod.Group].Error;
+		}
+		if (clusterLod.ParentGroup != LOD_GROUP_NONE)
+		{
+			clusterLod.ParentSphere = groups[clusterLod.ParentGroup].Sphere;
+			clusterLod.ParentError = groups[clusterLod.ParentGroup].Error;
+		}
+		else
+			clusterLod.ParentSphere = clusterLod.Sphere;
+	}
+	return mergedGroups;
+}
+
+ClusterPackingStats PackClusters(std::vector<Mesh>& meshes, std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters, std::vector<ClusterLod>& clusterLods,
+	std::vector<float3>& positions, std::vector<float3>& normals, std::vector<float4>& tangents, std::vector<float2>& texcoords,
+	std::vector<uint32_t>& triangles, uint32_t maxVertices, uint32_t maxTriangles, float coneWeight)
+{
+	ClusterPackingStats stats;
+	stats.clustersBefore = clusters.size();
+	stats.verticesBefore = positions.size();
+
+	std::vector<UINT> runGroups = FindRunGroups(groups, clusterLods);
+
+	// Every run is packed on its own, the runs of a mesh list stay in order
+	struct MeshRuns { size_t defaultEnd, end; };
+	std::vector<std::vector<UINT>> runs;
+	std::vector<MeshRuns> meshRuns(meshes.size());
+	for (size_t m = 0; m < meshes.size(); ++m)
+	{
+		const Mesh& mesh = meshes[m];
+		FindClusterRuns(mesh.ClusterStart, mesh.ClusterCount, clusterLods, runGroups, runs);
+		meshRuns[m].defaultEnd = runs.size();
+		FindClusterRuns(mesh.ClusterStart + mesh.ClusterCount, mesh.LodClusterCount - mesh.ClusterCount, clusterLods, runGroups, runs);
+		meshRuns[m].end = runs.size();
+	}
+
+	VertexStreams streams = { positions.data(), normals.data(), tangents.data(), texcoords.data(), triangles.data() };
+	std::vector<std::vector<ClusterBin>> runBins(runs.size());
+	ParallelFor(runs.size(), [&](size_t r)
+	{
+		PackClusterRun(runs[r], clusters, streams, maxVertices, maxTriangles, coneWeight, runBins[r]);
+	});
+
+	// A packed run merges the groups that produced its clusters
+	std::vector<ClusterBin> bins;
+	std::vector<UINT> groupRoots(groups.size());
+	for (UINT g = 0; g < groups.size(); ++g)
+		groupRoots[g] = g;
+	size_t run = 0;
+	for (size_t m = 0; m < meshes.size(); ++m)
+	{
+		Mesh& mesh = meshes[m];
+		mesh.ClusterStart = (UINT)bins.size();
+		for (; run < meshRuns[m].end; ++run)
+		{
+			if (run == meshRuns[m].defaultEnd)
+				mesh.ClusterCount = UINT(bins.size() - mesh.ClusterStart);
+			for (ClusterBin& bin : runBins[run])
+				bins.push_back(std::move(bin));
+
+			if (runBins[run].size() == runs[run].size())
+				continue;
+			stats.packedRuns += 1;
+			UINT group = clusterLods[runs[run][0]].Group;
+			if (group == LOD_GROUP_NONE)
+				continue;
+			for (UINT c : runs[run])
+				groupRoots[FindGroupRoot(groupRoots, clusterLods[c].Group)] = FindGroupRoot(groupRoots, group);
+		}
+		if (meshRuns[m].defaultEnd == meshRuns[m].end)
+			mesh.ClusterCount = UINT(bins.size() - mesh.ClusterStart);
+		mesh.LodClusterCount = UINT(bins.size() - mesh.ClusterStart);
+	}
+	runBins.clear();
+
+	// Every bin's place in the new streams
+	std::vector<UINT> vertexStarts(bins.size()), triangleStarts(bins.size());
+	size_t vertexCount = 0, triangleCount = 0;
+	for (size_t b = 0; b < bins.size(); ++b)
+	{
+		vertexStarts[b] = (UINT)vertexCount;
+		triangleStarts[b] = (UINT)triangleCount;
+		vertexCount += bins[b].vertices.size();
+		triangleCount += bins[b].triangles.size() / 3;
+	}
+
+	std::vector<Cluster> packedClusters(bins.size());
+	std::vector<ClusterLod> packedClusterLods(bins.size());
+	std::vector<float3> packedPositions(vertexCount);
+	std::vector<float3> packedNormals(vertexCount);
+	std::vector<float4> packedTangents(vertexCount);
+	std::vector<float2> packedTexcoords(vertexCount);
+	std::vector<uint32_t> packedTriangles(triangleCount);
+	ParallelFor(bins.size(), [&](size_t b)
+	{
+		ClusterBin& bin = bins[b];
+		UINT binTriangleCount = UINT(bin.triangles.size() / 3);
+		assert(bin.vertices.size() <= PACKED_TRIANGLE_MAX_VERTICES);
+
+		// Triangles in vertex cache order and vertices in the order the triangles use them
+		meshopt_optimizeMeshlet(bin.vertices.data(), bin.triangles.data(), binTriangleCount, bin.vertices.size());
+
+		MinMaxAABB box = MinMaxAABB{
+			float3 {FLT_MAX, FLT_MAX, FLT_MAX},
+			float3 {-FLT_MAX, -FLT_MAX, -FLT_MAX},
+		};
+		UINT vertexStart = vertexStarts[b];
+		for (size_t v = 0; v < bin.vertices.size(); ++v)
+		{
+			UINT source = bin.vertices[v];
+			packedPositions[vertexStart + v] = positions[source];
+			packedNormals[vertexStart + v] = normals[source];
+			packedTangents[vertexStart + v] = tangents[source];
+			packedTexcoords[vertexStart + v] = texcoords[source];
+			box.Min = min(box.Min, positions[source]);
+			box.Max = max(box.Max, positions[source]);
+		}
+
+		for (UINT t = 0; t < binTriangleCount; ++t)
+			packedTriangles[triangleStarts[b] + t] = PackTriangle(bin.triangles[t * 3 + 0], bin.triangles[t * 3 + 2], bin.triangles[t * 3 + 1]);
+		meshopt_Bounds coneBounds = meshopt_computeMeshletBounds(bin.vertices.data(), bin.triangles.data(), binTriangleCount, &positions[0].x, positions.size(), sizeof(float3));
+
+		packedClusters[b] = Cluster{
+			triangleStarts[b],
+			binTriangleCount,
+			vertexStart,
+			(UINT)bin.vertices.size(),
+			MinMaxToCenterExtents(box),
+			float4(coneBounds.center[0], coneBounds.center[1], coneBounds.center[2], coneBounds.radius),
+			float4(coneBounds.cone_axis[0], coneBounds.cone_axis[1], coneBounds.cone_axis[2], coneBounds.cone_cutoff),
+			0, // Pages are built after packing, see BuildClusterPages
+			0,
+			0,
+		};
+
+		// Every level but the first has the bounds of its group per cluster, the first level has bounds of its own
+		ClusterLod& clusterLod = packedClusterLods[b];
+		clusterLod = clusterLods[bin.members[0]];
+		if (clusterLod.Group == LOD_GROUP_NONE && bin.members.size() > 1)
+		{
+			std::vector<float4> spheres;
+			for (UINT c : bin.members)
+				spheres.push_back(clusterLods[c].Sphere);
+			clusterLod.Sphere = MergeSpheres(spheres);
+			if (clusterLod.ParentGroup == LOD_GROUP_NONE)
+				clusterLod.ParentSphere = clusterLod.Sphere;
+		}
+	});
+
+	stats.mergedGroups = MergeClusterGroups(groups, groupRoots, packedClusterLods);
+	for (ClusterGroup& group : groups)
+	{
+		group.ChildCount = 0;
+		group.ParentCount = 0;
+	}
+	for (const ClusterLod& clusterLod : packedClusterLods)
+	{
+		if (clusterLod.Group != LOD_GROUP_NONE)
+			groups[clusterLod.Group].ParentCount += 1;
+		if (clusterLod.ParentGroup != LOD_GROUP_NONE)
+			groups[clusterLod.ParentGroup].ChildCount += 1;
+	}
+
+	clusters.swap(packedClusters);
+	clusterLods.swap(packedClusterLods);
+	positions.swap(packedPositions);
+	normals.swap(packedNormals);
+	tangents.swap(packedTangents);
+	texcoords.swap(packedTexcoords);
+	triangles.swap(packedTriangles);
+
+	stats.clustersAfter = clusters.size();
+	stats.verticesAfter = positions.size();
+	return stats;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Render.h"
+
+#include <cstdint>
+#include <vector>
+
+// Cluster packing, -packclusters
+// Every primitive is clusterized on its own and every LOD group builds its own clusters, so the last cluster of each
+// meshopt_buildMeshlets call is partly filled and small primitives give nothing but partly filled clusters. Each one
+// still costs a mesh shader group and a culling test. The children of a group, the clusters of a mesh that the LOD cut
+// always drops together, get clustered again as one set of triangles. That merges underfilled clusters, across
+// primitives too on a first level that was never simplified, and the tails the groups below left. Vertices the clusters
+// share are welded first so the new clusters share them too. A run keeps its clusters if clustering it again doesn't
+// give fewer. Every cluster, packed or not, gets meshopt_optimizeMeshlet.
+// Above the first level the children of a group come from several groups, a packed run merges those so the new
+// clusters have one Group. The merged group has their largest error and the groups above grow to cover it, so only
+// groups with about the same error share a run, see PACK_MAX_ERROR_RATIO.
+// Clusters stay within their mesh and LOD list, the default level stays first so Mesh ranges keep their meaning.
+// A mesh has one material (see ConvertNodeHierarchy), so clusters of a mesh never mix materials.
+
+struct ClusterPackingStats
+{
+	size_t clustersBefore = 0;
+	size_t clustersAfter = 0;
+	size_t verticesBefore = 0;
+	size_t verticesAfter = 0;
+	size_t packedRuns = 0; // Runs that came out with fewer clusters
+	size_t mergedGroups = 0; // Groups merged into another one, they are left without clusters
+};
+
+// Rebuilds all streams, VertexStart and PrimitiveStart point into the new ones. Group child and parent counts follow
+ClusterPackingStats PackClusters(std::vector<Mesh>& meshes, std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters, std::vector<ClusterLod>& clusterLods,
+	std::vector<float3>& positions, std::vector<float3>& normals, std::vector<float4>& tangents, std::vector<float2>& texcoords,
+	std::vector<uint32_t>& triangles, uint32_t maxVertices, uint32_t maxTriangles, float coneWeight);
@@ -0,0 +1,268 @@
+#include "ClusterStreaming.h"
+#include "VertexQuantization.h"
+
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+#if defined(_WIN32)
+#define fseek64 _fseeki64
+#else
+#define fseek64 fseeko
+#endif
+
+void GetPageStreamStrides(uint32_t vertexFormat, uint32_t strides[PAGE_STREAM_COUNT])
+{
+	if (vertexFormat == VERTEX_FORMAT_QUANTIZED)
+	{
+		strides[0] = sizeof(QuantizedPosition);
+		strides[1] = sizeof(uint32_t);
+		strides[2] = sizeof(uint32_t);
+		strides[3] = sizeof(uint32_t);
+	}
+	else
+	{
+		strides[0] = sizeof(float3);
+		strides[1] = sizeof(float3);
+		strides[2] = sizeof(float4);
+		strides[3] = sizeof(float2);
+	}
+	strides[4] = sizeof(uint32_t); // Packed triangles
+}
+
+void GetPageStreamOffsets(const ClusterPage& page, const uint32_t strides[PAGE_STREAM_COUNT], uint32_t offsets[PAGE_STREAM_COUNT])
+{
+	uint32_t offset = 0;
+	for (int s = 0; s < PAGE_STREAM_COUNT; ++s)
+	{
+		offsets[s] = offset;
+		offset += strides[s] * (s < PAGE_STREAM_COUNT - 1 ? page.vertexCount : page.triangleCount);
+	}
+}
+
+size_t GetPageSlotSize(const uint32_t strides[PAGE_STREAM_COUNT])
+{
+	size_t size = 0;
+	for (int s = 0; s < PAGE_STREAM_COUNT; ++s)
+		size += size_t(strides[s]) * (s < PAGE_STREAM_COUNT - 1 ? CLUSTER_PAGE_VERTICES : CLUSTER_PAGE_TRIANGLES);
+	return size;
+}
+
+void BuildClusterPages(std::vector<Cluster>& clusters, const void* const vertexStreams[PAGE_STREAM_COUNT - 1], const uint32_t* triangles, uint32_t vertexFormat,
+	std::vector<ClusterPage>& pages, std::vector<uint8_t>& pageData)
+{
+	uint32_t strides[PAGE_STREAM_COUNT];
+	GetPageStreamStrides(vertexFormat, strides);
+
+	pages.clear();
+	pageData.clear();
+
+	// Greedy in cluster order, the clusters of a LOD level of a primitive are next to each other so pages stay local
+	auto flushPage = [&](ClusterPage& page)
+	{
+		uint32_t offsets[PAGE_STREAM_COUNT];
+		GetPageStreamOffsets(page, strides, offsets);
+		page.offset = pageData.size();
+		page.size = offsets[PAGE_STREAM_COUNT - 1] + strides[PAGE_STREAM_COUNT - 1] * page.triangleCount;
+		pageData.resize((size_t)page.offset + (page.size + PAGE_DATA_ALIGNMENT - 1) / PAGE_DATA_ALIGNMENT * PAGE_DATA_ALIGNMENT, 0);
+
+		uint8_t* data = pageData.data() + page.offset;
+		for (uint32_t ic = page.clusterStart; ic < page.clusterStart + page.clusterCount; ++ic)
+		{
+			const Cluster& cluster = clusters[ic];
+			for (int s = 0; s < PAGE_STREAM_COUNT - 1; ++s)
+			{
+				memcpy(data + offsets[s] + cluster.PageVertexStart * strides[s],
+					(const uint8_t*)vertexStreams[s] + size_t(cluster.VertexStart) * strides[s], size_t(cluster.VertexCount) * strides[s]);
+			}
+			memcpy(data + offsets[PAGE_STREAM_COUNT - 1] + cluster.PagePrimitiveStart * strides[PAGE_STREAM_COUNT - 1],
+				triangles + cluster.PrimitiveStart, size_t(cluster.PrimitiveCount) * strides[PAGE_STREAM_COUNT - 1]);
+		}
+
+		pages.push_back(page);
+	};
+
+	ClusterPage page = {};
+	for (uint32_t ic = 0; ic < clusters.size(); ++ic)
+	{
+		Cluster& cluster = clusters[ic];
+		assert(cluster.VertexCount <= CLUSTER_PAGE_VERTICES && cluster.PrimitiveCount <= CLUSTER_PAGE_TRIANGLES);
+
+		if (page.vertexCount + cluster.VertexCount > CLUSTER_PAGE_VERTICES || page.triangleCount + cluster.PrimitiveCount > CLUSTER_PAGE_TRIANGLES)
+		{
+			flushPage(page);
+			page = {};
+			page.clusterStart = ic;
+		}
+
+		cluster.Page = (UINT)pages.size();
+		cluster.PageVertexStart = page.vertexCount;
+		cluster.PagePrimitiveStart = page.triangleCount;
+		page.clusterCount += 1;
+		page.vertexCount += cluster.VertexCount;
+		page.triangleCount += cluster.PrimitiveCount;
+	}
+	if (page.clusterCount > 0)
+		flushPage(page);
+}
+
+void ClusterStreamingStats::Add(const ClusterStreamingStats& other)
+{
+	requests += other.requests;
+	hits += other.hits;
+	loads += other.loads;
+	evictions += other.evictions;
+	deferred += other.deferred;
+	bytesStreamed += other.bytesStreamed;
+}
+
+void ClusterPageStreamer::Initialize(const ClusterPage* pages_, uint32_t pageCount_, uint32_t slotCount_, uint32_t loadsPerFrame_, uint32_t keepFrames_)
+{
+	pages = pages_;
+	pageCount = pageCount_;
+	slotCount = slotCount_;
+	loadsPerFrame = loadsPerFrame_;
+	keepFrames = keepFrames_;
+	frame = 0;
+
+	pageTable.assign(pageCount, PAGE_NOT_RESIDENT);
+	pageRequestFrames.assign(pageCount, 0);
+	slotPages.assign(slotCount, PAGE_NOT_RESIDENT);
+	slotPrev.assign(slotCount, PAGE_NOT_RESIDENT);
+	slotNext.assign(slotCount, PAGE_NOT_RESIDENT);
+	lruHead = PAGE_NOT_RESIDENT;
+	lruTail = PAGE_NOT_RESIDENT;
+
+	// Hand out the low slots first
+	freeSlots.resize(slotCount);
+	for (uint32_t s = 0; s < slotCount; ++s)
+		freeSlots[s] = slotCount - 1 - s;
+}
+
+void ClusterPageStreamer::Unlink(uint32_t slot)
+{
+	uint32_t prev = slotPrev[slot];
+	uint32_t next = slotNext[slot];
+	if (prev != PAGE_NOT_RESIDENT)
+		slotNext[prev] = next;
+	else
+		lruHead = next;
+	if (next != PAGE_NOT_RESIDENT)
+		slotPrev[next] = prev;
+	else
+		lruTail = prev;
+	slotPrev[slot] = PAGE_NOT_RESIDENT;
+	slotNext[slot] = PAGE_NOT_RESIDENT;
+}
+
+void ClusterPageStreamer::PushFront(uint32_t slot)
+{
+	slotPrev[slot] = PAGE_NOT_RESIDENT;
+	slotNext[slot] = lruHead;
+	if (lruHead != PAGE_NOT_RESIDENT)
+		slotPrev[lruHead] = slot;
+	else
+		lruTail = slot;
+	lruHead = slot;
+}
+
+void ClusterPageStreamer::Update(const uint32_t* requestedPages, size_t requestCount, const std::function<void(uint32_t page, uint32_t slot)>& load, ClusterStreamingStats& stats)
+{
+	frame += 1;
+
+	// Touch the resident pages first, so none of them gets evicted for a miss of the same frame
+	std::vector<uint32_t> misses;
+	for (size_t r = 0; r < requestCount; ++r)
+	{
+		uint32_t page = requestedPages[r];
+		assert(page < pageCount);
+		if (pageRequestFrames[page] == frame)
+			continue;
+		pageRequestFrames[page] = frame;
+		stats.requests += 1;
+
+		uint32_t slot = pageTable[page];
+		if (slot == PAGE_NOT_RESIDENT)
+		{
+			misses.push_back(page);
+			continue;
+		}
+
+		stats.hits += 1;
+		Unlink(slot);
+		PushFront(slot);
+	}
+
+	uint32_t loads = 0;
+	for (size_t m = 0; m < misses.size(); ++m)
+	{
+		uint32_t page = misses[m];
+
+		uint32_t slot = PAGE_NOT_RESIDENT;
+		if (loads < loadsPerFrame || loadsPerFrame == 0)
+		{
+			if (!freeSlots.empty())
+			{
+				slot = freeSlots.back();
+				freeSlots.pop_back();
+			}
+			else if (lruTail != PAGE_NOT_RESIDENT && pageRequestFrames[slotPages[lruTail]] + keepFrames < frame)
+			{
+				slot = lruTail;
+				Unlink(slot);
+				pageTable[slotPages[slot]] = PAGE_NOT_RESIDENT;
+				stats.evictions += 1;
+			}
+		}
+
+		if (slot == PAGE_NOT_RESIDENT)
+		{
+			stats.deferred += misses.size() - m;
+			break;
+		}
+
+		load(page, slot);
+		slotPages[slot] = page;
+		pageTable[page] = slot;
+		PushFront(slot);
+		loads += 1;
+		stats.loads += 1;
+		stats.bytesStreamed += pages[page].size;
+	}
+}
+
+bool PageFileLoader::Open(const char* filename, const SceneFile& sceneFile, uint32_t slotCount)
+{
+	Close();
+
+	const SceneSection* pageDataSection = sceneFile.FindSection(SceneSectionType::PageData);
+	if (!pageDataSection)
+		return false;
+
+	file = fopen(filename, "rb");
+	if (!file)
+		return false;
+
+	uint32_t strides[PAGE_STREAM_COUNT];
+	GetPageStreamStrides(pageDataSection->format, strides);
+	pageDataOffset = pageDataSection->offset;
+	slotSize = GetPageSlotSize(strides);
+	pool.resize(slotSize * slotCount);
+	return true;
+}
+
+void PageFileLoader::Close()
+{
+	if (file)
+		fclose(file);
+	file = nullptr;
+	pool.clear();
+}
+
+bool PageFileLoader::Load(const ClusterPage& page, uint32_t slot)
+{
+	assert(page.size <= slotSize && (slot + 1) * slotSize <= pool.size());
+	if (fseek64(file, (long long)(pageDataOffset + page.offset), SEEK_SET) != 0)
+		return false;
+	return fread(pool.data() + slot * slotSize, 1, page.size, file) == page.size;
+}
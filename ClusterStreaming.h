@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Render.h"
+#include "SceneFile.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <functional>
+
+// Cluster geometry streaming
+// The generator cooks the clusters into pages of whole clusters in cluster order, see CLUSTER_PAGE_VERTICES in Common.h.
+// A page stores its vertex streams and its triangles back to back, the streams only hold the vertices of its clusters
+// and Cluster::PageVertexStart / PagePrimitiveStart locate a cluster within its page.
+// The streamer keeps a fixed pool of page slots, it loads the pages that are asked for and evicts the least recently used ones.
+// It only deals in page and slot numbers, the loading itself is done by a callback so it runs the same with and without a GPU.
+// A scene with pages has no whole scene vertex and index streams, the geometry is only stored once.
+
+#define PAGE_STREAM_COUNT 5 // Positions, normals, tangents, texcoords, packed triangles
+#define PAGE_DATA_ALIGNMENT 16 // Of every page in the PageData section
+
+// Entry of the page table section, the page data itself is in the PageData section
+struct ClusterPage
+{
+	uint64_t offset; // From the start of the PageData section
+	uint32_t size;
+	uint32_t clusterStart;
+	uint32_t clusterCount;
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	uint32_t padding;
+};
+
+// Element sizes of the page streams for a VERTEX_FORMAT_*, the index stream is in triangles
+void GetPageStreamStrides(uint32_t vertexFormat, uint32_t strides[PAGE_STREAM_COUNT]);
+// Byte offsets of the page streams within the page data
+void GetPageStreamOffsets(const ClusterPage& page, const uint32_t strides[PAGE_STREAM_COUNT], uint32_t offsets[PAGE_STREAM_COUNT]);
+// Size of a full page, what a slot of the pool has to hold
+size_t GetPageSlotSize(const uint32_t strides[PAGE_STREAM_COUNT]);
+
+// Cooking: assigns the clusters to pages in cluster order, fills in their page location and copies their geometry into the pages.
+// vertexStreams are the four vertex streams in vertexFormat, triangles are packed like in the Indices section.
+void BuildClusterPages(std::vector<Cluster>& clusters, const void* const vertexStreams[PAGE_STREAM_COUNT - 1], const uint32_t* triangles, uint32_t vertexFormat,
+	std::vector<ClusterPage>& pages, std::vector<uint8_t>& pageData);
+
+struct ClusterStreamingStats
+{
+	uint64_t requests = 0; // Unique pages asked for
+	uint64_t hits = 0; // Of those, already resident
+	uint64_t loads = 0;
+	uint64_t evictions = 0;
+	uint64_t deferred = 0; // Misses left for a later frame, over the load budget or no slot could be freed
+	uint64_t bytesStreamed = 0;
+
+	void Add(const ClusterStreamingStats& other);
+};
+
+struct ClusterPageStreamer
+{
+	const ClusterPage* pages = nullptr;
+	uint32_t pageCount = 0;
+	uint32_t slotCount = 0;
+	uint32_t loadsPerFrame = 0; // 0 = no limit
+	uint32_t keepFrames = 0; // A page asked for in the last keepFrames frames is not evicted, it may still be in use by frames in flight
+	uint64_t frame = 0;
+
+	std::vector<uint32_t> pageTable; // Slot of every page, PAGE_NOT_RESIDENT if it isn't loaded
+	std::vector<uint32_t> slotPages; // Page in every slot, PAGE_NOT_RESIDENT if free
+	std::vector<uint64_t> pageRequestFrames; // Last frame every page was asked for, frame numbers start at 1
+
+	// Slots in least recently used order, an intrusive list so touching a page is O(1)
+	std::vector<uint32_t> slotPrev;
+	std::vector<uint32_t> slotNext;
+	uint32_t lruHead = PAGE_NOT_RESIDENT; // Most recently used
+	uint32_t lruTail = PAGE_NOT_RESIDENT;
+	std::vector<uint32_t> freeSlots;
+
+	void Initialize(const ClusterPage* pages, uint32_t pageCount, uint32_t slotCount, uint32_t loadsPerFrame, uint32_t keepFrames);
+
+	// Starts a new frame with the pages that are needed, duplicates are fine. The missing pages are loaded in request order
+	// until the budget runs out, load is called for each with the slot to load it into. The page table is current once this returns.
+	void Update(const uint32_t* requestedPages, size_t requestCount, const std::function<void(uint32_t page, uint32_t slot)>& load, ClusterStreamingStats& stats);
+
+	uint32_t GetResidentCount() const { return slotCount - (uint32_t)freeSlots.size(); }
+
+	void Unlink(uint32_t slot);
+	void PushFront(uint32_t slot);
+};
+
+// Headless stand-in for the GPU upload, reads pages from the scene file into a CPU copy of the slot pool
+struct PageFileLoader
+{
+	FILE* file = nullptr;
+	uint64_t pageDataOffset = 0; // Of the PageData section in the file
+	size_t slotSize = 0;
+	std::vector<uint8_t> pool;
+
+	PageFileLoader() = default;
+	PageFileLoader(const PageFileLoader&) = delete;
+	PageFileLoader& operator=(const PageFileLoader&) = delete;
+	~PageFileLoader() { Close(); }
+
+	// Returns false if the scene file has no pages
+	bool Open(const char* filename, const SceneFile& sceneFile, uint32_t slotCount);
+	void Close();
+	bool Load(const ClusterPage& page, uint32_t slot);
+};
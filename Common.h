@@ -27,12 +27,35 @@
 
 #define TLAS_SRV 24
 
+#define PAGE_TABLE_SRV 25
+
+#define VERTEX_INDEX_BUFFER_SRV 26
+
 #define VISIBLE_INSTANCES_BITS 16
 #define VISIBLE_CLUSTERS_BITS 16
 
 #define MAX_VISIBLE_INSTANCES ((1 << VISIBLE_INSTANCES_BITS) - 1)
 #define MAX_VISIBLE_CLUSTERS ((1 << VISIBLE_CLUSTERS_BITS) - 1)
 
+// Cluster limits of the default meshlet config, the shaders are compiled with the limits of the scene, see MeshletConfig.h
+#define DEFAULT_MESHLET_MAX_VERTICES 64
+#define DEFAULT_MESHLET_MAX_TRIANGLES 124
+
+// A VBuffer texel is the visible cluster index above the triangle of the cluster
+#define VBUFFER_PRIMITIVE_BITS 8
+#define VBUFFER_PRIMITIVE_MASK ((1 << VBUFFER_PRIMITIVE_BITS) - 1)
+
+// Vertex Format
+#define VERTEX_FORMAT_FLOAT 0
+#define VERTEX_FORMAT_QUANTIZED 1
+
+// Cluster geometry streaming, see ClusterStreaming.h
+// A page holds the geometry of whole clusters, at most CLUSTER_PAGE_VERTICES vertices and CLUSTER_PAGE_TRIANGLES triangles.
+// Every slot of the GPU pool has room for one full page, slot s starts at vertex s * CLUSTER_PAGE_VERTICES and triangle s * CLUSTER_PAGE_TRIANGLES.
+#define CLUSTER_PAGE_VERTICES 2048
+#define CLUSTER_PAGE_TRIANGLES 4096
+#define PAGE_NOT_RESIDENT 0xffffffff
+
 // Debug Mode
 #define DEBUG_MODE_NONE 0
 #define DEBUG_MODE_SHOW_TRIANGLES 1
@@ -61,6 +84,7 @@ struct Camera
     float4x4 InverseProjectionMatrix;
     float4x4 InverseViewProjectionMatrix;
     float4 FrustumPlanes[6];
+    float4 Position; // World space, w unused
 };
 
 CB_ALIGN struct Constants
@@ -69,9 +93,10 @@ CB_ALIGN struct Constants
     Camera DrawingCamera;
     uint4 Counts;
     uint DebugMode;
-    uint Padding0;
-    uint Padding1;
-    uint Padding2;
+    uint VertexFormat;
+    uint PageStreaming; // Geometry is fetched through the page table
+    uint ConeCulling; // Clusters facing away from the culling camera are skipped
+    uint SharedVertices; // Cluster vertices are fetched through the vertex index lists
 };
 
 struct Instance
@@ -87,7 +112,8 @@ struct Instance
 struct Mesh
 {
     uint ClusterStart;
-    uint ClusterCount;
+    uint ClusterCount; // Clusters of the default LOD level
+    uint LodClusterCount; // Clusters of all LOD levels, starting at ClusterStart with the default level first
 
     // TODO: these do not need to be uploaded to GPU
     CenterExtentsAABB Box;
@@ -101,6 +127,38 @@ struct Cluster
     uint VertexCount;
 
     CenterExtentsAABB Box; // TODO: OOBB?
+    float4 Sphere; // Bounding sphere, xyz center, w radius
+    float4 Cone; // Normal cone, xyz axis, w cutoff, from meshopt_computeMeshletBounds. Cutoff 1 never culls
+
+    uint Page; // Streaming page holding the geometry
+    uint PageVertexStart; // Within the page
+    uint PagePrimitiveStart;
+};
+
+#define LOD_GROUP_NONE 0xffffffff
+
+// Per cluster LOD data, in the same order as the clusters
+// A cluster is part of the LOD cut when its own error is small enough and its parent error is not,
+// all clusters of a group share these values so the cut doesn't crack between groups
+struct ClusterLod
+{
+    float4 Sphere; // Bounds of the group that produced the cluster, the cluster itself for the first level
+    float4 ParentSphere; // Bounds of the group the cluster is merged in for the next level
+    float Error; // Object space simplification error of the group that produced the cluster
+    float ParentError; // Error of the group the cluster is merged in, FLT_MAX at the last level
+    uint Group; // Group that produced the cluster, LOD_GROUP_NONE for the first level
+    uint ParentGroup; // Group the cluster is merged in, LOD_GROUP_NONE for the last level
+};
+
+// A set of clusters that got merged and simplified into a new set of clusters one level up
+// The children are the clusters with this group as ParentGroup, the parents the ones with this group as Group
+struct ClusterGroup
+{
+    float4 Sphere;
+    float Error;
+    uint Level; // Level of the children
+    uint ChildCount;
+    uint ParentCount;
 };
 
 struct Material
@@ -0,0 +1,80 @@
+#include "CookCache.h"
+#include "SceneFile.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+static std::string GetEntryPath(const char* directory, uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.cook", (unsigned long long)key);
+	return (std::filesystem::path(directory) / name).string();
+}
+
+bool LoadCookCacheEntry(const char* directory, uint64_t key, CookCacheBlob& blob)
+{
+	blob.data.clear();
+	blob.readOffset = 0;
+
+	FILE* file = fopen(GetEntryPath(directory, key).c_str(), "rb");
+	if (!file)
+		return false;
+
+	CookCacheHeader header = {};
+	bool success = fread(&header, sizeof(header), 1, file) == 1 &&
+		header.magic == COOK_CACHE_MAGIC && header.version == COOK_CACHE_VERSION && header.key == key;
+	if (success)
+	{
+		blob.data.resize((size_t)header.size);
+		success = fread(blob.data.data(), 1, blob.data.size(), file) == blob.data.size() && fgetc(file) == EOF;
+	}
+	fclose(file);
+
+	success = success && HashBytes(blob.data.data(), blob.data.size()) == header.hash;
+	if (!success)
+		blob.data.clear();
+	return success;
+}
+
+bool StoreCookCacheEntry(const char* directory, uint64_t key, const CookCacheBlob& blob)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	CookCacheHeader header = {};
+	header.magic = COOK_CACHE_MAGIC;
+	header.version = COOK_CACHE_VERSION;
+	header.key = key;
+	header.size = blob.data.size();
+	header.hash = HashBytes(blob.data.data(), blob.data.size());
+
+	std::string path = GetEntryPath(directory, key);
+	// Identical primitives of one cook store the same key from different threads, and the cooker runs several cooks
+	// on one cache at once, so the temporary name has both the process and the thread in it
+	std::string tempPath = path + "." + std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (!file)
+		return false;
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(blob.data.data(), 1, blob.data.size(), file) == blob.data.size();
+	success = fclose(file) == 0 && success;
+
+	if (success)
+		std::filesystem::rename(tempPath, path, error);
+	if (!success || error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
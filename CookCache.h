@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// On disk cache of cooked primitives, so unchanged meshes are not clustered and simplified again
+// An entry is one file in the cache directory named after its key. The key is a hash of everything that goes into the cook:
+// the accessor data, the cooking parameters and GENERATOR_VERSION, so entries never have to be invalidated, only pruned.
+// Every entry has a header with its key, size and hash, a truncated or foreign file is a miss and gets cooked again.
+
+#define COOK_CACHE_DIRECTORY "cookcache" // Of -cache, in the working directory next to the scene file. Nothing prunes it, delete it to free the space
+#define COOK_CACHE_MAGIC 0x4b4f4f43 // "COOK"
+#define COOK_CACHE_VERSION 1 // Of the entry file layout, what goes into an entry is covered by the key
+
+struct CookCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint64_t size; // Of the data after the header
+	uint64_t hash; // Of the data after the header
+};
+
+// Arrays and plain values packed back to back, what an entry holds
+struct CookCacheBlob
+{
+	std::vector<uint8_t> data;
+	size_t readOffset = 0;
+
+	template<class T>
+	void Write(const T& value)
+	{
+		const uint8_t* bytes = (const uint8_t*)&value;
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	template<class T>
+	void Write(const std::vector<T>& arr)
+	{
+		Write((uint64_t)arr.size());
+		const uint8_t* bytes = (const uint8_t*)arr.data();
+		data.insert(data.end(), bytes, bytes + arr.size() * sizeof(T));
+	}
+
+	template<class T>
+	bool Read(T& value)
+	{
+		if (readOffset + sizeof(T) > data.size())
+			return false;
+		memcpy(&value, data.data() + readOffset, sizeof(T));
+		readOffset += sizeof(T);
+		return true;
+	}
+
+	template<class T>
+	bool Read(std::vector<T>& arr)
+	{
+		uint64_t count = 0;
+		if (!Read(count) || count > (data.size() - readOffset) / sizeof(T))
+			return false;
+		arr.resize((size_t)count);
+		memcpy(arr.data(), data.data() + readOffset, arr.size() * sizeof(T));
+		readOffset += arr.size() * sizeof(T);
+		return true;
+	}
+};
+
+// Returns false on a miss or a damaged entry
+bool LoadCookCacheEntry(const char* directory, uint64_t key, CookCacheBlob& blob);
+// Creates the directory if needed, the entry is written to a temporary file first so a crash never leaves half an entry behind
+bool StoreCookCacheEntry(const char* directory, uint64_t key, const CookCacheBlob& blob);
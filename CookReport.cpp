@@ -0,0 +1,195 @@
+#include "CookReport.h"
+
+#include <cstdio>
+
+const char* GetCookStageName(CookStage stage)
+{
+	switch (stage)
+	{
+	case CookStage::Decode: return "decode";
+	case CookStage::Optimize: return "optimize";
+	case CookStage::Meshlets: return "meshlets";
+	case CookStage::Adjacency: return "adjacency";
+	case CookStage::Grouping: return "grouping";
+	case CookStage::Simplify: return "simplify";
+	case CookStage::Output: return "output";
+	default: return "unknown";
+	}
+}
+
+const char* GetLodSimplifyModeName(LodSimplifyMode mode)
+{
+	switch (mode)
+	{
+	case LodSimplifyMode::Locked: return "locked";
+	case LodSimplifyMode::RelaxedError: return "relaxedError";
+	case LodSimplifyMode::PositionWeld: return "positionWeld";
+	case LodSimplifyMode::Sloppy: return "sloppy";
+	default: return "unknown";
+	}
+}
+
+static float WeightedMean(float a, uint64_t weightA, float b, uint64_t weightB)
+{
+	return weightA + weightB ? float((double(a) * weightA + double(b) * weightB) / double(weightA + weightB)) : 0.0f;
+}
+
+void PrimitiveCookStats::Add(const PrimitiveCookStats& other)
+{
+	for (int s = 0; s < (int)CookStage::Count; ++s)
+		stageMs[s] += other.stageMs[s];
+
+	acmr = WeightedMean(acmr, triangles, other.acmr, other.triangles);
+	atvr = WeightedMean(atvr, vertices, other.atvr, other.vertices);
+	overfetch = WeightedMean(overfetch, vertices, other.overfetch, other.vertices);
+	triangles += other.triangles;
+	inputVertices += other.inputVertices;
+	vertices += other.vertices;
+}
+
+void LodReductionStats::Add(const LodReductionStats& other)
+{
+	groups += other.groups;
+	clustersIn += other.clustersIn;
+	clustersOut += other.clustersOut;
+	trianglesIn += other.trianglesIn;
+	trianglesOut += other.trianglesOut;
+	for (int m = 0; m < (int)LodSimplifyMode::Count; ++m)
+		modeGroups[m] += other.modeGroups[m];
+	stalledGroups += other.stalledGroups;
+	endedChains += other.endedChains;
+	maxError = maxError > other.maxError ? maxError : other.maxError;
+}
+
+// Names come from the glTF file, anything that is not plain text is escaped
+static void WriteString(FILE* file, const std::string& value)
+{
+	fputc('"', file);
+	for (unsigned char c : value)
+	{
+		if (c == '"' || c == '\\')
+			fprintf(file, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(file, "\\u%04x", c);
+		else
+			fputc(c, file);
+	}
+	fputc('"', file);
+}
+
+static void WriteStageTimes(FILE* file, const double* stageMs)
+{
+	fprintf(file, "{");
+	for (int s = 0; s < (int)CookStage::Count; ++s)
+		fprintf(file, "%s\"%s\": %.3f", s ? ", " : "", GetCookStageName((CookStage)s), stageMs[s]);
+	fprintf(file, "}");
+}
+
+// Reduction is the triangle count relative to the level before
+static void WriteLevels(FILE* file, const char* name, const std::vector<CookReportLevel>& levels)
+{
+	fprintf(file, "  \"%s\": [\n", name);
+	for (size_t l = 0; l < levels.size(); ++l)
+	{
+		const CookReportLevel& level = levels[l];
+		double reduction = l > 0 && levels[l - 1].triangles ? double(level.triangles) / levels[l - 1].triangles : 1.0;
+		fprintf(file, "    {\"level\": %zu, \"clusters\": %u, \"triangles\": %u, \"vertices\": %u, \"reduction\": %.4f, \"triangleFill\": %.4f, \"vertexFill\": %.4f, \"fillHistogram\": [",
+			l, level.clusters, level.triangles, level.vertices, reduction, level.triangleFill, level.vertexFill);
+		for (int b = 0; b < COOK_REPORT_FILL_BUCKETS; ++b)
+			fprintf(file, "%s%u", b ? ", " : "", level.fillHistogram[b]);
+		fprintf(file, "]}%s\n", l + 1 < levels.size() ? "," : "");
+	}
+	fprintf(file, "  ],\n");
+}
+
+bool WriteCookReport(const char* filename, const CookReport& report)
+{
+	FILE* file = fopen(filename, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"version\": %d,\n", COOK_REPORT_VERSION);
+	fprintf(file, "  \"source\": ");
+	WriteString(file, report.source);
+	fprintf(file, ",\n");
+
+	fprintf(file, "  \"options\": {");
+	for (size_t i = 0; i < report.options.size(); ++i)
+	{
+		fprintf(file, "%s", i ? ", " : "");
+		WriteString(file, report.options[i].first);
+		fprintf(file, ": ");
+		WriteString(file, report.options[i].second);
+	}
+	fprintf(file, "},\n");
+
+	fprintf(file, "  \"totalMs\": %.3f,\n", report.totalMs);
+	fprintf(file, "  \"fileBytes\": %llu,\n", (unsigned long long)report.fileBytes);
+	fprintf(file, "  \"peakMemoryBytes\": %llu,\n", (unsigned long long)report.peakMemoryBytes);
+
+	fprintf(file, "  \"stages\": {");
+	for (size_t i = 0; i < report.stages.size(); ++i)
+	{
+		fprintf(file, "%s", i ? ", " : "");
+		WriteString(file, report.stages[i].first);
+		fprintf(file, ": %.3f", report.stages[i].second);
+	}
+	fprintf(file, "},\n");
+
+	PrimitiveCookStats total;
+	for (const CookReportMesh& mesh : report.meshes)
+		total.Add(mesh.stats);
+	fprintf(file, "  \"primitiveStages\": ");
+	WriteStageTimes(file, total.stageMs);
+	fprintf(file, ",\n");
+
+	fprintf(file, "  \"meshes\": [\n");
+	for (size_t m = 0; m < report.meshes.size(); ++m)
+	{
+		const CookReportMesh& mesh = report.meshes[m];
+		const PrimitiveCookStats& stats = mesh.stats;
+		fprintf(file, "    {\"index\": %zu, \"name\": ", m);
+		WriteString(file, mesh.name);
+		fprintf(file, ", \"primitives\": %u, \"cachedPrimitives\": %u, \"copiedPrimitives\": %u, \"clusters\": %u, \"triangles\": %u, \"inputVertices\": %u, \"vertices\": %u, "
+			"\"acmr\": %.4f, \"atvr\": %.4f, \"overfetch\": %.4f, \"stageMs\": ",
+			mesh.primitives, mesh.cachedPrimitives, mesh.copiedPrimitives, mesh.clusters, stats.triangles, stats.inputVertices, stats.vertices,
+			stats.acmr, stats.atvr, stats.overfetch);
+		WriteStageTimes(file, stats.stageMs);
+		fprintf(file, "}%s\n", m + 1 < report.meshes.size() ? "," : "");
+	}
+	fprintf(file, "  ],\n");
+
+	WriteLevels(file, "levels", report.levels);
+	if (!report.unpackedLevels.empty())
+		WriteLevels(file, "unpackedLevels", report.unpackedLevels);
+
+	// Reductions are of what the level simplified into, dropped levels included
+	fprintf(file, "  \"lodReduction\": [\n");
+	for (size_t l = 0; l < report.reduction.size(); ++l)
+	{
+		const LodReductionStats& stats = report.reduction[l];
+		fprintf(file, "    {\"level\": %zu, \"groups\": %u, \"clustersIn\": %u, \"clustersOut\": %u, \"clusterReduction\": %.4f, "
+			"\"trianglesIn\": %u, \"trianglesOut\": %u, \"triangleReduction\": %.4f, \"modes\": {",
+			l, stats.groups, stats.clustersIn, stats.clustersOut, stats.clustersIn ? double(stats.clustersOut) / stats.clustersIn : 1.0,
+			stats.trianglesIn, stats.trianglesOut, stats.trianglesIn ? double(stats.trianglesOut) / stats.trianglesIn : 1.0);
+		for (int m = 0; m < (int)LodSimplifyMode::Count; ++m)
+			fprintf(file, "%s\"%s\": %u", m ? ", " : "", GetLodSimplifyModeName((LodSimplifyMode)m), stats.modeGroups[m]);
+		fprintf(file, "}, \"stalledGroups\": %u, \"endedChains\": %u, \"maxError\": %.6f}%s\n",
+			stats.stalledGroups, stats.endedChains, stats.maxError, l + 1 < report.reduction.size() ? "," : "");
+	}
+	fprintf(file, "  ],\n");
+
+	fprintf(file, "  \"arena\": {\"peakReservedBytes\": %llu, \"stages\": {", (unsigned long long)report.arenaPeakReservedBytes);
+	for (size_t i = 0; i < report.arenaStages.size(); ++i)
+	{
+		const ArenaStageStats& stats = report.arenaStages[i].second;
+		fprintf(file, "%s\"%s\": {\"allocations\": %llu, \"totalBytes\": %llu, \"peakBytes\": %llu}", i ? ", " : "",
+			GetArenaStageName(report.arenaStages[i].first), (unsigned long long)stats.allocations, (unsigned long long)stats.totalBytes,
+			(unsigned long long)stats.peakBytes);
+	}
+	fprintf(file, "}}\n");
+	fprintf(file, "}\n");
+
+	return fclose(file) == 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Arena.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Machine readable summary of a cook, written as JSON so cook regressions can be gated on it
+// Times are wall clock milliseconds. The per primitive stages run inside the cook ParallelFor and are summed per mesh,
+// so with several threads they add up to more than the cook stage of the whole scene.
+
+#define COOK_REPORT_FILE_NAME "cookreport.json"
+#define COOK_REPORT_VERSION 1 // Bump when a field changes meaning or goes away, new fields don't need it
+#define COOK_REPORT_FILL_BUCKETS 10 // Clusters per tenth of the triangle limit, the last bucket takes full clusters too
+
+enum class CookStage : uint32_t
+{
+	Decode, // Accessors to the interleaved vertex buffer
+	Optimize, // Welding and the vertex cache, overdraw and fetch optimizers
+	Meshlets, // First level clusters and their bounds
+	Adjacency, // Border edges and cluster adjacency, every level
+	Grouping, // GroupClusters, every level
+	Simplify, // Merging, simplifying and clustering the groups, every level
+	Output, // Cluster streams and bounds
+	Count
+};
+
+const char* GetCookStageName(CookStage stage);
+
+// Per primitive, stored in the cook cache with the rest of the output so cached primitives still report their cook
+struct PrimitiveCookStats
+{
+	double stageMs[(int)CookStage::Count] = {};
+	uint32_t triangles = 0;
+	uint32_t inputVertices = 0;
+	uint32_t vertices = 0; // After welding
+	float acmr = 0.0f; // Transformed vertices per triangle of the optimized index buffer, meshopt_analyzeVertexCache
+	float atvr = 0.0f; // Transformed vertices per vertex
+	float overfetch = 0.0f; // Fetched bytes per vertex byte, meshopt_analyzeVertexFetch
+
+	// Sums the counts and times, the ratios are weighted by triangles (acmr) or vertices
+	void Add(const PrimitiveCookStats& other);
+};
+
+// How the LOD chain simplified a group, the modes are tried in this order while the group does not reduce enough
+enum class LodSimplifyMode : uint32_t
+{
+	Locked, // meshopt_simplify with the group border locked
+	RelaxedError, // Same with a larger error limit
+	PositionWeld, // Same on a shadow index buffer that welds vertices split only by their attributes
+	Sloppy, // meshopt_simplifySloppy, only for levels that are a single group
+	Count
+};
+
+const char* GetLodSimplifyModeName(LodSimplifyMode mode);
+
+// Per LOD level that was attempted, summed over primitives. Stored in the cook cache like PrimitiveCookStats
+struct LodReductionStats
+{
+	uint32_t groups = 0;
+	uint32_t clustersIn = 0;
+	uint32_t clustersOut = 0;
+	uint32_t trianglesIn = 0;
+	uint32_t trianglesOut = 0;
+	uint32_t modeGroups[(int)LodSimplifyMode::Count] = {}; // Groups by the mode of the result that was kept
+	uint32_t stalledGroups = 0; // Did not reduce enough with any mode
+	uint32_t endedChains = 0; // Primitives whose chain ended because this level did not reduce enough, the level was dropped
+	float maxError = 0.0f; // Relative to the mesh extents
+
+	void Add(const LodReductionStats& other);
+};
+
+struct CookReportMesh
+{
+	std::string name;
+	uint32_t primitives = 0;
+	uint32_t cachedPrimitives = 0; // Found in the cook cache, their times are from when they were cooked
+	uint32_t copiedPrimitives = 0; // Same content as a primitive cooked before, no time of their own
+	uint32_t clusters = 0; // All levels
+	PrimitiveCookStats stats;
+};
+
+struct CookReportLevel
+{
+	uint32_t clusters = 0;
+	uint32_t triangles = 0;
+	uint32_t vertices = 0; // Cluster vertices
+	float triangleFill = 0.0f; // Of the triangle limit of the meshlet config
+	float vertexFill = 0.0f; // Of the vertex limit
+	uint32_t fillHistogram[COOK_REPORT_FILL_BUCKETS] = {};
+};
+
+struct CookReport
+{
+	std::string source;
+	std::vector<std::pair<std::string, std::string>> options;
+	std::vector<std::pair<std::string, double>> stages; // Whole scene, in the order they ran
+	std::vector<CookReportMesh> meshes; // Written meshes, in file order
+	std::vector<CookReportLevel> levels;
+	std::vector<CookReportLevel> unpackedLevels; // Levels before -packclusters, empty without it
+	std::vector<LodReductionStats> reduction; // Per level the chain simplified from, level 0 first
+	std::vector<std::pair<ArenaStage, ArenaStageStats>> arenaStages;
+	uint64_t arenaPeakReservedBytes = 0;
+	double totalMs = 0.0;
+	uint64_t fileBytes = 0;
+	uint64_t peakMemoryBytes = 0;
+};
+
+bool WriteCookReport(const char* filename, const CookReport& report);
@@ -0,0 +1,274 @@
+// Headless batch cooker for machines without a desktop session, builds with CMakeLists.txt
+// cooker [options] <file.gltf|glb>...
+// Every file cooks in a process of its own, Generate uses one worker pool, one set of arenas and a fixed scene file name
+// per process. At most -jobs of them run at once and each gets -threads workers. The output of a file goes to
+// <out>/<name>/: SCENE_FILE_NAME, cook.log with what Generate logged and with -report the cook report.
+// With -cache all of them share one cook cache.
+
+#include "Generator.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct CookJob
+{
+	std::string input; // Absolute, the cook runs in the output directory
+	std::string outputDirectory;
+	pid_t pid = -1;
+	int resultPipe = -1; // The cook writes its GeneratorResult here when it is done
+	double startMs = 0.0;
+};
+
+static void PrintUsage()
+{
+	printf("Usage: cooker [options] <file.gltf|glb>...\n"
+		"  -jobs <n>           Files cooked at once, default a quarter of the hardware threads\n"
+		"  -threads <n>        Worker threads per cook, default the hardware threads split over the jobs\n"
+		"  -out <directory>    Each file cooks into <directory>/<name>, default cooked\n"
+		"  -cache <directory>  Cook cache shared by all cooks, off by default. Nothing prunes it\n"
+		"  -report             Write %s next to each scene file\n"
+		"  -lod <n>, -grouping greedy|partition, -meshlets <preset>, -quantize, -compress, -spatial, -pages,\n"
+		"  -sharedvertices, -packclusters, -budget <MB>: same as -generate of the viewer\n",
+		COOK_REPORT_FILE_NAME);
+}
+
+// Runs in the forked process, only returns through _exit
+static void RunCook(const CookJob& job, const GeneratorOptions& options, int resultPipe)
+{
+	int exitCode = 1;
+	std::error_code error;
+	std::filesystem::create_directories(job.outputDirectory, error);
+	if (!error && chdir(job.outputDirectory.c_str()) == 0 && freopen("cook.log", "w", stdout))
+	{
+		GeneratorResult result;
+		if (Generate(job.input.c_str(), options, &result))
+			exitCode = write(resultPipe, &result, sizeof(result)) == sizeof(result) ? 0 : 1;
+		fflush(stdout);
+	}
+	_exit(exitCode);
+}
+
+static bool StartCook(CookJob& job, const GeneratorOptions& options)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return false;
+
+	fflush(stdout);
+	job.startMs = GetTimeMs();
+	job.pid = fork();
+	if (job.pid == 0)
+	{
+		close(fds[0]);
+		RunCook(job, options, fds[1]);
+	}
+
+	close(fds[1]);
+	if (job.pid < 0)
+	{
+		close(fds[0]);
+		return false;
+	}
+	job.resultPipe = fds[0];
+	return true;
+}
+
+// Directory names from the file names, made unique when two inputs have the same one
+static std::string GetOutputDirectory(const std::filesystem::path& outputRoot, const std::filesystem::path& input, std::set<std::string>& used)
+{
+	std::string stem = input.stem().string();
+	std::string name = stem;
+	for (int n = 2; !used.insert(name).second; ++n)
+		name = stem + "_" + std::to_string(n);
+	return (outputRoot / name).string();
+}
+
+int main(int argc, char** argv)
+{
+	GeneratorOptions options;
+	int jobCount = 0;
+	const char* outputRoot = "cooked";
+	const char* cacheDirectory = nullptr;
+	std::vector<const char*> inputs;
+
+	for (int ia = 1; ia < argc; ++ia)
+	{
+		const char* arg = argv[ia];
+		bool hasValue = ia + 1 < argc;
+		if (strcmp(arg, "-jobs") == 0 && hasValue)
+			jobCount = atoi(argv[++ia]);
+		else if (strcmp(arg, "-threads") == 0 && hasValue)
+			options.numThreads = atoi(argv[++ia]);
+		else if (strcmp(arg, "-out") == 0 && hasValue)
+			outputRoot = argv[++ia];
+		else if (strcmp(arg, "-cache") == 0 && hasValue)
+			cacheDirectory = argv[++ia];
+		else if (strcmp(arg, "-report") == 0)
+			options.reportFile = COOK_REPORT_FILE_NAME;
+		else if (strcmp(arg, "-lod") == 0 && hasValue)
+			options.outputLod = atoi(argv[++ia]);
+		else if (strcmp(arg, "-grouping") == 0 && hasValue)
+		{
+			const char* grouping = argv[++ia];
+			if (strcmp(grouping, "greedy") == 0)
+				options.grouping = ClusterGrouping::Greedy;
+			else if (strcmp(grouping, "partition") == 0)
+				options.grouping = ClusterGrouping::Partition;
+			else
+			{
+				printf("Unknown grouping %s\n", grouping);
+				return 1;
+			}
+		}
+		else if (strcmp(arg, "-meshlets") == 0 && hasValue)
+		{
+			const MeshletPreset* preset = FindMeshletPreset(argv[++ia]);
+			if (!preset)
+			{
+				printf("Unknown meshlet preset %s\n", argv[ia]);
+				return 1;
+			}
+			options.meshletConfig = preset->config;
+		}
+		else if (strcmp(arg, "-quantize") == 0)
+			options.quantizeVertices = true;
+		else if (strcmp(arg, "-compress") == 0)
+			options.compressStreams = true;
+		else if (strcmp(arg, "-spatial") == 0)
+			options.spatialOrder = true;
+		else if (strcmp(arg, "-pages") == 0)
+			options.writePages = true;
+		else if (strcmp(arg, "-sharedvertices") == 0)
+			options.sharedVertices = true;
+		else if (strcmp(arg, "-packclusters") == 0)
+			options.packClusters = true;
+		else if (strcmp(arg, "-budget") == 0 && hasValue)
+			options.memoryBudgetMB = (size_t)atoll(argv[++ia]);
+		else if (arg[0] == '-')
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+			inputs.push_back(arg);
+	}
+
+	if (inputs.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	if (jobCount <= 0)
+		jobCount = std::max(1, hardwareThreads / 4);
+	jobCount = std::min(jobCount, (int)inputs.size());
+	if (options.numThreads <= 0)
+		options.numThreads = std::max(1, hardwareThreads / jobCount);
+
+	// The cooks run in their own directories, so everything they are given has to be absolute
+	std::error_code error;
+	std::string cachePath;
+	if (cacheDirectory)
+	{
+		cachePath = std::filesystem::absolute(cacheDirectory, error).string();
+		options.cacheDirectory = cachePath.c_str();
+	}
+
+	std::filesystem::path outputPath = std::filesystem::absolute(outputRoot, error);
+	std::set<std::string> usedNames;
+	std::vector<CookJob> jobs(inputs.size());
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		std::filesystem::path input = std::filesystem::absolute(inputs[i], error);
+		jobs[i].input = input.string();
+		jobs[i].outputDirectory = GetOutputDirectory(outputPath, input, usedNames);
+	}
+
+	Log("Cooking %zu files, %d at once with %d threads each, into %s\n", jobs.size(), jobCount, options.numThreads, outputPath.string().c_str());
+
+	double startMs = GetTimeMs();
+	size_t nextJob = 0;
+	size_t finished = 0;
+	size_t failed = 0;
+	int running = 0;
+	GeneratorResult total;
+	while (finished < jobs.size())
+	{
+		while (running < jobCount && nextJob < jobs.size())
+		{
+			CookJob& job = jobs[nextJob++];
+			if (StartCook(job, options))
+			{
+				running += 1;
+				continue;
+			}
+			Log("[%zu/%zu] %s: could not start a cook (%s)\n", ++finished, jobs.size(), job.input.c_str(), strerror(errno));
+			failed += 1;
+		}
+		if (running == 0)
+			break;
+
+		int status = 0;
+		pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			Log("waitpid failed (%s)\n", strerror(errno));
+			return 1;
+		}
+
+		auto iter = std::find_if(jobs.begin(), jobs.end(), [pid](const CookJob& job) { return job.pid == pid; });
+		if (iter == jobs.end())
+			continue;
+
+		CookJob& job = *iter;
+		running -= 1;
+		finished += 1;
+
+		GeneratorResult result;
+		bool succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0 && read(job.resultPipe, &result, sizeof(result)) == sizeof(result);
+		close(job.resultPipe);
+		job.resultPipe = -1;
+		job.pid = -1;
+		double seconds = (GetTimeMs() - job.startMs) / 1000.0;
+		if (!succeeded)
+		{
+			failed += 1;
+			if (WIFSIGNALED(status))
+				Log("[%zu/%zu] %s: failed with signal %d after %.2f s, see %s/cook.log\n", finished, jobs.size(), job.input.c_str(), WTERMSIG(status), seconds, job.outputDirectory.c_str());
+			else
+				Log("[%zu/%zu] %s: failed after %.2f s, see %s/cook.log\n", finished, jobs.size(), job.input.c_str(), seconds, job.outputDirectory.c_str());
+			continue;
+		}
+
+		Log("[%zu/%zu] %s: %zu triangles in %.2f s (%.0f triangles/s), %zu clusters, %zu triangles in all levels, %.1f MB\n",
+			finished, jobs.size(), job.input.c_str(), result.sourceTriangles, seconds, seconds > 0.0 ? result.sourceTriangles / seconds : 0.0,
+			result.clusters, result.triangles, result.fileBytes / (1024.0 * 1024.0));
+		total.sourceTriangles += result.sourceTriangles;
+		total.triangles += result.triangles;
+		total.clusters += result.clusters;
+		total.fileBytes += result.fileBytes;
+		total.totalMs += seconds * 1000.0;
+	}
+
+	// Throughput of the batch is over the wall clock, the cook time sum shows what the concurrency saved
+	double seconds = (GetTimeMs() - startMs) / 1000.0;
+	Log("Cooked %zu of %zu files in %.2f s (%.2f s of cooks): %zu triangles, %.0f triangles/s, %zu clusters, %.1f MB\n",
+		jobs.size() - failed, jobs.size(), seconds, total.totalMs / 1000.0, total.sourceTriangles,
+		seconds > 0.0 ? total.sourceTriangles / seconds : 0.0, total.clusters, total.fileBytes / (1024.0 * 1024.0));
+	return failed ? 1 : 0;
+}
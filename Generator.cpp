@@ -1,15 +1,48 @@
 #include "Generator.h"
 #include "Render.h"
+#include "Parallel.h"
+#include "ClusterGraph.h"
+#include "HashTable.h"
+#include "Log.h"
+#include "VertexQuantization.h"
+#include "SceneFile.h"
+#include "ClusterStreaming.h"
+#include "CookCache.h"
+#include "GltfDecode.h"
+#include "SpatialOrder.h"
+#include "SharedVertices.h"
+#include "PackedTriangles.h"
+#include "Arena.h"
+#include "CookReport.h"
+#include "OutOfCore.h"
+#include "ClusterPacking.h"
+#include "MeshletConfig.h"
 
 #define CGLTF_IMPLEMENTATION
 #include "cgltf.h"
 #include "meshoptimizer.h"
 
 #include <vector>
-#include <unordered_set>
-#include <unordered_map>
+#include <string>
+#include <cfloat>
 #include <algorithm>
 
+#define MAX_LOD_LEVELS 16
+#define DEDUP_PIECE_ELEMENTS 65536 // Accessor elements the primitive deduplication unpacks at a time
+#define MESHLET_CONE_WEIGHT 0.25f // Favors clusters with similar normals so their cones are tight enough to cull, meshopt's suggested value
+
+// LOD reduction, every level aims for half the triangles of the one below. Only the triangles are controlled: clusters
+// of simplified levels run out of vertices long before triangles, so a level keeps well over half the clusters. The
+// LOD reduction log and the cook report have the cluster ratio of every level
+#define LOD_TRIANGLE_RATIO 0.5f
+#define LOD_GROUP_MAX_RATIO 0.65f // A group that keeps more of its triangles falls back to the next SimplifyMode
+#define LOD_LEVEL_MAX_RATIO 0.85f // A level that keeps more of its triangles ends the chain, it would only add groups to the DAG
+#define LOD_TARGET_ERROR 1e-2f // Relative to the mesh extents, like meshopt_simplify reports it
+#define LOD_RELAXED_ERROR 1e-1f
+
+// Part of the cook cache key, bump whenever CookPrimitive produces different output for the same input
+#define GENERATOR_VERSION 7
+
 struct CpuVertex
 {
 	float3 pos;
@@ -18,6 +51,34 @@ struct CpuVertex
 	float2 texcoord;
 };
 
+struct LodBounds
+{
+	float3 center;
+	float radius = 0.0f;
+	float error = 0.0f; // Object space simplification error
+};
+
+// Smallest sphere around the sphere centers is too much work, this one is centered on the box around the spheres
+static LodBounds MergeLodBounds(const LodBounds* bounds, size_t count)
+{
+	float3 minPos = bounds[0].center - float3(bounds[0].radius);
+	float3 maxPos = bounds[0].center + float3(bounds[0].radius);
+	for (size_t i = 1; i < count; ++i)
+	{
+		minPos = min(minPos, bounds[i].center - float3(bounds[i].radius));
+		maxPos = max(maxPos, bounds[i].center + float3(bounds[i].radius));
+	}
+
+	LodBounds result;
+	result.center = (minPos + maxPos) * 0.5f;
+	for (size_t i = 0; i < count; ++i)
+	{
+		result.radius = std::max(result.radius, length(bounds[i].center - result.center) + bounds[i].radius);
+		result.error = std::max(result.error, bounds[i].error);
+	}
+	return result;
+}
+
 struct MeshletLodLevel
 {
 	// input data from mesh optimizer
@@ -25,7 +86,20 @@ struct MeshletLodLevel
 	std::vector<unsigned int> meshletVertices;
 	std::vector<unsigned char> meshletTriangles;
 
-	std::vector<std::unordered_set<uint64_t>> edgeSets;
+	std::vector<std::vector<uint64_t>> edgeSets; // Border edges of each meshlet
+
+	// LOD DAG, per meshlet
+	std::vector<LodBounds> bounds; // Bounds and error of the group that produced the meshlet, the meshlet itself for level 0
+	std::vector<int> groups; // Group that produced the meshlet, -1 for level 0
+	std::vector<int> parentGroups; // Group the meshlet is merged in to build the next level, -1 if there is none
+};
+
+struct LodGroup
+{
+	LodBounds bounds;
+	int level = 0; // Level of the merged meshlets, the ones it produces are one level up
+	int childCount = 0;
+	int parentCount = 0;
 };
 
 struct MeshletGeneratorContext
@@ -35,23 +109,34 @@ struct MeshletGeneratorContext
 	std::vector<unsigned int> indices;
 
 	std::vector<MeshletLodLevel> lods;
+	std::vector<LodGroup> groups;
 };
 
-template<class T>
-static void OutputDataToFile(LPCWSTR filename, const std::vector<T>& arr)
+static LodBounds ComputeMeshletBounds(const MeshletLodLevel& lod, int ml, const std::vector<CpuVertex>& vertices)
 {
-	const void* data = arr.data();
-	DWORD size = arr.size() * sizeof(T);
-    HANDLE file = CreateFile(filename, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-	WriteFile(file, data, size, nullptr, nullptr);
-	CloseHandle(file);
+	const meshopt_Meshlet& meshlet = lod.meshlets[ml];
+
+	float3 minPos = float3(FLT_MAX);
+	float3 maxPos = float3(-FLT_MAX);
+	for (uint v = 0; v < meshlet.vertex_count; ++v)
+	{
+		const float3& pos = vertices[lod.meshletVertices[meshlet.vertex_offset + v]].pos;
+		minPos = min(minPos, pos);
+		maxPos = max(maxPos, pos);
+	}
+
+	LodBounds result;
+	result.center = (minPos + maxPos) * 0.5f;
+	for (uint v = 0; v < meshlet.vertex_count; ++v)
+		result.radius = std::max(result.radius, length(vertices[lod.meshletVertices[meshlet.vertex_offset + v]].pos - result.center));
+	return result;
 }
-    
-static void ConvertNodeHierarchy(cgltf_data* data, std::vector<Instance>& instances, const std::vector<Mesh>& meshes, cgltf_node* node)
+
+static void ConvertNodeHierarchy(cgltf_data* data, std::vector<Instance>& instances, const std::vector<Mesh>& meshes, const std::vector<UINT>& meshRemap, cgltf_node* node)
 {
 	if (node->mesh != nullptr)
 	{
-		UINT meshID = node->mesh - data->meshes;
+		UINT meshID = meshRemap[node->mesh - data->meshes];
 		// TODO: wrong, since a mesh can have several primitives with different materials
 		UINT materialID = node->mesh->primitives->material - data->materials;
 
@@ -90,549 +175,1416 @@ static void ConvertNodeHierarchy(cgltf_data* data, std::vector<Instance>& instan
 	}
 		
 	for (int c = 0; c < node->children_count; ++c)
-		ConvertNodeHierarchy(data, instances, meshes, node->children[c]);
+		ConvertNodeHierarchy(data, instances, meshes, meshRemap, node->children[c]);
 }
 
-static uint64_t PackEdge(int v0, int v1)
+// Output of one cooked primitive, with offsets local to the primitive
+// These get concatenated in mesh/primitive order so the result does not depend on thread timing
+struct PrimitiveOutput
 {
-	if (v0 < v1)
-		return (uint64_t)v0 << 32 | (uint64_t)v1;
-	else
-		return (uint64_t)v1 << 32 | (uint64_t)v0;
+	std::vector<float3> positions;
+	std::vector<float3> normals;
+	std::vector<float4> tangents;
+	std::vector<float2> texcoords;
+	std::vector<uint32_t> triangles; // Packed, see PackedTriangles.h
+	std::vector<Cluster> clusters; // Default level
+	std::vector<ClusterLod> clusterLods;
+	std::vector<Cluster> lodClusters; // All other levels
+	std::vector<ClusterLod> lodClusterLods;
+	std::vector<ClusterGroup> groups;
+	std::vector<GroupingStats> groupingStats; // One per LOD level that was built
+	std::vector<LodReductionStats> reductionStats; // Same levels as groupingStats
+	PrimitiveCookStats cookStats;
+
+	MinMaxAABB bounds = MinMaxAABB{
+		float3 {FLT_MAX, FLT_MAX, FLT_MAX},
+		float3 {-FLT_MAX, -FLT_MAX, -FLT_MAX},
+	};
+};
+
+// Builds the meshlets into arena scratch sized for the worst case and only keeps what was used, needs an open ArenaScope
+static void BuildMeshlets(MeshletLodLevel& lod, const unsigned int* indices, size_t indexCount, const std::vector<CpuVertex>& vertices, const MeshletConfig& config)
+{
+	size_t maxMeshlets = meshopt_buildMeshletsBound(indexCount, config.maxVertices, config.maxTriangles);
+	ArenaVector<meshopt_Meshlet> meshlets(maxMeshlets);
+	ArenaVector<unsigned int> meshletVertices(maxMeshlets * config.maxVertices);
+	ArenaVector<unsigned char> meshletTriangles(maxMeshlets * config.maxTriangles * 3);
+	size_t meshletCount = meshopt_buildMeshlets(meshlets.data(),
+		meshletVertices.data(),
+		meshletTriangles.data(),
+		indices,
+		indexCount,
+		(float*)vertices.data(),
+		vertices.size(),
+		sizeof(CpuVertex),
+		config.maxVertices, config.maxTriangles, MESHLET_CONE_WEIGHT);
+	if (meshletCount == 0)
+		return;
+
+	const meshopt_Meshlet& last = meshlets[meshletCount - 1];
+	lod.meshlets.assign(meshlets.begin(), meshlets.begin() + meshletCount);
+	lod.meshletVertices.assign(meshletVertices.begin(), meshletVertices.begin() + last.vertex_offset + last.vertex_count);
+	lod.meshletTriangles.assign(meshletTriangles.begin(), meshletTriangles.begin() + last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
 }
 
-static uint64_t PackCluster(int c0, int c1)
+// Adds the time since the previous stage ended to a stage of the cook
+struct CookStageTimer
 {
-	// TODO: pack in cluster lod level as well
-	if (c0 < c1)
-		return (uint64_t)c0 << 32 | (uint64_t)c1;
-	else
-		return (uint64_t)c1 << 32 | (uint64_t)c0;
+	PrimitiveCookStats& stats;
+	double start = GetTimeMs();
+
+	void End(CookStage stage)
+	{
+		double now = GetTimeMs();
+		stats.stageMs[(int)stage] += now - start;
+		start = now;
+	}
+};
+
+// What CookPrimitive decodes into a CpuVertex, positions first
+static size_t GetVertexDecodeTargets(const cgltf_primitive& primitive, AccessorDecodeTarget targets[4])
+{
+	cgltf_attribute* positions = nullptr;
+	cgltf_attribute* normals = nullptr;
+	cgltf_attribute* tangents = nullptr;
+	cgltf_attribute* texcoords = nullptr;
+	for (int a = 0; a < primitive.attributes_count; ++a)
+	{
+		if (primitive.attributes[a].type == cgltf_attribute_type_position)
+			positions = &primitive.attributes[a];
+		else if (primitive.attributes[a].type == cgltf_attribute_type_normal)
+			normals = &primitive.attributes[a];
+		else if (primitive.attributes[a].type == cgltf_attribute_type_tangent)
+			tangents = &primitive.attributes[a];
+		else if (primitive.attributes[a].type == cgltf_attribute_type_texcoord)
+			texcoords = &primitive.attributes[a];
+	}
+	assert(positions != nullptr);
+
+	// Any stride and component type goes, see GltfDecode.h
+	assert(positions->data != nullptr);
+	size_t targetCount = 0;
+	targets[targetCount++] = { positions->data, 3, offsetof(CpuVertex, pos) };
+	if (normals)
+		targets[targetCount++] = { normals->data, 3, offsetof(CpuVertex, normal) };
+	if (tangents)
+		targets[targetCount++] = { tangents->data, 4, offsetof(CpuVertex, tangent) };
+	if (texcoords)
+		targets[targetCount++] = { texcoords->data, 2, offsetof(CpuVertex, texcoord) };
+	return targetCount;
 }
 
-#define MAX_CLUSTERS_PER_CANDIDATE 8
-#define PREFERED_CLUSTERS_PER_CANDIDATE 4
+// Welds and optimizes decoded triangles into the context, the inputs can be arena scratch of an open ArenaScope
+static void OptimizeTriangles(const UINT* indices, size_t index_count, const CpuVertex* vertices, size_t vertexCount, MeshletGeneratorContext& context, CookStageTimer& timer)
+{
+	PrimitiveCookStats& cookStats = timer.stats;
+
+	// Start mesh optimization
+	ArenaVector<unsigned int> remap(index_count);
+	size_t vertex_count = meshopt_generateVertexRemap(remap.data(), indices, index_count, vertices, vertexCount, sizeof(CpuVertex));
+
+	context.vertices.resize(vertex_count);
+	context.indices.resize(index_count);
+	meshopt_remapIndexBuffer(context.indices.data(), indices, index_count, remap.data());
+	meshopt_remapVertexBuffer(context.vertices.data(), vertices, vertexCount, sizeof(CpuVertex), remap.data());
+	meshopt_optimizeVertexCache(context.indices.data(), context.indices.data(), index_count, vertex_count);
+	meshopt_optimizeOverdraw(context.indices.data(), context.indices.data(), index_count, (float*)context.vertices.data(), vertex_count, sizeof(CpuVertex), 1.05f);
+	meshopt_optimizeVertexFetch(context.vertices.data(), context.indices.data(), index_count, context.vertices.data(), vertex_count, sizeof(CpuVertex));
+	timer.End(CookStage::Optimize);
+
+	// Quality of the optimized index buffer for the report, not part of any stage
+	meshopt_VertexCacheStatistics cacheStats = meshopt_analyzeVertexCache(context.indices.data(), index_count, vertex_count, 16, 0, 0);
+	meshopt_VertexFetchStatistics fetchStats = meshopt_analyzeVertexFetch(context.indices.data(), index_count, vertex_count, sizeof(CpuVertex));
+	cookStats.triangles = (uint32_t)(index_count / 3);
+	cookStats.inputVertices = (uint32_t)vertexCount;
+	cookStats.vertices = (uint32_t)vertex_count;
+	cookStats.acmr = cacheStats.acmr;
+	cookStats.atvr = cacheStats.atvr;
+	cookStats.overfetch = fetchStats.overfetch;
+	timer.start = GetTimeMs();
+}
 
-struct MergeCandidate
+// Simplifies the merged triangles of a group towards LOD_TRIANGLE_RATIO, trying the less constrained modes in order while
+// the result keeps more than LOD_GROUP_MAX_RATIO of the triangles. The smallest result is kept, its error is relative to
+// meshScale like the LOD_*_ERROR limits. Needs an open ArenaScope
+static LodSimplifyMode SimplifyGroup(const ArenaVector<unsigned int>& indices, const std::vector<CpuVertex>& vertices, float meshScale, bool allowSloppy,
+	ArenaVector<unsigned int>& simplifiedIndices, float& error)
 {
-	int set[MAX_CLUSTERS_PER_CANDIDATE] = { 0 };
-	int count = 0;
-	int score = 0;
+	// meshopt_simplify goes over every vertex it is given, so it only gets the ones of the group
+	static thread_local FlatHashMap<unsigned int> localVertexMap;
+	localVertexMap.Clear();
+	localVertexMap.Reserve(indices.size());
+	ArenaVector<unsigned int> localIndices(indices.size());
+	ArenaVector<unsigned int> globalVertices;
+	ArenaVector<float3> positions;
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		unsigned int* local = localVertexMap.Find(indices[i]);
+		if (!local)
+		{
+			local = &localVertexMap[indices[i]];
+			*local = (unsigned int)globalVertices.size();
+			globalVertices.push_back(indices[i]);
+			positions.push_back(vertices[indices[i]].pos);
+		}
+		localIndices[i] = *local;
+	}
 
-	void Push(int c)
+	// meshopt errors are relative to the extents of the vertices it gets, the group's
+	const float* positionData = (const float*)positions.data();
+	float groupScale = std::max(meshopt_simplifyScale(positionData, positions.size(), sizeof(float3)), FLT_MIN);
+	float targetError = LOD_TARGET_ERROR * meshScale / groupScale;
+	float relaxedError = LOD_RELAXED_ERROR * meshScale / groupScale;
+	size_t targetIndexCount = size_t(indices.size() / 3 * LOD_TRIANGLE_RATIO) * 3;
+	size_t acceptIndexCount = size_t(indices.size() / 3 * LOD_GROUP_MAX_RATIO) * 3;
+
+	ArenaVector<unsigned int> attempt(indices.size());
+	ArenaVector<unsigned int> shadowIndices;
+	ArenaVector<unsigned int> best(localIndices.begin(), localIndices.end());
+	LodSimplifyMode kept = LodSimplifyMode::Locked;
+	error = 0.0f;
+	for (int mode = 0; mode < (int)LodSimplifyMode::Count && best.size() > acceptIndexCount; ++mode)
 	{
-		assert(count < MAX_CLUSTERS_PER_CANDIDATE);
-		set[count] = c;
-		count += 1;
+		float attemptError = 0.0f;
+		size_t attemptCount = 0;
+		switch ((LodSimplifyMode)mode)
+		{
+		case LodSimplifyMode::Locked:
+		case LodSimplifyMode::RelaxedError:
+			attemptCount = meshopt_simplify(attempt.data(), localIndices.data(), localIndices.size(), positionData, positions.size(), sizeof(float3),
+				targetIndexCount, mode == (int)LodSimplifyMode::Locked ? targetError : relaxedError, meshopt_SimplifyLockBorder, &attemptError);
+			break;
+		case LodSimplifyMode::PositionWeld:
+			// Vertices split only by their attributes become one, the output keeps the attributes of one side of the seam
+			shadowIndices.resize(localIndices.size());
+			meshopt_generateShadowIndexBuffer(shadowIndices.data(), localIndices.data(), localIndices.size(), positionData, positions.size(), sizeof(float3), sizeof(float3));
+			attemptCount = meshopt_simplify(attempt.data(), shadowIndices.data(), shadowIndices.size(), positionData, positions.size(), sizeof(float3),
+				targetIndexCount, relaxedError, meshopt_SimplifyLockBorder, &attemptError);
+			break;
+		case LodSimplifyMode::Sloppy:
+			// Moves the border too, only for groups that have no neighbours to crack against
+			if (!allowSloppy)
+				continue;
+			attemptCount = meshopt_simplifySloppy(attempt.data(), localIndices.data(), localIndices.size(), positionData, positions.size(), sizeof(float3),
+				targetIndexCount, relaxedError, &attemptError);
+			break;
+		default:
+			break;
+		}
+
+		if (attemptCount > 0 && attemptCount < best.size())
+		{
+			best.assign(attempt.begin(), attempt.begin() + attemptCount);
+			error = attemptError * groupScale / meshScale;
+			kept = (LodSimplifyMode)mode;
+		}
 	}
 
-	int Pop()
+	simplifiedIndices.resize(best.size());
+	for (size_t i = 0; i < best.size(); ++i)
+		simplifiedIndices[i] = globalVertices[best[i]];
+	return kept;
+}
+
+// Builds the whole LOD chain of an optimized context and writes every level to out
+// allowSloppy lets a level that is a single group move its border, only for contexts that share no border with another item
+static void CookContext(MeshletGeneratorContext& context, bool allowSloppy, const GeneratorOptions& options, PrimitiveOutput& out, CookStageTimer& timer)
+{
+	// Start clustering
 	{
-		assert(count > 0);
-		count -= 1;
-		return set[count];
+		context.lods.reserve(MAX_LOD_LEVELS); // Levels hold on to references of the previous one
+		MeshletLodLevel& lod0 = context.lods.emplace_back();
+
+		{
+			// Do initial clustering
+			ArenaScope arenaScope(ArenaStage::Meshlets);
+			BuildMeshlets(lod0, context.indices.data(), context.indices.size(), context.vertices, options.meshletConfig);
+			lod0.edgeSets.resize(lod0.meshlets.size());
+
+			lod0.bounds.resize(lod0.meshlets.size());
+			lod0.groups.resize(lod0.meshlets.size(), -1);
+			lod0.parentGroups.resize(lod0.meshlets.size(), -1);
+			for (int ml = 0; ml < lod0.meshlets.size(); ++ml)
+				lod0.bounds[ml] = ComputeMeshletBounds(lod0, ml, context.vertices);
+		}
 	}
+	timer.End(CookStage::Meshlets);
+
+	// meshopt_simplify reports the error relative to the mesh extents
+	float simplifyScale = meshopt_simplifyScale((float*)context.vertices.data(), context.vertices.size(), sizeof(CpuVertex));
 
-	bool Contains(int c) const
+	// Always build the whole LOD chain, outputLod only picks the level meshes draw by default
+	// The chain ends at a single cluster or at the first level that does not reduce enough
+	int ilod = 0;
+	while (ilod + 1 < MAX_LOD_LEVELS && context.lods[ilod].meshlets.size() > 1)
 	{
-		for (int i = 0; i < count; ++i)
-			if (set[i] == c)
-				return true;
-		return false;
+		auto& prevLod = context.lods.at(ilod);
+		ilod += 1;
+
+		// Loop over all meshlets to figure out their external edges
+		// Each meshlet only writes its own edge set so these can run in parallel
+		ParallelFor(prevLod.meshlets.size(), [&](size_t ml)
+		{
+			meshopt_Meshlet& meshlet = prevLod.meshlets[ml];
+
+			// First loop over all triangles to count the nuber of times each edge occurs
+			// The table is reused by every meshlet cooked on this thread
+			static thread_local FlatHashMap<int> edgeCounterMap;
+			edgeCounterMap.Clear();
+			edgeCounterMap.Reserve(meshlet.triangle_count * 3);
+			for (uint t = 0; t < meshlet.triangle_count; ++t)
+			{
+				int o = meshlet.triangle_offset + 3 * t;
+				int i0 = prevLod.meshletTriangles[o + 0];
+				int i1 = prevLod.meshletTriangles[o + 2];
+				int i2 = prevLod.meshletTriangles[o + 1];
+
+				int v0 = prevLod.meshletVertices[meshlet.vertex_offset + i0];
+				int v1 = prevLod.meshletVertices[meshlet.vertex_offset + i1];
+				int v2 = prevLod.meshletVertices[meshlet.vertex_offset + i2];
+
+				edgeCounterMap[PackEdge(v0, v1)] += 1;
+				edgeCounterMap[PackEdge(v0, v2)] += 1;
+				edgeCounterMap[PackEdge(v1, v2)] += 1;
+			}
+
+			// Then loop over all found edges to get the ones that have occured only once
+			// This is the external edges of the clusters
+			auto& meshletEdgeSet = prevLod.edgeSets[ml];
+			edgeCounterMap.ForEach([&](uint64_t edge, int edgeCount)
+			{
+				if (edgeCount == 1)
+					meshletEdgeSet.push_back(edge);
+			});
+		});
+
+		// Loop over all meshlets to figure out which ones are connected
+		FlatHashMap<int> clusterAdjacencyMap; // Maps the pair <c0, c1> to common edge count
+		std::vector<std::pair<int, int>> clusterAdjacencyCount; // Contains the pair <cluster, counter> counting how many neighbours a cluster have
+		BuildClusterAdjacency(prevLod.edgeSets, clusterAdjacencyMap, clusterAdjacencyCount);
+		timer.End(CookStage::Adjacency);
+
+		double groupingStart = GetTimeMs();
+		std::vector<MergeCandidate> mergeLists;
+		GroupClusters(options.grouping, (int)prevLod.meshlets.size(), clusterAdjacencyMap, clusterAdjacencyCount, mergeLists);
+
+		GroupingStats& groupingStats = out.groupingStats.emplace_back();
+		groupingStats.timeMs = GetTimeMs() - groupingStart;
+		ComputeGroupingStats((int)prevLod.meshlets.size(), clusterAdjacencyMap, mergeLists, groupingStats);
+		timer.End(CookStage::Grouping);
+
+		// We now have all the clusters to merge. The groups do not depend on each other,
+		// so process them in parallel into separate outputs and append them in order afterwards
+		std::vector<MeshletLodLevel> mergeOutputs(mergeLists.size());
+		std::vector<LodBounds> mergeBounds(mergeLists.size());
+		std::vector<LodSimplifyMode> groupModes(mergeLists.size());
+		std::vector<float> groupErrors(mergeLists.size());
+		std::vector<uint8_t> groupStalled(mergeLists.size(), 0);
+		ParallelFor(mergeLists.size(), [&](size_t il)
+		{
+			const MergeCandidate& l = mergeLists[il];
+			MeshletLodLevel& mergeOutput = mergeOutputs[il];
+			ArenaScope arenaScope(ArenaStage::Simplify);
+
+			// Generate a new index list from the selected clusters, generating a merged mesh
+			size_t mergedIndexCount = 0;
+			for (int c = 0; c < l.count; ++c)
+				mergedIndexCount += 3 * prevLod.meshlets[l.set[c]].triangle_count;
+
+			ArenaVector<unsigned int> mergedIndices;
+			mergedIndices.reserve(mergedIndexCount);
+			for(int c = 0; c < l.count; ++c)
+			{
+				int ml = l.set[c];
+				meshopt_Meshlet& meshlet = prevLod.meshlets[ml];
+
+				for (uint i = 0; i < 3 * meshlet.triangle_count; ++i)
+				{
+					int localIndex = prevLod.meshletTriangles[meshlet.triangle_offset + i];
+					int globalIndex = prevLod.meshletVertices[meshlet.vertex_offset + localIndex];
+					mergedIndices.push_back(globalIndex);
+				}
+			}
+
+			// Simplify the merged mesh, a level that is a single group has no other group to crack against
+			ArenaVector<unsigned int> simplifiedIndices;
+			float lod_error = 0.f;
+			groupModes[il] = SimplifyGroup(mergedIndices, context.vertices, simplifyScale, allowSloppy && mergeLists.size() == 1, simplifiedIndices, lod_error);
+			groupErrors[il] = lod_error;
+			if (simplifiedIndices.size() > size_t(mergedIndices.size() / 3 * LOD_GROUP_MAX_RATIO) * 3)
+				groupStalled[il] = 1;
+
+			// The group bounds contain all the merged clusters, and the error never goes below theirs
+			// so a parent group is never picked at a smaller error than its children
+			LodBounds childBounds[MAX_CLUSTERS_PER_CANDIDATE];
+			for (int c = 0; c < l.count; ++c)
+				childBounds[c] = prevLod.bounds[l.set[c]];
+			mergeBounds[il] = MergeLodBounds(childBounds, l.count);
+			mergeBounds[il].error = std::max(mergeBounds[il].error, lod_error * simplifyScale);
+
+			// Generate new clusters for the new simplified index list, kept apart so we can append them in order later on
+			BuildMeshlets(mergeOutput, simplifiedIndices.data(), simplifiedIndices.size(), context.vertices, options.meshletConfig);
+		});
+
+		// Measure what the level reduced, one that barely did ends the chain and is dropped
+		LodReductionStats& reductionStats = out.reductionStats.emplace_back();
+		reductionStats.groups = (uint32_t)mergeLists.size();
+		reductionStats.clustersIn = (uint32_t)prevLod.meshlets.size();
+		for (const meshopt_Meshlet& meshlet : prevLod.meshlets)
+			reductionStats.trianglesIn += meshlet.triangle_count;
+		for (int il = 0; il < mergeOutputs.size(); ++il)
+		{
+			reductionStats.clustersOut += (uint32_t)mergeOutputs[il].meshlets.size();
+			for (const meshopt_Meshlet& meshlet : mergeOutputs[il].meshlets)
+				reductionStats.trianglesOut += meshlet.triangle_count;
+			reductionStats.modeGroups[(int)groupModes[il]] += 1;
+			reductionStats.stalledGroups += groupStalled[il];
+			reductionStats.maxError = std::max(reductionStats.maxError, groupErrors[il]);
+		}
+		if (reductionStats.trianglesOut > reductionStats.trianglesIn * LOD_LEVEL_MAX_RATIO)
+		{
+			reductionStats.endedChains = 1;
+			timer.End(CookStage::Simplify);
+			break;
+		}
+
+		MeshletLodLevel& currLod = context.lods.emplace_back();
+
+		// Append meshlets into lod array
+		for (int il = 0; il < mergeOutputs.size(); ++il)
+		{
+			const MergeCandidate& l = mergeLists[il];
+			MeshletLodLevel& mergeOutput = mergeOutputs[il];
+
+			int group = context.groups.size();
+			context.groups.push_back(LodGroup{ mergeBounds[il], ilod - 1, l.count, (int)mergeOutput.meshlets.size() });
+			for (int c = 0; c < l.count; ++c)
+				prevLod.parentGroups[l.set[c]] = group;
+
+			currLod.bounds.insert(currLod.bounds.end(), mergeOutput.meshlets.size(), mergeBounds[il]);
+			currLod.groups.insert(currLod.groups.end(), mergeOutput.meshlets.size(), group);
+
+			int vo = currLod.meshletVertices.size();
+			int to = currLod.meshletTriangles.size();
+			for (int ml = 0; ml < mergeOutput.meshlets.size(); ++ml)
+			{
+				meshopt_Meshlet& meshlet = mergeOutput.meshlets[ml];
+				currLod.meshlets.push_back({ meshlet.vertex_offset + vo, meshlet.triangle_offset + to, meshlet.vertex_count, meshlet.triangle_count });
+			}
+			currLod.meshletVertices.insert(currLod.meshletVertices.end(), mergeOutput.meshletVertices.begin(), mergeOutput.meshletVertices.end());
+			currLod.meshletTriangles.insert(currLod.meshletTriangles.end(), mergeOutput.meshletTriangles.begin(), mergeOutput.meshletTriangles.end());
+		}
+		currLod.edgeSets.resize(currLod.meshlets.size());
+		currLod.parentGroups.resize(currLod.meshlets.size(), -1);
+		timer.End(CookStage::Simplify);
+	}
+
+	// Write out every level. The default level goes first so primitives of a mesh can be drawn as one range,
+	// all the other levels follow in a second list
+	int defaultLod = std::min(options.outputLod, (int)context.lods.size() - 1);
+	for (int ilod = 0; ilod < context.lods.size(); ++ilod)
+	{
+		MeshletLodLevel& lod = context.lods[ilod];
+		std::vector<Cluster>& clusters = ilod == defaultLod ? out.clusters : out.lodClusters;
+		std::vector<ClusterLod>& clusterLods = ilod == defaultLod ? out.clusterLods : out.lodClusterLods;
+
+		for (int ml = 0; ml < lod.meshlets.size(); ++ml)
+		{
+			meshopt_Meshlet& meshlet = lod.meshlets[ml];
+
+			UINT outputVerticesOffset = out.positions.size();
+			MinMaxAABB clusterBounds = MinMaxAABB{
+				float3 {FLT_MAX, FLT_MAX, FLT_MAX},
+				float3 {-FLT_MAX, -FLT_MAX, -FLT_MAX},
+			};
+
+			for (uint v = 0; v < meshlet.vertex_count; ++v)
+			{
+				int vi = lod.meshletVertices[meshlet.vertex_offset + v];
+				CpuVertex& vert = context.vertices[vi];
+				out.positions.push_back(vert.pos);
+				out.normals.push_back(vert.normal);
+				out.tangents.push_back(vert.tangent);
+				out.texcoords.push_back(vert.texcoord);
+
+				clusterBounds.Min = min(clusterBounds.Min, vert.pos);
+				clusterBounds.Max = max(clusterBounds.Max, vert.pos);
+			}
+
+			UINT outputTriangleOffset = out.triangles.size();
+			for (uint t = 0; t < meshlet.triangle_count; ++t)
+			{
+				int o = meshlet.triangle_offset + 3 * t;
+				int i0 = lod.meshletTriangles[o + 0];
+				int i1 = lod.meshletTriangles[o + 2];
+				int i2 = lod.meshletTriangles[o + 1];
+
+				out.triangles.push_back(PackTriangle(i0, i1, i2));
+			}
+
+			// meshopt sees the glTF winding, the indices above swap two corners for the rasterizer so the cone still describes the front faces
+			meshopt_Bounds coneBounds = meshopt_computeMeshletBounds(&lod.meshletVertices[meshlet.vertex_offset], &lod.meshletTriangles[meshlet.triangle_offset],
+				meshlet.triangle_count, (float*)context.vertices.data(), context.vertices.size(), sizeof(CpuVertex));
+
+			clusters.push_back(Cluster{
+				outputTriangleOffset,
+				meshlet.triangle_count,
+				outputVerticesOffset,
+				meshlet.vertex_count,
+				MinMaxToCenterExtents(clusterBounds),
+				float4(coneBounds.center[0], coneBounds.center[1], coneBounds.center[2], coneBounds.radius),
+				float4(coneBounds.cone_axis[0], coneBounds.cone_axis[1], coneBounds.cone_axis[2], coneBounds.cone_cutoff),
+				0, // Pages are built once the whole scene is stitched, see BuildClusterPages
+				0,
+				0,
+				});
+
+			const LodBounds& bounds = lod.bounds[ml];
+			int parentGroup = lod.parentGroups[ml];
+			ClusterLod clusterLod;
+			clusterLod.Sphere = float4(bounds.center, bounds.radius);
+			clusterLod.ParentSphere = parentGroup != -1 ? float4(context.groups[parentGroup].bounds.center, context.groups[parentGroup].bounds.radius) : clusterLod.Sphere;
+			clusterLod.Error = bounds.error;
+			clusterLod.ParentError = parentGroup != -1 ? context.groups[parentGroup].bounds.error : FLT_MAX;
+			clusterLod.Group = lod.groups[ml] != -1 ? lod.groups[ml] : LOD_GROUP_NONE;
+			clusterLod.ParentGroup = parentGroup != -1 ? parentGroup : LOD_GROUP_NONE;
+			clusterLods.push_back(clusterLod);
+
+			if (ilod == defaultLod)
+			{
+				out.bounds.Min = min(out.bounds.Min, clusterBounds.Min);
+				out.bounds.Max = max(out.bounds.Max, clusterBounds.Max);
+			}
+		}
 	}
+
+	for (const LodGroup& group : context.groups)
+	{
+		out.groups.push_back(ClusterGroup{
+			float4(group.bounds.center, group.bounds.radius),
+			group.bounds.error,
+			(uint)group.level,
+			(uint)group.childCount,
+			(uint)group.parentCount,
+			});
+	}
+	timer.End(CookStage::Output);
+}
+
+static void CookPrimitive(const cgltf_primitive& primitive, const GeneratorOptions& options, PrimitiveOutput& out)
+{
+	assert(primitive.type == cgltf_primitive_type_triangles);
+
+	AccessorDecodeTarget targets[4];
+	size_t targetCount = GetVertexDecodeTargets(primitive, targets);
+
+	cgltf_accessor* indices_accessor = primitive.indices;
+	assert(indices_accessor != nullptr);
+	assert(indices_accessor->type == cgltf_type_scalar);
+
+	// The decoded streams are only needed until the optimized ones are built, they and the meshopt scratch come from the arena
+	CookStageTimer timer{ out.cookStats };
+	MeshletGeneratorContext context;
+	{
+		ArenaScope arenaScope(ArenaStage::Prepare);
+		ArenaVector<UINT> temp_indices(indices_accessor->count);
+		DecodeAccessorIndices(indices_accessor, temp_indices.data());
+
+		// Generate interleaved vertex buffer for processing
+		ArenaVector<CpuVertex> temp_vertices(targets[0].accessor->count);
+		memset(temp_vertices.data(), 0, sizeof(CpuVertex) * temp_vertices.size());
+		DecodeAccessorsInterleaved(targets, targetCount, temp_vertices.size(), temp_vertices.data(), sizeof(CpuVertex));
+		timer.End(CookStage::Decode);
+
+		OptimizeTriangles(temp_indices.data(), temp_indices.size(), temp_vertices.data(), temp_vertices.size(), context, timer);
+	}
+
+	CookContext(context, true, options, out, timer);
+}
+
+// Every accessor a cook reads can be decoded a piece at a time, so the primitive can be cooked in chunks
+static bool CanChunkPrimitive(const cgltf_primitive& primitive)
+{
+	AccessorDecodeTarget targets[4];
+	size_t targetCount = GetVertexDecodeTargets(primitive, targets);
+	bool canSplit = primitive.indices && CanSplitAccessor(primitive.indices);
+	for (size_t t = 0; t < targetCount; ++t)
+		canSplit = canSplit && CanSplitAccessor(targets[t].accessor);
+	return canSplit;
+}
+
+// Cooks one chunk of a primitive like a primitive of its own, see OutOfCore.h
+// Only decodes the vertices the chunk uses. Returns false if the chunk can't be read back from the spill file
+static bool CookPrimitiveChunk(const cgltf_primitive& primitive, SpillFile& triangleSpill, const TriangleChunk& chunk, const GeneratorOptions& options, PrimitiveOutput& out)
+{
+	AccessorDecodeTarget targets[4];
+	size_t targetCount = GetVertexDecodeTargets(primitive, targets);
+
+	CookStageTimer timer{ out.cookStats };
+	MeshletGeneratorContext context;
+	{
+		ArenaScope arenaScope(ArenaStage::Prepare);
+		std::vector<UINT> chunkIndices;
+		if (!ReadChunkTriangles(triangleSpill, chunk, chunkIndices))
+			return false;
+
+		// Source vertices of the chunk in order, so runs of them decode in one go
+		ArenaVector<UINT> chunkVertices(chunkIndices.begin(), chunkIndices.end());
+		std::sort(chunkVertices.begin(), chunkVertices.end());
+		chunkVertices.erase(std::unique(chunkVertices.begin(), chunkVertices.end()), chunkVertices.end());
+		for (UINT& index : chunkIndices)
+			index = UINT(std::lower_bound(chunkVertices.begin(), chunkVertices.end(), index) - chunkVertices.begin());
+
+		ArenaVector<CpuVertex> temp_vertices(chunkVertices.size());
+		memset(temp_vertices.data(), 0, sizeof(CpuVertex) * temp_vertices.size());
+		for (size_t first = 0; first < chunkVertices.size();)
+		{
+			size_t count = 1;
+			while (first + count < chunkVertices.size() && chunkVertices[first + count] == chunkVertices[first] + count)
+				count += 1;
+
+			cgltf_accessor ranges[4];
+			AccessorDecodeTarget rangeTargets[4];
+			for (size_t t = 0; t < targetCount; ++t)
+			{
+				ranges[t] = GetAccessorRange(targets[t].accessor, chunkVertices[first], count);
+				rangeTargets[t] = { &ranges[t], targets[t].components, targets[t].outOffset };
+			}
+			DecodeAccessorsInterleaved(rangeTargets, targetCount, count, &temp_vertices[first], sizeof(CpuVertex));
+			first += count;
+		}
+		timer.End(CookStage::Decode);
+
+		OptimizeTriangles(chunkIndices.data(), chunkIndices.size(), temp_vertices.data(), temp_vertices.size(), context, timer);
+	}
+
+	// The chunk borders are shared with the neighbouring chunks, they have to stay where they are on every level
+	CookContext(context, false, options, out, timer);
+	return true;
+}
+
+struct QuantizedVertexStreams
+{
+	std::vector<QuantizedPosition> positions;
+	std::vector<uint32_t> normals;
+	std::vector<uint32_t> tangents;
+	std::vector<uint32_t> texcoords;
 };
 
-MergeCandidate SelectBestCandidateTree(const MergeCandidate& input, const std::vector<std::pair<int, int>>& sortedAdjacency, const std::unordered_map<uint64_t, int>& clusterAdjacencyMap)
+// The accessors CookPrimitive reads, the first attribute of each type like it does
+static void GetPrimitiveAccessors(const cgltf_primitive& primitive, const cgltf_accessor* accessors[5])
+{
+	const cgltf_attribute_type attributeTypes[] = { cgltf_attribute_type_position, cgltf_attribute_type_normal, cgltf_attribute_type_tangent, cgltf_attribute_type_texcoord };
+	for (int t = 0; t < 4; ++t)
+	{
+		accessors[t] = nullptr;
+		for (size_t a = 0; a < primitive.attributes_count && !accessors[t]; ++a)
+		{
+			if (primitive.attributes[a].type == attributeTypes[t])
+				accessors[t] = primitive.attributes[a].data;
+		}
+	}
+	accessors[4] = primitive.indices;
+}
+
+// Elements of an accessor unpacked at a time by the content hash and comparison, so they need little memory whatever the
+// size of the primitive. Accessors that can't be split (see CanSplitAccessor) are unpacked whole
+static size_t GetUnpackPieceElements(const cgltf_accessor* accessor)
 {
-	// If the limit is hit we end the search
-	if (input.count >= PREFERED_CLUSTERS_PER_CANDIDATE)
-		return input;
+	return CanSplitAccessor(accessor) ? DEDUP_PIECE_ELEMENTS : std::max<size_t>(accessor->count, 1);
+}
 
-	// Go over all remaining possible clusters to add
-	MergeCandidate output = input;
-	for (auto& c : sortedAdjacency)
+// Decoded values of elements [first, first + count) of an accessor, so the same data stored with a different stride,
+// offset or buffer comes out the same
+static void UnpackAccessorPiece(const cgltf_accessor* accessor, bool isIndices, size_t first, size_t count, std::vector<uint32_t>& out)
+{
+	cgltf_accessor range = first == 0 && count == accessor->count ? *accessor : GetAccessorRange(accessor, first, count);
+	if (isIndices)
 	{
-		// If input candidate already contains the cluster it won't get added
-		if (input.Contains(c.first))
+		out.resize(count);
+		cgltf_accessor_unpack_indices(&range, out.data(), sizeof(uint32_t), out.size());
+	}
+	else
+	{
+		static_assert(sizeof(cgltf_float) == sizeof(uint32_t));
+		out.resize(count * cgltf_num_components(accessor->type));
+		cgltf_accessor_unpack_floats(&range, (cgltf_float*)out.data(), out.size());
+	}
+}
+
+// Hash of the geometry of a primitive, independent of how its accessors are laid out
+static uint64_t HashPrimitiveContent(const cgltf_primitive& primitive)
+{
+	const cgltf_accessor* accessors[5];
+	GetPrimitiveAccessors(primitive, accessors);
+
+	uint64_t hash = 0;
+	std::vector<uint32_t> values;
+	for (int a = 0; a < 5; ++a)
+	{
+		const cgltf_accessor* accessor = accessors[a];
+		uint64_t count = accessor ? accessor->count * (a == 4 ? 1 : cgltf_num_components(accessor->type)) : ~0ull; // Tell a missing attribute from an empty one
+		hash = HashBytes(&count, sizeof(count), hash);
+		if (!accessor)
 			continue;
 
-		// Go over all input clusters and get the total connectivity score for the selected cluster
-		int score = 0;
-		for (int i = 0; i < input.count; ++i)
+		// Hashed DEDUP_PIECE_ELEMENTS at a time even when unpacked whole, so the layout doesn't change the hash
+		size_t pieceElements = GetUnpackPieceElements(accessor);
+		for (size_t first = 0; first < accessor->count; first += pieceElements)
 		{
-			auto iter = clusterAdjacencyMap.find(PackCluster(input.set[i], c.first));
-			if (iter != clusterAdjacencyMap.end())
-				score += iter->second;
+			size_t elements = std::min(pieceElements, accessor->count - first);
+			UnpackAccessorPiece(accessor, a == 4, first, elements, values);
+			size_t valuesPerElement = values.size() / elements;
+			for (size_t block = 0; block < elements; block += DEDUP_PIECE_ELEMENTS)
+			{
+				size_t blockElements = std::min<size_t>(DEDUP_PIECE_ELEMENTS, elements - block);
+				hash = HashBytes(&values[block * valuesPerElement], blockElements * valuesPerElement * sizeof(uint32_t), hash);
+			}
 		}
+	}
+	return hash;
+}
+
+// Full comparison for primitives with the same content hash
+static bool PrimitiveContentEqual(const cgltf_primitive& a, const cgltf_primitive& b)
+{
+	const cgltf_accessor* accessorsA[5];
+	const cgltf_accessor* accessorsB[5];
+	GetPrimitiveAccessors(a, accessorsA);
+	GetPrimitiveAccessors(b, accessorsB);
+
+	std::vector<uint32_t> valuesA, valuesB;
+	for (int i = 0; i < 5; ++i)
+	{
+		const cgltf_accessor* accessorA = accessorsA[i];
+		const cgltf_accessor* accessorB = accessorsB[i];
+		if (accessorA == accessorB)
+			continue;
+		if (!accessorA || !accessorB || accessorA->count != accessorB->count ||
+			(i != 4 && cgltf_num_components(accessorA->type) != cgltf_num_components(accessorB->type)))
+			return false;
 
-		// If there is any score we try to recursively build up a bigger set of clusters
-		if (score > 0)
+		size_t pieceElements = std::max(GetUnpackPieceElements(accessorA), GetUnpackPieceElements(accessorB));
+		for (size_t first = 0; first < accessorA->count; first += pieceElements)
 		{
-			// Add the candidate to a local copy and accumulate score
-			MergeCandidate candidate = input;
-			candidate.Push(c.first);
-			candidate.score += score;
+			size_t elements = std::min(pieceElements, accessorA->count - first);
+			UnpackAccessorPiece(accessorA, i == 4, first, elements, valuesA);
+			UnpackAccessorPiece(accessorB, i == 4, first, elements, valuesB);
+			if (valuesA != valuesB)
+				return false;
+		}
+	}
+	return true;
+}
+
+// Everything CookPrimitive reads: the primitive content, the cooking parameters and the generator version
+static uint64_t GetCookCacheKey(uint64_t contentHash, const GeneratorOptions& options)
+{
+	uint64_t params[] = { GENERATOR_VERSION, MAX_LOD_LEVELS, options.meshletConfig.maxVertices, options.meshletConfig.maxTriangles, (uint64_t)options.outputLod, (uint64_t)options.grouping };
+	float coneWeight = MESHLET_CONE_WEIGHT;
+	uint64_t key = HashBytes(params, sizeof(params), contentHash);
+	return HashBytes(&coneWeight, sizeof(coneWeight), key);
+}
+
+static void WritePrimitiveOutput(const PrimitiveOutput& primitiveOutput, CookCacheBlob& blob)
+{
+	blob.Write(primitiveOutput.positions);
+	blob.Write(primitiveOutput.normals);
+	blob.Write(primitiveOutput.tangents);
+	blob.Write(primitiveOutput.texcoords);
+	blob.Write(primitiveOutput.triangles);
+	blob.Write(primitiveOutput.clusters);
+	blob.Write(primitiveOutput.clusterLods);
+	blob.Write(primitiveOutput.lodClusters);
+	blob.Write(primitiveOutput.lodClusterLods);
+	blob.Write(primitiveOutput.groups);
+	blob.Write(primitiveOutput.groupingStats);
+	blob.Write(primitiveOutput.reductionStats);
+	blob.Write(primitiveOutput.cookStats);
+	blob.Write(primitiveOutput.bounds);
+}
+
+static bool ReadPrimitiveOutput(CookCacheBlob& blob, PrimitiveOutput& primitiveOutput)
+{
+	return blob.Read(primitiveOutput.positions) &&
+		blob.Read(primitiveOutput.normals) &&
+		blob.Read(primitiveOutput.tangents) &&
+		blob.Read(primitiveOutput.texcoords) &&
+		blob.Read(primitiveOutput.triangles) &&
+		blob.Read(primitiveOutput.clusters) &&
+		blob.Read(primitiveOutput.clusterLods) &&
+		blob.Read(primitiveOutput.lodClusters) &&
+		blob.Read(primitiveOutput.lodClusterLods) &&
+		blob.Read(primitiveOutput.groups) &&
+		blob.Read(primitiveOutput.groupingStats) &&
+		blob.Read(primitiveOutput.reductionStats) &&
+		blob.Read(primitiveOutput.cookStats) &&
+		blob.Read(primitiveOutput.bounds) &&
+		blob.readOffset == blob.data.size();
+}
+
+// Largest error after a round trip through the quantized format
+struct QuantizationError
+{
+	float position = 0.0f; // Object space distance
+	float positionRelative = 0.0f; // Relative to the cluster box size
+	float normal = 0.0f; // Degrees
+	float tangent = 0.0f; // Degrees
+	float texcoord = 0.0f;
+
+	void Max(const QuantizationError& other)
+	{
+		position = std::max(position, other.position);
+		positionRelative = std::max(positionRelative, other.positionRelative);
+		normal = std::max(normal, other.normal);
+		tangent = std::max(tangent, other.tangent);
+		texcoord = std::max(texcoord, other.texcoord);
+	}
+};
+
+static float AngleDegrees(float3 a, float3 b)
+{
+	float la = length(a);
+	float lb = length(b);
+	if (la == 0.0f || lb == 0.0f)
+		return 0.0f;
+	return acosf(std::clamp(dot(a, b) / (la * lb), -1.0f, 1.0f)) * (180.0f / 3.14159265f);
+}
 
-			// Recursively find the best candidate
-			candidate = SelectBestCandidateTree(candidate, sortedAdjacency, clusterAdjacencyMap);
+// Returns the largest round trip error
+static QuantizationError QuantizeVertexStreams(const std::vector<Cluster>& clusters, const std::vector<float3>& positions, const std::vector<float3>& normals,
+	const std::vector<float4>& tangents, const std::vector<float2>& texcoords, QuantizedVertexStreams& out)
+{
+	out.positions.resize(positions.size());
+	out.normals.resize(normals.size());
+	out.tangents.resize(tangents.size());
+	out.texcoords.resize(texcoords.size());
+
+	// Positions are relative to the cluster box, every vertex belongs to exactly one cluster
+	std::vector<QuantizationError> clusterErrors(clusters.size());
+	ParallelFor(clusters.size(), [&](size_t ic)
+	{
+		const Cluster& cluster = clusters[ic];
+		QuantizationError& error = clusterErrors[ic];
+		float boxSize = std::max({ cluster.Box.Extents.x, cluster.Box.Extents.y, cluster.Box.Extents.z }) * 2.0f;
 
-			// Store the best candidate in the output
-			if (candidate.score > output.score)
-				output = candidate;
+		for (UINT v = cluster.VertexStart; v < cluster.VertexStart + cluster.VertexCount; ++v)
+		{
+			out.positions[v] = EncodePosition(positions[v], cluster.Box);
+			out.normals[v] = EncodeNormal(normals[v]);
+			out.tangents[v] = EncodeTangent(tangents[v]);
+			out.texcoords[v] = EncodeTexcoord(texcoords[v]);
+
+			// Check the round trip with the same decode the shaders do
+			float positionError = length(DecodePosition(out.positions[v], cluster.Box) - positions[v]);
+			float4 tangent = DecodeTangent(out.tangents[v]);
+			float2 texcoord = DecodeTexcoord(out.texcoords[v]);
+
+			QuantizationError vertexError;
+			vertexError.position = positionError;
+			vertexError.positionRelative = boxSize > 0.0f ? positionError / boxSize : 0.0f;
+			vertexError.normal = AngleDegrees(DecodeNormal(out.normals[v]), normals[v]);
+			vertexError.tangent = AngleDegrees(float3(tangent.x, tangent.y, tangent.z), float3(tangents[v].x, tangents[v].y, tangents[v].z));
+			vertexError.texcoord = std::max(fabsf(texcoord.x - texcoords[v].x), fabsf(texcoord.y - texcoords[v].y));
+			error.Max(vertexError);
 		}
- 	}
+	});
+
+	QuantizationError error;
+	for (const QuantizationError& clusterError : clusterErrors)
+		error.Max(clusterError);
+	return error;
+}
 
-	return output;
+static void LogQuantizationError(size_t vertexCount, const QuantizationError& error)
+{
+	size_t floatBytes = vertexCount * (sizeof(float3) + sizeof(float3) + sizeof(float4) + sizeof(float2));
+	size_t quantizedBytes = vertexCount * (sizeof(QuantizedPosition) + 3 * sizeof(uint32_t));
+	Log("Quantized vertices: %zu -> %zu bytes (%.2fx), max error: position %g (%g of cluster size), normal %.3f deg, tangent %.3f deg, texcoord %g\n",
+		floatBytes, quantizedBytes, quantizedBytes ? double(floatBytes) / quantizedBytes : 0.0,
+		error.position, error.positionRelative, error.normal, error.tangent, error.texcoord);
+}
+
+static void ComputeLevelFill(std::vector<CookReportLevel>& levels, const MeshletConfig& config)
+{
+	for (CookReportLevel& level : levels)
+	{
+		level.triangleFill = float(level.triangles) / (level.clusters * config.maxTriangles);
+		level.vertexFill = float(level.vertices) / (level.clusters * config.maxVertices);
+	}
 }
 
-void Generate(const char* filename, int outputLod)
+bool Generate(const char* filename, const GeneratorOptions& generatorOptions, GeneratorResult* generatorResult)
 {
 	std::vector<float3> out_positions;
 	std::vector<float3> out_normals;
 	std::vector<float4> out_tangents;
 	std::vector<float2> out_texcoords;
-	std::vector<UINT> out_indices;
+	std::vector<uint32_t> out_triangles;
 	std::vector<Cluster> out_clusters;
+	std::vector<ClusterLod> out_clusterLods;
+	std::vector<ClusterGroup> out_groups;
 	std::vector<Mesh> out_meshes;
 	std::vector<Material> out_materials;
 	std::vector<Instance> out_instances;
 
+	double startTime = GetTimeMs();
+	InitializeParallel(generatorOptions.numThreads);
+	InstallMeshoptArena();
+	ResetArenaStats();
+
+	// Every stage is reported, the optional ones with the little time it takes to skip them
+	CookReport report;
+	double stageStart = startTime;
+	auto endStage = [&](const char* name)
+	{
+		double now = GetTimeMs();
+		report.stages.push_back({ name, now - stageStart });
+		stageStart = now;
+	};
+
+	// The source files stay mapped until cgltf_free, the buffers point straight into them
+	GltfMappedFiles mappedFiles;
 	cgltf_options options = {};
+	SetGltfMappedFileCallbacks(options, mappedFiles);
 	cgltf_data* data = nullptr;
 	cgltf_result result = cgltf_parse_file(&options, filename, &data);
-	assert(result == cgltf_result_success);
 
-	result = cgltf_load_buffers(&options, data, nullptr);
-	assert(result == cgltf_result_success);
+	// External buffers are relative to the glTF file
+	if (result == cgltf_result_success)
+		result = cgltf_load_buffers(&options, data, filename);
+	if (result == cgltf_result_success)
+		result = cgltf_validate(data);
+	if (result != cgltf_result_success)
+	{
+		Log("Could not read %s (cgltf error %d)\n", filename, (int)result);
+		cgltf_free(data);
+		ShutdownParallel();
+		return false;
+	}
+	endStage("parse");
 
+	// Flatten all primitives so meshes with few primitives still spread over all threads
+	std::vector<std::pair<int, int>> primitiveList;
+	std::vector<int> meshPrimitiveStart(data->meshes_count + 1);
 	for (int m = 0; m < data->meshes_count; ++m)
 	{
-		UINT cluster_start = out_clusters.size();
-		MinMaxAABB meshBounds = MinMaxAABB{
-			float3 {FLT_MAX, FLT_MAX, FLT_MAX},
-			float3 {FLT_MIN, FLT_MIN, FLT_MIN},
-		};
-
+		meshPrimitiveStart[m] = primitiveList.size();
 		for (int p = 0; p < data->meshes[m].primitives_count; ++p)
+			primitiveList.push_back({ m, p });
+	}
+	meshPrimitiveStart[data->meshes_count] = primitiveList.size();
+
+	// Exported scenes often hold the same geometry in several glTF meshes, find the copies by content so each is cooked once
+	// A primitive that is a copy uses the output of the first one, a mesh whose primitives are all copies of those of an
+	// earlier mesh is not written at all and its instances use the earlier mesh
+	std::vector<uint64_t> contentHashes(primitiveList.size());
+	ParallelFor(primitiveList.size(), [&](size_t ip)
+	{
+		auto [m, p] = primitiveList[ip];
+		contentHashes[ip] = HashPrimitiveContent(data->meshes[m].primitives[p]);
+	});
+
+	std::vector<size_t> primitiveSource(primitiveList.size());
+	std::vector<size_t> uniquePrimitives;
+	FlatHashMap<size_t> primitivesByHash(primitiveList.size()); // First primitive with a hash
+	for (size_t ip = 0; ip < primitiveList.size(); ++ip)
+	{
+		// A hash collision just leaves the primitive unique
+		primitiveSource[ip] = ip;
+		auto [m, p] = primitiveList[ip];
+		const size_t* source = contentHashes[ip] != FlatHashMap<size_t>::EmptyKey ? primitivesByHash.Find(contentHashes[ip]) : nullptr;
+		if (source)
+		{
+			auto [sm, sp] = primitiveList[*source];
+			if (PrimitiveContentEqual(data->meshes[sm].primitives[sp], data->meshes[m].primitives[p]))
+				primitiveSource[ip] = *source;
+		}
+		else if (contentHashes[ip] != FlatHashMap<size_t>::EmptyKey)
 		{
-			cgltf_primitive& primitive = data->meshes[m].primitives[p];
-			assert(primitive.type == cgltf_primitive_type_triangles);
+			primitivesByHash[contentHashes[ip]] = ip;
+		}
+
+		if (primitiveSource[ip] == ip)
+			uniquePrimitives.push_back(ip);
+	}
 
-			cgltf_attribute* positions = nullptr;
-			cgltf_attribute* normals = nullptr;
-			cgltf_attribute* tangents = nullptr;
-			cgltf_attribute* texcoords = nullptr;
-			for (int a = 0; a < primitive.attributes_count; ++a)
+	std::vector<UINT> meshRemap(data->meshes_count); // glTF mesh to written mesh
+	std::vector<int> meshSource(data->meshes_count);
+	UINT uniqueMeshCount = 0;
+	FlatHashMap<int> meshesByHash(data->meshes_count); // First mesh with a hash of its primitive sources
+	for (int m = 0; m < data->meshes_count; ++m)
+	{
+		// Same as for primitives, a hash collision just leaves the mesh unique
+		meshSource[m] = m;
+		int primitiveCount = meshPrimitiveStart[m + 1] - meshPrimitiveStart[m];
+		uint64_t hash = HashBytes(&primitiveCount, sizeof(primitiveCount));
+		hash = HashBytes(primitiveSource.data() + meshPrimitiveStart[m], primitiveCount * sizeof(size_t), hash);
+		const int* source = hash != FlatHashMap<int>::EmptyKey ? meshesByHash.Find(hash) : nullptr;
+		if (source)
+		{
+			int sm = *source;
+			if (meshPrimitiveStart[sm + 1] - meshPrimitiveStart[sm] == primitiveCount &&
+				std::equal(primitiveSource.begin() + meshPrimitiveStart[m], primitiveSource.begin() + meshPrimitiveStart[m + 1], primitiveSource.begin() + meshPrimitiveStart[sm]))
+				meshSource[m] = sm;
+		}
+		else if (hash != FlatHashMap<int>::EmptyKey)
+		{
+			meshesByHash[hash] = m;
+		}
+		meshRemap[m] = meshSource[m] == m ? uniqueMeshCount++ : meshRemap[meshSource[m]];
+	}
+
+	endStage("dedup");
+
+	// With a memory budget, primitives too large to cook within it are split into chunks, and everything cooked goes
+	// through spill files into the scene file so nothing has to hold the whole scene, see OutOfCore.h
+	bool outOfCore = generatorOptions.memoryBudgetMB > 0;
+	size_t chunkTriangles = outOfCore ? GetChunkTriangleBudget(generatorOptions.memoryBudgetMB << 20) : 0;
+	if (outOfCore && (generatorOptions.memoryBudgetMB << 20) < GetMinCookBudget())
+		Log("Budget of %zu MB is below the %zu MB that %d chunks of %d triangles need, cooking with that\n", generatorOptions.memoryBudgetMB,
+			GetMinCookBudget() >> 20, COOK_CHUNKS_IN_FLIGHT, MIN_CHUNK_TRIANGLES);
+	// The spill files and section streams remove their .tmp files when they go out of scope, on failure as well
+	SpillFile triangleSpill, outputSpill;
+	if (outOfCore && !(triangleSpill.Open(SCENE_FILE_NAME ".chunks.tmp") && outputSpill.Open(SCENE_FILE_NAME ".cooked.tmp")))
+	{
+		Log("Could not create the spill files next to %s\n", SCENE_FILE_NAME);
+		cgltf_free(data);
+		ShutdownParallel();
+		return false;
+	}
+
+	// These reorder or rebuild whole streams, out of core those are never in memory
+	bool spatialOrder = generatorOptions.spatialOrder && !outOfCore;
+	bool writePages = generatorOptions.writePages && !outOfCore;
+	bool packClusters = generatorOptions.packClusters && !outOfCore;
+	if (outOfCore && (generatorOptions.spatialOrder || generatorOptions.writePages || generatorOptions.sharedVertices || generatorOptions.packClusters))
+		Log("-spatial, -pages, -sharedvertices and -packclusters need the whole scene in memory, they are off with -budget\n");
+
+	// What gets cooked: every unique primitive, or each chunk of one too large for the budget
+	struct CookItem
+	{
+		size_t primitive;
+		int chunk; // -1 for the whole primitive
+	};
+	std::vector<CookItem> cookItems;
+	std::vector<size_t> primitiveItemStart(primitiveList.size() + 1, 0);
+	std::vector<std::vector<TriangleChunk>> primitiveChunks(primitiveList.size());
+	size_t chunkedPrimitives = 0;
+	for (size_t ip = 0; ip < primitiveList.size(); ++ip)
+	{
+		primitiveItemStart[ip] = cookItems.size();
+		if (primitiveSource[ip] != ip)
+			continue;
+
+		auto [m, p] = primitiveList[ip];
+		const cgltf_primitive& primitive = data->meshes[m].primitives[p];
+		if (outOfCore && primitive.indices && primitive.indices->count / 3 > chunkTriangles)
+		{
+			AccessorDecodeTarget targets[4];
+			GetVertexDecodeTargets(primitive, targets);
+			if (!CanChunkPrimitive(primitive) || !PartitionTriangles(primitive.indices, targets[0].accessor, chunkTriangles, triangleSpill, primitiveChunks[ip]))
+				Log("Primitive %d of mesh %d can't be split into chunks, cooking it whole\n", p, m);
+		}
+
+		if (primitiveChunks[ip].size() > 1)
+		{
+			for (int c = 0; c < primitiveChunks[ip].size(); ++c)
+				cookItems.push_back({ ip, c });
+			chunkedPrimitives += 1;
+		}
+		else
+		{
+			primitiveChunks[ip].clear();
+			cookItems.push_back({ ip, -1 });
+		}
+	}
+	primitiveItemStart[primitiveList.size()] = cookItems.size();
+	if (outOfCore)
+	{
+		Log("Out of core: %zu MB budget, chunks of up to %zu triangles, %zu primitives split into %zu chunks (%.1f MB spilled)\n",
+			generatorOptions.memoryBudgetMB, chunkTriangles, chunkedPrimitives, cookItems.size() - (uniquePrimitives.size() - chunkedPrimitives),
+			triangleSpill.size / (1024.0 * 1024.0));
+	}
+	endStage("chunk");
+
+	// Items found in the cook cache are used as they are, the others are cooked and stored
+	// Chunks are cached too, their key adds the chunk size and index to the one of the primitive
+	std::vector<PrimitiveOutput> itemOutputs(cookItems.size());
+	std::vector<GroupingStats> groupingStats; // Per LOD level, summed over all primitives
+	std::vector<LodReductionStats>& reductionStats = report.reduction;
+	std::vector<uint8_t> cacheHits(cookItems.size(), 0);
+	std::vector<size_t> cacheBytes(cookItems.size(), 0);
+	std::vector<uint8_t> itemFailed(cookItems.size(), 0); // Chunks that could not be read back from the spill file, only out of core
+	bool cookFailed = false;
+	auto cookItem = [&](size_t ii)
+	{
+		const CookItem& item = cookItems[ii];
+		auto [m, p] = primitiveList[item.primitive];
+		const cgltf_primitive& primitive = data->meshes[m].primitives[p];
+		PrimitiveOutput& primitiveOutput = itemOutputs[ii];
+
+		uint64_t key = 0;
+		CookCacheBlob blob;
+		if (generatorOptions.cacheDirectory)
+		{
+			key = GetCookCacheKey(contentHashes[item.primitive], generatorOptions);
+			if (item.chunk >= 0)
 			{
-				if (primitive.attributes[a].type == cgltf_attribute_type_position)
-					positions = &primitive.attributes[a];
-				else if (primitive.attributes[a].type == cgltf_attribute_type_normal)
-					normals = &primitive.attributes[a];
-				else if (primitive.attributes[a].type == cgltf_attribute_type_tangent)
-					tangents = &primitive.attributes[a];
-				else if (primitive.attributes[a].type == cgltf_attribute_type_texcoord)
-					texcoords = &primitive.attributes[a];
+				uint64_t chunkParams[] = { chunkTriangles, (uint64_t)item.chunk };
+				key = HashBytes(chunkParams, sizeof(chunkParams), key);
 			}
-			assert(positions != nullptr);
-
-			cgltf_accessor* positions_accessor = positions->data;
-			assert(positions_accessor != nullptr);
-			assert(positions_accessor->type == cgltf_type_vec3);
-			assert(positions_accessor->component_type == cgltf_component_type_r_32f);
-			assert(positions_accessor->stride == 3 * sizeof(float));
-			cgltf_buffer* position_buffer = positions_accessor->buffer_view->buffer;
-			char* position_ptr_raw = reinterpret_cast<char*>(position_buffer->data) + positions_accessor->buffer_view->offset + positions_accessor->offset;
-			float* position_ptr = reinterpret_cast<float*>(position_ptr_raw);
-
-			float* normal_ptr = nullptr;
-			if (normals)
+			if (LoadCookCacheEntry(generatorOptions.cacheDirectory, key, blob) && ReadPrimitiveOutput(blob, primitiveOutput))
 			{
-				cgltf_accessor* normals_accessor = normals->data;
-				assert(normals_accessor != nullptr);
-				assert(normals_accessor->type == cgltf_type_vec3);
-				assert(normals_accessor->component_type == cgltf_component_type_r_32f);
-				assert(normals_accessor->stride == 3 * sizeof(float));
-				cgltf_buffer* normal_buffer = normals_accessor->buffer_view->buffer;
-				char* normal_ptr_raw = reinterpret_cast<char*>(normal_buffer->data) + normals_accessor->buffer_view->offset + normals_accessor->offset;
-				normal_ptr = reinterpret_cast<float*>(normal_ptr_raw);
+				cacheHits[ii] = 1;
+				cacheBytes[ii] = blob.data.size();
+				return;
 			}
+			primitiveOutput = PrimitiveOutput();
+		}
 
-			float* tangent_ptr = nullptr;
-			if (tangents)
+		if (item.chunk < 0)
+		{
+			CookPrimitive(primitive, generatorOptions, primitiveOutput);
+		}
+		else
+		{
+			if (!CookPrimitiveChunk(primitive, triangleSpill, primitiveChunks[item.primitive][item.chunk], generatorOptions, primitiveOutput))
 			{
-				cgltf_accessor* tangents_accessor = tangents->data;
-				assert(tangents_accessor != nullptr);
-				assert(tangents_accessor->type == cgltf_type_vec4);
-				assert(tangents_accessor->component_type == cgltf_component_type_r_32f);
-				assert(tangents_accessor->stride == 4 * sizeof(float));
-				cgltf_buffer* tangent_buffer = tangents_accessor->buffer_view->buffer;
-				char* tangent_ptr_raw = reinterpret_cast<char*>(tangent_buffer->data) + tangents_accessor->buffer_view->offset + tangents_accessor->offset;
-				tangent_ptr = reinterpret_cast<float*>(tangent_ptr_raw);
+				itemFailed[ii] = 1;
+				return;
 			}
+		}
+
+		if (generatorOptions.cacheDirectory)
+		{
+			blob = CookCacheBlob();
+			WritePrimitiveOutput(primitiveOutput, blob);
+			if (StoreCookCacheEntry(generatorOptions.cacheDirectory, key, blob))
+				cacheBytes[ii] = blob.data.size();
+		}
+	};
+
+	// What each item adds to the file, for the deduplication log
+	struct ItemFootprint { size_t clusters, bytes; };
+	std::vector<ItemFootprint> itemFootprints(cookItems.size());
+	auto measureItem = [&](size_t ii)
+	{
+		const PrimitiveOutput& primitiveOutput = itemOutputs[ii];
+		itemFootprints[ii].clusters = primitiveOutput.clusters.size() + primitiveOutput.lodClusters.size();
+		itemFootprints[ii].bytes = primitiveOutput.positions.size() * (sizeof(float3) + sizeof(float3) + sizeof(float4) + sizeof(float2)) +
+			primitiveOutput.triangles.size() * sizeof(uint32_t) +
+			(primitiveOutput.clusters.size() + primitiveOutput.lodClusters.size()) * (sizeof(Cluster) + sizeof(ClusterLod)) +
+			primitiveOutput.groups.size() * sizeof(ClusterGroup);
+	};
+
+	struct SpilledItem { uint64_t offset, size; };
+	std::vector<SpilledItem> spilledItems(cookItems.size());
+	if (!outOfCore)
+	{
+		ParallelFor(cookItems.size(), [&](size_t ii)
+		{
+			cookItem(ii);
+			measureItem(ii);
+		});
+	}
+	else
+	{
+		// Only COOK_CHUNKS_IN_FLIGHT items are in memory at a time, each batch goes to the spill file before the next starts
+		size_t batchSize = COOK_CHUNKS_IN_FLIGHT;
+		for (size_t first = 0; first < cookItems.size() && !cookFailed; first += batchSize)
+		{
+			size_t count = std::min(batchSize, cookItems.size() - first);
+			ParallelFor(count, [&](size_t i)
+			{
+				cookItem(first + i);
+				measureItem(first + i);
+			});
 
-			float* texcoord_ptr = nullptr;
-			if (texcoords)
+			for (size_t ii = first; ii < first + count; ++ii)
 			{
-				cgltf_accessor* texcoords_accessor = texcoords->data;
-				assert(texcoords_accessor != nullptr);
-				assert(texcoords_accessor->type == cgltf_type_vec2);
-				assert(texcoords_accessor->component_type == cgltf_component_type_r_32f);
-				assert(texcoords_accessor->stride == 2 * sizeof(float));
-				cgltf_buffer* texcoord_buffer = texcoords_accessor->buffer_view->buffer;
-				char* texcoord_ptr_raw = reinterpret_cast<char*>(texcoord_buffer->data) + texcoords_accessor->buffer_view->offset + texcoords_accessor->offset;
-				texcoord_ptr = reinterpret_cast<float*>(texcoord_ptr_raw);
+				CookCacheBlob blob;
+				WritePrimitiveOutput(itemOutputs[ii], blob);
+				spilledItems[ii] = { outputSpill.Append(blob.data.data(), blob.data.size()), blob.data.size() };
+				cookFailed = cookFailed || itemFailed[ii] || spilledItems[ii].offset == ~0ull;
+				itemOutputs[ii] = PrimitiveOutput();
 			}
+		}
+	}
+	if (cookFailed)
+	{
+		Log("Could not read the chunks or write the spill files next to %s\n", SCENE_FILE_NAME);
+		cgltf_free(data);
+		ShutdownParallel();
+		return false;
+	}
 
-			cgltf_accessor* indices_accessor = primitive.indices;
-			assert(indices_accessor != nullptr);
-			assert(indices_accessor->type == cgltf_type_scalar);
-			cgltf_buffer* index_buffer = indices_accessor->buffer_view->buffer;
-			char* index_ptr_raw = reinterpret_cast<char*>(index_buffer->data) + indices_accessor->buffer_view->offset + indices_accessor->offset;
+	if (generatorOptions.cacheDirectory)
+	{
+		size_t hits = 0, hitBytes = 0, storedBytes = 0;
+		for (size_t ii = 0; ii < cookItems.size(); ++ii)
+		{
+			hits += cacheHits[ii];
+			(cacheHits[ii] ? hitBytes : storedBytes) += cacheBytes[ii];
+		}
+		Log("Cook cache %s: %zu of %zu primitives cached (%.1f MB read), %zu cooked (%.1f MB stored)\n", generatorOptions.cacheDirectory,
+			hits, cookItems.size(), hitBytes / (1024.0 * 1024.0), cookItems.size() - hits, storedBytes / (1024.0 * 1024.0));
+	}
 
+	endStage("cook");
 
-			std::vector<UINT> temp_indices(indices_accessor->count);
-			if (indices_accessor->component_type == cgltf_component_type_r_16u)
-			{
-				assert(indices_accessor->stride == sizeof(UINT16));
-				UINT16* index_ptr = reinterpret_cast<UINT16*>(index_ptr_raw);
-				for (int i = 0; i < indices_accessor->count; ++i)
-				{
-					temp_indices[i] = index_ptr[i];
-				}
-			}
-			else
+	// What the meshes that are not written would have added to the file, and how often each output is still needed
+	size_t dedupClusters = 0, dedupBytes = 0;
+	std::vector<UINT> itemUses(cookItems.size(), 0);
+	for (int m = 0; m < data->meshes_count; ++m)
+	{
+		for (int ip = meshPrimitiveStart[m]; ip < meshPrimitiveStart[m + 1]; ++ip)
+		{
+			size_t source = primitiveSource[ip];
+			for (size_t ii = primitiveItemStart[source]; ii < primitiveItemStart[source + 1]; ++ii)
 			{
-				assert(indices_accessor->component_type == cgltf_component_type_r_32u);
-				UINT32* index_ptr = reinterpret_cast<UINT32*>(index_ptr_raw);
-				for (int i = 0; i < indices_accessor->count; ++i)
+				if (meshSource[m] == m)
 				{
-					temp_indices[i] = index_ptr[i];
+					itemUses[ii] += 1;
+					continue;
 				}
+				dedupClusters += itemFootprints[ii].clusters;
+				dedupBytes += itemFootprints[ii].bytes;
 			}
+		}
+	}
+	Log("Deduplication: %zu of %zu primitives and %u of %zu meshes are copies, %zu clusters and %.1f MB removed\n",
+		primitiveList.size() - uniquePrimitives.size(), primitiveList.size(), (UINT)data->meshes_count - uniqueMeshCount, data->meshes_count,
+		dedupClusters, dedupBytes / (1024.0 * 1024.0));
+
+	// Out of core the cooked items are read back one at a time, and everything but the meshes goes straight to the section streams
+	StreamCodec vertexCodec = generatorOptions.compressStreams ? StreamCodec::Vertex : StreamCodec::None;
+	StreamCodec indexCodec = generatorOptions.compressStreams ? StreamCodec::Index : StreamCodec::None;
+	uint32_t vertexFormat = generatorOptions.quantizeVertices ? VERTEX_FORMAT_QUANTIZED : VERTEX_FORMAT_FLOAT;
+	SceneSectionStream clusterStream, clusterLodStream, groupStream, triangleStream;
+	SceneSectionStream vertexSectionStreams[4]; // Positions, normals, tangents, texcoords
+	if (outOfCore)
+	{
+		bool quantize = generatorOptions.quantizeVertices;
+		size_t vertexStrides[4] = {
+			quantize ? sizeof(QuantizedPosition) : sizeof(float3),
+			quantize ? sizeof(uint32_t) : sizeof(float3),
+			quantize ? sizeof(uint32_t) : sizeof(float4),
+			quantize ? sizeof(uint32_t) : sizeof(float2),
+		};
+		bool streamsOpen = clusterStream.Open(SCENE_FILE_NAME ".clusters.tmp", sizeof(Cluster), StreamCodec::None) &&
+			clusterLodStream.Open(SCENE_FILE_NAME ".clusterlods.tmp", sizeof(ClusterLod), StreamCodec::None) &&
+			groupStream.Open(SCENE_FILE_NAME ".groups.tmp", sizeof(ClusterGroup), StreamCodec::None) &&
+			triangleStream.Open(SCENE_FILE_NAME ".indices.tmp", sizeof(uint32_t), indexCodec);
+		const char* vertexStreamNames[4] = { SCENE_FILE_NAME ".positions.tmp", SCENE_FILE_NAME ".normals.tmp", SCENE_FILE_NAME ".tangents.tmp", SCENE_FILE_NAME ".texcoords.tmp" };
+		for (int s = 0; s < 4; ++s)
+			streamsOpen = streamsOpen && vertexSectionStreams[s].Open(vertexStreamNames[s], vertexStrides[s], vertexCodec);
+		if (!streamsOpen)
+		{
+			Log("Could not create the section streams next to %s\n", SCENE_FILE_NAME);
+			cgltf_free(data);
+			ShutdownParallel();
+			return false;
+		}
+	}
 
-			// Generate interleaved vertex buffer for processing
-			std::vector<CpuVertex> temp_vertices(positions_accessor->count);
-			memset(temp_vertices.data(), 0, sizeof(CpuVertex) * temp_vertices.size());
-			for (int i = 0; i < positions_accessor->count; ++i)
-			{
-				int o2 = 2 * i;
-				int o3 = 3 * i;
-				int o4 = 4 * i;
-				float3 pos = float3{ position_ptr[o3], position_ptr[o3 + 1], position_ptr[o3 + 2] };
+	// A spilled item that can't be read back stitches as an empty one, and the cook fails after the stitch
+	PrimitiveOutput spilledOutput;
+	bool spillFailed = false;
+	auto getItemOutput = [&](size_t ii) -> PrimitiveOutput&
+	{
+		if (!outOfCore)
+			return itemOutputs[ii];
+
+		CookCacheBlob blob;
+		blob.data.resize((size_t)spilledItems[ii].size);
+		bool spillRead = outputSpill.Read(spilledItems[ii].offset, blob.data.data(), blob.data.size());
+		spilledOutput = PrimitiveOutput();
+		if (!(spillRead && ReadPrimitiveOutput(blob, spilledOutput)))
+		{
+			spilledOutput = PrimitiveOutput();
+			spillFailed = true;
+		}
+		return spilledOutput;
+	};
 
-				float3 normal = float3{ 0.0f, 0.0f, 0.0f };
-				if (normal_ptr)
-					normal = float3{ normal_ptr[o3], normal_ptr[o3 + 1], normal_ptr[o3 + 2] };
+	// Stitch everything together in order, rebasing the cluster offsets into the global streams
+	// Per mesh the default LOD level clusters of all primitives go first, then the other levels
+	size_t flushedClusters = 0;
+	auto appendClusters = [&](const std::vector<Cluster>& clusters, const std::vector<ClusterLod>& clusterLods, UINT vertexOffset, UINT triangleOffset, UINT groupOffset)
+	{
+		for (Cluster cluster : clusters)
+		{
+			cluster.VertexStart += vertexOffset;
+			cluster.PrimitiveStart += triangleOffset;
+			out_clusters.push_back(cluster);
+		}
 
-				float4 tangent = float4{ 0.0f, 0.0f, 0.0f, 0.0f };
-				if (tangent_ptr)
-					tangent = float4{ tangent_ptr[o4], tangent_ptr[o4 + 1], tangent_ptr[o4 + 2], tangent_ptr[o4 + 3] };
+		for (ClusterLod clusterLod : clusterLods)
+		{
+			if (clusterLod.Group != LOD_GROUP_NONE)
+				clusterLod.Group += groupOffset;
+			if (clusterLod.ParentGroup != LOD_GROUP_NONE)
+				clusterLod.ParentGroup += groupOffset;
+			out_clusterLods.push_back(clusterLod);
+		}
 
-				float2 texcoord = float2{ 0.0f, 0.0f };
-				if (texcoord_ptr)
-					texcoord = float2{ texcoord_ptr[o2], texcoord_ptr[o2 + 1] };
+		if (outOfCore)
+		{
+			clusterStream.Append(out_clusters);
+			clusterLodStream.Append(out_clusterLods);
+			flushedClusters += out_clusters.size();
+			out_clusters.clear();
+			out_clusterLods.clear();
+		}
+	};
 
-				temp_vertices[i] = CpuVertex{ pos, normal, tangent, texcoord };
-			}
+	// Clusters per LOD level, for the report
+	std::vector<CookReportLevel>& levels = report.levels;
+	auto countLevels = [&](const std::vector<Cluster>& clusters, const std::vector<ClusterLod>& clusterLods, const std::vector<ClusterGroup>& groups)
+	{
+		for (int c = 0; c < clusters.size(); ++c)
+		{
+			UINT level = clusterLods[c].Group != LOD_GROUP_NONE ? groups[clusterLods[c].Group].Level + 1 : 0;
+			if (levels.size() <= level)
+				levels.resize(level + 1);
+			levels[level].clusters += 1;
+			levels[level].triangles += clusters[c].PrimitiveCount;
+			levels[level].vertices += clusters[c].VertexCount;
+			levels[level].fillHistogram[std::min(clusters[c].PrimitiveCount * COOK_REPORT_FILL_BUCKETS / generatorOptions.meshletConfig.maxTriangles, COOK_REPORT_FILL_BUCKETS - 1u)] += 1;
+		}
+	};
 
-			// Start mesh optimization
-			MeshletGeneratorContext context;
-			{
-				size_t index_count = temp_indices.size();
-				std::vector<unsigned int> remap(index_count);
-				size_t vertex_count = meshopt_generateVertexRemap(remap.data(), temp_indices.data(), index_count, temp_vertices.data(), temp_vertices.size(), sizeof(CpuVertex));
-
-				context.vertices.resize(vertex_count);
-				context.indices.resize(index_count);
-				meshopt_remapIndexBuffer(context.indices.data(), temp_indices.data(), index_count, remap.data());
-				meshopt_remapVertexBuffer(context.vertices.data(), temp_vertices.data(), temp_vertices.size(), sizeof(CpuVertex), remap.data());
-				meshopt_optimizeVertexCache(context.indices.data(), context.indices.data(), index_count, vertex_count);
-				meshopt_optimizeOverdraw(context.indices.data(), context.indices.data(), index_count, (float*)context.vertices.data(), vertex_count, sizeof(CpuVertex), 1.05f);
-				meshopt_optimizeVertexFetch(context.vertices.data(), context.indices.data(), index_count, context.vertices.data(), vertex_count, sizeof(CpuVertex));
-			}
+	QuantizationError quantizationError;
+	size_t quantizedVertices = 0;
+	for (int m = 0; m < data->meshes_count; ++m)
+	{
+		if (meshSource[m] != m)
+			continue;
 
-			// Start clustering
-			const size_t max_vertices = 64;
-			const size_t max_triangles = 124;
-			const float cone_weight = 0.0f;
-			{
-				context.lods.reserve(16); // Just in case.
-				MeshletLodLevel& lod0 = context.lods.emplace_back();
+		CookReportMesh& reportMesh = report.meshes.emplace_back();
+		reportMesh.name = data->meshes[m].name ? data->meshes[m].name : "";
 
-				{
-					// Do initial clustering
-					size_t max_meshlets = meshopt_buildMeshletsBound(context.indices.size(), max_vertices, max_triangles);
-					lod0.meshlets.resize(max_meshlets);
-					lod0.meshletVertices.resize(max_meshlets * max_vertices);
-					lod0.meshletTriangles.resize(max_meshlets * max_triangles * 3);
-					lod0.meshlets.resize(meshopt_buildMeshlets(lod0.meshlets.data(),
-						lod0.meshletVertices.data(),
-						lod0.meshletTriangles.data(),
-						context.indices.data(),
-						context.indices.size(),
-						(float*)context.vertices.data(),
-						context.vertices.size(),
-						sizeof(CpuVertex),
-						max_vertices, max_triangles, cone_weight));
-
-					const meshopt_Meshlet& last = lod0.meshlets[lod0.meshlets.size() - 1];
-					lod0.meshletVertices.resize(last.vertex_offset + last.vertex_count);
-					lod0.meshletTriangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
-					lod0.edgeSets.resize(lod0.meshlets.size());
-				}
-			}
+		UINT cluster_start = flushedClusters + out_clusters.size();
+		MinMaxAABB meshBounds = MinMaxAABB{
+			float3 {FLT_MAX, FLT_MAX, FLT_MAX},
+			float3 {-FLT_MAX, -FLT_MAX, -FLT_MAX},
+		};
 
-			bool done = false;
-			int ilod = 0;
-			while (!done && ilod < outputLod)
+		struct PrimitiveOffsets { UINT vertex, triangle, group; };
+		std::vector<PrimitiveOffsets> itemOffsets;
+		for (int ip = meshPrimitiveStart[m]; ip < meshPrimitiveStart[m + 1]; ++ip)
+		{
+			size_t source = primitiveSource[ip];
+			for (size_t ii = primitiveItemStart[source]; ii < primitiveItemStart[source + 1]; ++ii)
 			{
-				auto& prevLod = context.lods.at(ilod);
-				ilod += 1;
-				assert(ilod < 16); // We can only handle so many steps for now
+				PrimitiveOutput& primitiveOutput = getItemOutput(ii);
 
-				// Loop over all meshlets to figure out their external edges
-				for (int ml = 0; ml < prevLod.meshlets.size(); ++ml)
+				UINT vertexOffset = outOfCore ? vertexSectionStreams[0].count : out_positions.size();
+				UINT triangleOffset = outOfCore ? triangleStream.count : out_triangles.size();
+				UINT groupOffset = outOfCore ? groupStream.count : out_groups.size();
+				itemOffsets.push_back({ vertexOffset, triangleOffset, groupOffset });
+				appendClusters(primitiveOutput.clusters, primitiveOutput.clusterLods, vertexOffset, triangleOffset, groupOffset);
+				countLevels(primitiveOutput.clusters, primitiveOutput.clusterLods, primitiveOutput.groups);
+				countLevels(primitiveOutput.lodClusters, primitiveOutput.lodClusterLods, primitiveOutput.groups);
+
+				if (outOfCore && generatorOptions.quantizeVertices)
 				{
-					meshopt_Meshlet& meshlet = prevLod.meshlets[ml];
-
-					// First loop over all triangles to count the nuber of times each edge occurs
-					std::unordered_map<uint64_t, int> edgeCounterMap;
-					for (uint t = 0; t < meshlet.triangle_count; ++t)
-					{
-						int o = meshlet.triangle_offset + 3 * t;
-						int i0 = prevLod.meshletTriangles[o + 0];
-						int i1 = prevLod.meshletTriangles[o + 2];
-						int i2 = prevLod.meshletTriangles[o + 1];
-
-						int v0 = prevLod.meshletVertices[meshlet.vertex_offset + i0];
-						int v1 = prevLod.meshletVertices[meshlet.vertex_offset + i1];
-						int v2 = prevLod.meshletVertices[meshlet.vertex_offset + i2];
-
-						uint64_t pe0 = PackEdge(v0, v1);
-						uint64_t pe1 = PackEdge(v0, v2);
-						uint64_t pe2 = PackEdge(v1, v2);
-
-						auto iter0 = edgeCounterMap.find(pe0);
-						if (iter0 != edgeCounterMap.end())
-							iter0->second += 1;
-						else
-							edgeCounterMap[pe0] = 1;
-
-						auto iter1 = edgeCounterMap.find(pe1);
-						if (iter1 != edgeCounterMap.end())
-							iter1->second += 1;
-						else
-							edgeCounterMap[pe1] = 1;
-
-						auto iter2 = edgeCounterMap.find(pe2);
-						if (iter2 != edgeCounterMap.end())
-							iter2->second += 1;
-						else
-							edgeCounterMap[pe2] = 1;
-					}
-
-					// Then loop over all found edges to get the ones that have occured only once
-					// This is the external edges of the clusters
-					auto& meshletEdgeSet = prevLod.edgeSets[ml];
-					for (auto iter : edgeCounterMap)
-					{
-						if (iter.second == 1)
-							meshletEdgeSet.insert(iter.first);
-					}
+					// Every vertex belongs to one cluster of either list, the item is quantized on its own
+					std::vector<Cluster> itemClusters = primitiveOutput.clusters;
+					itemClusters.insert(itemClusters.end(), primitiveOutput.lodClusters.begin(), primitiveOutput.lodClusters.end());
+					QuantizedVertexStreams quantized;
+					quantizationError.Max(QuantizeVertexStreams(itemClusters, primitiveOutput.positions, primitiveOutput.normals, primitiveOutput.tangents, primitiveOutput.texcoords, quantized));
+					quantizedVertices += primitiveOutput.positions.size();
+					vertexSectionStreams[0].Append(quantized.positions);
+					vertexSectionStreams[1].Append(quantized.normals);
+					vertexSectionStreams[2].Append(quantized.tangents);
+					vertexSectionStreams[3].Append(quantized.texcoords);
 				}
-
-				// Loop over all meshlets to figure out which ones are connected
-				std::unordered_map<uint64_t, int> clusterAdjacencyMap; // Maps the pair <c0, c1> to common edge count
-				std::vector<std::pair<int, int>> clusterAdjacencyCount(prevLod.meshlets.size()); // Contains the pair <cluster, counter> counting how many neighbours a cluster have
-				for (int ml = 0; ml < clusterAdjacencyCount.size(); ++ml)
+				else if (outOfCore)
 				{
-					clusterAdjacencyCount[ml].first = ml;
-					clusterAdjacencyCount[ml].second = 0;
+					vertexSectionStreams[0].Append(primitiveOutput.positions);
+					vertexSectionStreams[1].Append(primitiveOutput.normals);
+					vertexSectionStreams[2].Append(primitiveOutput.tangents);
+					vertexSectionStreams[3].Append(primitiveOutput.texcoords);
 				}
-				for (int ml = 0; ml < prevLod.meshlets.size(); ++ml)
+				else
 				{
-					auto& edgeSet = prevLod.edgeSets[ml];
-
-					for (int ml_inner = ml + 1; ml_inner < prevLod.meshlets.size(); ++ml_inner)
-					{
-						// For each edge test it in the other clusters set
-						auto& edgeSetInner = prevLod.edgeSets[ml_inner];
-						int count = 0;
-						for (uint64_t edge : edgeSetInner)
-						{
-							if (edgeSet.contains(edge))
-								count += 1;
-						}
-
-						// If we have any edges we can go ahead and add it to the map
-						// Also store the count so we know how "strong" this connection is
-						if (count > 0)
-						{
-							clusterAdjacencyMap[PackCluster(ml, ml_inner)] = count;
-							clusterAdjacencyCount[ml].second += 1;
-							clusterAdjacencyCount[ml_inner].second += 1;
-						}
-					}
+					out_positions.insert(out_positions.end(), primitiveOutput.positions.begin(), primitiveOutput.positions.end());
+					out_normals.insert(out_normals.end(), primitiveOutput.normals.begin(), primitiveOutput.normals.end());
+					out_tangents.insert(out_tangents.end(), primitiveOutput.tangents.begin(), primitiveOutput.tangents.end());
+					out_texcoords.insert(out_texcoords.end(), primitiveOutput.texcoords.begin(), primitiveOutput.texcoords.end());
 				}
 
-				// Sort the clusters by connection count
-				// Here we should probably have a triangle size metric as well
-				std::vector<std::pair<int, int>> sortedAdjacency(clusterAdjacencyCount.size());
-				std::partial_sort_copy(clusterAdjacencyCount.begin(), clusterAdjacencyCount.end(), sortedAdjacency.begin(), sortedAdjacency.end(), [](std::pair<int, int> l, std::pair<int, int> r) { return l.second > r.second; });
-
-				std::vector<MergeCandidate> mergeLists;
-				while (sortedAdjacency.size() > 0)
+				if (outOfCore)
 				{
-					// Create a new candidate and populate it with the least connected cluster
-					MergeCandidate candidate;
-					candidate.Push(sortedAdjacency.back().first);
-
-					// Get the best possible scoring merge candidate using this specific candidate starting point
-					MergeCandidate output = SelectBestCandidateTree(candidate, sortedAdjacency, clusterAdjacencyMap);
-					mergeLists.push_back(output);
-
-					// Remove all the selected clusters from future searches
-					std::erase_if(sortedAdjacency, [output](const auto& v) {
-						for (int c = 0; c < output.count; ++c)
-							if (v.first == output.set[c])
-								return true;
-						return false;
-					});
+					triangleStream.Append(primitiveOutput.triangles);
+					groupStream.Append(primitiveOutput.groups);
 				}
-
-				if (mergeLists.size() < 10) // TODO: end heuristic
-					break;
-
-				MeshletLodLevel& currLod = context.lods.emplace_back();
-
-				// We now have all the clusters to merge. Process them group by group
-				for (auto& l : mergeLists)
+				else
 				{
-					// Generate a new index list from the selected clusters, generating a merged mesh
-					std::vector<unsigned int> mergedIndices;
-					for(int c = 0; c < l.count; ++c)
-					{
-						int ml = l.set[c];
-						meshopt_Meshlet& meshlet = prevLod.meshlets[ml];
-
-						for (uint i = 0; i < 3 * meshlet.triangle_count; ++i)
-						{
-							int localIndex = prevLod.meshletTriangles[meshlet.triangle_offset + i];
-							int globalIndex = prevLod.meshletVertices[meshlet.vertex_offset + localIndex];
-							mergedIndices.push_back(globalIndex);
-						}
-					}
-
-					// Simplify the merged mesh
-					float threshold = 0.5f; // TODO: pick to get down to half the tris and half the clusters
-					size_t targetIndexCount = size_t(mergedIndices.size() * threshold);
-					float targetError = 1e-2f;
-					unsigned int options = meshopt_SimplifyLockBorder;
-
-					std::vector<unsigned int> simplifiedIndices(mergedIndices.size());
-					float lod_error = 0.f;
-					simplifiedIndices.resize(meshopt_simplify(simplifiedIndices.data(),
-						mergedIndices.data(),
-						mergedIndices.size(),
-						(float*)context.vertices.data(),
-						context.vertices.size(), 
-						sizeof(CpuVertex),
-						targetIndexCount,
-						targetError,
-						options,
-						&lod_error));
-
-					// Generate new clusters for the new simplified index list
-					size_t max_meshlets = meshopt_buildMeshletsBound(simplifiedIndices.size(), max_vertices, max_triangles);
-
-					// Temp vectors here so we can append things later on
-					std::vector<meshopt_Meshlet> meshlets(max_meshlets);
-					std::vector<unsigned int> meshletVertices(max_meshlets * max_vertices);
-					std::vector<unsigned char> meshletTriangles(max_meshlets * max_triangles * 3);
-
-					// Build actual meshlets
-					meshlets.resize(meshopt_buildMeshlets(meshlets.data(),
-						meshletVertices.data(),
-						meshletTriangles.data(),
-						simplifiedIndices.data(),
-						simplifiedIndices.size(),
-						(float*)context.vertices.data(),
-						context.vertices.size(),
-						sizeof(CpuVertex),
-						max_vertices, max_triangles, cone_weight));
-
-					// Append meshlets into lod array
-					int vo = currLod.meshletVertices.size();
-					int to = currLod.meshletTriangles.size();
-					for (int ml = 0; ml < meshlets.size(); ++ml)
-					{
-						meshopt_Meshlet& meshlet = meshlets[ml];
-						currLod.meshlets.push_back({ meshlet.vertex_offset + vo, meshlet.triangle_offset + to, meshlet.vertex_count, meshlet.triangle_count });
-					}
-					currLod.meshletVertices.insert(currLod.meshletVertices.end(), meshletVertices.begin(), meshletVertices.end());
-					currLod.meshletTriangles.insert(currLod.meshletTriangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+					out_triangles.insert(out_triangles.end(), primitiveOutput.triangles.begin(), primitiveOutput.triangles.end());
+					out_groups.insert(out_groups.end(), primitiveOutput.groups.begin(), primitiveOutput.groups.end());
 				}
-				currLod.edgeSets.resize(currLod.meshlets.size());
+
+				meshBounds.Min = min(meshBounds.Min, primitiveOutput.bounds.Min);
+				meshBounds.Max = max(meshBounds.Max, primitiveOutput.bounds.Max);
+
+				if (groupingStats.size() < primitiveOutput.groupingStats.size())
+					groupingStats.resize(primitiveOutput.groupingStats.size());
+				for (int ilod = 0; ilod < primitiveOutput.groupingStats.size(); ++ilod)
+					groupingStats[ilod].Add(primitiveOutput.groupingStats[ilod]);
+				if (reductionStats.size() < primitiveOutput.reductionStats.size())
+					reductionStats.resize(primitiveOutput.reductionStats.size());
+				for (int ilod = 0; ilod < primitiveOutput.reductionStats.size(); ++ilod)
+					reductionStats[ilod].Add(primitiveOutput.reductionStats[ilod]);
 			}
+		}
 
+		UINT defaultClusterCount = UINT(flushedClusters + out_clusters.size()) - cluster_start;
+		size_t itemIndex = 0;
+		for (int ip = meshPrimitiveStart[m]; ip < meshPrimitiveStart[m + 1]; ++ip)
+		{
+			size_t source = primitiveSource[ip];
+			bool cached = true;
+			for (size_t ii = primitiveItemStart[source]; ii < primitiveItemStart[source + 1]; ++ii)
 			{
-				MeshletLodLevel& lod = context.lods.at(std::min(outputLod, (int)context.lods.size() - 1));
-				for (int ml = 0; ml < lod.meshlets.size(); ++ml)
-				{
-					meshopt_Meshlet& meshlet = lod.meshlets[ml];
-
-					UINT outputVerticesOffset = out_positions.size();
-					MinMaxAABB clusterBounds = MinMaxAABB{
-						float3 {FLT_MAX, FLT_MAX, FLT_MAX},
-						float3 {FLT_MIN, FLT_MIN, FLT_MIN},
-					};
-
-					for (uint v = 0; v < meshlet.vertex_count; ++v)
-					{
-						int vi = lod.meshletVertices[meshlet.vertex_offset + v];
-						CpuVertex& vert = context.vertices[vi];
-						out_positions.push_back(vert.pos);
-						out_normals.push_back(vert.normal);
-						out_tangents.push_back(vert.tangent);
-						out_texcoords.push_back(vert.texcoord);
-
-						clusterBounds.Min = min(clusterBounds.Min, vert.pos);
-						clusterBounds.Max = max(clusterBounds.Max, vert.pos);
-					}
-
-					UINT outputTriangleOffset = out_indices.size() / 3;
-					for (uint t = 0; t < meshlet.triangle_count; ++t)
-					{
-						int o = meshlet.triangle_offset + 3 * t;
-						int i0 = lod.meshletTriangles[o + 0];
-						int i1 = lod.meshletTriangles[o + 2];
-						int i2 = lod.meshletTriangles[o + 1];
-
-						out_indices.push_back(i0);
-						out_indices.push_back(i1);
-						out_indices.push_back(i2);
-					}
-
-					out_clusters.push_back(Cluster{
-						outputTriangleOffset,
-						meshlet.triangle_count,
-						outputVerticesOffset,
-						meshlet.vertex_count,
-						MinMaxToCenterExtents(clusterBounds),
-						});
-
-					meshBounds.Min = min(meshBounds.Min, clusterBounds.Min);
-					meshBounds.Max = max(meshBounds.Max, clusterBounds.Max);
-				}
+				PrimitiveOutput& primitiveOutput = getItemOutput(ii);
+				PrimitiveOffsets offsets = itemOffsets[itemIndex++];
+				appendClusters(primitiveOutput.lodClusters, primitiveOutput.lodClusterLods, offsets.vertex, offsets.triangle, offsets.group);
+
+				// Copies didn't take any time of their own
+				PrimitiveCookStats cookStats = primitiveOutput.cookStats;
+				if (source != ip)
+					std::fill(std::begin(cookStats.stageMs), std::end(cookStats.stageMs), 0.0);
+				reportMesh.stats.Add(cookStats);
+				cached = cached && cacheHits[ii];
+
+				if (--itemUses[ii] == 0 && !outOfCore)
+					primitiveOutput = PrimitiveOutput(); // Release memory as we go
 			}
+
+			reportMesh.primitives += 1;
+			reportMesh.cachedPrimitives += source == ip && cached ? 1 : 0;
+			reportMesh.copiedPrimitives += source != ip ? 1 : 0;
 		}
 
+		reportMesh.clusters = UINT(flushedClusters + out_clusters.size()) - cluster_start;
 		out_meshes.push_back(Mesh{
 			cluster_start,
-			(UINT)out_clusters.size() - cluster_start,
+			defaultClusterCount,
+			UINT(flushedClusters + out_clusters.size()) - cluster_start,
 			MinMaxToCenterExtents(meshBounds),
 		});
 	}
+
+	ComputeLevelFill(levels, generatorOptions.meshletConfig);
+	if (outOfCore && generatorOptions.quantizeVertices)
+		LogQuantizationError(quantizedVertices, quantizationError);
+
+	size_t clusterCount = flushedClusters + out_clusters.size();
+	size_t triangleCount = outOfCore ? triangleStream.count : out_triangles.size();
+	size_t groupCount = outOfCore ? groupStream.count : out_groups.size();
 	
 	for (int m = 0; m < data->materials_count; ++m)
 	{
@@ -664,17 +1616,261 @@ void Generate(const char* filename, int outputLod)
 	assert(data->scene != nullptr);
 
 	for (int n = 0; n < data->scene->nodes_count; ++n)
-		ConvertNodeHierarchy(data, out_instances, out_meshes, data->scene->nodes[n]);
-
-	OutputDataToFile(L"positions.raw", out_positions);
-	OutputDataToFile(L"normals.raw", out_normals);
-	OutputDataToFile(L"tangents.raw", out_tangents);
-	OutputDataToFile(L"texcoords.raw", out_texcoords);
-	OutputDataToFile(L"indices.raw", out_indices);
-	OutputDataToFile(L"clusters.raw", out_clusters);
-	OutputDataToFile(L"meshes.raw", out_meshes);
-	OutputDataToFile(L"materials.raw", out_materials);
-	OutputDataToFile(L"instances.raw", out_instances);
+		ConvertNodeHierarchy(data, out_instances, out_meshes, meshRemap, data->scene->nodes[n]);
+	if (spillFailed)
+	{
+		Log("Could not read back the spill file next to %s\n", SCENE_FILE_NAME);
+		cgltf_free(data);
+		ShutdownParallel();
+		return false;
+	}
+	endStage("stitch");
+
+	// Before the spatial order, so the merged clusters get sorted too
+	if (packClusters)
+	{
+		double packStartTime = GetTimeMs();
+		ClusterPackingStats stats = PackClusters(out_meshes, out_groups, out_clusters, out_clusterLods, out_positions, out_normals, out_tangents, out_texcoords,
+			out_triangles, generatorOptions.meshletConfig.maxVertices, generatorOptions.meshletConfig.maxTriangles, MESHLET_CONE_WEIGHT);
+		report.unpackedLevels.swap(levels);
+		countLevels(out_clusters, out_clusterLods, out_groups);
+		ComputeLevelFill(levels, generatorOptions.meshletConfig);
+		clusterCount = out_clusters.size();
+
+		const CookReportLevel& before = report.unpackedLevels[0];
+		const CookReportLevel& after = levels[0];
+		Log("Cluster packing: %zu -> %zu clusters (%.1f%% fewer, %zu runs packed, %zu groups merged), first level triangle fill %.1f%% -> %.1f%%, %zu -> %zu vertices, %.2f ms\n",
+			stats.clustersBefore, stats.clustersAfter, stats.clustersBefore ? 100.0 - 100.0 * stats.clustersAfter / stats.clustersBefore : 0.0, stats.packedRuns, stats.mergedGroups,
+			before.triangleFill * 100.0, after.triangleFill * 100.0, stats.verticesBefore, stats.verticesAfter, GetTimeMs() - packStartTime);
+	}
+	endStage("pack");
+
+	// Culling order, the geometry follows the clusters so it is fetched in the same order
+	if (spatialOrder)
+	{
+		double spatialStartTime = GetTimeMs();
+		SortInstancesSpatially(out_instances);
+		SortClustersSpatially(out_meshes, out_groups, out_clusters, out_clusterLods);
+		GatherClusterVertices(out_clusters, out_positions);
+		GatherClusterVertices(out_clusters, out_normals);
+		GatherClusterVertices(out_clusters, out_tangents);
+		GatherClusterVertices(out_clusters, out_texcoords);
+		GatherClusterTriangles(out_clusters, out_triangles);
+		RebaseClusterElements(out_clusters);
+		Log("Spatial order: %zu instances and %zu clusters in %.2f ms\n", out_instances.size(), out_clusters.size(), GetTimeMs() - spatialStartTime);
+	}
+	endStage("spatial");
+
+	// Last of the reordering, VertexStart points into the index lists after this
+	std::vector<uint32_t> vertexIndices;
+	bool sharedVertices = generatorOptions.sharedVertices && !generatorOptions.quantizeVertices && !generatorOptions.writePages && !outOfCore;
+	if (generatorOptions.sharedVertices && !sharedVertices && !outOfCore)
+		Log("Shared vertices don't work with -quantize or -pages, writing the vertices per cluster\n");
+	if (sharedVertices)
+	{
+		double sharedStartTime = GetTimeMs();
+		const size_t vertexSize = sizeof(float3) + sizeof(float3) + sizeof(float4) + sizeof(float2);
+		SharedVertexStats stats = BuildSharedVertexPool(out_meshes, out_clusters, out_positions, out_normals, out_tangents, out_texcoords, vertexIndices);
+		size_t clusterBytes = stats.clusterVertices * vertexSize;
+		size_t poolBytes = stats.poolVertices * vertexSize + vertexIndices.size() * sizeof(uint32_t);
+		Log("Shared vertices: %zu cluster vertices -> %zu pool vertices (%.2fx), %.1f MB -> %.1f MB with the index lists (%.1f%% saved), %zu hash collisions, %.2f ms\n",
+			stats.clusterVertices, stats.poolVertices, stats.poolVertices ? double(stats.clusterVertices) / stats.poolVertices : 0.0,
+			clusterBytes / (1024.0 * 1024.0), poolBytes / (1024.0 * 1024.0), clusterBytes ? 100.0 - 100.0 * poolBytes / clusterBytes : 0.0,
+			stats.hashCollisions, GetTimeMs() - sharedStartTime);
+	}
+	endStage("shared");
+
+	// Vertex and index streams are the bulk of the file, those are the ones we compress
+	double writeStartTime = GetTimeMs();
+	QuantizedVertexStreams quantized;
+	if (generatorOptions.quantizeVertices && !outOfCore)
+		LogQuantizationError(out_positions.size(), QuantizeVertexStreams(out_clusters, out_positions, out_normals, out_tangents, out_texcoords, quantized));
+	endStage("quantize");
+
+	// Pages have to be built before the clusters are added, they fill in the page location of every cluster
+	std::vector<ClusterPage> pages;
+	std::vector<uint8_t> pageData;
+	if (writePages)
+	{
+		const void* vertexStreams[PAGE_STREAM_COUNT - 1] = { out_positions.data(), out_normals.data(), out_tangents.data(), out_texcoords.data() };
+		if (generatorOptions.quantizeVertices)
+		{
+			vertexStreams[0] = quantized.positions.data();
+			vertexStreams[1] = quantized.normals.data();
+			vertexStreams[2] = quantized.tangents.data();
+			vertexStreams[3] = quantized.texcoords.data();
+		}
+		BuildClusterPages(out_clusters, vertexStreams, out_triangles.data(), vertexFormat, pages, pageData);
+		Log("Cluster pages: %zu pages, %.1f clusters and %.1f KB per page\n", pages.size(),
+			pages.empty() ? 0.0 : double(out_clusters.size()) / pages.size(), pages.empty() ? 0.0 : pageData.size() / 1024.0 / pages.size());
+	}
+	endStage("pages");
+
+	SceneFileWriter sceneFile;
+	bool streamsWritten = true;
+	sceneFile.AddSection(SceneSectionType::Instances, out_instances);
+	sceneFile.AddSection(SceneSectionType::Meshes, out_meshes);
+	if (outOfCore)
+	{
+		streamsWritten = sceneFile.AddSection(SceneSectionType::Clusters, clusterStream) &&
+			sceneFile.AddSection(SceneSectionType::ClusterLods, clusterLodStream) &&
+			sceneFile.AddSection(SceneSectionType::Groups, groupStream);
+	}
+	else
+	{
+		sceneFile.AddSection(SceneSectionType::Clusters, out_clusters);
+		sceneFile.AddSection(SceneSectionType::ClusterLods, out_clusterLods);
+		sceneFile.AddSection(SceneSectionType::Groups, out_groups);
+	}
+	sceneFile.AddSection(SceneSectionType::Materials, out_materials);
+	if (outOfCore)
+	{
+		streamsWritten = streamsWritten &&
+			sceneFile.AddSection(SceneSectionType::Positions, vertexSectionStreams[0], vertexFormat) &&
+			sceneFile.AddSection(SceneSectionType::Normals, vertexSectionStreams[1], vertexFormat) &&
+			sceneFile.AddSection(SceneSectionType::Tangents, vertexSectionStreams[2], vertexFormat) &&
+			sceneFile.AddSection(SceneSectionType::Texcoords, vertexSectionStreams[3], vertexFormat) &&
+			sceneFile.AddSection(SceneSectionType::Indices, triangleStream);
+		if (!streamsWritten)
+		{
+			Log("Could not write the section streams of %s\n", SCENE_FILE_NAME);
+			cgltf_free(data);
+			ShutdownParallel();
+			return false;
+		}
+	}
+	else if (writePages)
+	{
+		// The geometry is only stored once, in the pages, and the renderer always streams such a scene
+	}
+	else if (generatorOptions.quantizeVertices)
+	{
+		sceneFile.AddSection(SceneSectionType::Positions, quantized.positions, vertexCodec, vertexFormat);
+		sceneFile.AddSection(SceneSectionType::Normals, quantized.normals, vertexCodec, vertexFormat);
+		sceneFile.AddSection(SceneSectionType::Tangents, quantized.tangents, vertexCodec, vertexFormat);
+		sceneFile.AddSection(SceneSectionType::Texcoords, quantized.texcoords, vertexCodec, vertexFormat);
+	}
+	else
+	{
+		sceneFile.AddSection(SceneSectionType::Positions, out_positions, vertexCodec, vertexFormat);
+		sceneFile.AddSection(SceneSectionType::Normals, out_normals, vertexCodec, vertexFormat);
+		sceneFile.AddSection(SceneSectionType::Tangents, out_tangents, vertexCodec, vertexFormat);
+		sceneFile.AddSection(SceneSectionType::Texcoords, out_texcoords, vertexCodec, vertexFormat);
+	}
+	if (!outOfCore && !writePages)
+		sceneFile.AddSection(SceneSectionType::Indices, out_triangles, indexCodec);
+	if (sharedVertices)
+		sceneFile.AddSection(SceneSectionType::VertexIndices, vertexIndices, vertexCodec);
+	sceneFile.AddSection(SceneSectionType::MeshletConfig, &generatorOptions.meshletConfig, sizeof(MeshletConfig), 1);
+	if (writePages)
+	{
+		sceneFile.AddSection(SceneSectionType::Pages, pages);
+		sceneFile.AddSection(SceneSectionType::PageData, pageData, StreamCodec::None, vertexFormat);
+	}
+
+	size_t sceneFileSize = sceneFile.Write(SCENE_FILE_NAME);
+	if (sceneFileSize == 0)
+	{
+		Log("Could not write %s\n", SCENE_FILE_NAME);
+		cgltf_free(data);
+		ShutdownParallel();
+		return false;
+	}
+
+	size_t rawSize = 0;
+	for (const SceneSection& section : sceneFile.sections)
+		rawSize += section.stride * section.count;
+	Log("Wrote %s: %zu sections, %zu -> %zu bytes (%.2fx) in %.2f ms\n",
+		SCENE_FILE_NAME, sceneFile.sections.size(), rawSize, sceneFileSize, double(rawSize) / sceneFileSize, GetTimeMs() - writeStartTime);
+	endStage("write");
 
 	cgltf_free(data);
+
+	int threadCount = GetParallelThreadCount();
+	ShutdownParallel();
+
+	Log("Cluster grouping (%s):\n", GetClusterGroupingName(generatorOptions.grouping));
+	for (int ilod = 0; ilod < groupingStats.size(); ++ilod)
+	{
+		const GroupingStats& stats = groupingStats[ilod];
+		Log("  lod %d: %d clusters -> %d groups (avg %.2f), edge cut %d/%d (%.1f%%), %.2f ms, sizes",
+			ilod, stats.clusterCount, stats.groupCount, stats.groupCount ? float(stats.clusterCount) / stats.groupCount : 0.0f,
+			stats.edgeCut, stats.totalEdges, stats.totalEdges ? 100.0f * stats.edgeCut / stats.totalEdges : 0.0f, stats.timeMs);
+		for (int size = 1; size <= MAX_CLUSTERS_PER_CANDIDATE; ++size)
+			Log(" %d:%d", size, stats.sizeHistogram[size]);
+		Log("\n");
+	}
+
+	Log("LOD reduction:\n");
+	for (int ilod = 0; ilod < reductionStats.size(); ++ilod)
+	{
+		const LodReductionStats& stats = reductionStats[ilod];
+		Log("  lod %d: %u groups, %u -> %u clusters (%.2f), %u -> %u triangles (%.2f), max error %.4f, modes",
+			ilod, stats.groups, stats.clustersIn, stats.clustersOut, stats.clustersIn ? float(stats.clustersOut) / stats.clustersIn : 1.0f,
+			stats.trianglesIn, stats.trianglesOut, stats.trianglesIn ? float(stats.trianglesOut) / stats.trianglesIn : 1.0f, stats.maxError);
+		for (int m = 0; m < (int)LodSimplifyMode::Count; ++m)
+			Log(" %s:%u", GetLodSimplifyModeName((LodSimplifyMode)m), stats.modeGroups[m]);
+		Log(", stalled %u groups, ended %u chains\n", stats.stalledGroups, stats.endedChains);
+	}
+
+	Log("LOD DAG: %zu groups\n", groupCount);
+	for (int level = 0; level < levels.size(); ++level)
+	{
+		Log("  level %d: %u clusters, %u triangles, fill %.1f%% triangles %.1f%% vertices\n", level, levels[level].clusters, levels[level].triangles,
+			100.0f * levels[level].triangleFill, 100.0f * levels[level].vertexFill);
+	}
+
+	Log("Cooked %s: %zu meshes, %zu clusters, %zu triangles in %.2f s, peak memory %.1f MB\n",
+		filename, out_meshes.size(), clusterCount, triangleCount,
+		(GetTimeMs() - startTime) / 1000.0, GetPeakMemoryUsage() / (1024.0 * 1024.0));
+
+	// Peaks are of all threads together, what the cook needs on top of its outputs
+	Log("Arena: %.1f MB reserved at peak\n", GetArenaPeakReservedBytes() / (1024.0 * 1024.0));
+	for (int stage = (int)ArenaStage::Prepare; stage < (int)ArenaStage::Count; ++stage)
+	{
+		ArenaStageStats stats = GetArenaStageStats((ArenaStage)stage);
+		Log("  %-8s %10llu allocations, %10.1f MB total, %8.1f MB peak\n", GetArenaStageName((ArenaStage)stage),
+			(unsigned long long)stats.allocations, stats.totalBytes / (1024.0 * 1024.0), stats.peakBytes / (1024.0 * 1024.0));
+		report.arenaStages.push_back({ (ArenaStage)stage, stats });
+	}
+
+	if (generatorOptions.reportFile)
+	{
+		report.source = filename;
+		report.options = {
+			{ "lod", std::to_string(generatorOptions.outputLod) },
+			{ "threads", std::to_string(threadCount) },
+			{ "grouping", GetClusterGroupingName(generatorOptions.grouping) },
+			{ "quantize", generatorOptions.quantizeVertices ? "true" : "false" },
+			{ "compress", generatorOptions.compressStreams ? "true" : "false" },
+			{ "meshlets", std::to_string(generatorOptions.meshletConfig.maxVertices) + "x" + std::to_string(generatorOptions.meshletConfig.maxTriangles) },
+			{ "spatial", spatialOrder ? "true" : "false" },
+			{ "packclusters", packClusters ? "true" : "false" },
+			{ "pages", writePages ? "true" : "false" },
+			{ "sharedVertices", sharedVertices ? "true" : "false" },
+			{ "cache", generatorOptions.cacheDirectory ? generatorOptions.cacheDirectory : "" },
+			{ "budgetMB", std::to_string(generatorOptions.memoryBudgetMB) },
+			{ "chunkTriangles", std::to_string(chunkTriangles) },
+		};
+		report.arenaPeakReservedBytes = GetArenaPeakReservedBytes();
+		report.totalMs = GetTimeMs() - startTime;
+		report.fileBytes = sceneFileSize;
+		report.peakMemoryBytes = GetPeakMemoryUsage();
+		if (WriteCookReport(generatorOptions.reportFile, report))
+			Log("Wrote %s\n", generatorOptions.reportFile);
+		else
+			Log("Could not write %s\n", generatorOptions.reportFile);
+	}
+
+	if (generatorResult)
+	{
+		*generatorResult = GeneratorResult();
+		for (const CookReportMesh& reportMesh : report.meshes)
+			generatorResult->sourceTriangles += reportMesh.stats.triangles;
+		generatorResult->triangles = triangleCount;
+		generatorResult->clusters = clusterCount;
+		generatorResult->fileBytes = sceneFileSize;
+		generatorResult->totalMs = GetTimeMs() - startTime;
+	}
+	return true;
 }
@@ -1,3 +1,36 @@
 #pragma once
 
-void Generate(const char* filename, int outputLod);
+#include "ClusterGraph.h"
+#include "CookCache.h"
+#include "CookReport.h"
+#include "MeshletConfig.h"
+
+struct GeneratorOptions
+{
+	int outputLod = 0;
+	int numThreads = 0; // 0 = use all hardware threads, 1 = cook serially
+	ClusterGrouping grouping = ClusterGrouping::Greedy; // Partition is much faster on large meshes, opt-in until its groups match Greedy
+	MeshletConfig meshletConfig = g_defaultMeshletConfig; // Cluster limits, see MeshletConfig.h
+	bool quantizeVertices = false; // Write compact vertex streams, see VertexQuantization.h
+	bool compressStreams = false; // Write vertex and index streams with the meshoptimizer codecs, see SceneCodec.h
+	bool spatialOrder = false; // Reorder instances and clusters along a Morton curve, see SpatialOrder.h
+	bool writePages = false; // Write the geometry as streaming pages instead of whole scene streams, see ClusterStreaming.h
+	bool sharedVertices = false; // Write one vertex pool per mesh that clusters index into, see SharedVertices.h
+	bool packClusters = false; // Merge underfilled clusters the LOD cut always picks together, see ClusterPacking.h
+	size_t memoryBudgetMB = 0; // Cook out of core within about this much memory, 0 = keep everything in memory, see OutOfCore.h
+	const char* reportFile = nullptr; // Per stage times and cluster quality as JSON, written by -report <file>, see CookReport.h
+	const char* cacheDirectory = nullptr; // Cooked primitives are reused from here, nullptr = always cook everything, -cache uses COOK_CACHE_DIRECTORY, see CookCache.h
+};
+
+// What a cook wrote, for callers that cook many files, see Cooker.cpp
+struct GeneratorResult
+{
+	size_t sourceTriangles = 0; // Of the glTF primitives
+	size_t triangles = 0; // Of all levels
+	size_t clusters = 0;
+	size_t fileBytes = 0;
+	double totalMs = 0.0;
+};
+
+// Cooks a glTF into SCENE_FILE_NAME in the working directory, false when the glTF can't be read or the scene can't be written
+bool Generate(const char* filename, const GeneratorOptions& options, GeneratorResult* result = nullptr);
@@ -0,0 +1,521 @@
+#include "GltfDecode.h"
+#include "Log.h"
+
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DECODE_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define DECODE_TARGET_AVX2
+#else
+#define DECODE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define DECODE_SIMD 0
+#endif
+
+/*
+ * Mapped input files
+ */
+
+static cgltf_result MappedFileRead(const cgltf_memory_options* /* memoryOptions */, const cgltf_file_options* fileOptions, const char* path, cgltf_size* size, void** data)
+{
+	GltfMappedFiles* files = (GltfMappedFiles*)fileOptions->user_data;
+	std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+	if (!file->Open(path))
+		return cgltf_result_file_not_found;
+
+	// Buffers are asked for with their declared size, the file may be longer
+	if (size && *size > file->size)
+		return cgltf_result_data_too_short;
+	if (size && *size == 0)
+		*size = file->size;
+
+	// cgltf never writes to file data, the const goes away only for its interface
+	*data = (void*)file->data;
+	files->files.push_back(std::move(file));
+	return cgltf_result_success;
+}
+
+static void MappedFileRelease(const cgltf_memory_options* /* memoryOptions */, const cgltf_file_options* fileOptions, void* data)
+{
+	GltfMappedFiles* files = (GltfMappedFiles*)fileOptions->user_data;
+	for (size_t f = 0; f < files->files.size(); ++f)
+	{
+		if (files->files[f]->data == data)
+		{
+			files->files.erase(files->files.begin() + f);
+			return;
+		}
+	}
+}
+
+void SetGltfMappedFileCallbacks(cgltf_options& options, GltfMappedFiles& files)
+{
+	options.file.read = MappedFileRead;
+	options.file.release = MappedFileRelease;
+	options.file.user_data = &files;
+}
+
+/*
+ * Kernel selection
+ */
+
+const char* GetDecodeKernelName(DecodeKernel kernel)
+{
+	switch (kernel)
+	{
+	case DecodeKernel::Scalar: return "scalar";
+	case DecodeKernel::Sse2: return "sse2";
+	case DecodeKernel::Avx2: return "avx2";
+	default: return "best";
+	}
+}
+
+DecodeKernel GetDecodeKernel(DecodeKernel kernel)
+{
+	static const bool hasAvx2 = HasAvx2();
+	if (kernel == DecodeKernel::Best || (kernel == DecodeKernel::Avx2 && !hasAvx2))
+		kernel = hasAvx2 ? DecodeKernel::Avx2 : DecodeKernel::Sse2;
+	if (kernel == DecodeKernel::Sse2 && !DECODE_SIMD)
+		kernel = DecodeKernel::Scalar;
+	return kernel;
+}
+
+/*
+ * Attribute decoding
+ */
+
+// Normalized integers are scaled by the reciprocal in every kernel, so they all give the same result
+template<class T>
+static float NormalizeScale()
+{
+	return 1.0f / float(std::numeric_limits<T>::max());
+}
+
+static float ReadComponent(const uint8_t* src, cgltf_component_type type, bool normalized)
+{
+	switch (type)
+	{
+	case cgltf_component_type_r_8:
+	{
+		int8_t v;
+		memcpy(&v, src, sizeof(v));
+		return normalized ? std::max(float(v) * NormalizeScale<int8_t>(), -1.0f) : float(v);
+	}
+	case cgltf_component_type_r_8u:
+	{
+		uint8_t v;
+		memcpy(&v, src, sizeof(v));
+		return normalized ? float(v) * NormalizeScale<uint8_t>() : float(v);
+	}
+	case cgltf_component_type_r_16:
+	{
+		int16_t v;
+		memcpy(&v, src, sizeof(v));
+		return normalized ? std::max(float(v) * NormalizeScale<int16_t>(), -1.0f) : float(v);
+	}
+	case cgltf_component_type_r_16u:
+	{
+		uint16_t v;
+		memcpy(&v, src, sizeof(v));
+		return normalized ? float(v) * NormalizeScale<uint16_t>() : float(v);
+	}
+	case cgltf_component_type_r_32u:
+	{
+		uint32_t v;
+		memcpy(&v, src, sizeof(v));
+		return float(v);
+	}
+	case cgltf_component_type_r_32f:
+	{
+		float v;
+		memcpy(&v, src, sizeof(v));
+		return v;
+	}
+	default:
+		assert(false);
+		return 0.0f;
+	}
+}
+
+static void DecodeFloatsScalar(const cgltf_accessor* accessor, const uint8_t* src, size_t start, size_t end, size_t components, float* out, size_t outStride)
+{
+	size_t accessorComponents = cgltf_num_components(accessor->type);
+	size_t componentSize = cgltf_component_size(accessor->component_type);
+	for (size_t i = start; i < end; ++i)
+	{
+		const uint8_t* element = src + i * accessor->stride;
+		float* dst = (float*)((uint8_t*)out + i * outStride);
+		for (size_t c = 0; c < components; ++c)
+			dst[c] = c < accessorComponents ? ReadComponent(element + c * componentSize, accessor->component_type, accessor->normalized) : 0.0f;
+	}
+}
+
+#if DECODE_SIMD
+// Bytes a kernel reads for one element, elements closer than this to the end of the buffer view are done by the scalar code
+template<cgltf_component_type Type>
+static constexpr size_t LoadSize()
+{
+	return Type == cgltf_component_type_r_32f ? 16 : Type == cgltf_component_type_r_8 || Type == cgltf_component_type_r_8u ? 4 : 8;
+}
+
+static inline void StoreComponents(float* out, __m128 v, size_t components)
+{
+	switch (components)
+	{
+	case 4:
+		_mm_storeu_ps(out, v);
+		break;
+	case 3:
+		_mm_storel_pi((__m64*)out, v);
+		_mm_store_ss(out + 2, _mm_movehl_ps(v, v));
+		break;
+	case 2:
+		_mm_storel_pi((__m64*)out, v);
+		break;
+	default:
+		_mm_store_ss(out, v);
+		break;
+	}
+}
+
+// First four components of an element widened to 32 bit, lanes past the components of the accessor are garbage
+template<cgltf_component_type Type>
+static inline __m128i LoadIntegersSse2(const uint8_t* src)
+{
+	__m128i zero = _mm_setzero_si128();
+	if constexpr (Type == cgltf_component_type_r_8 || Type == cgltf_component_type_r_8u)
+	{
+		int bits;
+		memcpy(&bits, src, sizeof(bits));
+		__m128i x = _mm_cvtsi32_si128(bits);
+		if constexpr (Type == cgltf_component_type_r_8u)
+			return _mm_unpacklo_epi16(_mm_unpacklo_epi8(x, zero), zero);
+		else
+			return _mm_srai_epi32(_mm_unpacklo_epi16(zero, _mm_unpacklo_epi8(zero, x)), 24); // Into the top byte and back, for the sign
+	}
+	else
+	{
+		__m128i x = _mm_loadl_epi64((const __m128i*)src);
+		if constexpr (Type == cgltf_component_type_r_16u)
+			return _mm_unpacklo_epi16(x, zero);
+		else
+			return _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 16);
+	}
+}
+
+template<cgltf_component_type Type, bool Normalized>
+static void DecodeFloatsSse2(const uint8_t* src, size_t stride, size_t count, __m128 mask, size_t components, float* out, size_t outStride)
+{
+	constexpr bool isSigned = Type == cgltf_component_type_r_8 || Type == cgltf_component_type_r_16;
+	const __m128 scale = _mm_set1_ps(Type == cgltf_component_type_r_8 ? NormalizeScale<int8_t>() : Type == cgltf_component_type_r_8u ? NormalizeScale<uint8_t>() :
+		Type == cgltf_component_type_r_16 ? NormalizeScale<int16_t>() : NormalizeScale<uint16_t>());
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		__m128 v;
+		if constexpr (Type == cgltf_component_type_r_32f)
+		{
+			v = _mm_loadu_ps((const float*)(src + i * stride));
+		}
+		else
+		{
+			v = _mm_cvtepi32_ps(LoadIntegersSse2<Type>(src + i * stride));
+			if constexpr (Normalized)
+				v = _mm_mul_ps(v, scale);
+			if constexpr (Normalized && isSigned)
+				v = _mm_max_ps(v, minusOne);
+		}
+		StoreComponents((float*)((uint8_t*)out + i * outStride), _mm_and_ps(v, mask), components);
+	}
+}
+
+// Two elements at a time, one per 128 bit half
+template<cgltf_component_type Type, bool Normalized>
+DECODE_TARGET_AVX2 static void DecodeFloatsAvx2(const uint8_t* src, size_t stride, size_t count, __m128 mask, size_t components, float* out, size_t outStride)
+{
+	constexpr bool isSigned = Type == cgltf_component_type_r_8 || Type == cgltf_component_type_r_16;
+	const __m256 scale = _mm256_set1_ps(Type == cgltf_component_type_r_8 ? NormalizeScale<int8_t>() : Type == cgltf_component_type_r_8u ? NormalizeScale<uint8_t>() :
+		Type == cgltf_component_type_r_16 ? NormalizeScale<int16_t>() : NormalizeScale<uint16_t>());
+	const __m256 minusOne = _mm256_set1_ps(-1.0f);
+	const __m256 mask2 = _mm256_insertf128_ps(_mm256_castps128_ps256(mask), mask, 1);
+
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2)
+	{
+		const uint8_t* a = src + i * stride;
+		const uint8_t* b = a + stride;
+
+		__m256 v;
+		if constexpr (Type == cgltf_component_type_r_32f)
+		{
+			v = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps((const float*)a)), _mm_loadu_ps((const float*)b), 1);
+		}
+		else
+		{
+			__m256i x;
+			if constexpr (Type == cgltf_component_type_r_8 || Type == cgltf_component_type_r_8u)
+			{
+				int bitsA, bitsB;
+				memcpy(&bitsA, a, sizeof(bitsA));
+				memcpy(&bitsB, b, sizeof(bitsB));
+				__m128i bytes = _mm_unpacklo_epi32(_mm_cvtsi32_si128(bitsA), _mm_cvtsi32_si128(bitsB));
+				x = Type == cgltf_component_type_r_8u ? _mm256_cvtepu8_epi32(bytes) : _mm256_cvtepi8_epi32(bytes);
+			}
+			else
+			{
+				__m128i shorts = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)a), _mm_loadl_epi64((const __m128i*)b));
+				x = Type == cgltf_component_type_r_16u ? _mm256_cvtepu16_epi32(shorts) : _mm256_cvtepi16_epi32(shorts);
+			}
+
+			v = _mm256_cvtepi32_ps(x);
+			if constexpr (Normalized)
+				v = _mm256_mul_ps(v, scale);
+			if constexpr (Normalized && isSigned)
+				v = _mm256_max_ps(v, minusOne);
+		}
+
+		v = _mm256_and_ps(v, mask2);
+		StoreComponents((float*)((uint8_t*)out + i * outStride), _mm256_castps256_ps128(v), components);
+		StoreComponents((float*)((uint8_t*)out + (i + 1) * outStride), _mm256_extractf128_ps(v, 1), components);
+	}
+	_mm256_zeroupper();
+
+	if (i < count)
+		DecodeFloatsSse2<Type, Normalized>(src + i * stride, stride, count - i, mask, components, (float*)((uint8_t*)out + i * outStride), outStride);
+}
+
+template<cgltf_component_type Type, bool Normalized>
+static size_t DecodeFloatsSimd(const cgltf_accessor* accessor, const uint8_t* src, size_t available, size_t start, size_t end, size_t components, float* out, size_t outStride, DecodeKernel kernel)
+{
+	// Vector loads read past the element, so the last few elements of the view are left to the scalar code
+	size_t safeEnd = available < LoadSize<Type>() ? 0 : std::min(end, (available - LoadSize<Type>()) / accessor->stride + 1);
+	if (safeEnd <= start)
+		return start;
+
+	size_t accessorComponents = cgltf_num_components(accessor->type);
+	__m128 mask = _mm_castsi128_ps(_mm_set_epi32(accessorComponents > 3 ? -1 : 0, accessorComponents > 2 ? -1 : 0, accessorComponents > 1 ? -1 : 0, -1));
+
+	src += start * accessor->stride;
+	out = (float*)((uint8_t*)out + start * outStride);
+	if (kernel == DecodeKernel::Avx2)
+		DecodeFloatsAvx2<Type, Normalized>(src, accessor->stride, safeEnd - start, mask, components, out, outStride);
+	else
+		DecodeFloatsSse2<Type, Normalized>(src, accessor->stride, safeEnd - start, mask, components, out, outStride);
+	return safeEnd;
+}
+#endif
+
+// Elements [start, end) of an accessor that is not sparse and has its data, out is where element 0 goes
+static void DecodeFloatsRange(const cgltf_accessor* accessor, size_t start, size_t end, size_t components, float* out, size_t outStride, DecodeKernel kernel)
+{
+	assert(accessor->stride > 0 && accessor->offset <= accessor->buffer_view->size);
+	const uint8_t* src = cgltf_buffer_view_data(accessor->buffer_view) + accessor->offset;
+	size_t available = accessor->buffer_view->size - accessor->offset;
+
+	size_t done = start;
+#if DECODE_SIMD
+	if (kernel != DecodeKernel::Scalar)
+	{
+		switch (accessor->component_type)
+		{
+		case cgltf_component_type_r_8:
+			done = accessor->normalized ? DecodeFloatsSimd<cgltf_component_type_r_8, true>(accessor, src, available, start, end, components, out, outStride, kernel) :
+				DecodeFloatsSimd<cgltf_component_type_r_8, false>(accessor, src, available, start, end, components, out, outStride, kernel);
+			break;
+		case cgltf_component_type_r_8u:
+			done = accessor->normalized ? DecodeFloatsSimd<cgltf_component_type_r_8u, true>(accessor, src, available, start, end, components, out, outStride, kernel) :
+				DecodeFloatsSimd<cgltf_component_type_r_8u, false>(accessor, src, available, start, end, components, out, outStride, kernel);
+			break;
+		case cgltf_component_type_r_16:
+			done = accessor->normalized ? DecodeFloatsSimd<cgltf_component_type_r_16, true>(accessor, src, available, start, end, components, out, outStride, kernel) :
+				DecodeFloatsSimd<cgltf_component_type_r_16, false>(accessor, src, available, start, end, components, out, outStride, kernel);
+			break;
+		case cgltf_component_type_r_16u:
+			done = accessor->normalized ? DecodeFloatsSimd<cgltf_component_type_r_16u, true>(accessor, src, available, start, end, components, out, outStride, kernel) :
+				DecodeFloatsSimd<cgltf_component_type_r_16u, false>(accessor, src, available, start, end, components, out, outStride, kernel);
+			break;
+		case cgltf_component_type_r_32f:
+			done = DecodeFloatsSimd<cgltf_component_type_r_32f, false>(accessor, src, available, start, end, components, out, outStride, kernel);
+			break;
+		default:
+			break;
+		}
+	}
+#endif
+
+	DecodeFloatsScalar(accessor, src, done, end, components, out, outStride);
+}
+
+// Sparse accessors, accessors without a buffer view and buffers cgltf did not load go through cgltf
+static bool NeedsUnpack(const cgltf_accessor* accessor)
+{
+	return accessor->is_sparse || !accessor->buffer_view || !cgltf_buffer_view_data(accessor->buffer_view);
+}
+
+static void DecodeFloatsUnpacked(const cgltf_accessor* accessor, size_t components, float* out, size_t outStride)
+{
+	size_t accessorComponents = cgltf_num_components(accessor->type);
+	std::vector<float> unpacked(accessor->count * accessorComponents);
+	cgltf_accessor_unpack_floats(accessor, unpacked.data(), unpacked.size());
+	for (size_t i = 0; i < accessor->count; ++i)
+	{
+		float* dst = (float*)((uint8_t*)out + i * outStride);
+		for (size_t c = 0; c < components; ++c)
+			dst[c] = c < accessorComponents ? unpacked[i * accessorComponents + c] : 0.0f;
+	}
+}
+
+void DecodeAccessorFloats(const cgltf_accessor* accessor, size_t components, float* out, size_t outStride, DecodeKernel kernel)
+{
+	assert(components >= 1 && components <= 4 && cgltf_num_components(accessor->type) <= 4);
+	if (NeedsUnpack(accessor))
+		DecodeFloatsUnpacked(accessor, components, out, outStride);
+	else
+		DecodeFloatsRange(accessor, 0, accessor->count, components, out, outStride, GetDecodeKernel(kernel));
+}
+
+void DecodeAccessorsInterleaved(const AccessorDecodeTarget* targets, size_t targetCount, size_t count, void* out, size_t outStride, DecodeKernel kernel)
+{
+	kernel = GetDecodeKernel(kernel);
+	for (size_t t = 0; t < targetCount; ++t)
+	{
+		assert(targets[t].accessor->count == count);
+		assert(targets[t].components >= 1 && targets[t].components <= 4 && cgltf_num_components(targets[t].accessor->type) <= 4);
+		if (NeedsUnpack(targets[t].accessor))
+			DecodeFloatsUnpacked(targets[t].accessor, targets[t].components, (float*)((uint8_t*)out + targets[t].outOffset), outStride);
+	}
+
+	for (size_t start = 0; start < count; start += DECODE_BLOCK_ELEMENTS)
+	{
+		size_t end = std::min(count, start + DECODE_BLOCK_ELEMENTS);
+		for (size_t t = 0; t < targetCount; ++t)
+		{
+			if (!NeedsUnpack(targets[t].accessor))
+				DecodeFloatsRange(targets[t].accessor, start, end, targets[t].components, (float*)((uint8_t*)out + targets[t].outOffset), outStride, kernel);
+		}
+	}
+}
+
+/*
+ * Index widening
+ */
+
+#if DECODE_SIMD
+static size_t WidenIndicesSse2(const uint8_t* src, size_t count, size_t indexSize, uint32_t* out)
+{
+	__m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	if (indexSize == 2)
+	{
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*)(src + i * 2));
+			_mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi16(x, zero));
+			_mm_storeu_si128((__m128i*)(out + i + 4), _mm_unpackhi_epi16(x, zero));
+		}
+	}
+	else
+	{
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+			__m128i lo = _mm_unpacklo_epi8(x, zero);
+			__m128i hi = _mm_unpackhi_epi8(x, zero);
+			_mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*)(out + i + 4), _mm_unpackhi_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*)(out + i + 8), _mm_unpacklo_epi16(hi, zero));
+			_mm_storeu_si128((__m128i*)(out + i + 12), _mm_unpackhi_epi16(hi, zero));
+		}
+	}
+	return i;
+}
+
+DECODE_TARGET_AVX2 static size_t WidenIndicesAvx2(const uint8_t* src, size_t count, size_t indexSize, uint32_t* out)
+{
+	size_t i = 0;
+	if (indexSize == 2)
+	{
+		for (; i + 16 <= count; i += 16)
+		{
+			_mm256_storeu_si256((__m256i*)(out + i), _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i * 2))));
+			_mm256_storeu_si256((__m256i*)(out + i + 8), _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i * 2 + 16))));
+		}
+	}
+	else
+	{
+		for (; i + 16 <= count; i += 16)
+		{
+			_mm256_storeu_si256((__m256i*)(out + i), _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i))));
+			_mm256_storeu_si256((__m256i*)(out + i + 8), _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i + 8))));
+		}
+	}
+	_mm256_zeroupper();
+	return i;
+}
+#endif
+
+void DecodeAccessorIndices(const cgltf_accessor* accessor, uint32_t* out, DecodeKernel kernel)
+{
+	kernel = GetDecodeKernel(kernel);
+
+	const uint8_t* viewData = accessor->buffer_view ? cgltf_buffer_view_data(accessor->buffer_view) : nullptr;
+	size_t indexSize = cgltf_component_size(accessor->component_type);
+	if (accessor->is_sparse || !viewData || accessor->stride != indexSize)
+	{
+		for (size_t i = 0; i < accessor->count; ++i)
+			out[i] = (uint32_t)cgltf_accessor_read_index(accessor, i);
+		return;
+	}
+
+	const uint8_t* src = viewData + accessor->offset;
+	if (indexSize == 4)
+	{
+		memcpy(out, src, accessor->count * sizeof(uint32_t));
+		return;
+	}
+
+	size_t i = 0;
+#if DECODE_SIMD
+	if (kernel == DecodeKernel::Avx2)
+		i = WidenIndicesAvx2(src, accessor->count, indexSize, out);
+	else if (kernel == DecodeKernel::Sse2)
+		i = WidenIndicesSse2(src, accessor->count, indexSize, out);
+#endif
+
+	for (; i < accessor->count; ++i)
+	{
+		if (indexSize == 2)
+		{
+			uint16_t index;
+			memcpy(&index, src + i * 2, sizeof(index));
+			out[i] = index;
+		}
+		else
+		{
+			out[i] = src[i];
+		}
+	}
+}
+
+bool CanSplitAccessor(const cgltf_accessor* accessor)
+{
+	return !NeedsUnpack(accessor) && accessor->stride > 0;
+}
+
+cgltf_accessor GetAccessorRange(const cgltf_accessor* accessor, size_t first, size_t count)
+{
+	assert(CanSplitAccessor(accessor) && first + count <= accessor->count);
+	cgltf_accessor range = *accessor;
+	range.offset += first * accessor->stride;
+	range.count = count;
+	range.has_min = false;
+	range.has_max = false;
+	return range;
+}
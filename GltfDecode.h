@@ -0,0 +1,62 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cgltf.h"
+
+// Reading glTF input for the generator
+// Source files are memory mapped instead of read into the heap, a .glb is used in place and so are the .bin files of a .gltf.
+// Accessors are decoded with SIMD kernels that take any stride and the normalized and integer component types of
+// KHR_mesh_quantization, so the generator never has to care about how an exporter laid out its buffers.
+
+#define DECODE_BLOCK_ELEMENTS 1024 // Vertices per step of DecodeAccessorsInterleaved, the output of a step stays in L1/L2
+
+enum class DecodeKernel
+{
+	Scalar,
+	Sse2,
+	Avx2,
+	Best, // Fastest one the CPU has
+};
+
+const char* GetDecodeKernelName(DecodeKernel kernel);
+// Resolves Best, and falls back to a kernel the CPU has
+DecodeKernel GetDecodeKernel(DecodeKernel kernel);
+
+// Files mapped for cgltf, they stay mapped until cgltf_free releases them
+struct GltfMappedFiles
+{
+	std::vector<std::unique_ptr<MappedFile>> files;
+};
+
+// Makes cgltf_parse_file and cgltf_load_buffers map files instead of reading them, files has to outlive the cgltf_data
+void SetGltfMappedFileCallbacks(cgltf_options& options, GltfMappedFiles& files);
+
+// Decodes every element of accessor to components floats at out, outStride bytes apart
+// Normalized integers are mapped to [0, 1] or [-1, 1], other integers are converted as they are. Missing components are 0.
+void DecodeAccessorFloats(const cgltf_accessor* accessor, size_t components, float* out, size_t outStride, DecodeKernel kernel = DecodeKernel::Best);
+
+// One attribute of an interleaved vertex, outOffset is in bytes
+struct AccessorDecodeTarget
+{
+	const cgltf_accessor* accessor;
+	size_t components;
+	size_t outOffset;
+};
+
+// Decodes accessors of count elements each into one interleaved vertex of outStride bytes
+// Goes over the vertices DECODE_BLOCK_ELEMENTS at a time so every output cache line is only fetched once
+void DecodeAccessorsInterleaved(const AccessorDecodeTarget* targets, size_t targetCount, size_t count, void* out, size_t outStride, DecodeKernel kernel = DecodeKernel::Best);
+
+// Widens 8, 16 or 32 bit indices to 32 bits
+void DecodeAccessorIndices(const cgltf_accessor* accessor, uint32_t* out, DecodeKernel kernel = DecodeKernel::Best);
+
+// Elements [first, first + count) of an accessor as an accessor of their own, so a large accessor can be decoded a piece at a time
+// Sparse accessors and ones without their data can't be split, CanSplitAccessor tells
+bool CanSplitAccessor(const cgltf_accessor* accessor);
+cgltf_accessor GetAccessorRange(const cgltf_accessor* accessor, size_t first, size_t count);
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// Open addressing hash map with linear probing, keyed by packed 64 bit values (PackEdge, PackCluster)
+// Keys and values live in flat arrays so lookups don't chase pointers, and Clear() keeps the
+// memory around so a table can be reused for every meshlet without reallocating.
+// There is no erase, the LOD builder only ever adds to these.
+template<class V>
+struct FlatHashMap
+{
+	static constexpr uint64_t EmptyKey = ~0ull; // Not a valid packed pair, both halves would be -1
+
+	std::vector<uint64_t> keys;
+	std::vector<V> values;
+	size_t count = 0;
+
+	FlatHashMap() = default;
+	explicit FlatHashMap(size_t expectedCount) { Reserve(expectedCount); }
+
+	// Makes room for expectedCount entries without growing
+	void Reserve(size_t expectedCount)
+	{
+		size_t capacity = 16;
+		while (capacity * 3 < expectedCount * 4) // Keep load factor below 3/4
+			capacity *= 2;
+
+		if (capacity > keys.size())
+			Rehash(capacity);
+	}
+
+	// Removes all entries but keeps the allocation
+	void Clear()
+	{
+		if (count == 0)
+			return;
+
+		std::fill(keys.begin(), keys.end(), EmptyKey);
+		count = 0;
+	}
+
+	size_t Size() const { return count; }
+	size_t Capacity() const { return keys.size(); }
+
+	V* Find(uint64_t key)
+	{
+		if (count == 0)
+			return nullptr;
+
+		size_t mask = keys.size() - 1;
+		for (size_t i = Hash(key) & mask;; i = (i + 1) & mask)
+		{
+			if (keys[i] == key)
+				return &values[i];
+			if (keys[i] == EmptyKey)
+				return nullptr;
+		}
+	}
+
+	const V* Find(uint64_t key) const
+	{
+		return const_cast<FlatHashMap*>(this)->Find(key);
+	}
+
+	// Returns the value for key, inserting a default constructed one if it is missing
+	V& operator[](uint64_t key)
+	{
+		if ((count + 1) * 4 > keys.size() * 3)
+			Rehash(std::max<size_t>(16, keys.size() * 2));
+
+		size_t mask = keys.size() - 1;
+		size_t i = Hash(key) & mask;
+		while (keys[i] != key)
+		{
+			if (keys[i] == EmptyKey)
+			{
+				keys[i] = key;
+				values[i] = V();
+				count += 1;
+				break;
+			}
+			i = (i + 1) & mask;
+		}
+		return values[i];
+	}
+
+	// Calls func(key, value) for every entry, in slot order
+	template<class F>
+	void ForEach(F&& func) const
+	{
+		for (size_t i = 0; i < keys.size(); ++i)
+		{
+			if (keys[i] != EmptyKey)
+				func(keys[i], values[i]);
+		}
+	}
+
+	size_t MemoryUsage() const { return keys.capacity() * sizeof(uint64_t) + values.capacity() * sizeof(V); }
+
+	static size_t Hash(uint64_t key)
+	{
+		// Packed pairs are two small integers, mix them so neighbouring pairs don't cluster
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdull;
+		key ^= key >> 33;
+		return (size_t)key;
+	}
+
+	void Rehash(size_t capacity)
+	{
+		std::vector<uint64_t> oldKeys(capacity, EmptyKey);
+		std::vector<V> oldValues(capacity);
+		oldKeys.swap(keys);
+		oldValues.swap(values);
+
+		size_t mask = capacity - 1;
+		for (size_t o = 0; o < oldKeys.size(); ++o)
+		{
+			if (oldKeys[o] == EmptyKey)
+				continue;
+
+			size_t i = Hash(oldKeys[o]) & mask;
+			while (keys[i] != EmptyKey)
+				i = (i + 1) & mask;
+
+			keys[i] = oldKeys[o];
+			values[i] = oldValues[o];
+		}
+	}
+};
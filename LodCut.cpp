@@ -0,0 +1,83 @@
+#include "LodCut.h"
+#include "Parallel.h"
+#include "Log.h"
+
+#include <cfloat>
+#include <algorithm>
+
+#define LOD_CUT_INSTANCES_PER_TASK 16
+
+LodCutParams MakeLodCutParams(const float4x4& viewMat, const float4x4& projMat, float viewportHeight, float errorThreshold)
+{
+	float4x4 invView;
+	invert(viewMat, &invView);
+
+	LodCutParams params;
+	params.cameraPosition = float3(invView.m41, invView.m42, invView.m43);
+	params.projectionScale = projMat.m22 * viewportHeight * 0.5f; // m22 is 1 / tan(fov / 2)
+	params.errorThreshold = errorThreshold;
+	return params;
+}
+
+static float ProjectError(const float4& sphere, float error, const float4x4& modelMat, float modelScale, const LodCutParams& params)
+{
+	if (error == 0.0f || error == FLT_MAX)
+		return error;
+
+	float3 center = transform(float3(sphere.x, sphere.y, sphere.z), modelMat);
+	float distance = length(center - params.cameraPosition) - sphere.w * modelScale;
+
+	// Inside the bounds, nothing but the full detail will do
+	if (distance <= 0.0f)
+		return FLT_MAX;
+
+	return error * modelScale * params.projectionScale / distance;
+}
+
+void SelectLodCut(const LodCutScene& scene, const LodCutParams& params, LodCut& cut)
+{
+	double startTime = GetTimeMs();
+
+	size_t numTasks = (scene.numInstances + LOD_CUT_INSTANCES_PER_TASK - 1) / LOD_CUT_INSTANCES_PER_TASK;
+	std::vector<LodCut> taskCuts(numTasks);
+	ParallelFor(numTasks, [&](size_t task)
+	{
+		LodCut& taskCut = taskCuts[task];
+		UINT instanceEnd = std::min<UINT>(UINT(task + 1) * LOD_CUT_INSTANCES_PER_TASK, scene.numInstances);
+		for (UINT ii = UINT(task) * LOD_CUT_INSTANCES_PER_TASK; ii < instanceEnd; ++ii)
+		{
+			const Instance& instance = scene.instances[ii];
+			const Mesh& mesh = scene.meshes[instance.MeshIndex];
+
+			// Errors are in object space, scale them by the largest axis scale
+			const float4x4& m = instance.ModelMatrix;
+			float modelScale = sqrtf(std::max({
+				m.m11 * m.m11 + m.m12 * m.m12 + m.m13 * m.m13,
+				m.m21 * m.m21 + m.m22 * m.m22 + m.m23 * m.m23,
+				m.m31 * m.m31 + m.m32 * m.m32 + m.m33 * m.m33 }));
+
+			for (UINT ic = mesh.ClusterStart; ic < mesh.ClusterStart + mesh.LodClusterCount; ++ic)
+			{
+				const ClusterLod& clusterLod = scene.clusterLods[ic];
+
+				if (ProjectError(clusterLod.Sphere, clusterLod.Error, m, modelScale, params) > params.errorThreshold)
+					continue;
+				if (ProjectError(clusterLod.ParentSphere, clusterLod.ParentError, m, modelScale, params) <= params.errorThreshold)
+					continue;
+
+				taskCut.selectedClusters.push_back({ ii, ic });
+				taskCut.triangleCount += scene.clusters[ic].PrimitiveCount;
+			}
+		}
+	});
+
+	cut.selectedClusters.clear();
+	cut.triangleCount = 0;
+	for (const LodCut& taskCut : taskCuts)
+	{
+		cut.selectedClusters.insert(cut.selectedClusters.end(), taskCut.selectedClusters.begin(), taskCut.selectedClusters.end());
+		cut.triangleCount += taskCut.triangleCount;
+	}
+
+	cut.timeMs = GetTimeMs() - startTime;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Render.h"
+
+#include <vector>
+
+// CPU selection of a cut through the cluster LOD DAG written by the generator
+// Every cluster is tested on its own, a cluster is kept when the error of the group that produced it
+// projects to at most errorThreshold pixels and the error of the group it was merged in does not.
+
+struct LodCutParams
+{
+	float3 cameraPosition;
+	float projectionScale = 1.0f; // Pixels per unit of error at distance 1
+	float errorThreshold = 1.0f; // In pixels
+};
+
+LodCutParams MakeLodCutParams(const float4x4& viewMat, const float4x4& projMat, float viewportHeight, float errorThreshold);
+
+struct LodCutScene
+{
+	const Instance* instances = nullptr;
+	UINT numInstances = 0;
+	const Mesh* meshes = nullptr;
+	const Cluster* clusters = nullptr;
+	const ClusterLod* clusterLods = nullptr;
+};
+
+struct LodCut
+{
+	std::vector<std::pair<UINT, UINT>> selectedClusters; // <instance, cluster>
+	UINT triangleCount = 0;
+	double timeMs = 0.0;
+};
+
+// Runs over the instances in parallel, the selected clusters come out in instance order
+void SelectLodCut(const LodCutScene& scene, const LodCutParams& params, LodCut& cut);
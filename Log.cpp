@@ -0,0 +1,94 @@
+#include "Log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <chrono>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#include <intrin.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+void Log(const char* format, ...)
+{
+	char buffer[1024];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	fputs(buffer, stdout);
+	fflush(stdout);
+
+#if defined(_WIN32)
+	OutputDebugStringA(buffer);
+#endif
+}
+
+double GetTimeMs()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+size_t GetPeakMemoryUsage()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return (size_t)usage.ru_maxrss * 1024; // Reported in kilobytes
+#endif
+}
+
+size_t GetMemoryUsage()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+#else
+	// Second field of statm is the resident set in pages
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (!file)
+		return 0;
+
+	unsigned long long size = 0, resident = 0;
+	int count = fscanf(file, "%llu %llu", &size, &resident);
+	fclose(file);
+	return count == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+bool HasAvx2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// The OS has to save the upper halves of the registers too
+	__cpuid(info, 1);
+	bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return avx && (info[1] & (1 << 5)) != 0;
+#elif defined(__x86_64__) || defined(__i386__)
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+
+// Prints to stdout and, on Windows, to the debugger output
+void Log(const char* format, ...);
+
+// Helpers for timing and memory reports
+double GetTimeMs();
+size_t GetPeakMemoryUsage(); // Peak resident memory of the process in bytes
+size_t GetMemoryUsage(); // Current resident memory of the process in bytes, includes mapped file pages that were touched
+
+// CPU and OS support for AVX2, false off x86 and x64
+bool HasAvx2();
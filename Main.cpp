@@ -1,5 +1,6 @@
 #include "Render.h"
 #include "Generator.h"
+#include "Benchmark.h"
 
 #include "shellapi.h"
 #include "stdlib.h"
@@ -47,9 +48,12 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
     const UINT height = 720;
 
     char* generatorFileName = nullptr;
-    int generatorLod = 0;
+    char* benchmarkName = nullptr;
+    GeneratorOptions generatorOptions;
+    std::string reportFileName; // Of -report, generatorOptions points at it
     bool useWarp = false;
     bool useWorkGraph = false;
+    bool usePageStreaming = false;
 
     int numArgs = 0;
     LPWSTR* args = CommandLineToArgvW(lpCmdLine, &numArgs);
@@ -77,7 +81,109 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
                 if (ia >= numArgs)
                     return -1;
 
-                generatorLod = _wtoi(args[ia]);
+                generatorOptions.outputLod = _wtoi(args[ia]);
+            }
+            else if (wcscmp(args[ia], L"-threads") == 0)
+            {
+                ia += 1;
+
+                if (ia >= numArgs)
+                    return -1;
+
+                generatorOptions.numThreads = _wtoi(args[ia]);
+            }
+            else if (wcscmp(args[ia], L"-quantize") == 0)
+            {
+                generatorOptions.quantizeVertices = true;
+            }
+            else if (wcscmp(args[ia], L"-compress") == 0)
+            {
+                generatorOptions.compressStreams = true;
+            }
+            else if (wcscmp(args[ia], L"-pages") == 0)
+            {
+                generatorOptions.writePages = true;
+            }
+            else if (wcscmp(args[ia], L"-spatial") == 0)
+            {
+                generatorOptions.spatialOrder = true;
+            }
+            else if (wcscmp(args[ia], L"-sharedvertices") == 0)
+            {
+                generatorOptions.sharedVertices = true;
+            }
+            else if (wcscmp(args[ia], L"-packclusters") == 0)
+            {
+                generatorOptions.packClusters = true;
+            }
+            else if (wcscmp(args[ia], L"-budget") == 0)
+            {
+                ia += 1;
+
+                if (ia >= numArgs)
+                    return -1;
+
+                generatorOptions.memoryBudgetMB = (size_t)_wtoi64(args[ia]);
+            }
+            else if (wcscmp(args[ia], L"-cache") == 0)
+            {
+                generatorOptions.cacheDirectory = COOK_CACHE_DIRECTORY;
+            }
+            else if (wcscmp(args[ia], L"-report") == 0)
+            {
+                ia += 1;
+
+                if (ia >= numArgs)
+                    return -1;
+
+                reportFileName.resize(wcstombs(nullptr, args[ia], 0));
+                wcstombs(reportFileName.data(), args[ia], reportFileName.size() + 1);
+                generatorOptions.reportFile = reportFileName.c_str();
+            }
+            else if (wcscmp(args[ia], L"-stream") == 0)
+            {
+                usePageStreaming = true;
+            }
+            else if (wcscmp(args[ia], L"-grouping") == 0)
+            {
+                ia += 1;
+
+                if (ia >= numArgs)
+                    return -1;
+
+                if (wcscmp(args[ia], L"greedy") == 0)
+                    generatorOptions.grouping = ClusterGrouping::Greedy;
+                else if (wcscmp(args[ia], L"partition") == 0)
+                    generatorOptions.grouping = ClusterGrouping::Partition;
+                else
+                    return -1;
+            }
+            else if (wcscmp(args[ia], L"-meshlets") == 0)
+            {
+                ia += 1;
+
+                if (ia >= numArgs)
+                    return -1;
+
+                char presetName[32] = {};
+                wcstombs(presetName, args[ia], sizeof(presetName) - 1);
+                const MeshletPreset* preset = FindMeshletPreset(presetName);
+                if (!preset)
+                    return -1;
+
+                generatorOptions.meshletConfig = preset->config;
+            }
+            else if (wcscmp(args[ia], L"-benchmark") == 0)
+            {
+                ia += 1;
+
+                if (ia >= numArgs)
+                    return -1;
+
+                size_t numBytes = wcstombs(nullptr, args[ia], 0) + 1;
+                benchmarkName = new char[numBytes];
+
+                numBytes = wcstombs(benchmarkName, args[ia], numBytes);
             }
             else if (wcscmp(args[ia], L"-warp") == 0)
             {
@@ -93,6 +199,17 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
         LocalFree(args);
     }
 
+    if (benchmarkName)
+    {
+        // Print to the console we were started from, if any
+        if (AttachConsole(ATTACH_PARENT_PROCESS))
+            freopen("CONOUT$", "w", stdout);
+
+        bool found = RunBenchmark(benchmarkName, generatorFileName);
+        delete[] benchmarkName;
+        return found ? 0 : -1;
+    }
+
     WNDCLASSEX windowClass = { 0 };
     windowClass.cbSize = sizeof(WNDCLASSEX);
     windowClass.style = CS_HREDRAW | CS_VREDRAW;
@@ -106,7 +223,7 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
     AdjustWindowRect(&windowRect, WS_OVERLAPPEDWINDOW, FALSE);
 
     if (generatorFileName)
-        Generate(generatorFileName, generatorLod);
+        Generate(generatorFileName, generatorOptions);
     
     Render* render = CreateRender(width, height);
 
@@ -144,6 +261,7 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
 
     Initialize(render, hwnd, useWarp);
     SetWorkGraph(render, useWorkGraph);
+    SetPageStreaming(render, usePageStreaming);
    
     ShowWindow(hwnd, nCmdShow);
 
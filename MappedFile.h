@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Read only memory mapping of a whole file, Win32 file mapping or POSIX mmap
+// Pages are only read in when they are touched, and they are backed by the file so they can be dropped under memory pressure.
+struct MappedFile
+{
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+
+#if defined(_WIN32)
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	int fd = -1;
+#endif
+
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() { Close(); }
+
+	// Closes the current mapping, if any, and maps filename. Returns false if the file can't be opened or is empty
+	bool Open(const char* filename);
+	void Close();
+	bool IsOpen() const { return data != nullptr; }
+};
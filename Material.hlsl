@@ -182,7 +182,7 @@ void main(uint2 dtid : SV_DispatchThreadID)
             return;
         }
         
-        uint primitiveIndex = v & 0x000000FF;
+        uint primitiveIndex = v & VBUFFER_PRIMITIVE_MASK;
         colorBuffer[dtid] = DebugColor(primitiveIndex);
     }
     else if (constants.DebugMode == DEBUG_MODE_SHOW_CLUSTERS)
@@ -193,8 +193,8 @@ void main(uint2 dtid : SV_DispatchThreadID)
             return;
         }
         
-        uint primitiveIndex = v & 0x000000FF;
-        uint visibleClusterIndex = v >> 8;
+        uint primitiveIndex = v & VBUFFER_PRIMITIVE_MASK;
+        uint visibleClusterIndex = v >> VBUFFER_PRIMITIVE_BITS;
 
         uint c = visibleClusters.Load(visibleClusterIndex * 4);
         uint clusterIndex = c & 0x0000ffff;
@@ -213,8 +213,8 @@ void main(uint2 dtid : SV_DispatchThreadID)
             return;
         }
         
-        uint primitiveIndex = v & 0x000000FF;
-        uint visibleClusterIndex = v >> 8;
+        uint primitiveIndex = v & VBUFFER_PRIMITIVE_MASK;
+        uint visibleClusterIndex = v >> VBUFFER_PRIMITIVE_BITS;
 
         uint c = visibleClusters.Load(visibleClusterIndex * 4);
         uint clusterIndex = c & 0x0000ffff;
@@ -233,8 +233,8 @@ void main(uint2 dtid : SV_DispatchThreadID)
             return;
         }
         
-        uint primitiveIndex = v & 0x000000FF;
-        uint visibleClusterIndex = v >> 8;
+        uint primitiveIndex = v & VBUFFER_PRIMITIVE_MASK;
+        uint visibleClusterIndex = v >> VBUFFER_PRIMITIVE_BITS;
 
         uint c = visibleClusters.Load(visibleClusterIndex * 4);
         uint clusterIndex = c & 0x0000ffff;
@@ -268,8 +268,8 @@ void main(uint2 dtid : SV_DispatchThreadID)
             return;
         }
 
-        uint primitiveIndex = v & 0x000000FF;
-        uint visibleClusterIndex = v >> 8;
+        uint primitiveIndex = v & VBUFFER_PRIMITIVE_MASK;
+        uint visibleClusterIndex = v >> VBUFFER_PRIMITIVE_BITS;
 
         uint c = visibleClusters.Load(visibleClusterIndex * 4);
         uint clusterIndex = c & 0x0000ffff;
@@ -279,10 +279,10 @@ void main(uint2 dtid : SV_DispatchThreadID)
 
         Instance instance = GetInstance(instanceIndex);
         Cluster cluster = GetCluster(clusterIndex);
-        uint3 tri = GetTri(cluster.PrimitiveStart + primitiveIndex);
-        float3 v0 = GetPosition(cluster.VertexStart + tri.x);
-        float3 v1 = GetPosition(cluster.VertexStart + tri.y);
-        float3 v2 = GetPosition(cluster.VertexStart + tri.z);
+        uint3 tri = GetTri(GetClusterPrimitiveStart(cluster) + primitiveIndex);
+        float3 v0 = GetPosition(cluster, tri.x);
+        float3 v1 = GetPosition(cluster, tri.y);
+        float3 v2 = GetPosition(cluster, tri.z);
 
         float2 uv = dtid * float2(1.0f / 1280.0f, 1.0f / 720.0f);
         float3 vp = ReprojectDepth(d, uv);
@@ -294,9 +294,9 @@ void main(uint2 dtid : SV_DispatchThreadID)
 
         float3 b = Barycentric(vp, vv0, vv1, vv2);
 
-        float3 n0 = GetNormal(cluster.VertexStart + tri.x);
-        float3 n1 = GetNormal(cluster.VertexStart + tri.y);
-        float3 n2 = GetNormal(cluster.VertexStart + tri.z);
+        float3 n0 = GetNormal(cluster, tri.x);
+        float3 n1 = GetNormal(cluster, tri.y);
+        float3 n2 = GetNormal(cluster, tri.z);
 
         float3 wn = TransformNormalToWorld(n0 * b.x + n1 * b.y + n2 * b.z, instance.NormalMatrix);
 
@@ -0,0 +1,21 @@
+#include "MeshletConfig.h"
+
+#include <cstring>
+#include <cwchar>
+
+const MeshletPreset* FindMeshletPreset(const char* name)
+{
+	for (const MeshletPreset& preset : g_meshletPresets)
+	{
+		if (strcmp(preset.name, name) == 0)
+			return &preset;
+	}
+	return nullptr;
+}
+
+void GetMeshletShaderDefines(const MeshletConfig& config, MeshletShaderDefines& defines)
+{
+	swprintf(defines.maxVertices, 32, L"MESHLET_MAX_VERTICES=%u", config.maxVertices);
+	swprintf(defines.maxTriangles, 32, L"MESHLET_MAX_TRIANGLES=%u", config.maxTriangles);
+	swprintf(defines.groupSize, 32, L"MESHLET_GROUP_SIZE=%u", GetMeshletGroupSize(config));
+}
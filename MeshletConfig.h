@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Render.h"
+#include "PackedTriangles.h"
+
+#include <cstdint>
+
+// Meshlet configurations, -meshlets <preset>
+// The cluster limits size the mesh shader outputs and its thread group, so the generator and VBufferMS.hlsl have to
+// agree on them. The presets are checked against every other limit at compile time, the generator cooks with the one
+// picked and writes it to the MeshletConfig section, and the renderer compiles the shaders with its defines, see
+// GetMeshletShaderDefines. Scenes without the section were cooked with the default. -benchmark meshlets cooks a scene
+// with every preset and compares them.
+
+struct MeshletConfig
+{
+	uint32_t maxVertices;
+	uint32_t maxTriangles;
+};
+
+struct MeshletPreset
+{
+	const char* name;
+	MeshletConfig config;
+};
+
+// One vertex and one triangle per thread, rounded up to whole waves of 32
+constexpr uint32_t GetMeshletGroupSize(const MeshletConfig& config)
+{
+	uint32_t threads = config.maxVertices > config.maxTriangles ? config.maxVertices : config.maxTriangles;
+	return (threads + 31) & ~31u;
+}
+
+template<uint32_t MaxVertices, uint32_t MaxTriangles>
+constexpr MeshletPreset MakeMeshletPreset(const char* name)
+{
+	static_assert(MaxVertices <= PACKED_TRIANGLE_MAX_VERTICES, "Cluster local indices don't fit a packed triangle");
+	static_assert(MaxVertices <= 255 && MaxTriangles <= 512 && MaxTriangles % 4 == 0, "Out of the meshopt_buildMeshlets limits");
+	static_assert(MaxTriangles <= (1 << VBUFFER_PRIMITIVE_BITS), "The VBuffer can't tell the triangles of a cluster apart");
+	static_assert(MaxVertices <= 256 && MaxTriangles <= 256, "Mesh shaders output at most 256 vertices and 256 primitives");
+	static_assert(GetMeshletGroupSize({ MaxVertices, MaxTriangles }) <= 128, "Mesh shader thread groups have at most 128 threads");
+	return MeshletPreset{ name, { MaxVertices, MaxTriangles } };
+}
+
+inline constexpr MeshletPreset g_meshletPresets[] = {
+	MakeMeshletPreset<DEFAULT_MESHLET_MAX_VERTICES, DEFAULT_MESHLET_MAX_TRIANGLES>("64x124"), // The default, fills the 128 threads with triangles
+	MakeMeshletPreset<128, 128>("128x128"), // Fewer, larger clusters, half the culling tests
+	MakeMeshletPreset<64, 64>("64x64"), // 64 thread groups, fills a wave on hardware with 64 wide waves
+};
+
+inline constexpr MeshletConfig g_defaultMeshletConfig = g_meshletPresets[0].config;
+
+// nullptr if there is no preset with that name
+const MeshletPreset* FindMeshletPreset(const char* name);
+
+struct MeshletShaderDefines
+{
+	wchar_t maxVertices[32];
+	wchar_t maxTriangles[32];
+	wchar_t groupSize[32];
+};
+
+// -D arguments for the compiler, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES and MESHLET_GROUP_SIZE
+void GetMeshletShaderDefines(const MeshletConfig& config, MeshletShaderDefines& defines);
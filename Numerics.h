@@ -0,0 +1,260 @@
+#pragma once
+
+// Stand in for the parts of Windows::Foundation::Numerics and the DirectXMath types the CPU code uses,
+// so the cooker builds where WindowsNumerics.h is not available. Same names, layouts and row vector conventions.
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+namespace Numerics
+{
+	struct float2
+	{
+		float x, y;
+
+		float2() = default;
+		constexpr float2(float x, float y) : x(x), y(y) {}
+		constexpr explicit float2(float value) : x(value), y(value) {}
+	};
+
+	struct float3
+	{
+		float x, y, z;
+
+		float3() = default;
+		constexpr float3(float x, float y, float z) : x(x), y(y), z(z) {}
+		constexpr explicit float3(float value) : x(value), y(value), z(value) {}
+		constexpr float3(float2 xy, float z) : x(xy.x), y(xy.y), z(z) {}
+
+		float3& operator+=(const float3& other) { x += other.x; y += other.y; z += other.z; return *this; }
+		float3& operator-=(const float3& other) { x -= other.x; y -= other.y; z -= other.z; return *this; }
+		float3& operator*=(float scale) { x *= scale; y *= scale; z *= scale; return *this; }
+	};
+
+	struct float4
+	{
+		float x, y, z, w;
+
+		float4() = default;
+		constexpr float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+		constexpr explicit float4(float value) : x(value), y(value), z(value), w(value) {}
+		constexpr float4(float3 xyz, float w) : x(xyz.x), y(xyz.y), z(xyz.z), w(w) {}
+	};
+
+	struct quaternion
+	{
+		float x, y, z, w;
+
+		quaternion() = default;
+		constexpr quaternion(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	// Row major, vectors are rows: transform(v, m) is v * m and the translation is m41 m42 m43
+	struct float4x4
+	{
+		float m11, m12, m13, m14;
+		float m21, m22, m23, m24;
+		float m31, m32, m33, m34;
+		float m41, m42, m43, m44;
+
+		float4x4() = default;
+		constexpr float4x4(float m11, float m12, float m13, float m14, float m21, float m22, float m23, float m24,
+			float m31, float m32, float m33, float m34, float m41, float m42, float m43, float m44)
+			: m11(m11), m12(m12), m13(m13), m14(m14), m21(m21), m22(m22), m23(m23), m24(m24),
+			m31(m31), m32(m32), m33(m33), m34(m34), m41(m41), m42(m42), m43(m43), m44(m44) {}
+
+		static constexpr float4x4 identity() { return float4x4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1); }
+	};
+
+	struct plane
+	{
+		float3 normal;
+		float d;
+
+		plane() = default;
+		constexpr plane(float3 normal, float d) : normal(normal), d(d) {}
+		constexpr explicit plane(float4 value) : normal(value.x, value.y, value.z), d(value.w) {}
+	};
+
+	inline float2 operator+(float2 a, float2 b) { return float2(a.x + b.x, a.y + b.y); }
+	inline float2 operator-(float2 a, float2 b) { return float2(a.x - b.x, a.y - b.y); }
+	inline float2 operator*(float2 a, float2 b) { return float2(a.x * b.x, a.y * b.y); }
+	inline float2 operator*(float2 a, float s) { return float2(a.x * s, a.y * s); }
+	inline bool operator==(float2 a, float2 b) { return a.x == b.x && a.y == b.y; }
+
+	inline float3 operator+(float3 a, float3 b) { return float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	inline float3 operator-(float3 a, float3 b) { return float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline float3 operator-(float3 a) { return float3(-a.x, -a.y, -a.z); }
+	inline float3 operator*(float3 a, float3 b) { return float3(a.x * b.x, a.y * b.y, a.z * b.z); }
+	inline float3 operator*(float3 a, float s) { return float3(a.x * s, a.y * s, a.z * s); }
+	inline float3 operator*(float s, float3 a) { return float3(a.x * s, a.y * s, a.z * s); }
+	inline float3 operator/(float3 a, float3 b) { return float3(a.x / b.x, a.y / b.y, a.z / b.z); }
+	inline float3 operator/(float3 a, float s) { return float3(a.x / s, a.y / s, a.z / s); }
+	inline bool operator==(float3 a, float3 b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+	inline bool operator!=(float3 a, float3 b) { return !(a == b); }
+
+	inline float4 operator+(float4 a, float4 b) { return float4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+	inline float4 operator-(float4 a, float4 b) { return float4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+	inline float4 operator*(float4 a, float s) { return float4(a.x * s, a.y * s, a.z * s, a.w * s); }
+	inline bool operator==(float4 a, float4 b) { return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; }
+
+	inline float dot(float2 a, float2 b) { return a.x * b.x + a.y * b.y; }
+	inline float dot(float3 a, float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float dot(float4 a, float4 b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+	inline float3 cross(float3 a, float3 b) { return float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+	inline float length_squared(float3 v) { return dot(v, v); }
+	inline float length(float3 v) { return sqrtf(dot(v, v)); }
+	inline float length(float4 v) { return sqrtf(dot(v, v)); }
+	inline float distance(float3 a, float3 b) { return length(a - b); }
+	inline float distance_squared(float3 a, float3 b) { return length_squared(a - b); }
+	inline float3 normalize(float3 v) { return v / length(v); }
+	inline float4 normalize(float4 v) { return v * (1.0f / length(v)); }
+	// Like WindowsNumerics, planes that are already close to unit length are returned as they are
+	inline plane normalize(plane p)
+	{
+		float lengthSq = dot(p.normal, p.normal);
+		if (fabsf(lengthSq - 1.0f) < FLT_EPSILON)
+			return p;
+		float scale = 1.0f / sqrtf(lengthSq);
+		return plane(p.normal * scale, p.d * scale);
+	}
+	inline float3 min(float3 a, float3 b) { return float3(fminf(a.x, b.x), fminf(a.y, b.y), fminf(a.z, b.z)); }
+	inline float3 max(float3 a, float3 b) { return float3(fmaxf(a.x, b.x), fmaxf(a.y, b.y), fmaxf(a.z, b.z)); }
+	inline float3 clamp(float3 v, float3 lo, float3 hi) { return min(max(v, lo), hi); }
+	inline float3 lerp(float3 a, float3 b, float t) { return a + (b - a) * t; }
+
+	inline float4x4 operator*(const float4x4& a, const float4x4& b)
+	{
+		const float* lhs = &a.m11;
+		const float* rhs = &b.m11;
+		float4x4 result;
+		float* out = &result.m11;
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+				out[r * 4 + c] = lhs[r * 4 + 0] * rhs[0 * 4 + c] + lhs[r * 4 + 1] * rhs[1 * 4 + c] + lhs[r * 4 + 2] * rhs[2 * 4 + c] + lhs[r * 4 + 3] * rhs[3 * 4 + c];
+		}
+		return result;
+	}
+
+	inline float3 transform(float3 v, const float4x4& m)
+	{
+		return float3(
+			v.x * m.m11 + v.y * m.m21 + v.z * m.m31 + m.m41,
+			v.x * m.m12 + v.y * m.m22 + v.z * m.m32 + m.m42,
+			v.x * m.m13 + v.y * m.m23 + v.z * m.m33 + m.m43);
+	}
+
+	inline float4 transform(float4 v, const float4x4& m)
+	{
+		return float4(
+			v.x * m.m11 + v.y * m.m21 + v.z * m.m31 + v.w * m.m41,
+			v.x * m.m12 + v.y * m.m22 + v.z * m.m32 + v.w * m.m42,
+			v.x * m.m13 + v.y * m.m23 + v.z * m.m33 + v.w * m.m43,
+			v.x * m.m14 + v.y * m.m24 + v.z * m.m34 + v.w * m.m44);
+	}
+
+	inline float3 transform_normal(float3 v, const float4x4& m)
+	{
+		return float3(
+			v.x * m.m11 + v.y * m.m21 + v.z * m.m31,
+			v.x * m.m12 + v.y * m.m22 + v.z * m.m32,
+			v.x * m.m13 + v.y * m.m23 + v.z * m.m33);
+	}
+
+	inline float4x4 transpose(const float4x4& m)
+	{
+		return float4x4(m.m11, m.m21, m.m31, m.m41, m.m12, m.m22, m.m32, m.m42, m.m13, m.m23, m.m33, m.m43, m.m14, m.m24, m.m34, m.m44);
+	}
+
+	inline float4x4 make_float4x4_scale(float3 scale)
+	{
+		return float4x4(scale.x, 0, 0, 0, 0, scale.y, 0, 0, 0, 0, scale.z, 0, 0, 0, 0, 1);
+	}
+
+	inline float4x4 make_float4x4_translation(float3 position)
+	{
+		return float4x4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, position.x, position.y, position.z, 1);
+	}
+
+	inline float4x4 make_float4x4_rotation_x(float radians)
+	{
+		float c = cosf(radians), s = sinf(radians);
+		return float4x4(1, 0, 0, 0, 0, c, s, 0, 0, -s, c, 0, 0, 0, 0, 1);
+	}
+
+	inline float4x4 make_float4x4_rotation_y(float radians)
+	{
+		float c = cosf(radians), s = sinf(radians);
+		return float4x4(c, 0, -s, 0, 0, 1, 0, 0, s, 0, c, 0, 0, 0, 0, 1);
+	}
+
+	// Right handed, depth 0 at the near plane
+	inline float4x4 make_float4x4_perspective_field_of_view(float fieldOfView, float aspectRatio, float nearPlane, float farPlane)
+	{
+		float yScale = 1.0f / tanf(fieldOfView * 0.5f);
+		float xScale = yScale / aspectRatio;
+		float range = farPlane / (nearPlane - farPlane);
+		return float4x4(xScale, 0, 0, 0, 0, yScale, 0, 0, 0, 0, range, -1, 0, 0, range * nearPlane, 0);
+	}
+
+	inline float4x4 make_float4x4_from_quaternion(quaternion q)
+	{
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, wz = q.z * q.w, xz = q.z * q.x;
+		float wy = q.y * q.w, yz = q.y * q.z, wx = q.x * q.w;
+		return float4x4(
+			1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0,
+			2.0f * (xy - wz), 1.0f - 2.0f * (zz + xx), 2.0f * (yz + wx), 0,
+			2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (yy + xx), 0,
+			0, 0, 0, 1);
+	}
+
+	// Cofactor expansion, false and result untouched for singular matrices
+	inline bool invert(const float4x4& matrix, float4x4* result)
+	{
+		const float* m = &matrix.m11;
+		float a0 = m[0] * m[5] - m[1] * m[4];
+		float a1 = m[0] * m[6] - m[2] * m[4];
+		float a2 = m[0] * m[7] - m[3] * m[4];
+		float a3 = m[1] * m[6] - m[2] * m[5];
+		float a4 = m[1] * m[7] - m[3] * m[5];
+		float a5 = m[2] * m[7] - m[3] * m[6];
+		float b0 = m[8] * m[13] - m[9] * m[12];
+		float b1 = m[8] * m[14] - m[10] * m[12];
+		float b2 = m[8] * m[15] - m[11] * m[12];
+		float b3 = m[9] * m[14] - m[10] * m[13];
+		float b4 = m[9] * m[15] - m[11] * m[13];
+		float b5 = m[10] * m[15] - m[11] * m[14];
+
+		float det = a0 * b5 - a1 * b4 + a2 * b3 + a3 * b2 - a4 * b1 + a5 * b0;
+		if (fabsf(det) < 1e-20f)
+			return false;
+
+		float s = 1.0f / det;
+		*result = float4x4(
+			(m[5] * b5 - m[6] * b4 + m[7] * b3) * s, (-m[1] * b5 + m[2] * b4 - m[3] * b3) * s, (m[13] * a5 - m[14] * a4 + m[15] * a3) * s, (-m[9] * a5 + m[10] * a4 - m[11] * a3) * s,
+			(-m[4] * b5 + m[6] * b2 - m[7] * b1) * s, (m[0] * b5 - m[2] * b2 + m[3] * b1) * s, (-m[12] * a5 + m[14] * a2 - m[15] * a1) * s, (m[8] * a5 - m[10] * a2 + m[11] * a1) * s,
+			(m[4] * b4 - m[5] * b2 + m[7] * b0) * s, (-m[0] * b4 + m[1] * b2 - m[3] * b0) * s, (m[12] * a4 - m[13] * a2 + m[15] * a0) * s, (-m[8] * a4 + m[9] * a2 - m[11] * a0) * s,
+			(-m[4] * b3 + m[5] * b1 - m[6] * b0) * s, (m[0] * b3 - m[1] * b1 + m[2] * b0) * s, (-m[12] * a3 + m[13] * a1 - m[14] * a0) * s, (m[8] * a3 - m[9] * a1 + m[10] * a0) * s);
+		return true;
+	}
+
+	// DirectXMath storage types Common.h shares with HLSL
+	struct uint4
+	{
+		uint32_t x, y, z, w;
+	};
+
+	struct float3x3
+	{
+		float _11, _12, _13;
+		float _21, _22, _23;
+		float _31, _32, _33;
+
+		float3x3() = default;
+		constexpr float3x3(float m11, float m12, float m13, float m21, float m22, float m23, float m31, float m32, float m33)
+			: _11(m11), _12(m12), _13(m13), _21(m21), _22(m22), _23(m23), _31(m31), _32(m32), _33(m33) {}
+	};
+}
@@ -0,0 +1,199 @@
+#include "OutOfCore.h"
+#include "GltfDecode.h"
+#include "Render.h"
+
+#include <cassert>
+#include <cfloat>
+#include <algorithm>
+
+#define PARTITION_PIECE_ELEMENTS 65536 // Vertices or triangles decoded per step of the partition
+#define LARGE_CELL_BIT 0x80000000u // In the chunk of a cell with more triangles than fit a chunk
+
+size_t GetChunkTriangleBudget(size_t budgetBytes)
+{
+	size_t triangles = budgetBytes / (COOK_CHUNKS_IN_FLIGHT * (size_t)COOK_BYTES_PER_TRIANGLE);
+	return std::max<size_t>(triangles, MIN_CHUNK_TRIANGLES);
+}
+
+size_t GetMinCookBudget()
+{
+	return COOK_CHUNKS_IN_FLIGHT * (size_t)COOK_BYTES_PER_TRIANGLE * MIN_CHUNK_TRIANGLES;
+}
+
+// Spreads the low 7 bits of v three bits apart
+static uint32_t SpreadCellBits(uint32_t v)
+{
+	v = (v | (v << 8)) & 0x0000f00f;
+	v = (v | (v << 4)) & 0x000c30c3;
+	v = (v | (v << 2)) & 0x00249249;
+	return v;
+}
+
+static_assert(CHUNK_GRID_BITS <= 7, "SpreadCellBits handles 7 bits per axis");
+
+static uint32_t CellMortonCode(uint32_t x, uint32_t y, uint32_t z)
+{
+	return SpreadCellBits(x) | (SpreadCellBits(y) << 1) | (SpreadCellBits(z) << 2);
+}
+
+// Grid coordinates of every vertex, packed CHUNK_GRID_BITS per axis
+static void ComputeVertexCells(const cgltf_accessor* positions, std::vector<uint32_t>& cells)
+{
+	const uint32_t gridSize = 1u << CHUNK_GRID_BITS;
+	std::vector<float3> piece(PARTITION_PIECE_ELEMENTS);
+
+	float3 boundsMin = float3(FLT_MAX, FLT_MAX, FLT_MAX);
+	float3 boundsMax = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (size_t first = 0; first < positions->count; first += piece.size())
+	{
+		size_t count = std::min(piece.size(), positions->count - first);
+		cgltf_accessor range = GetAccessorRange(positions, first, count);
+		DecodeAccessorFloats(&range, 3, &piece[0].x, sizeof(float3));
+		for (size_t v = 0; v < count; ++v)
+		{
+			boundsMin = min(boundsMin, piece[v]);
+			boundsMax = max(boundsMax, piece[v]);
+		}
+	}
+
+	float3 extent = boundsMax - boundsMin;
+	float3 scale = float3(extent.x > 0.0f ? gridSize / extent.x : 0.0f, extent.y > 0.0f ? gridSize / extent.y : 0.0f, extent.z > 0.0f ? gridSize / extent.z : 0.0f);
+
+	cells.resize(positions->count);
+	for (size_t first = 0; first < positions->count; first += piece.size())
+	{
+		size_t count = std::min(piece.size(), positions->count - first);
+		cgltf_accessor range = GetAccessorRange(positions, first, count);
+		DecodeAccessorFloats(&range, 3, &piece[0].x, sizeof(float3));
+		for (size_t v = 0; v < count; ++v)
+		{
+			float3 p = (piece[v] - boundsMin) * scale;
+			uint32_t x = std::min(uint32_t(std::max(p.x, 0.0f)), gridSize - 1);
+			uint32_t y = std::min(uint32_t(std::max(p.y, 0.0f)), gridSize - 1);
+			uint32_t z = std::min(uint32_t(std::max(p.z, 0.0f)), gridSize - 1);
+			cells[first + v] = x | (y << CHUNK_GRID_BITS) | (z << (2 * CHUNK_GRID_BITS));
+		}
+	}
+}
+
+// Cell of the triangle center, as a Morton code so cells in index order are close in space
+static uint32_t TriangleCell(const std::vector<uint32_t>& vertexCells, const uint32_t* triangle)
+{
+	const uint32_t mask = (1u << CHUNK_GRID_BITS) - 1;
+	uint32_t sum[3] = {};
+	for (int k = 0; k < 3; ++k)
+	{
+		uint32_t cell = vertexCells[triangle[k]];
+		for (int axis = 0; axis < 3; ++axis)
+			sum[axis] += (cell >> (axis * CHUNK_GRID_BITS)) & mask;
+	}
+	return CellMortonCode(sum[0] / 3, sum[1] / 3, sum[2] / 3);
+}
+
+// Calls visit(indices) for every triangle, decoding the indices a piece at a time
+template<class Visit>
+static void ForEachTriangle(const cgltf_accessor* indices, Visit visit)
+{
+	size_t triangleCount = indices->count / 3;
+	std::vector<uint32_t> piece(PARTITION_PIECE_ELEMENTS * 3);
+	for (size_t first = 0; first < triangleCount; first += PARTITION_PIECE_ELEMENTS)
+	{
+		size_t count = std::min<size_t>(PARTITION_PIECE_ELEMENTS, triangleCount - first);
+		cgltf_accessor range = GetAccessorRange(indices, first * 3, count * 3);
+		DecodeAccessorIndices(&range, piece.data());
+		for (size_t t = 0; t < count; ++t)
+			visit(&piece[t * 3]);
+	}
+}
+
+bool PartitionTriangles(const cgltf_accessor* indices, const cgltf_accessor* positions, size_t maxChunkTriangles, SpillFile& spill, std::vector<TriangleChunk>& chunks)
+{
+	chunks.clear();
+	if (!CanSplitAccessor(indices) || !CanSplitAccessor(positions) || maxChunkTriangles == 0)
+		return false;
+
+	std::vector<uint32_t> vertexCells;
+	ComputeVertexCells(positions, vertexCells);
+
+	// Triangles per cell, then cells in Morton order fill up chunks. A cell with more triangles than fit a chunk gets
+	// chunks of its own, its triangles go to them in index order
+	const size_t cellCount = size_t(1) << (3 * CHUNK_GRID_BITS);
+	std::vector<uint32_t> cellTriangles(cellCount, 0);
+	ForEachTriangle(indices, [&](const uint32_t* triangle)
+	{
+		cellTriangles[TriangleCell(vertexCells, triangle)] += 1;
+	});
+
+	std::vector<uint32_t> cellChunk(cellCount, 0);
+	size_t chunkCount = 0, chunkFill = 0;
+	for (size_t cell = 0; cell < cellCount; ++cell)
+	{
+		size_t count = cellTriangles[cell];
+		if (count == 0)
+			continue;
+		if (count > maxChunkTriangles)
+		{
+			chunkCount += chunkFill > 0 ? 1 : 0;
+			cellChunk[cell] = (uint32_t)chunkCount | LARGE_CELL_BIT;
+			chunkCount += (count + maxChunkTriangles - 1) / maxChunkTriangles;
+			chunkFill = 0;
+			continue;
+		}
+		if (chunkFill + count > maxChunkTriangles)
+		{
+			chunkCount += 1;
+			chunkFill = 0;
+		}
+		cellChunk[cell] = (uint32_t)chunkCount;
+		chunkFill += count;
+	}
+	chunkCount += chunkFill > 0 ? 1 : 0;
+
+	// Second pass puts every triangle in its chunk, large cells hand theirs out to their chunks in index order
+	chunks.resize(chunkCount);
+	std::vector<std::vector<uint32_t>> pending(chunkCount);
+	bool success = true;
+	auto flush = [&](size_t chunk)
+	{
+		std::vector<uint32_t>& triangles = pending[chunk];
+		if (triangles.empty())
+			return;
+		TriangleChunkSegment segment = { spill.Append(triangles.data(), triangles.size() * sizeof(uint32_t)), uint32_t(triangles.size() / 3) };
+		success = success && segment.offset != ~0ull;
+		chunks[chunk].segments.push_back(segment);
+		chunks[chunk].triangleCount += segment.triangleCount;
+		triangles.clear();
+	};
+
+	// cellTriangles counts what large cells handed out from here on
+	std::fill(cellTriangles.begin(), cellTriangles.end(), 0);
+	ForEachTriangle(indices, [&](const uint32_t* triangle)
+	{
+		uint32_t cell = TriangleCell(vertexCells, triangle);
+		size_t chunk = cellChunk[cell] & ~LARGE_CELL_BIT;
+		if (cellChunk[cell] & LARGE_CELL_BIT)
+			chunk += cellTriangles[cell]++ / maxChunkTriangles;
+
+		std::vector<uint32_t>& triangles = pending[chunk];
+		triangles.insert(triangles.end(), triangle, triangle + 3);
+		if (triangles.size() == CHUNK_SEGMENT_TRIANGLES * 3)
+			flush(chunk);
+	});
+
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+		flush(chunk);
+	return success;
+}
+
+bool ReadChunkTriangles(SpillFile& spill, const TriangleChunk& chunk, std::vector<uint32_t>& indices)
+{
+	indices.resize(size_t(chunk.triangleCount) * 3);
+	size_t written = 0;
+	for (const TriangleChunkSegment& segment : chunk.segments)
+	{
+		if (!spill.Read(segment.offset, indices.data() + written, size_t(segment.triangleCount) * 3 * sizeof(uint32_t)))
+			return false;
+		written += size_t(segment.triangleCount) * 3;
+	}
+	return true;
+}
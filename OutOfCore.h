@@ -0,0 +1,49 @@
+#pragma once
+
+#include "SceneFile.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "cgltf.h"
+
+// Out of core cooking, -budget <MB>
+// A primitive too large to cook within the memory budget is split into spatially coherent chunks, and every chunk is
+// cooked on its own as if it were a primitive of the mesh. The chunk borders are open edges of each chunk, and
+// meshopt_SimplifyLockBorder keeps open edges where they are on every level, so chunks still meet without cracks.
+// Chunks never fall back to meshopt_simplifySloppy, which moves borders, not even on their single group last levels.
+// Cooked chunks go to a spill file right away, the stitch reads them back one at a time and streams the sections
+// through SceneSectionStream, so neither the input nor the output ever has to fit in memory.
+
+#define COOK_BYTES_PER_TRIANGLE 400 // Peak memory of cooking one input triangle, measured on the test scenes
+#define MIN_CHUNK_TRIANGLES 16384 // Chunks much smaller than this hardly simplify, their borders are locked
+#define CHUNK_GRID_BITS 7 // Per axis, the partition counts triangles on a grid of 2^21 cells
+#define CHUNK_SEGMENT_TRIANGLES 256 // Triangles of a chunk are spilled this many at a time
+#define COOK_CHUNKS_IN_FLIGHT 8 // Items cooking at once out of core, whatever -threads is, so the chunks and the output don't depend on it
+
+// Largest chunk that keeps COOK_CHUNKS_IN_FLIGHT chunks cooking at once within budgetBytes
+// Never below MIN_CHUNK_TRIANGLES, so budgets under GetMinCookBudget cook with that instead
+size_t GetChunkTriangleBudget(size_t budgetBytes);
+// Memory COOK_CHUNKS_IN_FLIGHT chunks of MIN_CHUNK_TRIANGLES take, the smallest budget that holds
+size_t GetMinCookBudget();
+
+struct TriangleChunkSegment
+{
+	uint64_t offset; // Into the spill file
+	uint32_t triangleCount;
+};
+
+// Triangles of one chunk, three source indices each
+struct TriangleChunk
+{
+	std::vector<TriangleChunkSegment> segments;
+	uint32_t triangleCount = 0;
+};
+
+// Splits the triangles of indices into chunks of at most maxChunkTriangles along a Morton curve over the positions
+// Both accessors are read a piece at a time, but the partition holds a 4 byte cell for every source vertex next to the
+// grid, so its memory grows with the vertex count of the primitive, not with the budget.
+// Returns false if the accessors can't be split, see CanSplitAccessor
+bool PartitionTriangles(const cgltf_accessor* indices, const cgltf_accessor* positions, size_t maxChunkTriangles, SpillFile& spill, std::vector<TriangleChunk>& chunks);
+
+bool ReadChunkTriangles(SpillFile& spill, const TriangleChunk& chunk, std::vector<uint32_t>& indices);
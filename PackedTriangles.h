@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// Triangle format of the Indices section and of the index stream of a page, decoded by GetTri in ShaderCommon.hlsl
+// Indices are local to their cluster and clusters have at most 64 vertices, so a triangle is three 8 bit indices
+// in one 32 bit word: i0 | i1 << 8 | i2 << 16, the top byte is 0. That is 4 bytes per triangle instead of 12.
+// DXR only builds from 16 or 32 bit indices, the BLAS builds widen them, see RebuildScene in Render.cpp.
+
+#define PACKED_TRIANGLE_INDEX_BITS 8
+#define PACKED_TRIANGLE_MAX_VERTICES (1 << PACKED_TRIANGLE_INDEX_BITS)
+
+inline uint32_t PackTriangle(uint32_t i0, uint32_t i1, uint32_t i2)
+{
+	return i0 | (i1 << 8) | (i2 << 16);
+}
+
+inline void UnpackTriangle(uint32_t packed, uint32_t indices[3])
+{
+	indices[0] = packed & 0xff;
+	indices[1] = (packed >> 8) & 0xff;
+	indices[2] = (packed >> 16) & 0xff;
+}
@@ -0,0 +1,143 @@
+#include "Parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+struct ParallelBatch
+{
+	const std::function<void(size_t)>* func = nullptr;
+	size_t count = 0;
+	std::atomic<size_t> next = 0;
+	std::atomic<size_t> done = 0;
+	std::atomic<int> refs = 0; // Workers currently looking at this batch
+};
+
+struct ParallelPool
+{
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<ParallelBatch*> batches; // Batches that might still have items left to pick
+	bool quit = false;
+};
+
+static ParallelPool* g_pool = nullptr;
+
+static void RunBatchItems(ParallelBatch* batch)
+{
+	for (;;)
+	{
+		size_t i = batch->next.fetch_add(1);
+		if (i >= batch->count)
+			break;
+
+		(*batch->func)(i);
+		batch->done.fetch_add(1);
+	}
+}
+
+static void RemoveBatch(ParallelPool* pool, ParallelBatch* batch)
+{
+	auto iter = std::find(pool->batches.begin(), pool->batches.end(), batch);
+	if (iter != pool->batches.end())
+		pool->batches.erase(iter);
+}
+
+static void WorkerThread(ParallelPool* pool)
+{
+	for (;;)
+	{
+		ParallelBatch* batch = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(pool->mutex);
+			pool->wake.wait(lock, [pool] { return pool->quit || !pool->batches.empty(); });
+			if (pool->quit)
+				return;
+
+			// Newest batch first, that is the most nested one and the one blocking the others
+			batch = pool->batches.back();
+			batch->refs.fetch_add(1);
+		}
+
+		RunBatchItems(batch);
+
+		{
+			std::unique_lock<std::mutex> lock(pool->mutex);
+			RemoveBatch(pool, batch);
+			batch->refs.fetch_sub(1);
+		}
+	}
+}
+
+void InitializeParallel(int numThreads)
+{
+	assert(g_pool == nullptr);
+
+	if (numThreads <= 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	g_pool = new ParallelPool;
+
+	// The calling thread is one of the threads doing work
+	for (int i = 1; i < numThreads; ++i)
+		g_pool->threads.emplace_back(WorkerThread, g_pool);
+}
+
+void ShutdownParallel()
+{
+	if (g_pool == nullptr)
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(g_pool->mutex);
+		g_pool->quit = true;
+	}
+	g_pool->wake.notify_all();
+
+	for (auto& thread : g_pool->threads)
+		thread.join();
+
+	delete g_pool;
+	g_pool = nullptr;
+}
+
+int GetParallelThreadCount()
+{
+	return g_pool ? (int)g_pool->threads.size() + 1 : 1;
+}
+
+void ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+	if (g_pool == nullptr || g_pool->threads.empty() || count <= 1)
+	{
+		for (size_t i = 0; i < count; ++i)
+			func(i);
+		return;
+	}
+
+	ParallelBatch batch;
+	batch.func = &func;
+	batch.count = count;
+
+	{
+		std::unique_lock<std::mutex> lock(g_pool->mutex);
+		g_pool->batches.push_back(&batch);
+	}
+	g_pool->wake.notify_all();
+
+	RunBatchItems(&batch);
+
+	{
+		std::unique_lock<std::mutex> lock(g_pool->mutex);
+		RemoveBatch(g_pool, &batch);
+	}
+
+	// Wait for the items other threads picked up, the batch lives on our stack so no one can be left looking at it
+	while (batch.done.load() < count || batch.refs.load() > 0)
+		std::this_thread::yield();
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <functional>
+
+// Small shared worker pool for CPU side work (scene cooking, per instance loops)
+// ParallelFor blocks until all items are done and the calling thread helps out,
+// so it is safe to nest ParallelFor calls inside each other.
+
+void InitializeParallel(int numThreads); // 0 = one thread per hardware thread, 1 = run everything serially
+void ShutdownParallel();
+int GetParallelThreadCount();
+
+void ParallelFor(size_t count, const std::function<void(size_t)>& func);
@@ -1,4 +1,13 @@
 #include "Render.h"
+#include "LodCut.h"
+#include "Parallel.h"
+#include "VertexQuantization.h"
+#include "SceneFile.h"
+#include "ClusterStreaming.h"
+#include "PackedTriangles.h"
+#include "MeshletConfig.h"
+#include "SimdMath.h"
+#include "Log.h"
 
 #include <dxgi1_6.h>
 #include <d3dx12.h>
@@ -25,9 +34,15 @@ using winrt::check_bool;
 #define MAX_INSTANCES 4096
 #define MAX_CLUSTERS UINT16_MAX
 #define MAX_VERTICES (4 * 1024 * 1024)
-#define MAX_INDICES (16 * 1024 * 1024)
+#define MAX_TRIANGLES (8 * 1024 * 1024)
 #define MAX_MESHES (8 * 1024)
 #define MAX_MATERIALS (1024)
+#define MAX_PAGES (64 * 1024)
+
+// With cluster streaming the geometry buffers are a pool of page slots, the vertex buffers are the tighter limit
+#define PAGE_POOL_SLOTS (MAX_VERTICES / CLUSTER_PAGE_VERTICES)
+#define PAGE_LOADS_PER_FRAME 64
+static_assert(PAGE_POOL_SLOTS * CLUSTER_PAGE_TRIANGLES <= MAX_TRIANGLES, "Page pool does not fit the index buffer");
 
 extern "C" { __declspec(dllexport) extern const UINT D3D12SDKVersion = 717; }
 extern "C" { __declspec(dllexport) extern const char8_t* D3D12SDKPath = u8".\\D3D12\\"; }
@@ -201,6 +216,7 @@ struct Render
     com_ptr<IDStorageFactory> storageFactory;
     com_ptr<ID3D12CommandQueue> commandQueue;
     com_ptr<IDStorageQueue3> storageQueue;
+    com_ptr<IDStorageCustomDecompressionQueue> decompressionQueue;
     com_ptr<IDXGISwapChain3> swapChain;
     UINT frameIndex = 0;
 
@@ -241,15 +257,42 @@ struct Render
     Buffer tangentsBuffer;
     Buffer texcoordsBuffer;
     Buffer indexDataBuffer;
+    Buffer vertexIndexBuffer; // Per cluster vertex lists into the shared vertex pool
     Buffer materialsBuffer;
     Buffer workGraphBuffer;
     Buffer workGraphBackingMemory;
     Buffer workGraphNodeLocalRootArgumentsTable;
     char* cbvDataBegin = nullptr;
 
-    Instance* instancesCpu = nullptr;
-    Mesh* meshesCpu = nullptr;
-    Cluster* clustersCpu = nullptr;
+    // The CPU side scene data points straight into the mapped scene file
+    SceneFile sceneFile;
+    const Instance* instancesCpu = nullptr;
+    const Mesh* meshesCpu = nullptr;
+    const Cluster* clustersCpu = nullptr;
+    const ClusterLod* clusterLodsCpu = nullptr;
+    bool quantizedVertices = false;
+    bool sharedVertices = false; // Cooked with -sharedvertices, see SharedVertices.h
+    MeshletConfig meshletConfig = g_defaultMeshletConfig; // Cooked with -meshlets, the shaders are compiled for it
+
+    // Stream decoding done for DirectStorage, reset on every scene load
+    UINT64 decodedBytes = 0;
+    UINT64 decodedCompressedBytes = 0;
+    double decodeMs = 0.0; // Summed over all decoded blocks, so per core
+
+    // Cluster geometry streaming, the geometry buffers hold PAGE_POOL_SLOTS pages instead of the whole scene
+    bool pageStreaming = false; // Asked for, only used when the scene has pages
+    bool pageStreamingActive = false;
+    com_ptr<IDStorageFile> pageFile;
+    const ClusterPage* pagesCpu = nullptr;
+    UINT numPages = 0;
+    UINT64 pageDataOffset = 0;
+    UINT pageStreamStrides[PAGE_STREAM_COUNT] = {};
+    ClusterPageStreamer pageStreamer;
+    ClusterStreamingStats pageStreamingStats; // Of the last frame
+    std::vector<UINT> requestedPages;
+    std::vector<uint8_t> clusterVisibility; // Frustum test results of the clusters of one instance, see SimdMath.h
+    Buffer pageTableBuffer;
+    UINT* pageTableCpu = nullptr; // Persistently mapped, the GPU reads it straight from upload memory
 
     Buffer visibleInstances;
     Buffer visibleClusters;
@@ -260,6 +303,7 @@ struct Render
 
     Buffer scratch;
     Buffer blasPool;
+    Buffer blasIndices; // The packed triangles widened to 16 bits, DXR has no 8 bit index format
     Buffer tlas;
     Buffer tlasInstances;
     Buffer shaderIDs;
@@ -325,8 +369,13 @@ struct Render
     bool visualizeClusters = false;
     bool fastMove = false;
     bool lockedCullingCamera = false;
+    bool coneCulling = true;
     bool workGraph = false;
     bool traceVisibility = false;
+    bool cpuLodCut = false;
+
+    float lodErrorThreshold = 1.0f; // In pixels
+    LodCut lodCut;
 };
 
 struct handle_closer
@@ -455,6 +504,15 @@ static com_ptr<ID3DBlob> CompileShader(Render* render, LPCWSTR shaderName, LPCWS
     arguments.push_back(L"-I");
     arguments.push_back(L"C:\\Code\\DSTest\\");
 
+    MeshletShaderDefines meshletDefines;
+    GetMeshletShaderDefines(render->meshletConfig, meshletDefines);
+    arguments.push_back(L"-D");
+    arguments.push_back(meshletDefines.maxVertices);
+    arguments.push_back(L"-D");
+    arguments.push_back(meshletDefines.maxTriangles);
+    arguments.push_back(L"-D");
+    arguments.push_back(meshletDefines.groupSize);
+
     arguments.push_back(L"/Zi");
     arguments.push_back(L"/Zss");
 
@@ -619,46 +677,129 @@ static void CreateBuffer(Render* render, Buffer* out_buffer, const BufferDesc& d
     out_buffer->addressRangeAndStride.StrideInBytes = desc.stride;
 }
 
-static void OpenFileForLoading(Render* render, LPCWSTR fileName, com_ptr<IDStorageFile>& file, UINT32& size)
+static const SceneSection& GetSceneSection(const SceneFile& sceneFile, SceneSectionType type)
 {
-	check_hresult(render->storageFactory->OpenFile(fileName, IID_PPV_ARGS(file.put())));
+    const SceneSection* section = sceneFile.FindSection(type);
+    if (!section)
+    {
+        throw std::exception();
+    }
+    return *section;
+}
 
-	BY_HANDLE_FILE_INFORMATION info = {};
-	check_hresult(file->GetFileInformation(&info));
-    size = info.nFileSizeLow;
+static void LoadSectionToGPU(Render* render, const com_ptr<IDStorageFile>& file, const SceneSection& section, ID3D12Resource* resource)
+{
+    if (section.codec == StreamCodec::None)
+    {
+        DSTORAGE_REQUEST request = {};
+        request.Options.SourceType = DSTORAGE_REQUEST_SOURCE_FILE;
+        request.Options.DestinationType = DSTORAGE_REQUEST_DESTINATION_BUFFER;
+        request.Options.CompressionFormat = DSTORAGE_COMPRESSION_FORMAT_NONE;
+        request.Source.File.Source = file.get();
+        request.Source.File.Offset = section.offset;
+        request.Source.File.Size = (UINT32)section.size;
+        request.UncompressedSize = (UINT32)section.size;
+        request.Destination.Buffer.Resource = resource;
+        request.Destination.Buffer.Offset = 0;
+        request.Destination.Buffer.Size = (UINT32)section.size;
+
+        render->storageQueue->EnqueueRequest(&request);
+        return;
+    }
+
+    // One request per block, DirectStorage hands them to ServiceDecompressionRequests with the upload memory as destination
+    const StreamBlock* blocks = GetSceneBlocks(render->sceneFile.file.data) + section.blockStart;
+    for (UINT32 b = 0; b < section.blockCount; ++b)
+    {
+        const StreamBlock& block = blocks[b];
+        UINT32 blockSize = block.elementCount * section.stride;
+
+        DSTORAGE_REQUEST request = {};
+        request.Options.SourceType = DSTORAGE_REQUEST_SOURCE_FILE;
+        request.Options.DestinationType = DSTORAGE_REQUEST_DESTINATION_BUFFER;
+        request.Options.CompressionFormat = DSTORAGE_CUSTOM_COMPRESSION_0;
+        request.Source.File.Source = file.get();
+        request.Source.File.Offset = block.offset;
+        request.Source.File.Size = block.size;
+        request.UncompressedSize = blockSize;
+        request.Destination.Buffer.Resource = resource;
+        request.Destination.Buffer.Offset = UINT64(b) * STREAM_BLOCK_ELEMENTS * section.stride;
+        request.Destination.Buffer.Size = blockSize;
+
+        render->storageQueue->EnqueueRequest(&request);
+    }
 }
 
-static void LoadFileToGPU(Render* render, const com_ptr<IDStorageFile>& file, ID3D12Resource* resource, UINT32 size)
+// One request per page stream, each one goes to the slot in its own geometry buffer
+static void LoadPageToGPU(Render* render, const ClusterPage& page, UINT slot)
 {
-	DSTORAGE_REQUEST request = {};
-	request.Options.SourceType = DSTORAGE_REQUEST_SOURCE_FILE;
-	request.Options.DestinationType = DSTORAGE_REQUEST_DESTINATION_BUFFER;
-    request.Options.CompressionFormat = DSTORAGE_COMPRESSION_FORMAT_NONE;
-	request.Source.File.Source = file.get();
-	request.Source.File.Offset = 0;
-	request.Source.File.Size = size;
-	request.UncompressedSize = size;
-	request.Destination.Buffer.Resource = resource;
-	request.Destination.Buffer.Offset = 0;
-	request.Destination.Buffer.Size = size;
-
-	render->storageQueue->EnqueueRequest(&request);
+    ID3D12Resource* resources[PAGE_STREAM_COUNT] = {
+        render->positionsBuffer.resource.get(),
+        render->normalsBuffer.resource.get(),
+        render->tangentsBuffer.resource.get(),
+        render->texcoordsBuffer.resource.get(),
+        render->indexDataBuffer.resource.get(),
+    };
+
+    UINT32 offsets[PAGE_STREAM_COUNT];
+    GetPageStreamOffsets(page, render->pageStreamStrides, offsets);
+    for (int s = 0; s < PAGE_STREAM_COUNT; ++s)
+    {
+        bool vertexStream = s < PAGE_STREAM_COUNT - 1;
+        UINT32 stride = render->pageStreamStrides[s];
+        UINT32 size = stride * (vertexStream ? page.vertexCount : page.triangleCount);
+
+        DSTORAGE_REQUEST request = {};
+        request.Options.SourceType = DSTORAGE_REQUEST_SOURCE_FILE;
+        request.Options.DestinationType = DSTORAGE_REQUEST_DESTINATION_BUFFER;
+        request.Options.CompressionFormat = DSTORAGE_COMPRESSION_FORMAT_NONE;
+        request.Source.File.Source = render->pageFile.get();
+        request.Source.File.Offset = render->pageDataOffset + page.offset + offsets[s];
+        request.Source.File.Size = size;
+        request.UncompressedSize = size;
+        request.Destination.Buffer.Resource = resources[s];
+        request.Destination.Buffer.Offset = UINT64(slot) * (vertexStream ? CLUSTER_PAGE_VERTICES : CLUSTER_PAGE_TRIANGLES) * stride;
+        request.Destination.Buffer.Size = size;
+
+        render->storageQueue->EnqueueRequest(&request);
+    }
 }
 
-static void LoadFileToCPU(Render* render, const com_ptr<IDStorageFile>& file, void* buffer, UINT32 size)
+// Decodes the blocks DirectStorage has read so far, spread over the worker threads
+// The destination can be write combined upload memory, the meshoptimizer decoders only write to it
+static void ServiceDecompressionRequests(Render* render)
 {
-	DSTORAGE_REQUEST request = {};
-	request.Options.SourceType = DSTORAGE_REQUEST_SOURCE_FILE;
-	request.Options.DestinationType = DSTORAGE_REQUEST_DESTINATION_MEMORY;
-    request.Options.CompressionFormat = DSTORAGE_COMPRESSION_FORMAT_NONE;
-	request.Source.File.Source = file.get();
-	request.Source.File.Offset = 0;
-	request.Source.File.Size = size;
-	request.UncompressedSize = size;
-    request.Destination.Memory.Buffer = buffer;
-	request.Destination.Memory.Size = size;
-
-	render->storageQueue->EnqueueRequest(&request);
+    DSTORAGE_CUSTOM_DECOMPRESSION_REQUEST requests[64];
+    UINT32 numRequests = 0;
+    do
+    {
+        check_hresult(render->decompressionQueue->GetRequests(_countof(requests), requests, &numRequests));
+
+        DSTORAGE_CUSTOM_DECOMPRESSION_RESULT results[_countof(requests)];
+        double blockMs[_countof(requests)];
+        ParallelFor(numRequests, [&](size_t i)
+        {
+            const DSTORAGE_CUSTOM_DECOMPRESSION_REQUEST& request = requests[i];
+
+            double start = GetTimeMs();
+            bool success = request.CompressionFormat == DSTORAGE_CUSTOM_COMPRESSION_0 &&
+                DecodeStreamBlock(request.SrcBuffer, request.SrcSize, request.DstBuffer, request.DstSize);
+            blockMs[i] = GetTimeMs() - start;
+
+            results[i].Id = request.Id;
+            results[i].Result = success ? S_OK : E_FAIL;
+        });
+
+        for (UINT32 i = 0; i < numRequests; ++i)
+        {
+            render->decodedBytes += requests[i].DstSize;
+            render->decodedCompressedBytes += requests[i].SrcSize;
+            render->decodeMs += blockMs[i];
+        }
+
+        if (numRequests > 0)
+            check_hresult(render->decompressionQueue->SetRequestResults(numRequests, results));
+    } while (numRequests == _countof(requests));
 }
 
 Render* CreateRender(UINT width, UINT height)
@@ -677,9 +818,7 @@ void Destroy(Render* render)
     ImGui_ImplWin32_Shutdown();
     ImGui::DestroyContext();
 
-    free(render->instancesCpu);
-    free(render->meshesCpu);
-    free(render->clustersCpu);
+    ShutdownParallel();
 
 	delete render;
 }
@@ -688,6 +827,8 @@ void Initialize(Render* render, HWND hwnd, bool useWarp)
 {
     render->hwnd = hwnd;
 
+    InitializeParallel(0);
+
     //UUID GPUWorkGraphExperimentalFeatures[2] = { D3D12ExperimentalShaderModels, D3D12StateObjectsExperiment };
     //D3D12EnableExperimentalFeatures(_countof(GPUWorkGraphExperimentalFeatures), GPUWorkGraphExperimentalFeatures, nullptr, nullptr);
 
@@ -751,6 +892,9 @@ void Initialize(Render* render, HWND hwnd, bool useWarp)
         queueDesc.Device = render->device.get();
 
         check_hresult(render->storageFactory->CreateQueue(&queueDesc, IID_PPV_ARGS(render->storageQueue.put())));
+
+        // Requests with DSTORAGE_CUSTOM_COMPRESSION_0 are compressed streams, see ServiceDecompressionRequests
+        check_hresult(render->storageFactory->QueryInterface(IID_PPV_ARGS(render->decompressionQueue.put())));
     }
 
     D3D12_COMMAND_QUEUE_DESC queueDesc = {};
@@ -836,7 +980,12 @@ static void WaitStorageIdle(Render* render)
 
     render->storageQueue->Submit();
 
-    WaitForSingleObject(fenceEvent.get(), INFINITE);
+    // Compressed streams need us to decode them while we wait
+    HANDLE events[] = { fenceEvent.get(), render->decompressionQueue->GetEvent() };
+    while (WaitForMultipleObjects(_countof(events), events, FALSE, INFINITE) != WAIT_OBJECT_0)
+    {
+        ServiceDecompressionRequests(render);
+    }
 }
 
 static void WaitGraphicsIdle(Render* render)
@@ -1075,15 +1224,32 @@ static void RecreateResources(Render* render) {
         .WithSRV(TEXCOORD_DATA_BUFFER_SRV)
         .WithRAW());
     CreateBuffer(render, &render->indexDataBuffer,
-        BufferDesc(MAX_INDICES, sizeof(UINT))
+        BufferDesc(MAX_TRIANGLES, sizeof(UINT))
         .WithName(L"IndexDataBuffer")
         .WithSRV(INDEX_DATA_BUFFER_SRV)
         .WithRAW());
+    CreateBuffer(render, &render->vertexIndexBuffer,
+        BufferDesc(MAX_VERTICES, sizeof(UINT))
+        .WithName(L"VertexIndexBuffer")
+        .WithSRV(VERTEX_INDEX_BUFFER_SRV)
+        .WithRAW());
     CreateBuffer(render, &render->materialsBuffer,
         BufferDesc(MAX_MATERIALS, sizeof(Material))
         .WithName(L"MaterialsBuffer")
         .WithSRV(MATERIAL_BUFFER_SRV));
 
+    CreateBuffer(render, &render->pageTableBuffer,
+        BufferDesc(MAX_PAGES, sizeof(UINT))
+        .WithName(L"PageTable")
+        .WithHeapType(D3D12_HEAP_TYPE_UPLOAD)
+        .WithResourceState(D3D12_RESOURCE_STATE_GENERIC_READ)
+        .WithSRV(PAGE_TABLE_SRV)
+        .WithRAW());
+    {
+        CD3DX12_RANGE readRange(0, 0);
+        check_hresult(render->pageTableBuffer.resource->Map(0, &readRange, reinterpret_cast<void**>(&render->pageTableCpu)));
+    }
+
     CreateBuffer(render, &render->workGraphBuffer,
         BufferDesc(16 * 1024 * 1024 / sizeof(uint), sizeof(uint))
         .WithName(L"WorkGraphBuffer")
@@ -1131,6 +1297,11 @@ static void RecreateResources(Render* render) {
         .WithAS()
         .WithName(L"BLASPool"));
 
+    CreateBuffer(render, &render->blasIndices,
+        BufferDesc(MAX_TRIANGLES * 3, sizeof(uint16_t))
+        .WithName(L"BLASIndices")
+        .WithHeapType(D3D12_HEAP_TYPE_UPLOAD));
+
     CreateBuffer(render, &render->tlas,
         BufferDesc(512 * 1024 * 1024, sizeof(BYTE))
         .WithName(L"TLAS")
@@ -1401,74 +1572,138 @@ void CreatePSOs(Render* render)
 static void ReloadScene(Render* render)
 {
     /*
-    * Open files to query sizes
+    * Map the scene file, this replaces the previous mapping. The metadata and the CPU side sections are used in place,
+    * the GPU side sections are loaded from a DirectStorage handle to the same file in one batch
     */
-    com_ptr<IDStorageFile> instancesFile;
-    com_ptr<IDStorageFile> meshesFile;
-    com_ptr<IDStorageFile> clustersFile;
-    com_ptr<IDStorageFile> positionsFile;
-    com_ptr<IDStorageFile> normalsFile;
-    com_ptr<IDStorageFile> tangentsFile;
-    com_ptr<IDStorageFile> texcoordsFile;
-    com_ptr<IDStorageFile> indicesFile;
-    com_ptr<IDStorageFile> materialsFile;
-    UINT32 instancesSize = 0;
-    UINT32 meshesSize = 0;
-    UINT32 clustersSize = 0;
-    UINT32 positionsSize = 0;
-    UINT32 normalsSize = 0;
-    UINT32 tangentsSize = 0;
-    UINT32 texcoordsSize = 0;
-    UINT32 indicesSize = 0;
-    UINT32 materialsSize = 0;
-    OpenFileForLoading(render, L"instances.raw", instancesFile, instancesSize);
-    OpenFileForLoading(render, L"meshes.raw", meshesFile, meshesSize);
-    OpenFileForLoading(render, L"clusters.raw", clustersFile, clustersSize);
-    OpenFileForLoading(render, L"positions.raw", positionsFile, positionsSize);
-    OpenFileForLoading(render, L"normals.raw", normalsFile, normalsSize);
-    OpenFileForLoading(render, L"tangents.raw", tangentsFile, tangentsSize);
-    OpenFileForLoading(render, L"texcoords.raw", texcoordsFile, texcoordsSize);
-    OpenFileForLoading(render, L"indices.raw", indicesFile, indicesSize);
-    OpenFileForLoading(render, L"materials.raw", materialsFile, materialsSize);
-    render->numInstances = instancesSize / sizeof(Instance);
-    render->numClusters = clustersSize / sizeof(Cluster);
+    if (!OpenSceneFile(SCENE_FILE_NAME, render->sceneFile))
+    {
+        throw std::exception();
+    }
+
+    com_ptr<IDStorageFile> sceneFile;
+    check_hresult(render->storageFactory->OpenFile(TEXT(SCENE_FILE_NAME), IID_PPV_ARGS(sceneFile.put())));
+
+    const SceneSection& instancesSection = GetSceneSection(render->sceneFile, SceneSectionType::Instances);
+    const SceneSection& meshesSection = GetSceneSection(render->sceneFile, SceneSectionType::Meshes);
+    const SceneSection& clustersSection = GetSceneSection(render->sceneFile, SceneSectionType::Clusters);
+    const SceneSection& clusterLodsSection = GetSceneSection(render->sceneFile, SceneSectionType::ClusterLods);
+    const SceneSection& materialsSection = GetSceneSection(render->sceneFile, SceneSectionType::Materials);
+    const SceneSection* pagesSection = render->sceneFile.FindSection(SceneSectionType::Pages);
+    const SceneSection* pageDataSection = render->sceneFile.FindSection(SceneSectionType::PageData);
+    const SceneSection* vertexIndicesSection = render->sceneFile.FindSection(SceneSectionType::VertexIndices);
+
+    // Scenes cooked with -pages only have their geometry in the pages, those always stream
+    bool hasPages = pagesSection && pageDataSection;
+    bool hasStreams = render->sceneFile.FindSection(SceneSectionType::Positions) != nullptr;
+    render->pageStreamingActive = hasPages && (render->pageStreaming || !hasStreams);
+    if (render->pageStreaming && !hasPages)
+    {
+        Log("%s has no cluster pages, loading all of the geometry. Cook it with -pages to stream it\n", SCENE_FILE_NAME);
+    }
+    else if (!render->pageStreaming && render->pageStreamingActive)
+    {
+        Log("%s only has its geometry in cluster pages, streaming it\n", SCENE_FILE_NAME);
+    }
+
+    // The whole scene streams, only loaded without streaming
+    const SceneSection noSection = {};
+    const SceneSection& positionsSection = render->pageStreamingActive ? noSection : GetSceneSection(render->sceneFile, SceneSectionType::Positions);
+    const SceneSection& normalsSection = render->pageStreamingActive ? noSection : GetSceneSection(render->sceneFile, SceneSectionType::Normals);
+    const SceneSection& tangentsSection = render->pageStreamingActive ? noSection : GetSceneSection(render->sceneFile, SceneSectionType::Tangents);
+    const SceneSection& texcoordsSection = render->pageStreamingActive ? noSection : GetSceneSection(render->sceneFile, SceneSectionType::Texcoords);
+    const SceneSection& indicesSection = render->pageStreamingActive ? noSection : GetSceneSection(render->sceneFile, SceneSectionType::Indices);
+    uint32_t vertexFormat = render->pageStreamingActive ? pageDataSection->format : positionsSection.format;
+
+    render->numInstances = (UINT32)instancesSection.count;
+    render->numClusters = (UINT32)clustersSection.count;
     render->maxNumClusters = MAX_VISIBLE_CLUSTERS; // TODO: max visible and max existing should be different
+    render->quantizedVertices = vertexFormat == VERTEX_FORMAT_QUANTIZED;
+    render->sharedVertices = vertexIndicesSection != nullptr;
 
-    UINT32 numVertices = positionsSize / sizeof(float3);
-    UINT32 numIndices = indicesSize / sizeof(UINT);
-    UINT32 numMaterials = materialsSize / sizeof(Material);
-    UINT32 numMeshes = meshesSize / sizeof(Mesh);
+    // The mesh shader outputs are sized for the cluster limits, a scene cooked with other limits needs the shaders compiled again
+    MeshletConfig meshletConfig = g_defaultMeshletConfig;
+    if (render->sceneFile.FindSection(SceneSectionType::MeshletConfig))
+    {
+        size_t configCount = 0;
+        const MeshletConfig* sceneConfig = render->sceneFile.GetSectionView<MeshletConfig>(SceneSectionType::MeshletConfig, configCount);
+        assert(sceneConfig && configCount == 1);
+        meshletConfig = *sceneConfig;
+    }
+    if (meshletConfig.maxVertices != render->meshletConfig.maxVertices || meshletConfig.maxTriangles != render->meshletConfig.maxTriangles)
+    {
+        Log("%s was cooked with %ux%u clusters, compiling the shaders for them\n", SCENE_FILE_NAME, meshletConfig.maxVertices, meshletConfig.maxTriangles);
+        render->meshletConfig = meshletConfig;
+        render->compileShaders = true;
+    }
+
+    UINT32 numVertices = (UINT32)positionsSection.count;
+    UINT32 numTriangles = (UINT32)indicesSection.count;
+    UINT32 numMaterials = (UINT32)materialsSection.count;
+    UINT32 numMeshes = (UINT32)meshesSection.count;
+
+    assert(instancesSection.stride == sizeof(Instance));
+    assert(meshesSection.stride == sizeof(Mesh));
+    assert(clustersSection.stride == sizeof(Cluster));
+    assert(clusterLodsSection.stride == sizeof(ClusterLod));
+    assert(materialsSection.stride == sizeof(Material));
+    assert(render->pageStreamingActive || positionsSection.stride == (render->quantizedVertices ? sizeof(QuantizedPosition) : sizeof(float3)));
+    assert(render->pageStreamingActive || indicesSection.stride == sizeof(UINT)); // Packed triangles
+    assert(!render->sharedVertices || (vertexIndicesSection->stride == sizeof(UINT) && vertexIndicesSection->count <= MAX_VERTICES));
+    assert(!render->sharedVertices || (!render->quantizedVertices && !render->pageStreamingActive)); // The generator never writes those together
 
     assert(render->numInstances <= MAX_VISIBLE_INSTANCES);
-    assert(render->numClusters <= MAX_VISIBLE_CLUSTERS);
-    assert(numVertices <= MAX_VERTICES); // Assumes all vertex data has the same count
-    assert(numIndices <= MAX_INDICES);
+    assert(render->numClusters <= MAX_VISIBLE_CLUSTERS); // Visible clusters are packed in 16 bits, streaming or not
+    assert(clusterLodsSection.count == render->numClusters);
+    assert(numVertices <= MAX_VERTICES || render->pageStreamingActive);
+    assert(normalsSection.count == numVertices && tangentsSection.count == numVertices && texcoordsSection.count == numVertices);
+    assert(numTriangles <= MAX_TRIANGLES || render->pageStreamingActive);
     assert(numMaterials <= MAX_MATERIALS);
     assert(numMeshes <= MAX_MESHES);
 
+    size_t count = 0;
+    render->instancesCpu = render->sceneFile.GetSectionView<Instance>(SceneSectionType::Instances, count);
+    render->meshesCpu = render->sceneFile.GetSectionView<Mesh>(SceneSectionType::Meshes, count);
+    render->clustersCpu = render->sceneFile.GetSectionView<Cluster>(SceneSectionType::Clusters, count);
+    render->clusterLodsCpu = render->sceneFile.GetSectionView<ClusterLod>(SceneSectionType::ClusterLods, count); // Only used by the CPU LOD cut for now
+    if (!render->instancesCpu || !render->meshesCpu || !render->clustersCpu || !render->clusterLodsCpu)
+    {
+        throw std::exception();
+    }
+
+#ifdef _DEBUG
+    // Hashing touches every page, so only check the CPU side sections in debug builds
+    if (!VerifySceneSection(render->sceneFile, instancesSection) || !VerifySceneSection(render->sceneFile, meshesSection) ||
+        !VerifySceneSection(render->sceneFile, clustersSection) || !VerifySceneSection(render->sceneFile, clusterLodsSection))
+    {
+        __debugbreak();
+    }
+#endif
+
     /*
-    * Load data using DirectStorage
+    * Load the GPU side sections using DirectStorage
     */
     {
-        render->instancesCpu = (Instance*)malloc(instancesSize);
-        render->meshesCpu = (Mesh*)malloc(meshesSize);
-        render->clustersCpu = (Cluster*)malloc(clustersSize);
-
-        LoadFileToGPU(render, instancesFile, render->instancesBuffer.resource.get(), instancesSize);
-        LoadFileToCPU(render, instancesFile, render->instancesCpu, instancesSize);
-        LoadFileToGPU(render, meshesFile, render->meshesBuffer.resource.get(), meshesSize);
-        LoadFileToCPU(render, meshesFile, render->meshesCpu, meshesSize);
-        LoadFileToGPU(render, clustersFile, render->clustersBuffer.resource.get(), clustersSize);
-        LoadFileToCPU(render, clustersFile, render->clustersCpu, clustersSize);
-        LoadFileToGPU(render, positionsFile, render->positionsBuffer.resource.get(), positionsSize);
-        LoadFileToGPU(render, normalsFile, render->normalsBuffer.resource.get(), normalsSize);
-        LoadFileToGPU(render, tangentsFile, render->tangentsBuffer.resource.get(), tangentsSize);
-        LoadFileToGPU(render, texcoordsFile, render->texcoordsBuffer.resource.get(), texcoordsSize);
-        LoadFileToGPU(render, indicesFile, render->indexDataBuffer.resource.get(), indicesSize);
-        LoadFileToGPU(render, materialsFile, render->materialsBuffer.resource.get(), materialsSize);
+        LoadSectionToGPU(render, sceneFile, instancesSection, render->instancesBuffer.resource.get());
+        LoadSectionToGPU(render, sceneFile, meshesSection, render->meshesBuffer.resource.get());
+        LoadSectionToGPU(render, sceneFile, clustersSection, render->clustersBuffer.resource.get());
+        if (!render->pageStreamingActive)
+        {
+            LoadSectionToGPU(render, sceneFile, positionsSection, render->positionsBuffer.resource.get());
+            LoadSectionToGPU(render, sceneFile, normalsSection, render->normalsBuffer.resource.get());
+            LoadSectionToGPU(render, sceneFile, tangentsSection, render->tangentsBuffer.resource.get());
+            LoadSectionToGPU(render, sceneFile, texcoordsSection, render->texcoordsBuffer.resource.get());
+            LoadSectionToGPU(render, sceneFile, indicesSection, render->indexDataBuffer.resource.get());
+            if (render->sharedVertices)
+                LoadSectionToGPU(render, sceneFile, *vertexIndicesSection, render->vertexIndexBuffer.resource.get());
+        }
+        LoadSectionToGPU(render, sceneFile, materialsSection, render->materialsBuffer.resource.get());
 
         // Issue a fence and wait for it
         {
+            render->decodedBytes = 0;
+            render->decodedCompressedBytes = 0;
+            render->decodeMs = 0.0;
+
             WaitStorageIdle(render);
 
             DSTORAGE_ERROR_RECORD errorRecord{};
@@ -1477,14 +1712,66 @@ static void ReloadScene(Render* render)
             {
                 __debugbreak();
             }
+
+            if (render->decodedBytes > 0)
+            {
+                Log("Decoded %.1f MB of compressed streams (%.2fx) at %.2f GB/s per core\n",
+                    render->decodedBytes / (1024.0 * 1024.0), double(render->decodedBytes) / render->decodedCompressedBytes,
+                    render->decodedBytes / (render->decodeMs / 1000.0) / 1e9);
+            }
         }
     }
 
+    /*
+    * With streaming the geometry comes in page by page as it gets visible, starting from an empty pool
+    */
+    if (render->pageStreamingActive)
+    {
+        render->pagesCpu = render->sceneFile.GetSectionView<ClusterPage>(SceneSectionType::Pages, count);
+        render->numPages = (UINT)count;
+        render->pageDataOffset = pageDataSection->offset;
+        render->pageFile = sceneFile;
+        GetPageStreamStrides(vertexFormat, render->pageStreamStrides);
+        assert(render->pagesCpu && render->numPages <= MAX_PAGES);
+
+        // Frames in flight may still draw from a slot, a page is only evicted once none of them asked for it
+        render->pageStreamer.Initialize(render->pagesCpu, render->numPages, PAGE_POOL_SLOTS, PAGE_LOADS_PER_FRAME, NUM_QUEUED_FRAMES);
+        std::fill(render->pageTableCpu, render->pageTableCpu + render->numPages, PAGE_NOT_RESIDENT);
+        render->pageStreamingStats = ClusterStreamingStats();
+    }
+
     render->rebuildScene = true;
 }
 
 static void RebuildScene(Render* render)
 {
+    // The BLAS are built from the whole scene streams, those are not loaded when streaming.
+    // With a shared vertex pool the positions of a cluster are not one range of the vertex buffer, which the BLAS builds need.
+    if (render->pageStreamingActive || render->sharedVertices)
+    {
+        return;
+    }
+
+    // DXR has no 8 bit index format, the BLAS builds read the triangles widened to 16 bits from an upload buffer.
+    // The shaders keep using the packed ones in the index buffer.
+    std::vector<UINT> triangles;
+    if (!ReadSceneSection(render->sceneFile, SceneSectionType::Indices, triangles))
+    {
+        throw std::exception();
+    }
+
+    uint16_t* blasIndices;
+    render->blasIndices.resource->Map(0, nullptr, reinterpret_cast<void**>(&blasIndices));
+    for (size_t t = 0; t < triangles.size(); ++t)
+    {
+        UINT tri[3];
+        UnpackTriangle(triangles[t], tri);
+        blasIndices[t * 3 + 0] = (uint16_t)tri[0];
+        blasIndices[t * 3 + 1] = (uint16_t)tri[1];
+        blasIndices[t * 3 + 2] = (uint16_t)tri[2];
+    }
+    render->blasIndices.resource->Unmap(0, nullptr);
+
     std::vector<D3D12_GPU_VIRTUAL_ADDRESS> blasAddrs;
 
     D3D12_GPU_VIRTUAL_ADDRESS scratchStart = render->scratch.addressRange.StartAddress;
@@ -1492,6 +1779,7 @@ static void RebuildScene(Render* render)
     D3D12_GPU_VIRTUAL_ADDRESS scratchCurr = scratchStart;
 
     D3D12_GPU_VIRTUAL_ADDRESS blasAddr = render->blasPool.addressRange.StartAddress;
+    UINT64 vertexStride = render->quantizedVertices ? sizeof(QuantizedPosition) : sizeof(float3);
     for (uint ic = 0; ic < render->numClusters; ++ic)
     {
         const Cluster& cluster = render->clustersCpu[ic];
@@ -1501,14 +1789,14 @@ static void RebuildScene(Render* render)
             .Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE,
             .Triangles = {
                 .Transform3x4 = 0,
-                .IndexFormat = DXGI_FORMAT_R32_UINT,
-                .VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT,
+                .IndexFormat = DXGI_FORMAT_R16_UINT,
+                .VertexFormat = render->quantizedVertices ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT,
                 .IndexCount = cluster.PrimitiveCount * 3,
                 .VertexCount = cluster.VertexCount,
-                .IndexBuffer = render->indexDataBuffer.resource->GetGPUVirtualAddress() + cluster.PrimitiveStart * 3 * sizeof(UINT),
+                .IndexBuffer = render->blasIndices.resource->GetGPUVirtualAddress() + cluster.PrimitiveStart * 3 * sizeof(uint16_t),
                 .VertexBuffer = {
-                    .StartAddress = render->positionsBuffer.resource->GetGPUVirtualAddress() + cluster.VertexStart * sizeof(float3),
-                    .StrideInBytes = sizeof(float3),
+                    .StartAddress = render->positionsBuffer.resource->GetGPUVirtualAddress() + cluster.VertexStart * vertexStride,
+                    .StrideInBytes = vertexStride,
                 }
             }
         };
@@ -1570,11 +1858,19 @@ static void RebuildScene(Render* render)
 
             for (UINT32 ic = mesh.ClusterStart; ic < mesh.ClusterStart + mesh.ClusterCount; ++ic)
             {
+                float4x4 modelMatrix = instance.ModelMatrix;
+                if (render->quantizedVertices)
+                {
+                    // Quantized BLAS positions are unorm in the cluster box, fold the dequantization into the instance transform
+                    const CenterExtentsAABB& box = render->clustersCpu[ic].Box;
+                    modelMatrix = make_float4x4_scale(box.Extents * 2.0f) * make_float4x4_translation(box.Center - box.Extents) * modelMatrix;
+                }
+
                 D3D12_RAYTRACING_INSTANCE_DESC instanceDesc = {
                     .Transform = {
-                        { instance.ModelMatrix.m11, instance.ModelMatrix.m21, instance.ModelMatrix.m31, instance.ModelMatrix.m41 },
-                        { instance.ModelMatrix.m12, instance.ModelMatrix.m22, instance.ModelMatrix.m32, instance.ModelMatrix.m42 },
-                        { instance.ModelMatrix.m13, instance.ModelMatrix.m23, instance.ModelMatrix.m33, instance.ModelMatrix.m43 },
+                        { modelMatrix.m11, modelMatrix.m21, modelMatrix.m31, modelMatrix.m41 },
+                        { modelMatrix.m12, modelMatrix.m22, modelMatrix.m32, modelMatrix.m42 },
+                        { modelMatrix.m13, modelMatrix.m23, modelMatrix.m33, modelMatrix.m43 },
                     },
                     .InstanceID = globalClusterIndex,
                     .InstanceMask = 0xff,
@@ -1608,63 +1904,6 @@ static void RebuildScene(Render* render)
     }
 }
 
-void ExtractPlanesD3D(plane* planes, const float4x4& comboMatrix, bool normalizePlanes)
-{
-    // Left clipping plane
-    planes[0].normal.x = comboMatrix.m14 + comboMatrix.m11;
-    planes[0].normal.y = comboMatrix.m24 + comboMatrix.m21;
-    planes[0].normal.z = comboMatrix.m34 + comboMatrix.m31;
-    planes[0].d        = comboMatrix.m44 + comboMatrix.m41;
-
-    // Right clipping plane
-    planes[1].normal.x = comboMatrix.m14 - comboMatrix.m11;
-    planes[1].normal.y = comboMatrix.m24 - comboMatrix.m21;
-    planes[1].normal.z = comboMatrix.m34 - comboMatrix.m31;
-    planes[1].d        = comboMatrix.m44 - comboMatrix.m41;
-
-    // Top clipping plane
-    planes[2].normal.x = comboMatrix.m14 - comboMatrix.m12;
-    planes[2].normal.y = comboMatrix.m24 - comboMatrix.m22;
-    planes[2].normal.z = comboMatrix.m34 - comboMatrix.m32;
-    planes[2].d        = comboMatrix.m44 - comboMatrix.m42;
-
-    // Bottom clipping plane
-    planes[3].normal.x = comboMatrix.m14 + comboMatrix.m12;
-    planes[3].normal.y = comboMatrix.m24 + comboMatrix.m22;
-    planes[3].normal.z = comboMatrix.m34 + comboMatrix.m32;
-    planes[3].d        = comboMatrix.m44 + comboMatrix.m42;
-
-    // Near clipping plane
-    planes[4].normal.x = comboMatrix.m13;
-    planes[4].normal.y = comboMatrix.m23;
-    planes[4].normal.z = comboMatrix.m33;
-    planes[4].d        = comboMatrix.m43;
-
-    // Far clipping plane
-    planes[5].normal.x = comboMatrix.m14 - comboMatrix.m13;
-    planes[5].normal.y = comboMatrix.m24 - comboMatrix.m23;
-    planes[5].normal.z = comboMatrix.m34 - comboMatrix.m33;
-    planes[5].d        = comboMatrix.m44 - comboMatrix.m43;
-
-    // Normalize the plane equations, if requested
-    if (normalizePlanes)
-    {
-        planes[0] = normalize(planes[0]);
-        planes[1] = normalize(planes[1]);
-        planes[2] = normalize(planes[2]);
-        planes[3] = normalize(planes[3]);
-        planes[4] = normalize(planes[4]);
-        planes[5] = normalize(planes[5]);
-    }
-}
-
-bool IsBoxOutsidePlane(CenterExtentsAABB aabb, plane p)
-{
-	float d = dot(p.normal, aabb.Center);
-	float r = dot(abs(p.normal), aabb.Extents);
-    return d + r < -p.d;
-}
-
 bool IsCulled(CenterExtentsAABB aabb, Camera& camera)
 {
 	bool t0 = IsBoxOutsidePlane(aabb, plane(camera.FrustumPlanes[0]));
@@ -1677,6 +1916,55 @@ bool IsCulled(CenterExtentsAABB aabb, Camera& camera)
 	return t0 | t1 | t2 | t3 | t4 | t5;
 }
 
+// Requests the pages of the clusters the CPU frustum and cone tests let through, the GPU draws the same default level clusters.
+// Missing pages are loaded into the pool before the frame is recorded, the GPU culling skips clusters that didn't make it in.
+static void UpdatePageStreaming(Render* render, Camera& cullCam)
+{
+    render->requestedPages.clear();
+    for (UINT ii = 0; ii < render->numInstances; ++ii)
+    {
+        const Instance& instance = render->instancesCpu[ii];
+        if (IsCulled(instance.Box, cullCam))
+            continue;
+
+        const Mesh& mesh = render->meshesCpu[instance.MeshIndex];
+        float coneAxisScale = render->coneCulling ? GetConeAxisScale(instance.ModelMatrix) : 0.0f;
+        render->clusterVisibility.resize(mesh.ClusterCount);
+        CullTransformedAABBs(&render->clustersCpu[mesh.ClusterStart].Box, sizeof(Cluster), mesh.ClusterCount, instance.ModelMatrix,
+            cullCam.FrustumPlanes, render->clusterVisibility.data());
+        for (UINT ic = mesh.ClusterStart; ic < mesh.ClusterStart + mesh.ClusterCount; ++ic)
+        {
+            const Cluster& cluster = render->clustersCpu[ic];
+            if (!render->clusterVisibility[ic - mesh.ClusterStart])
+                continue;
+            if (IsClusterBackfacing(cluster, instance.ModelMatrix, coneAxisScale, float3(cullCam.Position.x, cullCam.Position.y, cullCam.Position.z)))
+                continue;
+            render->requestedPages.push_back(cluster.Page);
+        }
+    }
+
+    ClusterStreamingStats stats;
+    render->pageStreamer.Update(render->requestedPages.data(), render->requestedPages.size(), [render](uint32_t page, uint32_t slot)
+    {
+        LoadPageToGPU(render, render->pagesCpu[page], slot);
+    }, stats);
+
+    if (stats.loads > 0)
+    {
+        WaitStorageIdle(render);
+
+        DSTORAGE_ERROR_RECORD errorRecord{};
+        render->storageQueue->RetrieveErrorRecord(&errorRecord);
+        if (FAILED(errorRecord.FirstFailure.HResult))
+        {
+            __debugbreak();
+        }
+    }
+
+    memcpy(render->pageTableCpu, render->pageStreamer.pageTable.data(), render->numPages * sizeof(UINT));
+    render->pageStreamingStats = stats;
+}
+
 void Draw(Render* render)
 {
     if (render->recreateResources)
@@ -1788,6 +2076,7 @@ void Draw(Render* render)
         invert(render->cullingCamera.projMat, &invProj);
         float4x4 invView;
         invert(render->cullingCamera.viewMat, &invView);
+        float3 position = float3(invView.m41, invView.m42, invView.m43);
         invView = float4x4_clear_non3x3(transpose(invView));
 
         render->constantBufferData.CullingCamera.ViewMatrix = render->cullingCamera.viewMat;
@@ -1795,7 +2084,8 @@ void Draw(Render* render)
         render->constantBufferData.CullingCamera.InverseTransposeViewMatrix = invView;
         render->constantBufferData.CullingCamera.InverseProjectionMatrix = invProj;
         render->constantBufferData.CullingCamera.InverseViewProjectionMatrix = invViewProj;
-        ExtractPlanesD3D((plane*)render->constantBufferData.CullingCamera.FrustumPlanes, viewProj, true);
+        render->constantBufferData.CullingCamera.Position = float4(position, 1.0f);
+        ExtractFrustumPlanes(&viewProj, 1, render->constantBufferData.CullingCamera.FrustumPlanes);
 
         cullCam = render->constantBufferData.CullingCamera;
     }
@@ -1808,6 +2098,7 @@ void Draw(Render* render)
         invert(render->drawingCamera.projMat, &invProj);
         float4x4 invView;
         invert(render->drawingCamera.viewMat, &invView);
+        float3 position = float3(invView.m41, invView.m42, invView.m43);
         invView = float4x4_clear_non3x3(transpose(invView));
 
         render->constantBufferData.DrawingCamera.ViewMatrix = render->drawingCamera.viewMat;
@@ -1815,7 +2106,25 @@ void Draw(Render* render)
         render->constantBufferData.DrawingCamera.InverseTransposeViewMatrix = invView;
         render->constantBufferData.DrawingCamera.InverseProjectionMatrix = invProj;
         render->constantBufferData.DrawingCamera.InverseViewProjectionMatrix = invViewProj;
-        ExtractPlanesD3D((plane*)render->constantBufferData.DrawingCamera.FrustumPlanes, viewProj, true);
+        render->constantBufferData.DrawingCamera.Position = float4(position, 1.0f);
+        ExtractFrustumPlanes(&viewProj, 1, render->constantBufferData.DrawingCamera.FrustumPlanes);
+    }
+
+    // CPU LOD cut, only reported for now, the GPU still draws the default level
+    if (render->cpuLodCut)
+    {
+        LodCutScene scene;
+        scene.instances = render->instancesCpu;
+        scene.numInstances = render->numInstances;
+        scene.meshes = render->meshesCpu;
+        scene.clusters = render->clustersCpu;
+        scene.clusterLods = render->clusterLodsCpu;
+        SelectLodCut(scene, MakeLodCutParams(render->drawingCamera.viewMat, render->drawingCamera.projMat, (float)render->height, render->lodErrorThreshold), render->lodCut);
+    }
+
+    if (render->pageStreamingActive)
+    {
+        UpdatePageStreaming(render, cullCam);
     }
 
     render->constantBufferData.Counts.x = render->numInstances;
@@ -1823,6 +2132,10 @@ void Draw(Render* render)
     render->constantBufferData.Counts.z = 0;
     render->constantBufferData.Counts.w = 0;
     render->constantBufferData.DebugMode = render->displayMode;
+    render->constantBufferData.VertexFormat = render->quantizedVertices ? VERTEX_FORMAT_QUANTIZED : VERTEX_FORMAT_FLOAT;
+    render->constantBufferData.PageStreaming = render->pageStreamingActive ? 1 : 0;
+    render->constantBufferData.ConeCulling = render->coneCulling ? 1 : 0;
+    render->constantBufferData.SharedVertices = render->sharedVertices ? 1 : 0;
     memcpy(render->cbvDataBegin + sizeof(Constants) * render->frameIndex, &render->constantBufferData, sizeof(render->constantBufferData));
 
     // Debug visualization
@@ -1838,7 +2151,7 @@ void Draw(Render* render)
 
         for (uint i = 0; i < render->numInstances; ++i)
         {
-            Instance* instance = render->instancesCpu + i;
+            const Instance* instance = render->instancesCpu + i;
 
             if (IsCulled(instance->Box, cullCam))
                 continue;
@@ -1848,16 +2161,20 @@ void Draw(Render* render)
 
             if (render->visualizeClusters)
             {
-                Mesh* mesh = render->meshesCpu + instance->MeshIndex;
+                const Mesh* mesh = render->meshesCpu + instance->MeshIndex;
+                float coneAxisScale = render->coneCulling ? GetConeAxisScale(instance->ModelMatrix) : 0.0f;
                 for (uint c = 0; c < mesh->ClusterCount; ++c)
                 {
-                    Cluster* cluster = render->clustersCpu + mesh->ClusterStart + c;
+                    const Cluster* cluster = render->clustersCpu + mesh->ClusterStart + c;
 
                     CenterExtentsAABB box = TransformAABB(cluster->Box, instance->ModelMatrix);
 
 					if (IsCulled(box, cullCam))
 						continue;
 
+					if (IsClusterBackfacing(*cluster, instance->ModelMatrix, coneAxisScale, float3(cullCam.Position.x, cullCam.Position.y, cullCam.Position.z)))
+						continue;
+
                     wireContainer->AddAABB(box);
                 }
             }
@@ -2015,10 +2332,34 @@ void Draw(Render* render)
     ImGui::Combo("Display Mode", &render->displayMode, items, IM_ARRAYSIZE(items));
     ImGui::Checkbox("Fast Move", &render->fastMove);
     ImGui::Checkbox("Locked Culling Camera", &render->lockedCullingCamera);
+    ImGui::Checkbox("Cone Culling", &render->coneCulling);
     ImGui::Checkbox("Vizualize Instances", &render->visualizeInstances);
     ImGui::Checkbox("Vizualize Clusters", &render->visualizeClusters);
 
-    ImGui::Checkbox("Ray Trace Visibility", &render->traceVisibility);
+    if (render->pageStreamingActive)
+    {
+        const ClusterStreamingStats& stats = render->pageStreamingStats;
+        render->traceVisibility = false; // No BLAS without the whole scene streams
+        ImGui::Text("Pages: %u of %u resident (%u slots)", render->pageStreamer.GetResidentCount(), render->numPages, PAGE_POOL_SLOTS);
+        ImGui::Text("Page requests: %llu, %.1f%% hits, %llu loads (%.2f MB), %llu evictions, %llu deferred",
+            stats.requests, stats.requests ? 100.0 * stats.hits / stats.requests : 0.0, stats.loads, stats.bytesStreamed / (1024.0 * 1024.0),
+            stats.evictions, stats.deferred);
+    }
+    else if (render->sharedVertices)
+    {
+        render->traceVisibility = false; // No BLAS for a shared vertex pool
+    }
+    else
+    {
+        ImGui::Checkbox("Ray Trace Visibility", &render->traceVisibility);
+    }
+
+    ImGui::Checkbox("CPU LOD Cut", &render->cpuLodCut);
+    if (render->cpuLodCut)
+    {
+        ImGui::SliderFloat("LOD Error (px)", &render->lodErrorThreshold, 0.1f, 16.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+        ImGui::Text("LOD Cut: %zu clusters, %u triangles, %.2f ms", render->lodCut.selectedClusters.size(), render->lodCut.triangleCount, render->lodCut.timeMs);
+    }
 
     ImGui::End();
     ImGui::Render();
@@ -2086,4 +2427,10 @@ void Draw(Render* render)
 void SetWorkGraph(Render* render, bool useWorkGraph)
 {
     render->workGraph = useWorkGraph;
+}
+
+void SetPageStreaming(Render* render, bool usePageStreaming)
+{
+    render->pageStreaming = usePageStreaming;
+    render->reloadScene = true;
 }
\ No newline at end of file
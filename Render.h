@@ -1,5 +1,6 @@
 #pragma once
 
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <windows.h>
@@ -9,6 +10,13 @@ using namespace DirectX;
 typedef UINT uint;
 typedef DirectX::XMUINT4 uint4;
 typedef DirectX::XMFLOAT3X3 float3x3;
+#else
+// Only the cooker builds here, see CMakeLists.txt
+#include "Numerics.h"
+using namespace Numerics;
+typedef unsigned int UINT;
+typedef unsigned int uint;
+#endif
 
 inline float3x3 float3x3_from_float4x4(const float4x4& m)
 {
@@ -35,7 +43,11 @@ inline float4x4 float4x4_clear_non3x3(const float4x4& m)
 }
 
 struct Render;
-#define CB_ALIGN _declspec(align(256u)) 
+#if defined(_MSC_VER)
+#define CB_ALIGN _declspec(align(256u))
+#else
+#define CB_ALIGN // Constant buffers are only uploaded by the renderer
+#endif
 #include "Common.h"
 
 inline CenterExtentsAABB MinMaxToCenterExtents(const MinMaxAABB& mm)
@@ -67,10 +79,99 @@ inline CenterExtentsAABB TransformAABB(const CenterExtentsAABB& in, const float4
 	return CenterExtentsAABB{ center, extents };
 }
 
+// Planes of a view projection matrix facing into the frustum: left, right, top, bottom, near, far
+inline void ExtractPlanesD3D(plane* planes, const float4x4& comboMatrix, bool normalizePlanes)
+{
+	// Left clipping plane
+	planes[0].normal.x = comboMatrix.m14 + comboMatrix.m11;
+	planes[0].normal.y = comboMatrix.m24 + comboMatrix.m21;
+	planes[0].normal.z = comboMatrix.m34 + comboMatrix.m31;
+	planes[0].d        = comboMatrix.m44 + comboMatrix.m41;
+
+	// Right clipping plane
+	planes[1].normal.x = comboMatrix.m14 - comboMatrix.m11;
+	planes[1].normal.y = comboMatrix.m24 - comboMatrix.m21;
+	planes[1].normal.z = comboMatrix.m34 - comboMatrix.m31;
+	planes[1].d        = comboMatrix.m44 - comboMatrix.m41;
+
+	// Top clipping plane
+	planes[2].normal.x = comboMatrix.m14 - comboMatrix.m12;
+	planes[2].normal.y = comboMatrix.m24 - comboMatrix.m22;
+	planes[2].normal.z = comboMatrix.m34 - comboMatrix.m32;
+	planes[2].d        = comboMatrix.m44 - comboMatrix.m42;
+
+	// Bottom clipping plane
+	planes[3].normal.x = comboMatrix.m14 + comboMatrix.m12;
+	planes[3].normal.y = comboMatrix.m24 + comboMatrix.m22;
+	planes[3].normal.z = comboMatrix.m34 + comboMatrix.m32;
+	planes[3].d        = comboMatrix.m44 + comboMatrix.m42;
+
+	// Near clipping plane
+	planes[4].normal.x = comboMatrix.m13;
+	planes[4].normal.y = comboMatrix.m23;
+	planes[4].normal.z = comboMatrix.m33;
+	planes[4].d        = comboMatrix.m43;
+
+	// Far clipping plane
+	planes[5].normal.x = comboMatrix.m14 - comboMatrix.m13;
+	planes[5].normal.y = comboMatrix.m24 - comboMatrix.m23;
+	planes[5].normal.z = comboMatrix.m34 - comboMatrix.m33;
+	planes[5].d        = comboMatrix.m44 - comboMatrix.m43;
+
+	// Normalize the plane equations, if requested
+	if (normalizePlanes)
+	{
+		planes[0] = normalize(planes[0]);
+		planes[1] = normalize(planes[1]);
+		planes[2] = normalize(planes[2]);
+		planes[3] = normalize(planes[3]);
+		planes[4] = normalize(planes[4]);
+		planes[5] = normalize(planes[5]);
+	}
+}
+
+inline bool IsBoxOutsidePlane(CenterExtentsAABB aabb, plane p)
+{
+	float d = dot(p.normal, aabb.Center);
+	float r = dot(abs(p.normal), aabb.Extents);
+	return d + r < -p.d;
+}
+
+// Turns a cone axis moved by the instance matrix back into a unit vector. Negative when the instance mirrors the mesh,
+// that flips the winding and with it the side the rasterizer culls. 0 when the axes are scaled differently,
+// the cone angles don't survive that and such instances skip cone culling.
+inline float GetConeAxisScale(const float4x4& mat)
+{
+	float3 x = float3(mat.m11, mat.m12, mat.m13);
+	float3 y = float3(mat.m21, mat.m22, mat.m23);
+	float3 z = float3(mat.m31, mat.m32, mat.m33);
+	float scale = length(x);
+	if (scale == 0.0f || fabsf(length(y) - scale) > 1e-3f * scale || fabsf(length(z) - scale) > 1e-3f * scale)
+		return 0.0f;
+	return (dot(cross(x, y), z) < 0.0f ? -1.0f : 1.0f) / scale;
+}
+
+// True when every triangle of the cluster faces away from the camera, the bounding sphere test of meshopt_computeMeshletBounds
+// Matches IsClusterBackfacing in ShaderCommon.hlsl
+inline bool IsClusterBackfacing(const Cluster& cluster, const float4x4& mat, float coneAxisScale, float3 cameraPosition)
+{
+	if (coneAxisScale == 0.0f)
+		return false;
+
+	float3 center = transform(float3(cluster.Sphere.x, cluster.Sphere.y, cluster.Sphere.z), mat);
+	float radius = cluster.Sphere.w / fabsf(coneAxisScale);
+	float3 axis = transform_normal(float3(cluster.Cone.x, cluster.Cone.y, cluster.Cone.z), mat) * coneAxisScale;
+	float3 toCenter = center - cameraPosition;
+	return dot(toCenter, axis) >= cluster.Cone.w * length(toCenter) + radius;
+}
+
+#if defined(_WIN32)
 Render* CreateRender(UINT width, UINT height);
 void Destroy(Render* render);
  
 void Initialize(Render* render, HWND hwnd, bool useWarp);
 void Draw(Render* render);
 
-void SetWorkGraph(Render* render, bool useWorkGraph);
\ No newline at end of file
+void SetWorkGraph(Render* render, bool useWorkGraph);
+void SetPageStreaming(Render* render, bool usePageStreaming); // Needs a scene cooked with pages, see ClusterStreaming.h
+#endif
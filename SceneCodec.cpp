@@ -0,0 +1,115 @@
+#include "SceneCodec.h"
+#include "Parallel.h"
+#include "PackedTriangles.h"
+
+#include "meshoptimizer.h"
+
+#include <cstring>
+#include <algorithm>
+
+static void EncodeStreamBlock(StreamCodec codec, const uint8_t* data, size_t elementSize, size_t elementCount, std::vector<uint8_t>& out)
+{
+	StreamBlockHeader header = { codec, (uint32_t)elementSize, (uint32_t)elementCount, 0 };
+
+	// The index codec takes 32 bit indices, packed triangles are widened for it
+	std::vector<uint32_t> indices;
+	size_t bound = 0;
+	if (codec == StreamCodec::Vertex)
+	{
+		bound = meshopt_encodeVertexBufferBound(elementCount, elementSize);
+	}
+	else
+	{
+		indices.resize(elementCount * 3);
+		for (size_t t = 0; t < elementCount; ++t)
+			UnpackTriangle(((const uint32_t*)data)[t], &indices[t * 3]);
+		bound = meshopt_encodeIndexBufferBound(elementCount * 3, PACKED_TRIANGLE_MAX_VERTICES);
+	}
+
+	out.resize(sizeof(header) + bound);
+	memcpy(out.data(), &header, sizeof(header));
+
+	size_t size = 0;
+	if (codec == StreamCodec::Vertex)
+		size = meshopt_encodeVertexBuffer(out.data() + sizeof(header), bound, data, elementCount, elementSize);
+	else
+		size = meshopt_encodeIndexBuffer(out.data() + sizeof(header), bound, indices.data(), elementCount * 3);
+
+	out.resize(sizeof(header) + size);
+}
+
+void EncodeStream(StreamCodec codec, const void* data, size_t elementSize, size_t elementCount, std::vector<StreamBlock>& blocks, std::vector<uint8_t>& blockData)
+{
+	size_t blockCount = (elementCount + STREAM_BLOCK_ELEMENTS - 1) / STREAM_BLOCK_ELEMENTS;
+
+	std::vector<std::vector<uint8_t>> encodedBlocks(blockCount);
+	ParallelFor(blockCount, [&](size_t b)
+	{
+		size_t first = b * STREAM_BLOCK_ELEMENTS;
+		size_t count = std::min<size_t>(STREAM_BLOCK_ELEMENTS, elementCount - first);
+		EncodeStreamBlock(codec, (const uint8_t*)data + first * elementSize, elementSize, count, encodedBlocks[b]);
+	});
+
+	blocks.resize(blockCount);
+	blockData.clear();
+	for (size_t b = 0; b < blockCount; ++b)
+	{
+		blocks[b].offset = blockData.size();
+		blocks[b].size = (uint32_t)encodedBlocks[b].size();
+		blocks[b].elementCount = (uint32_t)std::min<size_t>(STREAM_BLOCK_ELEMENTS, elementCount - b * STREAM_BLOCK_ELEMENTS);
+		blockData.insert(blockData.end(), encodedBlocks[b].begin(), encodedBlocks[b].end());
+	}
+}
+
+bool DecodeStreamBlock(const void* src, size_t srcSize, void* dst, size_t dstSize)
+{
+	if (srcSize < sizeof(StreamBlockHeader))
+		return false;
+
+	StreamBlockHeader header;
+	memcpy(&header, src, sizeof(header));
+	if (size_t(header.elementSize) * header.elementCount != dstSize)
+		return false;
+
+	const unsigned char* data = (const unsigned char*)src + sizeof(header);
+	size_t size = srcSize - sizeof(header);
+
+	if (header.codec == StreamCodec::Vertex)
+		return meshopt_decodeVertexBuffer(dst, header.elementCount, header.elementSize, data, size) == 0;
+	if (header.codec == StreamCodec::Index && header.elementSize == sizeof(uint32_t))
+	{
+		// Decoded to 16 bits first, dst may be write combined memory so it is only written once
+		static_assert(PACKED_TRIANGLE_MAX_VERTICES <= 65536);
+		static thread_local std::vector<uint16_t> indices;
+		indices.resize(size_t(header.elementCount) * 3);
+		if (meshopt_decodeIndexBuffer(indices.data(), indices.size(), sizeof(uint16_t), data, size) != 0)
+			return false;
+		uint32_t* triangles = (uint32_t*)dst;
+		for (size_t t = 0; t < header.elementCount; ++t)
+			triangles[t] = PackTriangle(indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2]);
+		return true;
+	}
+	return false;
+}
+
+bool DecodeStream(const StreamBlock* blocks, size_t blockCount, size_t elementSize, const void* base, size_t baseSize, void* dst, size_t dstSize)
+{
+	size_t totalSize = 0;
+	for (size_t b = 0; b < blockCount; ++b)
+		totalSize += size_t(blocks[b].elementCount) * elementSize;
+	if (totalSize != dstSize)
+		return false;
+
+	std::vector<uint8_t> failed(blockCount, 0);
+	ParallelFor(blockCount, [&](size_t b)
+	{
+		const StreamBlock& block = blocks[b];
+		size_t dstOffset = b * STREAM_BLOCK_ELEMENTS * elementSize;
+		if (block.offset + block.size > baseSize)
+			failed[b] = 1;
+		else
+			failed[b] = !DecodeStreamBlock((const uint8_t*)base + block.offset, block.size, (uint8_t*)dst + dstOffset, size_t(block.elementCount) * elementSize);
+	});
+
+	return std::find(failed.begin(), failed.end(), 1) == failed.end();
+}
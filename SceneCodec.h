@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Compressed vertex and index streams, encoded with the meshoptimizer codecs
+// A stream is split into blocks of STREAM_BLOCK_ELEMENTS elements, block b decodes to element b * STREAM_BLOCK_ELEMENTS.
+// Every block starts with its own small header so it can be decoded on its own, DirectStorage custom decompression only hands us the block bytes.
+
+#define STREAM_BLOCK_ELEMENTS 16384
+
+enum class StreamCodec : uint32_t
+{
+	None,
+	Vertex, // meshopt_encodeVertexBuffer, any element size that is a multiple of 4 up to 256
+	Index, // meshopt_encodeIndexBuffer, elements are packed triangles, see PackedTriangles.h. Triangles may come back rotated, winding is kept
+};
+
+struct StreamBlock
+{
+	uint64_t offset; // Points at the StreamBlockHeader
+	uint32_t size; // Including the StreamBlockHeader
+	uint32_t elementCount;
+};
+
+struct StreamBlockHeader
+{
+	StreamCodec codec;
+	uint32_t elementSize;
+	uint32_t elementCount;
+	uint32_t padding;
+};
+
+// Encodes elementCount elements, blocks are encoded in parallel. Block offsets are relative to the start of blockData
+void EncodeStream(StreamCodec codec, const void* data, size_t elementSize, size_t elementCount, std::vector<StreamBlock>& blocks, std::vector<uint8_t>& blockData);
+// Decodes one block, src points at its StreamBlockHeader. Returns false if the block is corrupt or dst has the wrong size
+bool DecodeStreamBlock(const void* src, size_t srcSize, void* dst, size_t dstSize);
+// Decodes all blocks in parallel, block offsets are relative to base. dst must hold elementSize * elementCount bytes
+bool DecodeStream(const StreamBlock* blocks, size_t blockCount, size_t elementSize, const void* base, size_t baseSize, void* dst, size_t dstSize);
@@ -0,0 +1,427 @@
+#include "SceneFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	ByteHasher hasher(size, seed);
+	hasher.Add(data, size);
+	return hasher.Finish();
+}
+
+// 64 bit words with a murmur style mix, fast enough to run over whole sections
+static const uint64_t HashMultiplier = 0xc6a4a7935bd1e995ull;
+
+static uint64_t MixHashWord(uint64_t h, uint64_t k)
+{
+	k *= HashMultiplier;
+	k ^= k >> 47;
+	k *= HashMultiplier;
+	h ^= k;
+	return h * HashMultiplier;
+}
+
+ByteHasher::ByteHasher(size_t size, uint64_t seed)
+	: hash(seed ^ (size * HashMultiplier))
+{
+}
+
+void ByteHasher::Add(const void* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	if (tailSize > 0)
+	{
+		size_t fill = std::min(size, sizeof(tail) - tailSize);
+		memcpy(tail + tailSize, bytes, fill);
+		tailSize += fill;
+		bytes += fill;
+		size -= fill;
+		if (tailSize < sizeof(tail))
+			return;
+
+		uint64_t k;
+		memcpy(&k, tail, 8);
+		hash = MixHashWord(hash, k);
+		tailSize = 0;
+	}
+
+	size_t words = size / 8;
+	for (size_t i = 0; i < words; ++i)
+	{
+		uint64_t k;
+		memcpy(&k, bytes + i * 8, 8);
+		hash = MixHashWord(hash, k);
+	}
+
+	tailSize = size - words * 8;
+	memcpy(tail, bytes + words * 8, tailSize);
+}
+
+uint64_t ByteHasher::Finish()
+{
+	uint64_t k = 0;
+	memcpy(&k, tail, tailSize);
+	uint64_t h = hash;
+	h ^= k;
+	h *= HashMultiplier;
+
+	h ^= h >> 47;
+	h *= HashMultiplier;
+	h ^= h >> 47;
+	return h;
+}
+
+static bool SeekFile(FILE* file, uint64_t offset)
+{
+#if defined(_WIN32)
+	return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool SpillFile::Open(const char* filename)
+{
+	Close();
+	file = fopen(filename, "w+b");
+	if (!file)
+		return false;
+	path = filename;
+	size = 0;
+	return true;
+}
+
+void SpillFile::Close()
+{
+	if (!file)
+		return;
+	fclose(file);
+	remove(path.c_str());
+	file = nullptr;
+	path.clear();
+	size = 0;
+}
+
+uint64_t SpillFile::Append(const void* data, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	uint64_t offset = size;
+	if (!file || !SeekFile(file, offset) || fwrite(data, 1, bytes, file) != bytes)
+		return ~0ull;
+	size += bytes;
+	return offset;
+}
+
+bool SpillFile::Read(uint64_t offset, void* data, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return file && offset + bytes <= size && SeekFile(file, offset) && fread(data, 1, bytes, file) == bytes;
+}
+
+bool SceneSectionStream::Open(const char* filename, size_t elementSize, StreamCodec streamCodec)
+{
+	stride = elementSize;
+	codec = streamCodec;
+	count = 0;
+	pending.clear();
+	blocks.clear();
+	failed = !spill.Open(filename);
+	return !failed;
+}
+
+void SceneSectionStream::Append(const void* data, size_t elementCount)
+{
+	count += elementCount;
+	if (codec == StreamCodec::None)
+	{
+		failed = failed || (elementCount > 0 && spill.Append(data, elementCount * stride) == ~0ull);
+		return;
+	}
+
+	// Only whole blocks are encoded until Finish, so the blocks come out the same as EncodeStream over everything
+	const size_t flushSize = SECTION_STREAM_BLOCKS * STREAM_BLOCK_ELEMENTS * stride;
+	const uint8_t* bytes = (const uint8_t*)data;
+	size_t size = elementCount * stride;
+	while (size > 0)
+	{
+		size_t take = std::min(size, flushSize - pending.size());
+		pending.insert(pending.end(), bytes, bytes + take);
+		bytes += take;
+		size -= take;
+		if (pending.size() == flushSize)
+			Finish();
+	}
+}
+
+bool SceneSectionStream::Finish()
+{
+	if (codec != StreamCodec::None && !pending.empty())
+	{
+		std::vector<StreamBlock> pendingBlocks;
+		std::vector<uint8_t> encoded;
+		EncodeStream(codec, pending.data(), stride, pending.size() / stride, pendingBlocks, encoded);
+
+		uint64_t offset = spill.Append(encoded.data(), encoded.size());
+		failed = failed || offset == ~0ull;
+		for (StreamBlock& block : pendingBlocks)
+		{
+			block.offset += offset;
+			blocks.push_back(block);
+		}
+		pending.clear();
+	}
+	return !failed;
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static uint64_t HashMetadataTables(const SceneFileHeader* header)
+{
+	const uint8_t* tables = (const uint8_t*)(header + 1);
+	size_t size = header->sectionCount * sizeof(SceneSection) + header->blockCount * sizeof(StreamBlock);
+	return HashBytes(tables, size, header->version);
+}
+
+void SceneFileWriter::AddSection(SceneSectionType type, const void* data, size_t stride, size_t count, StreamCodec codec, uint32_t format)
+{
+	SceneSection section = {};
+	section.type = type;
+	section.format = format;
+	section.stride = (uint32_t)stride;
+	section.codec = codec;
+	section.count = count;
+
+	std::vector<uint8_t> encoded;
+	if (codec == StreamCodec::None)
+	{
+		section.size = stride * count;
+	}
+	else
+	{
+		std::vector<StreamBlock> sectionBlocks;
+		EncodeStream(codec, data, stride, count, sectionBlocks, encoded);
+
+		section.size = encoded.size();
+		section.blockStart = (uint32_t)blocks.size();
+		section.blockCount = (uint32_t)sectionBlocks.size();
+		blocks.insert(blocks.end(), sectionBlocks.begin(), sectionBlocks.end());
+	}
+
+	encodedData.push_back(std::move(encoded));
+	sectionData.push_back(codec == StreamCodec::None ? data : encodedData.back().data());
+	sectionStreams.push_back(nullptr);
+	section.hash = HashBytes(sectionData.back(), section.size);
+	sections.push_back(section);
+}
+
+// Pieces streamed sections are hashed and copied in
+#define SECTION_STREAM_COPY_SIZE (1 << 20)
+
+bool SceneFileWriter::AddSection(SceneSectionType type, SceneSectionStream& stream, uint32_t format)
+{
+	if (!stream.Finish())
+		return false;
+
+	SceneSection section = {};
+	section.type = type;
+	section.format = format;
+	section.stride = (uint32_t)stream.stride;
+	section.codec = stream.codec;
+	section.count = stream.count;
+	section.size = stream.spill.size;
+	if (stream.codec != StreamCodec::None)
+	{
+		section.blockStart = (uint32_t)blocks.size();
+		section.blockCount = (uint32_t)stream.blocks.size();
+		blocks.insert(blocks.end(), stream.blocks.begin(), stream.blocks.end());
+	}
+
+	ByteHasher hasher((size_t)section.size);
+	std::vector<uint8_t> piece(SECTION_STREAM_COPY_SIZE);
+	for (uint64_t offset = 0; offset < section.size; offset += piece.size())
+	{
+		size_t size = (size_t)std::min<uint64_t>(piece.size(), section.size - offset);
+		if (!stream.spill.Read(offset, piece.data(), size))
+			return false;
+		hasher.Add(piece.data(), size);
+	}
+	section.hash = hasher.Finish();
+
+	encodedData.emplace_back();
+	sectionData.push_back(nullptr);
+	sectionStreams.push_back(&stream);
+	sections.push_back(section);
+	return true;
+}
+
+size_t SceneFileWriter::Write(const char* filename)
+{
+	SceneFileHeader header = {};
+	header.magic = SCENE_FILE_MAGIC;
+	header.version = SCENE_FILE_VERSION;
+	header.sectionCount = (uint32_t)sections.size();
+	header.blockCount = (uint32_t)blocks.size();
+	header.metadataSize = AlignUp(sizeof(SceneFileHeader) + sections.size() * sizeof(SceneSection) + blocks.size() * sizeof(StreamBlock), SCENE_FILE_ALIGNMENT);
+
+	// Lay out the sections and move the block offsets from section to file relative
+	std::vector<SceneSection> fileSections = sections;
+	std::vector<StreamBlock> fileBlocks = blocks;
+	uint64_t offset = header.metadataSize;
+	for (SceneSection& section : fileSections)
+	{
+		section.offset = offset;
+		for (uint32_t b = section.blockStart; b < section.blockStart + section.blockCount; ++b)
+			fileBlocks[b].offset += offset;
+		offset = AlignUp(offset + section.size, SCENE_FILE_ALIGNMENT);
+	}
+	header.fileSize = offset;
+
+	std::vector<uint8_t> metadata(header.metadataSize, 0);
+	memcpy(metadata.data(), &header, sizeof(header));
+	memcpy(metadata.data() + sizeof(header), fileSections.data(), fileSections.size() * sizeof(SceneSection));
+	memcpy(metadata.data() + sizeof(header) + fileSections.size() * sizeof(SceneSection), fileBlocks.data(), fileBlocks.size() * sizeof(StreamBlock));
+	((SceneFileHeader*)metadata.data())->metadataHash = HashMetadataTables((const SceneFileHeader*)metadata.data());
+
+	FILE* file = fopen(filename, "wb");
+	if (!file)
+		return 0;
+
+	bool success = fwrite(metadata.data(), 1, metadata.size(), file) == metadata.size();
+	static const uint8_t padding[SCENE_FILE_ALIGNMENT] = {};
+	for (size_t s = 0; s < fileSections.size() && success; ++s)
+	{
+		size_t size = (size_t)fileSections[s].size;
+		size_t paddingSize = AlignUp(size, SCENE_FILE_ALIGNMENT) - size;
+		if (sectionStreams[s])
+		{
+			std::vector<uint8_t> piece(SECTION_STREAM_COPY_SIZE);
+			for (size_t offset = 0; offset < size && success; offset += piece.size())
+			{
+				size_t pieceSize = std::min(piece.size(), size - offset);
+				success = sectionStreams[s]->spill.Read(offset, piece.data(), pieceSize) && fwrite(piece.data(), 1, pieceSize, file) == pieceSize;
+			}
+		}
+		else
+		{
+			success = fwrite(sectionData[s], 1, size, file) == size;
+		}
+		success = success && fwrite(padding, 1, paddingSize, file) == paddingSize;
+	}
+
+	success = fclose(file) == 0 && success;
+	return success ? (size_t)header.fileSize : 0;
+}
+
+bool ValidateSceneMetadata(const void* metadata, size_t metadataSize, uint64_t fileSize)
+{
+	const SceneFileHeader* header = (const SceneFileHeader*)metadata;
+	if (metadataSize < sizeof(SceneFileHeader) || header->magic != SCENE_FILE_MAGIC || header->version != SCENE_FILE_VERSION)
+		return false;
+	if (header->fileSize != fileSize || header->metadataSize > metadataSize)
+		return false;
+	if (sizeof(SceneFileHeader) + header->sectionCount * sizeof(SceneSection) + header->blockCount * sizeof(StreamBlock) > header->metadataSize)
+		return false;
+	if (HashMetadataTables(header) != header->metadataHash)
+		return false;
+
+	const SceneSection* sections = (const SceneSection*)(header + 1);
+	const StreamBlock* blocks = GetSceneBlocks(metadata);
+	for (uint32_t s = 0; s < header->sectionCount; ++s)
+	{
+		const SceneSection& section = sections[s];
+		if (section.offset < header->metadataSize || section.offset + section.size > fileSize)
+			return false;
+
+		if (section.codec == StreamCodec::None)
+		{
+			if (section.size != section.stride * section.count)
+				return false;
+			continue;
+		}
+
+		if (uint64_t(section.blockStart) + section.blockCount > header->blockCount)
+			return false;
+
+		uint64_t count = 0;
+		for (uint32_t b = section.blockStart; b < section.blockStart + section.blockCount; ++b)
+		{
+			if (blocks[b].offset < section.offset || blocks[b].offset + blocks[b].size > section.offset + section.size)
+				return false;
+			count += blocks[b].elementCount;
+		}
+		if (count != section.count)
+			return false;
+	}
+
+	return true;
+}
+
+const SceneSection* FindSceneSection(const void* metadata, SceneSectionType type)
+{
+	const SceneFileHeader* header = (const SceneFileHeader*)metadata;
+	const SceneSection* sections = (const SceneSection*)(header + 1);
+	for (uint32_t s = 0; s < header->sectionCount; ++s)
+	{
+		if (sections[s].type == type)
+			return &sections[s];
+	}
+	return nullptr;
+}
+
+const StreamBlock* GetSceneBlocks(const void* metadata)
+{
+	const SceneFileHeader* header = (const SceneFileHeader*)metadata;
+	return (const StreamBlock*)((const SceneSection*)(header + 1) + header->sectionCount);
+}
+
+const void* SceneFile::GetSectionView(SceneSectionType type, size_t stride, size_t& count) const
+{
+	count = 0;
+	const SceneSection* section = FindSection(type);
+	if (!section || section->codec != StreamCodec::None || section->stride != stride)
+		return nullptr;
+
+	count = (size_t)section->count;
+	return file.data + section->offset;
+}
+
+bool OpenSceneFile(const char* filename, SceneFile& file)
+{
+	if (!file.file.Open(filename))
+		return false;
+
+	if (!ValidateSceneMetadata(file.file.data, file.file.size, file.file.size))
+	{
+		file.file.Close();
+		return false;
+	}
+	return true;
+}
+
+bool VerifySceneSection(const SceneFile& file, const SceneSection& section)
+{
+	return HashBytes(file.file.data + section.offset, (size_t)section.size) == section.hash;
+}
+
+bool ReadSceneSection(const SceneFile& file, SceneSectionType type, size_t stride, std::vector<uint8_t>& out)
+{
+	const SceneSection* section = file.FindSection(type);
+	if (!section || section->stride != stride || !VerifySceneSection(file, *section))
+		return false;
+
+	out.resize(section->stride * section->count);
+	const uint8_t* data = file.file.data + section->offset;
+	if (section->codec == StreamCodec::None)
+	{
+		memcpy(out.data(), data, out.size());
+		return true;
+	}
+
+	const StreamBlock* blocks = GetSceneBlocks(file.file.data) + section->blockStart;
+	return DecodeStream(blocks, section->blockCount, section->stride, file.file.data, file.file.size, out.data(), out.size());
+}
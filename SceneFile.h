@@ -0,0 +1,196 @@
+#pragma once
+
+#include "SceneCodec.h"
+#include "MappedFile.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <mutex>
+#include <vector>
+
+// All cooked scene data in one file
+// The file starts with the metadata: a header, the section table and the block tables of the compressed sections.
+// Sections follow, each starting on SCENE_FILE_ALIGNMENT so they can be read straight into GPU buffers or mapped.
+// Block offsets of compressed sections are from the start of the file, so they can be handed to DirectStorage as is.
+
+#define SCENE_FILE_NAME "scene.bin"
+#define SCENE_FILE_MAGIC 0x4e435344 // "DSCN"
+#define SCENE_FILE_VERSION 4 // Bump when the layout of the file or of any section element changes
+#define SCENE_FILE_ALIGNMENT 4096
+
+enum class SceneSectionType : uint32_t
+{
+	Instances,
+	Meshes,
+	Clusters,
+	ClusterLods,
+	Groups,
+	Materials,
+	Positions,
+	Normals,
+	Tangents,
+	Texcoords,
+	Indices,
+	Pages, // ClusterPage table, see ClusterStreaming.h
+	PageData, // Geometry of all pages, stride 1
+	VertexIndices, // Per cluster vertex lists into the shared vertex pool, see SharedVertices.h
+	MeshletConfig, // The cluster limits the scene was cooked with, one MeshletConfig, see MeshletConfig.h
+	Count
+};
+
+struct SceneFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sectionCount;
+	uint32_t blockCount;
+	uint64_t metadataSize; // Header and tables, padded to SCENE_FILE_ALIGNMENT
+	uint64_t fileSize;
+	uint64_t metadataHash; // Of the section and block tables
+};
+
+struct SceneSection
+{
+	SceneSectionType type;
+	uint32_t format; // VERTEX_FORMAT_* for the vertex streams, 0 otherwise
+	uint32_t stride; // Size of one element once decoded
+	StreamCodec codec;
+	uint64_t count; // Elements once decoded
+	uint64_t offset; // From the start of the file
+	uint64_t size; // Stored size, compressed sections are smaller than stride * count
+	uint64_t hash; // Of the stored bytes
+	uint32_t blockStart; // Into the block table, compressed sections only
+	uint32_t blockCount;
+};
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// HashBytes of data that comes in pieces, the total size has to be known up front
+struct ByteHasher
+{
+	uint64_t hash;
+	uint8_t tail[8];
+	size_t tailSize = 0;
+
+	ByteHasher(size_t size, uint64_t seed = 0);
+	void Add(const void* data, size_t size);
+	uint64_t Finish();
+};
+
+// Temporary file of the out of core cook, deleted on Close
+// Reads and appends can come from any thread
+struct SpillFile
+{
+	FILE* file = nullptr;
+	std::string path;
+	uint64_t size = 0;
+	std::mutex mutex;
+
+	SpillFile() = default;
+	SpillFile(const SpillFile&) = delete;
+	SpillFile& operator=(const SpillFile&) = delete;
+	~SpillFile() { Close(); }
+
+	bool Open(const char* filename);
+	void Close();
+	// Returns the offset the data went to, ~0ull on failure
+	uint64_t Append(const void* data, size_t bytes);
+	bool Read(uint64_t offset, void* data, size_t bytes);
+};
+
+// Section elements appended piece by piece to a spill file, for scenes that don't fit in memory
+// Compressed sections are encoded every SECTION_STREAM_BLOCKS blocks, so only that much is ever held
+#define SECTION_STREAM_BLOCKS 16
+
+struct SceneSectionStream
+{
+	SpillFile spill;
+	size_t stride = 0;
+	StreamCodec codec = StreamCodec::None;
+	uint64_t count = 0; // Elements appended
+	std::vector<uint8_t> pending; // Elements not encoded yet
+	std::vector<StreamBlock> blocks; // Offsets are relative to the section
+	bool failed = false;
+
+	bool Open(const char* filename, size_t elementSize, StreamCodec streamCodec);
+	void Append(const void* data, size_t elementCount);
+
+	template<class T>
+	void Append(const std::vector<T>& arr)
+	{
+		assert(sizeof(T) == stride);
+		Append(arr.data(), arr.size());
+	}
+
+	// Encodes what is pending, no more appends after this
+	bool Finish();
+};
+
+// Collects the sections and writes the file in one go
+// Uncompressed sections are not copied, their data has to stay alive until Write. So do the streams of streamed sections.
+struct SceneFileWriter
+{
+	std::vector<SceneSection> sections;
+	std::vector<StreamBlock> blocks; // Offsets are relative to the section until Write
+	std::vector<const void*> sectionData;
+	std::vector<SceneSectionStream*> sectionStreams; // nullptr for sections in memory
+	std::vector<std::vector<uint8_t>> encodedData; // Compressed sections
+
+	void AddSection(SceneSectionType type, const void* data, size_t stride, size_t count, StreamCodec codec = StreamCodec::None, uint32_t format = 0);
+	// Finishes the stream and hashes what it stored, which reads the spill file once. Returns false if the stream failed
+	bool AddSection(SceneSectionType type, SceneSectionStream& stream, uint32_t format = 0);
+
+	template<class T>
+	void AddSection(SceneSectionType type, const std::vector<T>& arr, StreamCodec codec = StreamCodec::None, uint32_t format = 0)
+	{
+		AddSection(type, arr.data(), sizeof(T), arr.size(), codec, format);
+	}
+
+	// Returns the file size, 0 on failure
+	size_t Write(const char* filename);
+};
+
+// Checks the header, hash and bounds of the metadata of a file of fileSize bytes
+bool ValidateSceneMetadata(const void* metadata, size_t metadataSize, uint64_t fileSize);
+const SceneSection* FindSceneSection(const void* metadata, SceneSectionType type);
+const StreamBlock* GetSceneBlocks(const void* metadata);
+
+// Read only view of a mapped scene file, uncompressed sections are used in place
+struct SceneFile
+{
+	MappedFile file;
+
+	const SceneSection* FindSection(SceneSectionType type) const { return file.IsOpen() ? FindSceneSection(file.data, type) : nullptr; }
+
+	// Points straight into the mapping, nullptr if the section is missing, compressed or has a different stride
+	const void* GetSectionView(SceneSectionType type, size_t stride, size_t& count) const;
+
+	template<class T>
+	const T* GetSectionView(SceneSectionType type, size_t& count) const
+	{
+		return (const T*)GetSectionView(type, sizeof(T), count);
+	}
+};
+
+// Maps the file and validates its metadata, an already open file is unmapped first
+bool OpenSceneFile(const char* filename, SceneFile& file);
+// Hashes the stored bytes, this touches every page of the section
+bool VerifySceneSection(const SceneFile& file, const SceneSection& section);
+// Copies the section out, decoding it if it is compressed. Returns false if it is missing, corrupt or has a different stride
+bool ReadSceneSection(const SceneFile& file, SceneSectionType type, size_t stride, std::vector<uint8_t>& out);
+
+template<class T>
+bool ReadSceneSection(const SceneFile& file, SceneSectionType type, std::vector<T>& out)
+{
+	std::vector<uint8_t> bytes;
+	if (!ReadSceneSection(file, type, sizeof(T), bytes))
+		return false;
+
+	out.resize(bytes.size() / sizeof(T));
+	memcpy(out.data(), bytes.data(), bytes.size());
+	return true;
+}
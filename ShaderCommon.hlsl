@@ -8,6 +8,13 @@ struct Payload
 #define CB_ALIGN
 #include "Common.h"
 
+// The renderer passes the limits of the scene it loaded, see GetMeshletShaderDefines
+#ifndef MESHLET_MAX_VERTICES
+#define MESHLET_MAX_VERTICES DEFAULT_MESHLET_MAX_VERTICES
+#define MESHLET_MAX_TRIANGLES DEFAULT_MESHLET_MAX_TRIANGLES
+#define MESHLET_GROUP_SIZE 128
+#endif
+
 ConstantBuffer<Constants> constants : register(b0);
 
 StructuredBuffer<Instance> GetInstanceBuffer() { return ResourceDescriptorHeap[INSTANCE_BUFFER_SRV]; }
@@ -19,17 +26,102 @@ ByteAddressBuffer GetTangentDataBuffer() { return ResourceDescriptorHeap[TANGENT
 ByteAddressBuffer GetTexcoordDataBuffer() { return ResourceDescriptorHeap[TEXCOORD_DATA_BUFFER_SRV]; }
 ByteAddressBuffer GetIndexDataBuffer() { return ResourceDescriptorHeap[INDEX_DATA_BUFFER_SRV]; }
 StructuredBuffer<Material> GetMaterialBuffer() { return ResourceDescriptorHeap[MATERIAL_BUFFER_SRV]; }
+ByteAddressBuffer GetPageTableBuffer() { return ResourceDescriptorHeap[PAGE_TABLE_SRV]; }
+ByteAddressBuffer GetVertexIndexBuffer() { return ResourceDescriptorHeap[VERTEX_INDEX_BUFFER_SRV]; }
 
 Instance GetInstance(uint idx) { return GetInstanceBuffer()[idx]; }
 Mesh GetMesh(uint idx) { return GetMeshBuffer()[idx]; }
 Cluster GetCluster(uint idx) { return GetClusterBuffer()[idx]; }
-float3 GetPosition(uint idx) { return asfloat(GetPositionDataBuffer().Load3(idx * 12)); }
-float3 GetNormal(uint idx) { return asfloat(GetNormalDataBuffer().Load3(idx * 12)); }
-float4 GetTangent(uint idx) { return asfloat(GetTangentDataBuffer().Load4(idx * 16)); }
-float2 GetTexcoord(uint idx) { return asfloat(GetTexcoordDataBuffer().Load2(idx * 8)); }
-uint3 GetTri(uint idx) { return GetIndexDataBuffer().Load3(idx * 12); }
 Material GetMaterial(uint idx) { return GetMaterialBuffer()[idx]; }
 
+// With page streaming the geometry buffers are a pool of page slots, the page table maps a page to its slot
+uint GetPageSlot(uint page) { return GetPageTableBuffer().Load(page * 4); }
+bool IsClusterResident(Cluster cluster) { return constants.PageStreaming == 0 || GetPageSlot(cluster.Page) != PAGE_NOT_RESIDENT; }
+
+uint GetClusterVertexStart(Cluster cluster)
+{
+	if (constants.PageStreaming != 0)
+		return GetPageSlot(cluster.Page) * CLUSTER_PAGE_VERTICES + cluster.PageVertexStart;
+	return cluster.VertexStart;
+}
+
+// With a shared vertex pool the cluster has a list of pool indices instead of its own vertices, see SharedVertices.h
+uint GetVertexIndex(Cluster cluster, uint idx)
+{
+	uint v = GetClusterVertexStart(cluster) + idx;
+	if (constants.SharedVertices != 0)
+		return GetVertexIndexBuffer().Load(v * 4);
+	return v;
+}
+
+uint GetClusterPrimitiveStart(Cluster cluster)
+{
+	if (constants.PageStreaming != 0)
+		return GetPageSlot(cluster.Page) * CLUSTER_PAGE_TRIANGLES + cluster.PagePrimitiveStart;
+	return cluster.PrimitiveStart;
+}
+
+// Triangles are three 8 bit cluster local indices in one uint, matches UnpackTriangle in PackedTriangles.h
+uint3 GetTri(uint idx)
+{
+	uint packed = GetIndexDataBuffer().Load(idx * 4);
+	return uint3(packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff);
+}
+
+// Vertex fetch, the index is local to the cluster
+// VERTEX_FORMAT_QUANTIZED matches the encoding in VertexQuantization.h
+float3 OctahedralDecode(float2 p)
+{
+	float3 n = float3(p.x, p.y, 1.0f - abs(p.x) - abs(p.y));
+	float t = max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+float3 GetPosition(Cluster cluster, uint idx)
+{
+	if (constants.VertexFormat == VERTEX_FORMAT_QUANTIZED)
+	{
+		uint2 packed = GetPositionDataBuffer().Load2(GetVertexIndex(cluster, idx) * 8);
+		float3 q = float3(packed.x & 0xffff, packed.x >> 16, packed.y & 0xffff) * (1.0f / 65535.0f);
+		return cluster.Box.Center - cluster.Box.Extents + q * cluster.Box.Extents * 2.0f;
+	}
+	return asfloat(GetPositionDataBuffer().Load3(GetVertexIndex(cluster, idx) * 12));
+}
+
+float3 GetNormal(Cluster cluster, uint idx)
+{
+	if (constants.VertexFormat == VERTEX_FORMAT_QUANTIZED)
+	{
+		uint packed = GetNormalDataBuffer().Load(GetVertexIndex(cluster, idx) * 4);
+		return OctahedralDecode(float2(packed & 0xffff, packed >> 16) * (2.0f / 65535.0f) - 1.0f);
+	}
+	return asfloat(GetNormalDataBuffer().Load3(GetVertexIndex(cluster, idx) * 12));
+}
+
+float4 GetTangent(Cluster cluster, uint idx)
+{
+	if (constants.VertexFormat == VERTEX_FORMAT_QUANTIZED)
+	{
+		uint packed = GetTangentDataBuffer().Load(GetVertexIndex(cluster, idx) * 4);
+		float3 t = OctahedralDecode(float2(packed & 0x7fff, (packed >> 15) & 0x7fff) * (2.0f / 32767.0f) - 1.0f);
+		return float4(t, (packed >> 31) ? -1.0f : 1.0f);
+	}
+	return asfloat(GetTangentDataBuffer().Load4(GetVertexIndex(cluster, idx) * 16));
+}
+
+float2 GetTexcoord(Cluster cluster, uint idx)
+{
+	if (constants.VertexFormat == VERTEX_FORMAT_QUANTIZED)
+	{
+		uint packed = GetTexcoordDataBuffer().Load(GetVertexIndex(cluster, idx) * 4);
+		return f16tof32(uint2(packed & 0xffff, packed >> 16));
+	}
+	return asfloat(GetTexcoordDataBuffer().Load2(GetVertexIndex(cluster, idx) * 8));
+}
+
+
 CenterExtentsAABB TransformAABB(CenterExtentsAABB aabb, float4x4 mat)
 {
 	CenterExtentsAABB res;
@@ -64,3 +156,26 @@ bool IsCulled(CenterExtentsAABB aabb)
 
 	return t0 | t1 | t2 | t3 | t4 | t5;
 }
+
+// Same as GetConeAxisScale in Render.h
+float GetConeAxisScale(float4x4 mat)
+{
+	float3x3 m = (float3x3)mat;
+	float scale = length(m._m00_m10_m20);
+	if (scale == 0.0f || abs(length(m._m01_m11_m21) - scale) > 1e-3f * scale || abs(length(m._m02_m12_m22) - scale) > 1e-3f * scale)
+		return 0.0f;
+	return (determinant(m) < 0.0f ? -1.0f : 1.0f) / scale;
+}
+
+// Same as IsClusterBackfacing in Render.h
+bool IsClusterBackfacing(Cluster cluster, float4x4 mat, float coneAxisScale)
+{
+	if (constants.ConeCulling == 0 || coneAxisScale == 0.0f)
+		return false;
+
+	float3 center = mul(mat, float4(cluster.Sphere.xyz, 1.0f)).xyz;
+	float radius = cluster.Sphere.w / abs(coneAxisScale);
+	float3 axis = mul((float3x3)mat, cluster.Cone.xyz) * coneAxisScale;
+	float3 toCenter = center - constants.CullingCamera.Position.xyz;
+	return dot(toCenter, axis) >= cluster.Cone.w * length(toCenter) + radius;
+}
@@ -0,0 +1,84 @@
+#include "SharedVertices.h"
+#include "SceneFile.h"
+#include "HashTable.h"
+
+#include <cassert>
+#include <cstring>
+
+struct PoolVertex
+{
+	float3 position;
+	float3 normal;
+	float4 tangent;
+	float2 texcoord;
+};
+
+SharedVertexStats BuildSharedVertexPool(const std::vector<Mesh>& meshes, std::vector<Cluster>& clusters, std::vector<float3>& positions,
+	std::vector<float3>& normals, std::vector<float4>& tangents, std::vector<float2>& texcoords, std::vector<uint32_t>& vertexIndices)
+{
+	SharedVertexStats stats;
+	stats.clusterVertices = positions.size();
+
+	std::vector<float3> poolPositions, poolNormals;
+	std::vector<float4> poolTangents;
+	std::vector<float2> poolTexcoords;
+	poolPositions.reserve(positions.size());
+	poolNormals.reserve(positions.size());
+	poolTangents.reserve(positions.size());
+	poolTexcoords.reserve(positions.size());
+
+	vertexIndices.clear();
+	vertexIndices.reserve(positions.size());
+
+	// Vertex hash to pool index, vertices are only shared within a mesh so the table starts over for each
+	FlatHashMap<uint32_t> pool;
+	for (const Mesh& mesh : meshes)
+	{
+		pool.Clear();
+
+		// Pool vertices in first use order, the default level comes first so its vertices end up together
+		for (UINT c = mesh.ClusterStart; c < mesh.ClusterStart + mesh.LodClusterCount; ++c)
+		{
+			Cluster& cluster = clusters[c];
+			UINT listStart = (UINT)vertexIndices.size();
+			for (UINT v = cluster.VertexStart; v < cluster.VertexStart + cluster.VertexCount; ++v)
+			{
+				// Compared by bits, +0 and -0 or different NaNs are different vertices, which is what the cook wrote anyway
+				PoolVertex vertex = { positions[v], normals[v], tangents[v], texcoords[v] };
+				uint64_t key = HashBytes(&vertex, sizeof(vertex));
+				if (key == FlatHashMap<uint32_t>::EmptyKey)
+					key -= 1;
+
+				uint32_t* found = pool.Find(key);
+				if (found)
+				{
+					PoolVertex existing = { poolPositions[*found], poolNormals[*found], poolTangents[*found], poolTexcoords[*found] };
+					if (memcmp(&existing, &vertex, sizeof(vertex)) == 0)
+					{
+						vertexIndices.push_back(*found);
+						continue;
+					}
+					stats.hashCollisions += 1;
+				}
+
+				uint32_t index = (uint32_t)poolPositions.size();
+				if (!found)
+					pool[key] = index;
+				poolPositions.push_back(vertex.position);
+				poolNormals.push_back(vertex.normal);
+				poolTangents.push_back(vertex.tangent);
+				poolTexcoords.push_back(vertex.texcoord);
+				vertexIndices.push_back(index);
+			}
+			cluster.VertexStart = listStart;
+		}
+	}
+	assert(vertexIndices.size() == positions.size());
+
+	stats.poolVertices = poolPositions.size();
+	positions.swap(poolPositions);
+	normals.swap(poolNormals);
+	tangents.swap(poolTangents);
+	texcoords.swap(poolTexcoords);
+	return stats;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Render.h"
+
+#include <cstdint>
+#include <vector>
+
+// Shared vertex pool, written with -sharedvertices
+// Cooked clusters own their vertices, so a vertex on the border between clusters, and every vertex the LOD levels
+// keep from the level below, is stored once per cluster using it. This keeps one copy of every distinct vertex per mesh
+// instead and gives each cluster a list of indices into that pool, the VertexIndices section. Cluster::VertexStart then
+// points into the list, triangles stay local to the cluster and go through it, see GetVertexIndex in ShaderCommon.hlsl.
+// Quantized positions are relative to the cluster box and pages hold the vertices of their clusters, so neither -quantize
+// nor -pages work with a pool.
+
+struct SharedVertexStats
+{
+	size_t clusterVertices = 0; // Vertices as cooked, one per cluster using them
+	size_t poolVertices = 0;
+	size_t hashCollisions = 0; // Different vertices with the same hash, those are kept apart
+};
+
+// Replaces the vertex streams with the pools of all meshes and fills vertexIndices, in the order of the clusters
+SharedVertexStats BuildSharedVertexPool(const std::vector<Mesh>& meshes, std::vector<Cluster>& clusters, std::vector<float3>& positions,
+	std::vector<float3>& normals, std::vector<float4>& tangents, std::vector<float2>& texcoords, std::vector<uint32_t>& vertexIndices);
+
+// Vertex v of a cluster, the CPU side of GetVertexIndex. Without a pool vertexIndices is null and clusters own their vertices
+inline uint32_t GetClusterVertexIndex(const Cluster& cluster, const uint32_t* vertexIndices, uint32_t v)
+{
+	return vertexIndices ? vertexIndices[cluster.VertexStart + v] : cluster.VertexStart + v;
+}
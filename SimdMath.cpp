@@ -0,0 +1,477 @@
+#include "SimdMath.h"
+#include "Log.h"
+
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MATH_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define MATH_TARGET_AVX2
+#else
+#define MATH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define MATH_SIMD 0
+#endif
+
+/*
+ * Kernel selection
+ */
+
+const char* GetMathKernelName(MathKernel kernel)
+{
+	switch (kernel)
+	{
+	case MathKernel::Scalar: return "scalar";
+	case MathKernel::Sse2: return "sse2";
+	case MathKernel::Avx2: return "avx2";
+	default: return "best";
+	}
+}
+
+MathKernel GetMathKernel(MathKernel kernel)
+{
+	static const bool hasAvx2 = HasAvx2();
+	if (kernel == MathKernel::Best || (kernel == MathKernel::Avx2 && !hasAvx2))
+		kernel = hasAvx2 ? MathKernel::Avx2 : MathKernel::Sse2;
+	if (kernel == MathKernel::Sse2 && !MATH_SIMD)
+		kernel = MathKernel::Scalar;
+	return kernel;
+}
+
+#if MATH_SIMD
+
+/*
+ * SSE2, 4 boxes at a time
+ */
+
+// Boxes as structure of arrays, one box per lane
+struct Boxes4
+{
+	__m128 cx, cy, cz, ex, ey, ez;
+};
+
+static Boxes4 LoadBoxes4(const uint8_t* boxes, size_t stride)
+{
+	// Center and extents.x of each box, then extents.y and .z
+	__m128 r0 = _mm_loadu_ps((const float*)(boxes));
+	__m128 r1 = _mm_loadu_ps((const float*)(boxes + stride));
+	__m128 r2 = _mm_loadu_ps((const float*)(boxes + 2 * stride));
+	__m128 r3 = _mm_loadu_ps((const float*)(boxes + 3 * stride));
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	__m128 s0 = _mm_castpd_ps(_mm_load_sd((const double*)(boxes + 16)));
+	__m128 s1 = _mm_castpd_ps(_mm_load_sd((const double*)(boxes + stride + 16)));
+	__m128 s2 = _mm_castpd_ps(_mm_load_sd((const double*)(boxes + 2 * stride + 16)));
+	__m128 s3 = _mm_castpd_ps(_mm_load_sd((const double*)(boxes + 3 * stride + 16)));
+	__m128 t0 = _mm_unpacklo_ps(s0, s1);
+	__m128 t1 = _mm_unpacklo_ps(s2, s3);
+	return Boxes4{ r0, r1, r2, r3, _mm_movelh_ps(t0, t1), _mm_movehl_ps(t1, t0) };
+}
+
+static void StoreBoxes4(const Boxes4& b, CenterExtentsAABB* out)
+{
+	__m128 r0 = b.cx, r1 = b.cy, r2 = b.cz, r3 = b.ex;
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(&out[0].Center.x, r0);
+	_mm_storeu_ps(&out[1].Center.x, r1);
+	_mm_storeu_ps(&out[2].Center.x, r2);
+	_mm_storeu_ps(&out[3].Center.x, r3);
+
+	__m128 t0 = _mm_unpacklo_ps(b.ey, b.ez);
+	__m128 t1 = _mm_unpackhi_ps(b.ey, b.ez);
+	_mm_storel_pi((__m64*)&out[0].Extents.y, t0);
+	_mm_storeh_pi((__m64*)&out[1].Extents.y, t0);
+	_mm_storel_pi((__m64*)&out[2].Extents.y, t1);
+	_mm_storeh_pi((__m64*)&out[3].Extents.y, t1);
+}
+
+// The first 3 columns of the matrix and the absolute 3x3 TransformAABB moves the extents with
+struct BoxTransformValues
+{
+	float m[12]; // m11 m12 m13, m21 m22 m23, m31 m32 m33, m41 m42 m43
+	float a[9];
+};
+
+static BoxTransformValues GetBoxTransformValues(const float4x4& mat)
+{
+	const float* rows[4] = { &mat.m11, &mat.m21, &mat.m31, &mat.m41 };
+	BoxTransformValues values;
+	for (int r = 0; r < 4; ++r)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			values.m[r * 3 + c] = rows[r][c];
+			if (r < 3)
+				values.a[r * 3 + c] = fabsf(rows[r][c]);
+		}
+	}
+	return values;
+}
+
+// Plane normals, their absolute values and -d, what IsBoxOutsidePlane uses
+struct FrustumValues
+{
+	float n[6][3];
+	float absN[6][3];
+	float negD[6];
+};
+
+static FrustumValues GetFrustumValues(const float4* planes)
+{
+	FrustumValues values;
+	for (int p = 0; p < 6; ++p)
+	{
+		const float normal[3] = { planes[p].x, planes[p].y, planes[p].z };
+		for (int c = 0; c < 3; ++c)
+		{
+			values.n[p][c] = normal[c];
+			values.absN[p][c] = fabsf(normal[c]);
+		}
+		values.negD[p] = -planes[p].w;
+	}
+	return values;
+}
+
+static void StoreVisibility(int outsideMask, int width, uint8_t* visible)
+{
+	for (int lane = 0; lane < width; ++lane)
+		visible[lane] = ((outsideMask >> lane) & 1) ^ 1;
+}
+
+struct BoxTransform4
+{
+	__m128 m[12];
+	__m128 a[9];
+};
+
+static BoxTransform4 MakeBoxTransform4(const BoxTransformValues& values)
+{
+	BoxTransform4 t;
+	for (int i = 0; i < 12; ++i)
+		t.m[i] = _mm_set1_ps(values.m[i]);
+	for (int i = 0; i < 9; ++i)
+		t.a[i] = _mm_set1_ps(values.a[i]);
+	return t;
+}
+
+// Same operations in the same order as TransformAABB
+static Boxes4 TransformBoxes4(const Boxes4& b, const BoxTransform4& t)
+{
+	Boxes4 o;
+	o.cx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b.cx, t.m[0]), _mm_mul_ps(b.cy, t.m[3])), _mm_mul_ps(b.cz, t.m[6])), t.m[9]);
+	o.cy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b.cx, t.m[1]), _mm_mul_ps(b.cy, t.m[4])), _mm_mul_ps(b.cz, t.m[7])), t.m[10]);
+	o.cz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b.cx, t.m[2]), _mm_mul_ps(b.cy, t.m[5])), _mm_mul_ps(b.cz, t.m[8])), t.m[11]);
+	o.ex = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b.ex, t.a[0]), _mm_mul_ps(b.ey, t.a[3])), _mm_mul_ps(b.ez, t.a[6]));
+	o.ey = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b.ex, t.a[1]), _mm_mul_ps(b.ey, t.a[4])), _mm_mul_ps(b.ez, t.a[7]));
+	o.ez = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b.ex, t.a[2]), _mm_mul_ps(b.ey, t.a[5])), _mm_mul_ps(b.ez, t.a[8]));
+	return o;
+}
+
+struct Frustum4
+{
+	__m128 n[6][3];
+	__m128 absN[6][3];
+	__m128 negD[6];
+};
+
+static Frustum4 MakeFrustum4(const FrustumValues& values)
+{
+	Frustum4 f;
+	for (int p = 0; p < 6; ++p)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			f.n[p][c] = _mm_set1_ps(values.n[p][c]);
+			f.absN[p][c] = _mm_set1_ps(values.absN[p][c]);
+		}
+		f.negD[p] = _mm_set1_ps(values.negD[p]);
+	}
+	return f;
+}
+
+// Lane bits of the boxes outside any plane, same operations in the same order as IsBoxOutsidePlane
+static int GetOutsideMask4(const Boxes4& b, const Frustum4& f)
+{
+	__m128 outside = _mm_setzero_ps();
+	for (int p = 0; p < 6; ++p)
+	{
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(f.n[p][0], b.cx), _mm_mul_ps(f.n[p][1], b.cy)), _mm_mul_ps(f.n[p][2], b.cz));
+		__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(f.absN[p][0], b.ex), _mm_mul_ps(f.absN[p][1], b.ey)), _mm_mul_ps(f.absN[p][2], b.ez));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), f.negD[p]));
+	}
+	return _mm_movemask_ps(outside);
+}
+
+// Return how many boxes they did, the rest is left to the scalar code
+static size_t TransformAABBsSse2(const uint8_t* in, size_t inStride, size_t count, const BoxTransformValues& values, CenterExtentsAABB* out)
+{
+	BoxTransform4 transform = MakeBoxTransform4(values);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		StoreBoxes4(TransformBoxes4(LoadBoxes4(in + i * inStride, inStride), transform), out + i);
+	return i;
+}
+
+// Boxes are moved by transform first when there is one
+static size_t CullAABBsSse2(const uint8_t* boxes, size_t stride, size_t count, const BoxTransformValues* transformValues, const FrustumValues& frustumValues, uint8_t* visible)
+{
+	BoxTransform4 transform = transformValues ? MakeBoxTransform4(*transformValues) : BoxTransform4();
+	Frustum4 frustum = MakeFrustum4(frustumValues);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		Boxes4 b = LoadBoxes4(boxes + i * stride, stride);
+		if (transformValues)
+			b = TransformBoxes4(b, transform);
+		StoreVisibility(GetOutsideMask4(b, frustum), 4, visible + i);
+	}
+	return i;
+}
+
+static void ExtractFrustumPlanesSse2(const float4x4* matrices, size_t count, float4* planes)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		// Columns of the matrix, the planes are sums and differences of them
+		__m128 c1 = _mm_loadu_ps(&matrices[i].m11);
+		__m128 c2 = _mm_loadu_ps(&matrices[i].m21);
+		__m128 c3 = _mm_loadu_ps(&matrices[i].m31);
+		__m128 c4 = _mm_loadu_ps(&matrices[i].m41);
+		_MM_TRANSPOSE4_PS(c1, c2, c3, c4);
+
+		__m128 p[6] = { _mm_add_ps(c4, c1), _mm_sub_ps(c4, c1), _mm_sub_ps(c4, c2), _mm_add_ps(c4, c2), c3, _mm_sub_ps(c4, c3) };
+		for (int ip = 0; ip < 6; ++ip)
+		{
+			// x * x + y * y + z * z like the scalar dot, planes that are close to unit length stay as they are like in normalize
+			__m128 sq = _mm_mul_ps(p[ip], p[ip]);
+			__m128 lengthSq = _mm_add_ss(_mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2)));
+			if (!(fabsf(_mm_cvtss_f32(lengthSq) - 1.0f) < FLT_EPSILON))
+			{
+				__m128 scale = _mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(lengthSq));
+				p[ip] = _mm_mul_ps(p[ip], _mm_shuffle_ps(scale, scale, 0));
+			}
+			_mm_storeu_ps(&planes[i * 6 + ip].x, p[ip]);
+		}
+	}
+}
+
+/*
+ * AVX2, 8 boxes at a time
+ */
+
+struct Boxes8
+{
+	__m256 cx, cy, cz, ex, ey, ez;
+};
+
+// Box i in the low half and box i + 4 in the high half
+MATH_TARGET_AVX2 static __m256 LoadPair(const uint8_t* lo, const uint8_t* hi)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps((const float*)lo)), _mm_loadu_ps((const float*)hi), 1);
+}
+
+MATH_TARGET_AVX2 static __m256 LoadPairYZ(const uint8_t* lo, const uint8_t* hi)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_castpd_ps(_mm_load_sd((const double*)(lo + 16)))), _mm_castpd_ps(_mm_load_sd((const double*)(hi + 16))), 1);
+}
+
+// LoadBoxes4 in both halves at once, calling the SSE2 code from here would mix in non-VEX instructions
+MATH_TARGET_AVX2 static Boxes8 LoadBoxes8(const uint8_t* boxes, size_t stride)
+{
+	const uint8_t* b[8];
+	for (int k = 0; k < 8; ++k)
+		b[k] = boxes + k * stride;
+
+	__m256 r0 = LoadPair(b[0], b[4]), r1 = LoadPair(b[1], b[5]), r2 = LoadPair(b[2], b[6]), r3 = LoadPair(b[3], b[7]);
+	__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+	__m256 t1 = _mm256_unpacklo_ps(r2, r3);
+	__m256 t2 = _mm256_unpackhi_ps(r0, r1);
+	__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+
+	__m256 s0 = _mm256_unpacklo_ps(LoadPairYZ(b[0], b[4]), LoadPairYZ(b[1], b[5]));
+	__m256 s1 = _mm256_unpacklo_ps(LoadPairYZ(b[2], b[6]), LoadPairYZ(b[3], b[7]));
+	return Boxes8{ _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2)),
+		_mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2)),
+		_mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 2, 3, 2)) };
+}
+
+MATH_TARGET_AVX2 static void StoreBoxes8(const Boxes8& b, CenterExtentsAABB* out)
+{
+	__m256 t0 = _mm256_unpacklo_ps(b.cx, b.cy);
+	__m256 t1 = _mm256_unpacklo_ps(b.cz, b.ex);
+	__m256 t2 = _mm256_unpackhi_ps(b.cx, b.cy);
+	__m256 t3 = _mm256_unpackhi_ps(b.cz, b.ex);
+	__m256 r[4] = { _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2)),
+		_mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2)) };
+	__m256 u0 = _mm256_unpacklo_ps(b.ey, b.ez);
+	__m256 u1 = _mm256_unpackhi_ps(b.ey, b.ez);
+	for (int half = 0; half < 2; ++half)
+	{
+		CenterExtentsAABB* o = out + half * 4;
+		for (int k = 0; k < 4; ++k)
+			_mm_storeu_ps(&o[k].Center.x, half ? _mm256_extractf128_ps(r[k], 1) : _mm256_castps256_ps128(r[k]));
+		__m128 yz01 = half ? _mm256_extractf128_ps(u0, 1) : _mm256_castps256_ps128(u0);
+		__m128 yz23 = half ? _mm256_extractf128_ps(u1, 1) : _mm256_castps256_ps128(u1);
+		_mm_storel_pi((__m64*)&o[0].Extents.y, yz01);
+		_mm_storeh_pi((__m64*)&o[1].Extents.y, yz01);
+		_mm_storel_pi((__m64*)&o[2].Extents.y, yz23);
+		_mm_storeh_pi((__m64*)&o[3].Extents.y, yz23);
+	}
+}
+
+struct BoxTransform8
+{
+	__m256 m[12];
+	__m256 a[9];
+};
+
+MATH_TARGET_AVX2 static BoxTransform8 MakeBoxTransform8(const BoxTransformValues& values)
+{
+	BoxTransform8 t;
+	for (int i = 0; i < 12; ++i)
+		t.m[i] = _mm256_set1_ps(values.m[i]);
+	for (int i = 0; i < 9; ++i)
+		t.a[i] = _mm256_set1_ps(values.a[i]);
+	return t;
+}
+
+MATH_TARGET_AVX2 static Boxes8 TransformBoxes8(const Boxes8& b, const BoxTransform8& t)
+{
+	Boxes8 o;
+	o.cx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b.cx, t.m[0]), _mm256_mul_ps(b.cy, t.m[3])), _mm256_mul_ps(b.cz, t.m[6])), t.m[9]);
+	o.cy = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b.cx, t.m[1]), _mm256_mul_ps(b.cy, t.m[4])), _mm256_mul_ps(b.cz, t.m[7])), t.m[10]);
+	o.cz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b.cx, t.m[2]), _mm256_mul_ps(b.cy, t.m[5])), _mm256_mul_ps(b.cz, t.m[8])), t.m[11]);
+	o.ex = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b.ex, t.a[0]), _mm256_mul_ps(b.ey, t.a[3])), _mm256_mul_ps(b.ez, t.a[6]));
+	o.ey = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b.ex, t.a[1]), _mm256_mul_ps(b.ey, t.a[4])), _mm256_mul_ps(b.ez, t.a[7]));
+	o.ez = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b.ex, t.a[2]), _mm256_mul_ps(b.ey, t.a[5])), _mm256_mul_ps(b.ez, t.a[8]));
+	return o;
+}
+
+struct Frustum8
+{
+	__m256 n[6][3];
+	__m256 absN[6][3];
+	__m256 negD[6];
+};
+
+MATH_TARGET_AVX2 static Frustum8 MakeFrustum8(const FrustumValues& values)
+{
+	Frustum8 f;
+	for (int p = 0; p < 6; ++p)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			f.n[p][c] = _mm256_set1_ps(values.n[p][c]);
+			f.absN[p][c] = _mm256_set1_ps(values.absN[p][c]);
+		}
+		f.negD[p] = _mm256_set1_ps(values.negD[p]);
+	}
+	return f;
+}
+
+MATH_TARGET_AVX2 static int GetOutsideMask8(const Boxes8& b, const Frustum8& f)
+{
+	__m256 outside = _mm256_setzero_ps();
+	for (int p = 0; p < 6; ++p)
+	{
+		__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(f.n[p][0], b.cx), _mm256_mul_ps(f.n[p][1], b.cy)), _mm256_mul_ps(f.n[p][2], b.cz));
+		__m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(f.absN[p][0], b.ex), _mm256_mul_ps(f.absN[p][1], b.ey)), _mm256_mul_ps(f.absN[p][2], b.ez));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), f.negD[p], _CMP_LT_OQ));
+	}
+	return _mm256_movemask_ps(outside);
+}
+
+MATH_TARGET_AVX2 static size_t TransformAABBsAvx2(const uint8_t* in, size_t inStride, size_t count, const BoxTransformValues& values, CenterExtentsAABB* out)
+{
+	BoxTransform8 transform = MakeBoxTransform8(values);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+		StoreBoxes8(TransformBoxes8(LoadBoxes8(in + i * inStride, inStride), transform), out + i);
+	return i;
+}
+
+MATH_TARGET_AVX2 static size_t CullAABBsAvx2(const uint8_t* boxes, size_t stride, size_t count, const BoxTransformValues* transformValues, const FrustumValues& frustumValues, uint8_t* visible)
+{
+	BoxTransform8 transform = transformValues ? MakeBoxTransform8(*transformValues) : BoxTransform8();
+	Frustum8 frustum = MakeFrustum8(frustumValues);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		Boxes8 b = LoadBoxes8(boxes + i * stride, stride);
+		if (transformValues)
+			b = TransformBoxes8(b, transform);
+		StoreVisibility(GetOutsideMask8(b, frustum), 8, visible + i);
+	}
+	return i;
+}
+
+#endif // MATH_SIMD
+
+/*
+ * Public functions, the SIMD kernels do whole groups of boxes and the scalar code the rest
+ */
+
+void TransformAABBs(const CenterExtentsAABB* in, size_t inStride, size_t count, const float4x4& mat, CenterExtentsAABB* out, MathKernel kernel)
+{
+	kernel = GetMathKernel(kernel);
+	const uint8_t* bytes = (const uint8_t*)in;
+	size_t i = 0;
+#if MATH_SIMD
+	if (kernel != MathKernel::Scalar)
+	{
+		BoxTransformValues values = GetBoxTransformValues(mat);
+		i = kernel == MathKernel::Avx2 ? TransformAABBsAvx2(bytes, inStride, count, values, out) : TransformAABBsSse2(bytes, inStride, count, values, out);
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = TransformAABB(*(const CenterExtentsAABB*)(bytes + i * inStride), mat);
+}
+
+void ExtractFrustumPlanes(const float4x4* matrices, size_t count, float4* planes, MathKernel kernel)
+{
+	kernel = GetMathKernel(kernel);
+#if MATH_SIMD
+	if (kernel != MathKernel::Scalar)
+	{
+		ExtractFrustumPlanesSse2(matrices, count, planes);
+		return;
+	}
+#endif
+	for (size_t i = 0; i < count; ++i)
+		ExtractPlanesD3D((plane*)&planes[i * 6], matrices[i], true);
+}
+
+// mat is null for boxes that stay where they are
+static void CullBoxes(const CenterExtentsAABB* boxes, size_t stride, size_t count, const float4x4* mat, const float4* planes, uint8_t* visible, MathKernel kernel)
+{
+	kernel = GetMathKernel(kernel);
+	const uint8_t* bytes = (const uint8_t*)boxes;
+	size_t i = 0;
+#if MATH_SIMD
+	if (kernel != MathKernel::Scalar)
+	{
+		BoxTransformValues transformValues = mat ? GetBoxTransformValues(*mat) : BoxTransformValues();
+		FrustumValues frustumValues = GetFrustumValues(planes);
+		const BoxTransformValues* transform = mat ? &transformValues : nullptr;
+		i = kernel == MathKernel::Avx2 ? CullAABBsAvx2(bytes, stride, count, transform, frustumValues, visible) : CullAABBsSse2(bytes, stride, count, transform, frustumValues, visible);
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const CenterExtentsAABB& box = *(const CenterExtentsAABB*)(bytes + i * stride);
+		visible[i] = !IsAABBOutsideFrustum(mat ? TransformAABB(box, *mat) : box, planes);
+	}
+}
+
+void CullAABBs(const CenterExtentsAABB* boxes, size_t stride, size_t count, const float4* planes, uint8_t* visible, MathKernel kernel)
+{
+	CullBoxes(boxes, stride, count, nullptr, planes, visible, kernel);
+}
+
+void CullTransformedAABBs(const CenterExtentsAABB* boxes, size_t stride, size_t count, const float4x4& mat, const float4* planes, uint8_t* visible, MathKernel kernel)
+{
+	CullBoxes(boxes, stride, count, &mat, planes, visible, kernel);
+}
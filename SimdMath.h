@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Render.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Batched versions of the CPU culling math in Render.h, for loops over many boxes or matrices
+// They work on the layouts Common.h shares with HLSL, boxes are read with a stride so they can stay inside Cluster or
+// Instance. A lane holds one box and computes in the same order as the scalar function it replaces, without FMA, so all
+// kernels give the same results bit for bit. -benchmark simd times them against the Render.h functions.
+
+enum class MathKernel
+{
+	Scalar, // The Render.h functions in a loop
+	Sse2, // 4 boxes at a time
+	Avx2, // 8 boxes at a time
+	Best, // Fastest one the CPU has
+};
+
+const char* GetMathKernelName(MathKernel kernel);
+// Resolves Best, and falls back to a kernel the CPU has
+MathKernel GetMathKernel(MathKernel kernel);
+
+inline bool IsAABBOutsideFrustum(const CenterExtentsAABB& box, const float4* planes)
+{
+	for (int p = 0; p < 6; ++p)
+	{
+		if (IsBoxOutsidePlane(box, plane(planes[p])))
+			return true;
+	}
+	return false;
+}
+
+// out[i] = TransformAABB(box i, mat), in is read with inStride bytes between boxes and may be out
+void TransformAABBs(const CenterExtentsAABB* in, size_t inStride, size_t count, const float4x4& mat, CenterExtentsAABB* out, MathKernel kernel = MathKernel::Best);
+
+// ExtractPlanesD3D with normalized planes, 6 planes per matrix. A matrix fills 4 lanes, Avx2 runs the Sse2 kernel.
+void ExtractFrustumPlanes(const float4x4* matrices, size_t count, float4* planes, MathKernel kernel = MathKernel::Best);
+
+// visible[i] = 1 when box i is not outside any of the 6 planes, the inverse of IsCulled in Render.cpp
+void CullAABBs(const CenterExtentsAABB* boxes, size_t stride, size_t count, const float4* planes, uint8_t* visible, MathKernel kernel = MathKernel::Best);
+
+// CullAABBs of the boxes moved by mat, without writing the moved boxes out
+void CullTransformedAABBs(const CenterExtentsAABB* boxes, size_t stride, size_t count, const float4x4& mat, const float4* planes, uint8_t* visible,
+	MathKernel kernel = MathKernel::Best);
@@ -0,0 +1,116 @@
+#include "SpatialOrder.h"
+#include "meshoptimizer.h"
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+// order[new] = old
+template<class T>
+static void ApplyOrder(T* items, const std::vector<UINT>& order)
+{
+	std::vector<T> sorted(order.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		sorted[i] = items[order[i]];
+	std::copy(sorted.begin(), sorted.end(), items);
+}
+
+// Appends the items of run to order in Morton order of their box centers
+template<class T>
+static void AppendSpatialOrder(const T* items, const std::vector<UINT>& run, std::vector<UINT>& order)
+{
+	if (run.empty())
+		return;
+
+	std::vector<float3> centers(run.size());
+	for (size_t i = 0; i < run.size(); ++i)
+		centers[i] = items[run[i]].Box.Center;
+
+	std::vector<unsigned int> remap(run.size()); // remap[old] = new
+	meshopt_spatialSortRemap(remap.data(), &centers[0].x, centers.size(), sizeof(float3));
+
+	size_t base = order.size();
+	order.resize(base + run.size());
+	for (size_t i = 0; i < run.size(); ++i)
+		order[base + remap[i]] = run[i];
+}
+
+void SortInstancesSpatially(std::vector<Instance>& instances)
+{
+	// Instances of a mesh stay together so its clusters and geometry are still in cache for the next one
+	std::vector<std::vector<UINT>> meshInstances;
+	for (UINT i = 0; i < instances.size(); ++i)
+	{
+		if (meshInstances.size() <= instances[i].MeshIndex)
+			meshInstances.resize(instances[i].MeshIndex + 1);
+		meshInstances[instances[i].MeshIndex].push_back(i);
+	}
+
+	std::vector<UINT> order;
+	for (const std::vector<UINT>& run : meshInstances)
+		AppendSpatialOrder(instances.data(), run, order);
+	ApplyOrder(instances.data(), order);
+}
+
+void SortClustersSpatially(const std::vector<Mesh>& meshes, const std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters, std::vector<ClusterLod>& clusterLods)
+{
+	std::vector<UINT> order, run, levels;
+	for (const Mesh& mesh : meshes)
+	{
+		// Levels of all clusters of the mesh, relative to ClusterStart
+		levels.resize(mesh.LodClusterCount);
+		for (UINT c = 0; c < mesh.LodClusterCount; ++c)
+		{
+			const ClusterLod& clusterLod = clusterLods[mesh.ClusterStart + c];
+			levels[c] = clusterLod.Group != LOD_GROUP_NONE ? groups[clusterLod.Group].Level + 1 : 0;
+		}
+
+		// The default range first, it holds the -lod level of every primitive, then the other levels. Within each one
+		// level at a time, the levels of the primitives of a mesh are interleaved
+		order.clear();
+		UINT maxLevel = mesh.LodClusterCount ? *std::max_element(levels.begin(), levels.end()) : 0;
+		UINT rangeEnds[2] = { mesh.ClusterCount, mesh.LodClusterCount };
+		for (UINT range = 0, rangeStart = 0; range < 2; rangeStart = rangeEnds[range++])
+		{
+			for (UINT level = 0; level <= maxLevel; ++level)
+			{
+				run.clear();
+				for (UINT c = rangeStart; c < rangeEnds[range]; ++c)
+				{
+					if (levels[c] == level)
+						run.push_back(c);
+				}
+				AppendSpatialOrder(clusters.data() + mesh.ClusterStart, run, order);
+			}
+		}
+		assert(order.size() == mesh.LodClusterCount);
+
+		ApplyOrder(clusters.data() + mesh.ClusterStart, order);
+		ApplyOrder(clusterLods.data() + mesh.ClusterStart, order);
+	}
+}
+
+void GatherClusterElements(const std::vector<Cluster>& clusters, bool triangles, const void* src, size_t stride, void* dst)
+{
+	size_t offset = 0;
+	for (const Cluster& cluster : clusters)
+	{
+		size_t start = triangles ? cluster.PrimitiveStart : cluster.VertexStart;
+		size_t count = triangles ? cluster.PrimitiveCount : cluster.VertexCount;
+		memcpy((uint8_t*)dst + offset * stride, (const uint8_t*)src + start * stride, count * stride);
+		offset += count;
+	}
+}
+
+void RebaseClusterElements(std::vector<Cluster>& clusters)
+{
+	UINT vertexStart = 0;
+	UINT primitiveStart = 0;
+	for (Cluster& cluster : clusters)
+	{
+		cluster.VertexStart = vertexStart;
+		cluster.PrimitiveStart = primitiveStart;
+		vertexStart += cluster.VertexCount;
+		primitiveStart += cluster.PrimitiveCount;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Render.h"
+
+#include <vector>
+
+// Spatial ordering of cooked data along a Morton curve, meshopt_spatialSortRemap
+// Instances and clusters that are close in space end up close in memory, so culling walks memory and visibility in runs.
+// Clusters only move within their mesh and LOD level, the default level stays first so Mesh::ClusterStart/ClusterCount
+// keep their meaning. ClusterLods move with their clusters, nothing else refers to a cluster or an instance by index.
+
+// Grouped by mesh, in spatial order within a mesh
+void SortInstancesSpatially(std::vector<Instance>& instances);
+void SortClustersSpatially(const std::vector<Mesh>& meshes, const std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters, std::vector<ClusterLod>& clusterLods);
+
+// Copies the vertices (or triangles) of every cluster from src to dst in cluster order
+// Every vertex and triangle belongs to exactly one cluster, so dst is as large as src
+void GatherClusterElements(const std::vector<Cluster>& clusters, bool triangles, const void* src, size_t stride, void* dst);
+// Points VertexStart and PrimitiveStart at the gathered streams
+void RebaseClusterElements(std::vector<Cluster>& clusters);
+
+template<class T>
+void GatherClusterVertices(const std::vector<Cluster>& clusters, std::vector<T>& stream)
+{
+	std::vector<T> sorted(stream.size());
+	GatherClusterElements(clusters, false, stream.data(), sizeof(T), sorted.data());
+	stream.swap(sorted);
+}
+
+// Packed triangles, see PackedTriangles.h
+inline void GatherClusterTriangles(const std::vector<Cluster>& clusters, std::vector<uint32_t>& triangles)
+{
+	std::vector<uint32_t> sorted(triangles.size());
+	GatherClusterElements(clusters, true, triangles.data(), sizeof(uint32_t), sorted.data());
+	triangles.swap(sorted);
+}
@@ -10,14 +10,14 @@ struct VertexAttributes
     float4 Position : SV_Position;
 };
 
-[NumThreads(128, 1, 1)]
+[NumThreads(MESHLET_GROUP_SIZE, 1, 1)]
 [OutputTopology("triangle")]
 void main(
     uint gtid : SV_GroupThreadID,
     uint gid : SV_GroupID,
-    out indices uint3 tri[124],
-    out primitives PrimitiveAttributes prims[124],
-    out vertices VertexAttributes verts[64]
+    out indices uint3 tri[MESHLET_MAX_TRIANGLES],
+    out primitives PrimitiveAttributes prims[MESHLET_MAX_TRIANGLES],
+    out vertices VertexAttributes verts[MESHLET_MAX_VERTICES]
 )
 {
 	ByteAddressBuffer visibleInstances = ResourceDescriptorHeap[VISIBLE_INSTANCES_SRV];
@@ -34,13 +34,13 @@ void main(
  
 	if (gtid < cluster.PrimitiveCount)
 	{
-		tri[gtid] = GetTri(cluster.PrimitiveStart + gtid);
-		prims[gtid].PackedOutput = (gid << 8) | (gtid & 0x000000FF);
+		tri[gtid] = GetTri(GetClusterPrimitiveStart(cluster) + gtid);
+		prims[gtid].PackedOutput = (gid << VBUFFER_PRIMITIVE_BITS) | (gtid & VBUFFER_PRIMITIVE_MASK);
 	}
     
 	if (gtid < cluster.VertexCount)
 	{
-		float3 vert = GetPosition(cluster.VertexStart + gtid);
+		float3 vert = GetPosition(cluster, gtid);
 
 		float4 transformedVert = mul(instance.ModelMatrix, float4(vert, 1.0));
 
@@ -91,7 +91,7 @@ void Miss(inout RayPayload payload)
 [shader("closesthit")]
 void ClosestHit(inout RayPayload payload, BuiltInTriangleIntersectionAttributes attribs)
 {
-    payload.vBufferValue = (InstanceID() << 8) | (PrimitiveIndex() & 0x000000FF);
+    payload.vBufferValue = (InstanceID() << VBUFFER_PRIMITIVE_BITS) | (PrimitiveIndex() & VBUFFER_PRIMITIVE_MASK);
 
     float4 hitPositionWorld = float4(WorldRayOrigin() + RayTCurrent() * WorldRayDirection(), 1.0);
     float4 hitPositionNDC = mul(constants.DrawingCamera.ViewProjectionMatrix, hitPositionWorld);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Render.h"
+#include "meshoptimizer.h"
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Quantized vertex streams, decoded by the matching functions in ShaderCommon.hlsl
+// position: 16 bit unorm xyz relative to the cluster box, padded to 8 bytes
+// normal: octahedral, 16 bit unorm per component
+// tangent: octahedral, 15 bit unorm per component with the bitangent sign in the top bit
+// texcoord: two half floats
+// That is 20 bytes per vertex instead of 48.
+
+struct QuantizedPosition
+{
+	uint16_t x, y, z, w;
+};
+
+inline float2 OctahedralEncode(float3 n)
+{
+	float2 p = float2(n.x, n.y) * (1.0f / (fabsf(n.x) + fabsf(n.y) + fabsf(n.z)));
+	if (n.z < 0.0f)
+	{
+		float2 signs = float2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+		p = float2((1.0f - fabsf(p.y)) * signs.x, (1.0f - fabsf(p.x)) * signs.y);
+	}
+	return p;
+}
+
+inline float3 OctahedralDecode(float2 p)
+{
+	float3 n = float3(p.x, p.y, 1.0f - fabsf(p.x) - fabsf(p.y));
+	float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+inline QuantizedPosition EncodePosition(float3 pos, const CenterExtentsAABB& box)
+{
+	float3 boxMin = box.Center - box.Extents;
+	float3 boxSize = box.Extents * 2.0f;
+
+	auto encode = [](float v, float start, float size) { return (uint16_t)meshopt_quantizeUnorm(size > 0.0f ? std::clamp((v - start) / size, 0.0f, 1.0f) : 0.0f, 16); };
+	return QuantizedPosition{ encode(pos.x, boxMin.x, boxSize.x), encode(pos.y, boxMin.y, boxSize.y), encode(pos.z, boxMin.z, boxSize.z), 0 };
+}
+
+inline float3 DecodePosition(QuantizedPosition pos, const CenterExtentsAABB& box)
+{
+	float3 boxMin = box.Center - box.Extents;
+	float3 boxSize = box.Extents * 2.0f;
+	return boxMin + float3(pos.x, pos.y, pos.z) * (1.0f / 65535.0f) * boxSize;
+}
+
+inline uint32_t EncodeNormal(float3 normal)
+{
+	if (dot(normal, normal) == 0.0f)
+		normal = float3(0.0f, 0.0f, 1.0f);
+
+	float2 p = OctahedralEncode(normal);
+	return uint32_t(meshopt_quantizeUnorm(p.x * 0.5f + 0.5f, 16)) | uint32_t(meshopt_quantizeUnorm(p.y * 0.5f + 0.5f, 16)) << 16;
+}
+
+inline float3 DecodeNormal(uint32_t packed)
+{
+	float2 p = float2(float(packed & 0xffff), float(packed >> 16)) * (2.0f / 65535.0f) - float2(1.0f, 1.0f);
+	return OctahedralDecode(p);
+}
+
+inline uint32_t EncodeTangent(float4 tangent)
+{
+	float3 t = float3(tangent.x, tangent.y, tangent.z);
+	if (dot(t, t) == 0.0f)
+		t = float3(1.0f, 0.0f, 0.0f);
+
+	float2 p = OctahedralEncode(t);
+	uint32_t sign = tangent.w < 0.0f ? 1 : 0;
+	return uint32_t(meshopt_quantizeUnorm(p.x * 0.5f + 0.5f, 15)) | uint32_t(meshopt_quantizeUnorm(p.y * 0.5f + 0.5f, 15)) << 15 | sign << 31;
+}
+
+inline float4 DecodeTangent(uint32_t packed)
+{
+	float2 p = float2(float(packed & 0x7fff), float((packed >> 15) & 0x7fff)) * (2.0f / 32767.0f) - float2(1.0f, 1.0f);
+	return float4(OctahedralDecode(p), (packed >> 31) ? -1.0f : 1.0f);
+}
+
+inline uint32_t EncodeTexcoord(float2 texcoord)
+{
+	return uint32_t(meshopt_quantizeHalf(texcoord.x)) | uint32_t(meshopt_quantizeHalf(texcoord.y)) << 16;
+}
+
+inline float2 DecodeTexcoord(uint32_t packed)
+{
+	return float2(meshopt_dequantizeHalf(packed & 0xffff), meshopt_dequantizeHalf(packed >> 16));
+}
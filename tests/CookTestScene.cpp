@@ -0,0 +1,96 @@
+// Writes the scene the ctest cooks: a rolling terrain of <size> x <size> quads in one glTF primitive, positions and
+// 32 bit indices in an external buffer next to it. Large enough sizes get split into chunks by -budget.
+// cook_test_scene <file.gltf> <size>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	if (argc < 3 || atoi(argv[2]) <= 0)
+	{
+		printf("Usage: cook_test_scene <file.gltf> <size>\n");
+		return 1;
+	}
+
+	std::string gltfPath = argv[1];
+	uint32_t size = (uint32_t)atoi(argv[2]);
+	uint32_t vertexCount = (size + 1) * (size + 1);
+	uint32_t indexCount = size * size * 6;
+
+	std::vector<float> positions;
+	positions.reserve(vertexCount * 3);
+	float minHeight = 0.0f, maxHeight = 0.0f;
+	for (uint32_t y = 0; y <= size; ++y)
+	{
+		for (uint32_t x = 0; x <= size; ++x)
+		{
+			float height = 4.0f * sinf(x * 0.11f) * cosf(y * 0.07f) + sinf((x + y) * 0.5f);
+			minHeight = std::min(minHeight, height);
+			maxHeight = std::max(maxHeight, height);
+			positions.insert(positions.end(), { (float)x, height, (float)y });
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	indices.reserve(indexCount);
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			uint32_t v = y * (size + 1) + x;
+			indices.insert(indices.end(), { v, v + size + 1, v + 1, v + 1, v + size + 1, v + size + 2 });
+		}
+	}
+
+	// The buffer goes next to the glTF under the same name
+	std::string binPath = gltfPath.substr(0, gltfPath.find_last_of('.')) + ".bin";
+	std::string binName = binPath.substr(binPath.find_last_of("/\\") + 1);
+	size_t positionBytes = positions.size() * sizeof(float);
+	size_t indexBytes = indices.size() * sizeof(uint32_t);
+
+	FILE* bin = fopen(binPath.c_str(), "wb");
+	if (!bin)
+	{
+		printf("Could not write %s\n", binPath.c_str());
+		return 1;
+	}
+	bool binWritten = fwrite(positions.data(), 1, positionBytes, bin) == positionBytes && fwrite(indices.data(), 1, indexBytes, bin) == indexBytes;
+	binWritten = fclose(bin) == 0 && binWritten;
+
+	FILE* gltf = fopen(gltfPath.c_str(), "w");
+	if (!binWritten || !gltf)
+	{
+		printf("Could not write %s\n", gltf ? binPath.c_str() : gltfPath.c_str());
+		return 1;
+	}
+	fprintf(gltf,
+		"{\n"
+		"  \"asset\": { \"version\": \"2.0\" },\n"
+		"  \"scene\": 0,\n"
+		"  \"scenes\": [ { \"nodes\": [ 0 ] } ],\n"
+		"  \"nodes\": [ { \"mesh\": 0 } ],\n"
+		"  \"meshes\": [ { \"primitives\": [ { \"attributes\": { \"POSITION\": 0 }, \"indices\": 1 } ] } ],\n"
+		"  \"accessors\": [\n"
+		"    { \"bufferView\": 0, \"componentType\": 5126, \"count\": %u, \"type\": \"VEC3\", \"min\": [ 0, %.9g, 0 ], \"max\": [ %u, %.9g, %u ] },\n"
+		"    { \"bufferView\": 1, \"componentType\": 5125, \"count\": %u, \"type\": \"SCALAR\" }\n"
+		"  ],\n"
+		"  \"bufferViews\": [\n"
+		"    { \"buffer\": 0, \"byteOffset\": 0, \"byteLength\": %zu, \"target\": 34962 },\n"
+		"    { \"buffer\": 0, \"byteOffset\": %zu, \"byteLength\": %zu, \"target\": 34963 }\n"
+		"  ],\n"
+		"  \"buffers\": [ { \"uri\": \"%s\", \"byteLength\": %zu } ]\n"
+		"}\n",
+		vertexCount, minHeight, size, maxHeight, size, indexCount, positionBytes, positionBytes, indexBytes, binName.c_str(), positionBytes + indexBytes);
+	if (fclose(gltf) != 0)
+	{
+		printf("Could not write %s\n", gltfPath.c_str());
+		return 1;
+	}
+	return 0;
+}
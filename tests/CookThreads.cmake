@@ -0,0 +1,23 @@
+# Cooks the test scene with -threads 1 and -threads 4 and fails unless both scene files are the same byte for byte
+# cmake -DCOOKER=<cooker> -DSCENE_TOOL=<cook_test_scene> -DWORK=<directory> [-DCOOK_OPTIONS=<options>] -P CookThreads.cmake
+
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+execute_process(COMMAND ${SCENE_TOOL} ${WORK}/grid.gltf 160 RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "cook_test_scene failed")
+endif()
+
+separate_arguments(COOK_OPTIONS)
+foreach(threads 1 4)
+	execute_process(COMMAND ${COOKER} -threads ${threads} ${COOK_OPTIONS} -out ${WORK}/threads${threads} ${WORK}/grid.gltf
+		RESULT_VARIABLE result OUTPUT_QUIET)
+	if(NOT result EQUAL 0)
+		message(FATAL_ERROR "Cooking with ${threads} threads failed, see ${WORK}/threads${threads}/grid/cook.log")
+	endif()
+endforeach()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK}/threads1/grid/scene.bin ${WORK}/threads4/grid/scene.bin RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "The scene cooked with 4 threads differs from the one cooked with 1")
+endif()